@@ -0,0 +1,269 @@
+/* $Id$ */
+
+class Regression extends AIController {
+	errors = 0;
+
+	function Start();
+}
+
+/**
+ * Check that a list valuated by one of the native Valuate methods got the
+ *  same values as the same list valuated by a scripted Valuate.
+ */
+function Regression::CompareLists(name, native, scripted)
+{
+	local wrong = 0;
+	if (native.Count() != scripted.Count()) wrong++;
+	for (local i = native.Begin(); native.HasNext(); i = native.Next()) {
+		if (!scripted.HasItem(i) || native.GetValue(i) != scripted.GetValue(i)) wrong++;
+	}
+
+	if (wrong == 0) {
+		print("  " + name + ": OK");
+	} else {
+		print("  " + name + ": FAILED (" + wrong + " wrong values)");
+		this.errors++;
+	}
+}
+
+function Regression::StaleValue(item)
+{
+	return 0x1234567;
+}
+
+/**
+ * Give every item of a list a value no valuator gives, so values that a
+ *  native valuator forgot to overwrite stand out.
+ */
+function Regression::Scramble(list)
+{
+	list.Valuate(Regression.StaleValue);
+	return list;
+}
+
+function Regression::NewTileList()
+{
+	local list = AITileList();
+	list.AddRectangle(AIMap.GetTileIndex(8, 8), AIMap.GetTileIndex(40, 40));
+	return list;
+}
+
+function Regression::TileList(cargo)
+{
+	local tile = AIMap.GetTileIndex(20, 20);
+	local native, scripted;
+
+	print("");
+	print("--TileList NativeValuate--");
+
+	native = this.Scramble(this.NewTileList());
+	scripted = this.NewTileList();
+	native.ValuateDistanceManhattanToTile(tile);
+	scripted.Valuate(AITile.GetDistanceManhattanToTile, tile);
+	this.CompareLists("ValuateDistanceManhattanToTile", native, scripted);
+
+	native = this.Scramble(this.NewTileList());
+	scripted = this.NewTileList();
+	native.ValuateDistanceSquareToTile(tile);
+	scripted.Valuate(AITile.GetDistanceSquareToTile, tile);
+	this.CompareLists("ValuateDistanceSquareToTile", native, scripted);
+
+	native = this.Scramble(this.NewTileList());
+	scripted = this.NewTileList();
+	native.ValuateBuildable();
+	scripted.Valuate(AITile.IsBuildable);
+	this.CompareLists("ValuateBuildable", native, scripted);
+
+	native = this.Scramble(this.NewTileList());
+	scripted = this.NewTileList();
+	native.ValuateSlope();
+	scripted.Valuate(AITile.GetSlope);
+	this.CompareLists("ValuateSlope", native, scripted);
+
+	native = this.Scramble(this.NewTileList());
+	scripted = this.NewTileList();
+	native.ValuateOwner();
+	scripted.Valuate(AITile.GetOwner);
+	this.CompareLists("ValuateOwner", native, scripted);
+
+	native = this.Scramble(this.NewTileList());
+	scripted = this.NewTileList();
+	native.ValuateCargoAcceptance(cargo, 1, 1, 3);
+	scripted.Valuate(AITile.GetCargoAcceptance, cargo, 1, 1, 3);
+	this.CompareLists("ValuateCargoAcceptance", native, scripted);
+
+	native = this.Scramble(this.NewTileList());
+	scripted = this.NewTileList();
+	native.ValuateCargoAcceptance(255, 1, 1, 3);
+	scripted.Valuate(AITile.GetCargoAcceptance, 255, 1, 1, 3);
+	this.CompareLists("ValuateCargoAcceptance (invalid cargo)", native, scripted);
+
+	native = this.Scramble(this.NewTileList());
+	scripted = this.NewTileList();
+	native.ValuateCargoProduction(cargo, 1, 1, 3);
+	scripted.Valuate(AITile.GetCargoProduction, cargo, 1, 1, 3);
+	this.CompareLists("ValuateCargoProduction", native, scripted);
+
+	native = this.Scramble(this.NewTileList());
+	scripted = this.NewTileList();
+	native.ValuateCargoProduction(255, 1, 1, 3);
+	scripted.Valuate(AITile.GetCargoProduction, 255, 1, 1, 3);
+	this.CompareLists("ValuateCargoProduction (invalid cargo)", native, scripted);
+}
+
+function Regression::IndustryList(cargo)
+{
+	local tile = AIMap.GetTileIndex(20, 20);
+	local native, scripted;
+
+	print("");
+	print("--IndustryList NativeValuate--");
+
+	native = this.Scramble(AIIndustryList());
+	scripted = AIIndustryList();
+	native.ValuateDistanceManhattanToTile(tile);
+	scripted.Valuate(AIIndustry.GetDistanceManhattanToTile, tile);
+	this.CompareLists("ValuateDistanceManhattanToTile", native, scripted);
+
+	native = this.Scramble(AIIndustryList());
+	scripted = AIIndustryList();
+	native.ValuateDistanceSquareToTile(tile);
+	scripted.Valuate(AIIndustry.GetDistanceSquareToTile, tile);
+	this.CompareLists("ValuateDistanceSquareToTile", native, scripted);
+
+	native = this.Scramble(AIIndustryList());
+	scripted = AIIndustryList();
+	native.ValuateLastMonthProduction(cargo);
+	scripted.Valuate(AIIndustry.GetLastMonthProduction, cargo);
+	this.CompareLists("ValuateLastMonthProduction", native, scripted);
+
+	native = this.Scramble(AIIndustryList());
+	scripted = AIIndustryList();
+	native.ValuateLastMonthProduction(255);
+	scripted.Valuate(AIIndustry.GetLastMonthProduction, 255);
+	this.CompareLists("ValuateLastMonthProduction (invalid cargo)", native, scripted);
+
+	native = this.Scramble(AIIndustryList());
+	scripted = AIIndustryList();
+	native.ValuateCargoAccepted(cargo);
+	scripted.Valuate(AIIndustry.IsCargoAccepted, cargo);
+	this.CompareLists("ValuateCargoAccepted", native, scripted);
+
+	native = this.Scramble(AIIndustryList());
+	scripted = AIIndustryList();
+	native.ValuateCargoAccepted(255);
+	scripted.Valuate(AIIndustry.IsCargoAccepted, 255);
+	this.CompareLists("ValuateCargoAccepted (invalid cargo)", native, scripted);
+
+	native = this.Scramble(AIIndustryList());
+	scripted = AIIndustryList();
+	native.ValuateAmountOfStationsAround();
+	scripted.Valuate(AIIndustry.GetAmountOfStationsAround);
+	this.CompareLists("ValuateAmountOfStationsAround", native, scripted);
+}
+
+function Regression::StationList(cargo)
+{
+	local tile = AIMap.GetTileIndex(20, 20);
+	local native, scripted;
+
+	print("");
+	print("--StationList NativeValuate--");
+
+	native = this.Scramble(AIStationList(AIStation.STATION_ANY));
+	scripted = AIStationList(AIStation.STATION_ANY);
+	native.ValuateDistanceManhattanToTile(tile);
+	scripted.Valuate(AIStation.GetDistanceManhattanToTile, tile);
+	this.CompareLists("ValuateDistanceManhattanToTile", native, scripted);
+
+	native = this.Scramble(AIStationList(AIStation.STATION_ANY));
+	scripted = AIStationList(AIStation.STATION_ANY);
+	native.ValuateDistanceSquareToTile(tile);
+	scripted.Valuate(AIStation.GetDistanceSquareToTile, tile);
+	this.CompareLists("ValuateDistanceSquareToTile", native, scripted);
+
+	native = this.Scramble(AIStationList(AIStation.STATION_ANY));
+	scripted = AIStationList(AIStation.STATION_ANY);
+	native.ValuateCargoWaiting(cargo);
+	scripted.Valuate(AIStation.GetCargoWaiting, cargo);
+	this.CompareLists("ValuateCargoWaiting", native, scripted);
+
+	native = this.Scramble(AIStationList(AIStation.STATION_ANY));
+	scripted = AIStationList(AIStation.STATION_ANY);
+	native.ValuateCargoWaiting(255);
+	scripted.Valuate(AIStation.GetCargoWaiting, 255);
+	this.CompareLists("ValuateCargoWaiting (invalid cargo)", native, scripted);
+
+	native = this.Scramble(AIStationList(AIStation.STATION_ANY));
+	scripted = AIStationList(AIStation.STATION_ANY);
+	native.ValuateCargoRating(cargo);
+	scripted.Valuate(AIStation.GetCargoRating, cargo);
+	this.CompareLists("ValuateCargoRating", native, scripted);
+
+	native = this.Scramble(AIStationList(AIStation.STATION_ANY));
+	scripted = AIStationList(AIStation.STATION_ANY);
+	native.ValuateCargoRating(255);
+	scripted.Valuate(AIStation.GetCargoRating, 255);
+	this.CompareLists("ValuateCargoRating (invalid cargo)", native, scripted);
+}
+
+function Regression::TownList(cargo)
+{
+	local tile = AIMap.GetTileIndex(20, 20);
+	local native, scripted;
+
+	print("");
+	print("--TownList NativeValuate--");
+
+	native = this.Scramble(AITownList());
+	scripted = AITownList();
+	native.ValuateDistanceManhattanToTile(tile);
+	scripted.Valuate(AITown.GetDistanceManhattanToTile, tile);
+	this.CompareLists("ValuateDistanceManhattanToTile", native, scripted);
+
+	native = this.Scramble(AITownList());
+	scripted = AITownList();
+	native.ValuateDistanceSquareToTile(tile);
+	scripted.Valuate(AITown.GetDistanceSquareToTile, tile);
+	this.CompareLists("ValuateDistanceSquareToTile", native, scripted);
+
+	native = this.Scramble(AITownList());
+	scripted = AITownList();
+	native.ValuatePopulation();
+	scripted.Valuate(AITown.GetPopulation);
+	this.CompareLists("ValuatePopulation", native, scripted);
+
+	native = this.Scramble(AITownList());
+	scripted = AITownList();
+	native.ValuateLastMonthProduction(cargo);
+	scripted.Valuate(AITown.GetLastMonthProduction, cargo);
+	this.CompareLists("ValuateLastMonthProduction", native, scripted);
+
+	native = this.Scramble(AITownList());
+	scripted = AITownList();
+	native.ValuateLastMonthProduction(255);
+	scripted.Valuate(AITown.GetLastMonthProduction, 255);
+	this.CompareLists("ValuateLastMonthProduction (invalid cargo)", native, scripted);
+}
+
+function Regression::Start()
+{
+	local cargo = AICargoList().Begin();
+
+	this.TileList(cargo);
+	this.IndustryList(cargo);
+	this.StationList(cargo);
+	this.TownList(cargo);
+
+	print("");
+	if (this.errors == 0) {
+		print("Regression test passed");
+	} else {
+		print("Regression test failed: " + this.errors + " errors");
+	}
+
+	/* Don't let the AI end, as that would be reported as a crash */
+	while (true) {
+		this.Sleep(1000);
+	}
+}
@@ -0,0 +1,45 @@
+#!/bin/sh
+
+# $Id$
+
+if ! [ -f ai/regression/regression.nut ]; then
+	echo "Make sure you are in the bin directory of OpenTTD before starting this script."
+	exit 1
+fi
+
+cp ai/regression/regression.nut ai/regression/main.nut
+cp ai/regression/regression_info.nut ai/regression/info.nut
+
+if [ -f scripts/game_start.scr ]; then
+	mv scripts/game_start.scr scripts/game_start.scr.regression
+fi
+
+params=""
+gdb=""
+if [ "$1" != "-r" ]; then
+	params="-snull -mnull -vnull:ticks=3000"
+fi
+if [ "$1" = "-g" ]; then
+	gdb="gdb --ex run --args "
+fi
+
+$gdb ./openttd -x -c ai/regression/regression.cfg $params -g -G 1 -d ai=2 2>&1 | tee tmp.regression
+
+ret=0
+if [ -z "$gdb" ]; then
+	if grep -q "FAILED\|\[S\]\|died" tmp.regression || ! grep -q "Regression test passed" tmp.regression; then
+		echo "Regression test failed!"
+		ret=1
+	else
+		echo "Regression test passed!"
+	fi
+	rm -f tmp.regression
+fi
+
+rm -f ai/regression/main.nut ai/regression/info.nut
+
+if [ -f scripts/game_start.scr.regression ]; then
+	mv scripts/game_start.scr.regression scripts/game_start.scr
+fi
+
+exit $ret
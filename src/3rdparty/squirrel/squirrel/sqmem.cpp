@@ -2,8 +2,12 @@
 	see copyright notice in squirrel.h
 */
 #include "sqpcheader.h"
-void *sq_vm_malloc(SQUnsignedInteger size){	return malloc(size); }
 
-void *sq_vm_realloc(void *p, SQUnsignedInteger oldsize, SQUnsignedInteger size){ return realloc(p, size); }
+/* OpenTTD: keep track of the memory the VMs use, so it can be accounted to the AIs */
+SQInteger _sq_vm_allocated = 0;
 
-void sq_vm_free(void *p, SQUnsignedInteger size){	free(p); }
+void *sq_vm_malloc(SQUnsignedInteger size){	_sq_vm_allocated += size; return malloc(size); }
+
+void *sq_vm_realloc(void *p, SQUnsignedInteger oldsize, SQUnsignedInteger size){ _sq_vm_allocated += size - oldsize; return realloc(p, size); }
+
+void sq_vm_free(void *p, SQUnsignedInteger size){	_sq_vm_allocated -= size; free(p); }
@@ -11,6 +11,9 @@
 
 typedef std::map<const char *, class AIInfo *, StringCompare> AIInfoList;
 
+/** Callback for AI::PrintStats; gets called with every line of the output. */
+typedef void AIStatsPrintProc(const char *s);
+
 
 void CcAI(bool success, TileIndex tile, uint32 p1, uint32 p2);
 
@@ -104,6 +107,25 @@ public:
 	 */
 	static int GetStartNextTime();
 
+	/**
+	 * Print the resources used by all AIs and, for the AIs being
+	 *  profiled, the script functions that took the most time.
+	 * @param proc The function to print every line with.
+	 */
+	static void PrintStats(AIStatsPrintProc *proc);
+
+	/**
+	 * Reset the resources used by all AIs and their profiles.
+	 */
+	static void ResetStats();
+
+	/**
+	 * Start or stop the sampling profiler of an AI.
+	 * @param company The company of the AI.
+	 * @param interval The number of opcodes between two samples, or 0 to stop profiling.
+	 */
+	static void SetProfileInterval(CompanyID company, uint interval);
+
 	static char *GetConsoleList(char *p, const char *last);
 	static const AIInfoList *GetInfoList();
 	static const AIInfoList *GetUniqueInfoList();
@@ -11,11 +11,15 @@
 #include "../settings_type.h"
 #include "../window_func.h"
 #include "../command_func.h"
+#include "../state_hash.h"
 #include "ai.hpp"
 #include "ai_scanner.hpp"
 #include "ai_instance.hpp"
 #include "ai_config.hpp"
 
+#include <vector>
+#include <algorithm>
+
 /* static */ uint AI::frame_counter = 0;
 /* static */ AIScanner *AI::ai_scanner = NULL;
 
@@ -55,6 +59,8 @@
 {
 	/* If we are in networking, only servers run this function, and that only if it is allowed */
 	if (_networking && (!_network_server || !_settings_game.ai.ai_in_multiplayer)) return;
+	/* When replaying a command log the commands of the AIs come from the log */
+	if (_replaying_commands) return;
 
 	/* The speed with which AIs go, is limited by the 'competitor_speed' */
 	AI::frame_counter++;
@@ -265,6 +271,84 @@ void CcAI(bool success, TileIndex tile, uint32 p1, uint32 p2)
 	return DAYS_IN_YEAR;
 }
 
+/** The number of script functions of a profile that are printed. */
+static const uint AI_PROFILE_PRINT_ENTRIES = 20;
+
+/** Sorts profile entries on the time spent in them, most first. */
+static bool AIProfileSorter(AIProfile::const_iterator a, AIProfile::const_iterator b)
+{
+	return a->second.us > b->second.us;
+}
+
+/* static */ void AI::PrintStats(AIStatsPrintProc *proc)
+{
+	char buf[256];
+
+	proc("---- AI stats start ----");
+
+	const Company *c;
+	FOR_ALL_COMPANIES(c) {
+		if (IsHumanCompany(c->index)) continue;
+
+		/* Clients do not run the AIs */
+		AIInstance *instance = c->ai_instance;
+		if (instance == NULL) continue;
+
+		const AIInstanceStats *stats = instance->GetStats();
+
+		snprintf(buf, lengthof(buf), "Company %d: %s, version %d", c->index + 1, c->ai_info->GetName(), c->ai_info->GetVersion());
+		proc(buf);
+		snprintf(buf, lengthof(buf), "  script:  %" OTTD_PRINTF64 "u ms in %u runs, %" OTTD_PRINTF64 "u opcodes, %u commands",
+				stats->resume_us / 1000, stats->resumes, stats->opcodes, stats->commands);
+		proc(buf);
+		snprintf(buf, lengthof(buf), "  garbage: %" OTTD_PRINTF64 "u ms in %u runs",
+				stats->gc_us / 1000, stats->gc_runs);
+		proc(buf);
+		snprintf(buf, lengthof(buf), "  memory:  %" OTTD_PRINTF64 "d KiB, peak %" OTTD_PRINTF64 "d KiB",
+				stats->memory / 1024, stats->peak_memory / 1024);
+		proc(buf);
+
+		const AIProfile *profile = instance->GetProfile();
+		if (profile->empty()) continue;
+
+		std::vector<AIProfile::const_iterator> entries;
+		uint64 total = 0;
+		for (AIProfile::const_iterator it = profile->begin(); it != profile->end(); it++) {
+			entries.push_back(it);
+			total += it->second.us;
+		}
+		std::sort(entries.begin(), entries.end(), &AIProfileSorter);
+
+		if (instance->GetProfileInterval() == 0) {
+			proc("  profile, stopped:");
+		} else {
+			snprintf(buf, lengthof(buf), "  profile, a sample every %u opcodes:", instance->GetProfileInterval());
+			proc(buf);
+		}
+		for (uint i = 0; i < entries.size() && i < AI_PROFILE_PRINT_ENTRIES; i++) {
+			const AIProfileEntry *entry = &entries[i]->second;
+			snprintf(buf, lengthof(buf), "  %5.1f%% %8u samples %10" OTTD_PRINTF64 "u ms  %s",
+					total == 0 ? 0.0 : entry->us * 100.0 / total, entry->samples, entry->us / 1000, entries[i]->first);
+			proc(buf);
+		}
+	}
+
+	proc("---- AI stats end ----");
+}
+
+/* static */ void AI::ResetStats()
+{
+	const Company *c;
+	FOR_ALL_COMPANIES(c) {
+		if (!IsHumanCompany(c->index) && c->ai_instance != NULL) c->ai_instance->ResetStats();
+	}
+}
+
+/* static */ void AI::SetProfileInterval(CompanyID company, uint interval)
+{
+	GetCompany(company)->ai_instance->SetProfileInterval(interval);
+}
+
 /* static */ char *AI::GetConsoleList(char *p, const char *last)
 {
 	return AI::ai_scanner->GetAIConsoleList(p, last);
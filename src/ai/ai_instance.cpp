@@ -8,6 +8,7 @@
 #include "../vehicle_base.h"
 #include "../saveload/saveload.h"
 #include "../gui.h"
+#include "../string_func.h"
 #include "table/strings.h"
 
 #include <squirrel.h>
@@ -78,6 +79,28 @@
 
 /* static */ AIInstance *AIInstance::current_instance = NULL;
 
+extern uint64 ottd_microseconds();
+extern SQInteger _sq_vm_allocated;
+
+/**
+ * Accounts the memory that the VMs allocate while it exists to an AI. As
+ *  only one AI runs at a time, all memory allocated in between is its.
+ */
+class AIMemoryAccounting {
+public:
+	AIMemoryAccounting(AIInstanceStats *stats) : stats(stats), start(_sq_vm_allocated) {}
+
+	~AIMemoryAccounting()
+	{
+		this->stats->memory += _sq_vm_allocated - this->start;
+		this->stats->peak_memory = max(this->stats->peak_memory, this->stats->memory);
+	}
+
+private:
+	AIInstanceStats *stats; ///< The stats to account the memory to
+	SQInteger start;        ///< The memory allocated by all VMs when accounting started
+};
+
 AIStorage::~AIStorage()
 {
 	/* Free our pointers */
@@ -99,8 +122,12 @@ AIInstance::AIInstance(AIInfo *info) :
 	is_started(false),
 	is_dead(false),
 	suspend(0),
-	callback(NULL)
+	callback(NULL),
+	profile_interval(0)
 {
+	memset(&this->stats, 0, sizeof(this->stats));
+	AIMemoryAccounting accounting(&this->stats);
+
 	/* Set the instance already, so we can use AIObject::Set commands */
 	GetCompany(_current_company)->ai_instance = this;
 	AIInstance::current_instance = this;
@@ -148,6 +175,10 @@ AIInstance::~AIInstance()
 	delete this->storage;
 	delete this->controller;
 	free(this->instance);
+
+	for (AIProfile::iterator it = this->profile.begin(); it != this->profile.end(); it++) {
+		free((void *)it->first);
+	}
 }
 
 void AIInstance::RegisterAPI()
@@ -274,6 +305,8 @@ void AIInstance::GameLoop()
 	if (this->suspend   < 0)  return;          // Multiplayer suspend, wait for Continue().
 	if (--this->suspend > 0)  return;          // Singleplayer suspend, decrease to 0.
 
+	AIMemoryAccounting accounting(&this->stats);
+
 	/* If there is a callback to call, call that first */
 	if (this->callback != NULL) {
 		try {
@@ -304,23 +337,100 @@ void AIInstance::GameLoop()
 			this->suspend  = e.GetSuspendTime();
 			this->callback = e.GetSuspendCallback();
 		}
+		if (this->engine != NULL) this->stats.opcodes += _settings_game.ai.ai_max_opcode_till_suspend - this->engine->GetOpsTillSuspend();
 
 		this->is_started = true;
 		return;
 	}
 
 	/* Continue the VM */
+	uint64 start = ottd_microseconds();
+	this->stats.resumes++;
 	try {
-		if (!this->engine->Resume(_settings_game.ai.ai_max_opcode_till_suspend)) this->Died();
+		int ops = _settings_game.ai.ai_max_opcode_till_suspend;
+		if (!(this->profile_interval != 0 ? this->ResumeProfiled(ops) : this->Resume(ops))) this->Died();
 	} catch (AI_VMSuspend e) {
 		this->suspend  = e.GetSuspendTime();
 		this->callback = e.GetSuspendCallback();
 	}
+	this->stats.resume_us += ottd_microseconds() - start;
+}
+
+bool AIInstance::Resume(int suspend)
+{
+	try {
+		bool suspended = this->engine->Resume(suspend);
+		this->stats.opcodes += suspend - this->engine->GetOpsTillSuspend();
+		return suspended;
+	} catch (AI_VMSuspend e) {
+		this->stats.opcodes += suspend - this->engine->GetOpsTillSuspend();
+		throw;
+	}
+}
+
+bool AIInstance::ResumeProfiled(int suspend)
+{
+	for (;;) {
+		int slice = min(suspend, (int)this->profile_interval);
+		uint64 start = ottd_microseconds();
+		try {
+			if (!this->Resume(slice)) return false;
+		} catch (AI_VMSuspend e) {
+			this->AddProfileSample(ottd_microseconds() - start);
+			throw;
+		}
+		this->AddProfileSample(ottd_microseconds() - start);
+
+		/* The VM suspends by itself only when it ran out of opcodes */
+		suspend -= slice - this->engine->GetOpsTillSuspend();
+		if (suspend <= 0) return true;
+	}
+}
+
+void AIInstance::AddProfileSample(uint64 us)
+{
+	SQStackInfos si;
+	char name[128];
+	if (SQ_SUCCEEDED(sq_stackinfos(this->engine->GetVM(), 0, &si))) {
+		char *p = strecpy(name, si.funcname == NULL ? "(anonymous)" : FS2OTTD(si.funcname), lastof(name));
+		p = strecpy(p, " (", lastof(name));
+		p = strecpy(p, si.source == NULL ? "unknown" : FS2OTTD(si.source), lastof(name));
+		strecpy(p, ")", lastof(name));
+	} else {
+		strecpy(name, "(unknown)", lastof(name));
+	}
+
+	AIProfile::iterator it = this->profile.find(name);
+	if (it == this->profile.end()) {
+		AIProfileEntry entry = { 0, 0 };
+		it = this->profile.insert(AIProfile::value_type(strdup(name), entry)).first;
+	}
+	it->second.samples++;
+	it->second.us += us;
+}
+
+void AIInstance::ResetStats()
+{
+	int64 memory = this->stats.memory;
+	memset(&this->stats, 0, sizeof(this->stats));
+	this->stats.memory = memory;
+	this->stats.peak_memory = memory;
+
+	for (AIProfile::iterator it = this->profile.begin(); it != this->profile.end(); it++) {
+		free((void *)it->first);
+	}
+	this->profile.clear();
 }
 
 void AIInstance::CollectGarbage()
 {
-	if (this->is_started && !this->is_dead) this->engine->CollectGarbage();
+	if (!this->is_started || this->is_dead) return;
+
+	AIMemoryAccounting accounting(&this->stats);
+	uint64 start = ottd_microseconds();
+	this->engine->CollectGarbage();
+	this->stats.gc_us += ottd_microseconds() - start;
+	this->stats.gc_runs++;
 }
 
 /* static */ void AIInstance::DoCommandReturn(AIInstance *instance)
@@ -349,6 +459,12 @@ void AIInstance::CollectGarbage()
 	return GetCompany(_current_company)->ai_instance->storage;
 }
 
+/* static */ AIInstanceStats *AIInstance::GetCurrentStats()
+{
+	assert(IsValidCompanyID(_current_company) && !IsHumanCompany(_current_company));
+	return &GetCompany(_current_company)->ai_instance->stats;
+}
+
 /*
  * All data is stored in the following format:
  * First 1 byte indicating if there is a data blob at all.
@@ -519,6 +635,8 @@ enum {
 
 void AIInstance::Save()
 {
+	AIMemoryAccounting accounting(&this->stats);
+
 	/* Don't save data if the AI didn't start yet or if it crashed. */
 	if (this->engine == NULL || this->engine->HasScriptCrashed()) {
 		SaveEmpty();
@@ -644,6 +762,8 @@ void AIInstance::Save()
 
 void AIInstance::Load(int version)
 {
+	AIMemoryAccounting accounting(&this->stats);
+
 	if (this->engine == NULL || version == -1) {
 		LoadEmpty();
 		return;
@@ -5,6 +5,9 @@
 #ifndef AI_INSTANCE_HPP
 #define AI_INSTANCE_HPP
 
+#include <map>
+#include "../core/string_compare_type.hpp"
+
 /**
  * The callback function when an AI suspends.
  */
@@ -28,6 +31,30 @@ private:
 	AISuspendCallbackProc *callback;
 };
 
+/**
+ * The resources an AI used since it started, to find out which AI takes up
+ *  the time of the game. Times are in microseconds.
+ */
+struct AIInstanceStats {
+	uint64 resume_us;     ///< Microseconds spent in running the script
+	uint64 gc_us;         ///< Microseconds spent in collecting garbage
+	uint64 opcodes;       ///< The number of opcodes the script ran
+	uint32 resumes;       ///< The number of times the script was run
+	uint32 gc_runs;       ///< The number of garbage collections
+	uint32 commands;      ///< The number of DoCommands the script issued
+	int64 memory;         ///< The amount of memory allocated by the VM, in bytes
+	int64 peak_memory;    ///< The highest amount of memory allocated by the VM, in bytes
+};
+
+/** The samples the profiler took in a single script function. */
+struct AIProfileEntry {
+	uint samples;  ///< The number of samples taken in the function
+	uint64 us;     ///< The microseconds spent in the slices that ended in the function
+};
+
+/** The profile of an AI; a mapping of 'function (source file)' to its samples. */
+typedef std::map<const char *, AIProfileEntry, StringCompare> AIProfile;
+
 class AIInstance {
 public:
 	AIInstance(class AIInfo *info);
@@ -54,6 +81,11 @@ public:
 	 */
 	static class AIStorage *GetStorage();
 
+	/**
+	 * Get the resources used by the AI that is running now.
+	 */
+	static AIInstanceStats *GetCurrentStats();
+
 	/**
 	 * Return a true/false reply for a DoCommand.
 	 */
@@ -107,6 +139,33 @@ public:
 	 */
 	static void LoadEmpty();
 
+	/**
+	 * Get the resources this AI used.
+	 */
+	AIInstanceStats *GetStats() { return &this->stats; }
+
+	/**
+	 * Get the profile the sampling profiler collected for this AI.
+	 */
+	const AIProfile *GetProfile() { return &this->profile; }
+
+	/**
+	 * Start or stop the sampling profiler.
+	 * @param interval The number of opcodes between two samples, or 0 to stop profiling.
+	 */
+	void SetProfileInterval(uint interval) { this->profile_interval = interval; }
+
+	/**
+	 * Get the number of opcodes between two samples of the profiler, 0 when it is not running.
+	 */
+	uint GetProfileInterval() { return this->profile_interval; }
+
+	/**
+	 * Reset the resources used by this AI and the collected profile. The
+	 *  memory of the VM is kept, as that memory is still in use.
+	 */
+	void ResetStats();
+
 private:
 	static class AIInstance *current_instance; //!< Static current AIInstance, so we can register AIs.
 
@@ -120,6 +179,31 @@ private:
 	int suspend;
 	AISuspendCallbackProc *callback;
 
+	AIInstanceStats stats;  ///< The resources used by this AI
+	AIProfile profile;      ///< The samples taken by the profiler
+	uint profile_interval;  ///< Opcodes between two profiler samples, 0 when not profiling
+
+	/**
+	 * Continue the VM and account the opcodes it ran.
+	 * @param suspend The number of opcodes the VM may run.
+	 * @return True when the VM is suspended, false when it stopped.
+	 */
+	bool Resume(int suspend);
+
+	/**
+	 * Continue the VM in slices of profile_interval opcodes, sampling
+	 *  the script function it is in at the end of every slice.
+	 * @param suspend The number of opcodes the VM may run.
+	 * @return True when the VM is suspended, false when it stopped.
+	 */
+	bool ResumeProfiled(int suspend);
+
+	/**
+	 * Add a sample of the script function the VM is in to the profile.
+	 * @param us The microseconds spent since the previous sample.
+	 */
+	void AddProfileSample(uint64 us);
+
 	/**
 	 * Register all API functions to the VM.
 	 */
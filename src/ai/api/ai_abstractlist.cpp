@@ -7,415 +7,364 @@
 #include "../../debug.h"
 #include "../../core/alloc_func.hpp"
 #include "../../script/squirrel.hpp"
+#include <algorithm>
 
 /**
- * Base class for any AIAbstractList sorter.
+ * Make the key of an entry in the order by value of an AIAbstractList.
+ * @param value the value of the entry.
+ * @param pos the position of the entry in the items of the list.
+ * @return the key; sorting the keys sorts by value first and by item second.
  */
-class AIAbstractListSorter {
-protected:
-	AIAbstractList *list;
-
-public:
-	/**
-	 * Virtual dtor, needed to mute warnings.
-	 */
-	virtual ~AIAbstractListSorter() { }
-
-	/**
-	 * Get the first item of the sorter.
-	 */
-	virtual int32 Begin() = 0;
-
-	/**
-	 * Stop iterating a sorter.
-	 */
-	virtual void End() = 0;
-
-	/**
-	 * Get the next item of the sorter.
-	 */
-	virtual int32 Next() = 0;
-
-	/**
-	 * See if there is a next item of the sorter.
-	 */
-	virtual bool HasNext() = 0;
-
-	/**
-	 * Callback from the list if an item gets removed.
-	 */
-	virtual void Remove(int item) = 0;
-};
+static inline uint64 MakeValueOrderKey(int32 value, size_t pos)
+{
+	return (uint64)((uint32)value ^ 0x80000000) << 32 | (uint32)pos;
+}
 
 /**
- * Sort by value, ascending.
+ * Walks the items of an AIAbstractList in the order of the sorter.
  */
-class AIAbstractListSorterValueAscending : public AIAbstractListSorter {
+class AIAbstractListSorter {
 private:
-	AIAbstractList::AIAbstractListBucket::iterator bucket_iter;
-	AIAbstractList::AIItemList *bucket_list;
-	AIAbstractList::AIItemList::iterator bucket_list_iter;
-	bool has_no_more_items;
-	int32 item_next;
-
-public:
-	AIAbstractListSorterValueAscending(AIAbstractList *list)
-	{
-		this->list = list;
-		this->End();
-	}
+	AIAbstractList *list;
+	AIAbstractList::SorterType type;
+	bool ascending;
+	bool has_no_more_items; ///< Whether the end of the list is passed.
+	bool at_end;            ///< Whether 'item_next' is the last item and already returned.
+	int32 item_next;        ///< The item that is returned next.
+	int32 value_next;       ///< The value 'item_next' had when it was found.
+	size_t index;           ///< The index of 'item_next' in the sort order.
+	uint generation;        ///< The generation of the list 'index' is valid for.
 
-	int32 Begin()
+	/**
+	 * Get the amount of entries in the sort order.
+	 */
+	size_t Size() const
 	{
-		if (this->list->buckets.empty()) return 0;
-		this->has_no_more_items = false;
-
-		this->bucket_iter = this->list->buckets.begin();
-		this->bucket_list = &(*this->bucket_iter).second;
-		this->bucket_list_iter = this->bucket_list->begin();
-		this->item_next = *this->bucket_list_iter;
-
-		int32 item_current = this->item_next;
-		FindNext();
-		return item_current;
+		return this->type == AIAbstractList::SORT_BY_ITEM ? this->list->items.size() : this->list->value_order.size();
 	}
 
-	void End()
+	/**
+	 * Get the position in the items of the list of an entry in the sort order.
+	 */
+	size_t Position(size_t index) const
 	{
-		this->bucket_list = NULL;
-		this->has_no_more_items = true;
-		this->item_next = 0;
+		return this->type == AIAbstractList::SORT_BY_ITEM ? index : (uint32)this->list->value_order[index];
 	}
 
-	void FindNext()
+	/**
+	 * Go one entry further in the sort order. Going beyond the first entry
+	 *  wraps 'index', so it ends up out of range just like after the last.
+	 */
+	void Step()
 	{
-		if (this->bucket_list == NULL) {
-			this->has_no_more_items = true;
-			return;
-		}
-
-		this->bucket_list_iter++;
-		if (this->bucket_list_iter == this->bucket_list->end()) {
-			this->bucket_iter++;
-			if (this->bucket_iter == this->list->buckets.end()) {
-				this->bucket_list = NULL;
-				return;
-			}
-			this->bucket_list = &(*this->bucket_iter).second;
-			this->bucket_list_iter = this->bucket_list->begin();
+		if (this->ascending) {
+			this->index++;
+		} else {
+			this->index--;
 		}
-		this->item_next = *this->bucket_list_iter;
-	}
-
-	int32 Next()
-	{
-		if (!this->HasNext()) return 0;
-
-		int32 item_current = this->item_next;
-		FindNext();
-		return item_current;
 	}
 
-	void Remove(int item)
+	/**
+	 * Find the first entry from 'index' on that is not removed and make it 'item_next'.
+	 * @return false if there is no such entry.
+	 */
+	bool SkipRemoved()
 	{
-		if (!this->HasNext()) return;
+		for (; this->index < this->Size(); this->Step()) {
+			size_t pos = this->Position(this->index);
+			if (this->list->removed[pos]) continue;
 
-		/* If we remove the 'next' item, skip to the next */
-		if (item == this->item_next) {
-			FindNext();
-			return;
+			this->item_next  = this->list->items[pos];
+			this->value_next = this->list->values[pos];
+			return true;
 		}
+		return false;
 	}
 
-	bool HasNext()
-	{
-		return !(this->list->buckets.empty() || this->has_no_more_items);
-	}
-};
-
-/**
- * Sort by value, descending.
- */
-class AIAbstractListSorterValueDescending : public AIAbstractListSorter {
-private:
-	AIAbstractList::AIAbstractListBucket::iterator bucket_iter;
-	AIAbstractList::AIItemList *bucket_list;
-	AIAbstractList::AIItemList::iterator bucket_list_iter;
-	bool has_no_more_items;
-	int32 item_next;
-
-public:
-	AIAbstractListSorterValueDescending(AIAbstractList *list)
-	{
-		this->list = list;
-		this->End();
-	}
-
-	int32 Begin()
-	{
-		if (this->list->buckets.empty()) return 0;
-		this->has_no_more_items = false;
-
-		/* Go to the end of the bucket-list */
-		this->bucket_iter = this->list->buckets.begin();
-		for (size_t i = this->list->buckets.size(); i > 1; i--) this->bucket_iter++;
-		this->bucket_list = &(*this->bucket_iter).second;
-
-		/* Go to the end of the items in the bucket */
-		this->bucket_list_iter = this->bucket_list->begin();
-		for (size_t i = this->bucket_list->size(); i > 1; i--) this->bucket_list_iter++;
-		this->item_next = *this->bucket_list_iter;
-
-		int32 item_current = this->item_next;
-		FindNext();
-		return item_current;
-	}
-
-	void End() {
-		this->bucket_list = NULL;
-		this->has_no_more_items = true;
-		this->item_next = 0;
-	}
-
-	void FindNext()
+	/**
+	 * Make sure 'index' is valid for the current entries of the list. When
+	 *  entries moved, 'item_next' is looked up again; if it is not in the
+	 *  list anymore, the item after it becomes 'item_next'.
+	 */
+	void Sync()
 	{
-		if (this->bucket_list == NULL) {
-			this->has_no_more_items = true;
-			return;
-		}
-
-		if (this->bucket_list_iter == this->bucket_list->begin()) {
-			if (this->bucket_iter == this->list->buckets.begin()) {
-				this->bucket_list = NULL;
-				return;
-			}
-			this->bucket_iter--;
-			this->bucket_list = &(*this->bucket_iter).second;
-			/* Go to the end of the items in the bucket */
-			this->bucket_list_iter = this->bucket_list->begin();
-			for (size_t i = this->bucket_list->size(); i > 1; i--) this->bucket_list_iter++;
+		if (this->type == AIAbstractList::SORT_BY_VALUE) this->list->UpdateValueOrder();
+		if (this->generation == this->list->generation) return;
+		this->generation = this->list->generation;
+		if (this->has_no_more_items || this->at_end) return;
+
+		const std::vector<int32> &items = this->list->items;
+		size_t pos = std::lower_bound(items.begin(), items.end(), this->item_next) - items.begin();
+		if (this->type == AIAbstractList::SORT_BY_ITEM) {
+			this->index = pos;
 		} else {
-			this->bucket_list_iter--;
-		}
-		this->item_next = *this->bucket_list_iter;
-	}
-
-	int32 Next()
-	{
-		if (!this->HasNext()) return 0;
-
-		int32 item_current = this->item_next;
-		FindNext();
-		return item_current;
-	}
-
-	void Remove(int item)
-	{
-		if (!this->HasNext()) return;
-
-		/* If we remove the 'next' item, skip to the next */
-		if (item == this->item_next) {
-			FindNext();
-			return;
+			const std::vector<uint64> &order = this->list->value_order;
+			this->index = std::lower_bound(order.begin(), order.end(), MakeValueOrderKey(this->value_next, pos)) - order.begin();
 		}
-	}
+		/* When walking backwards, the entry before it is next if 'item_next' itself is gone */
+		if (!this->ascending && (this->index >= this->Size() || items[this->Position(this->index)] != this->item_next)) this->index--;
 
-	bool HasNext()
-	{
-		return !(this->list->buckets.empty() || this->has_no_more_items);
+		if (!this->SkipRemoved()) this->at_end = true;
 	}
-};
-
-/**
- * Sort by item, ascending.
- */
-class AIAbstractListSorterItemAscending : public AIAbstractListSorter {
-private:
-	AIAbstractList::AIAbstractListMap::iterator item_iter;
-	bool has_no_more_items;
-	int32 item_next;
 
 public:
-	AIAbstractListSorterItemAscending(AIAbstractList *list)
+	AIAbstractListSorter(AIAbstractList *list, AIAbstractList::SorterType type, bool ascending) :
+		list(list),
+		type(type),
+		ascending(ascending),
+		generation(0)
 	{
-		this->list = list;
 		this->End();
 	}
 
+	/**
+	 * Get the first item of the sorter.
+	 */
 	int32 Begin()
 	{
-		if (this->list->items.empty()) return 0;
+		if (this->list->IsEmpty()) return 0;
 		this->has_no_more_items = false;
+		this->at_end = false;
 
-		this->item_iter = this->list->items.begin();
-		this->item_next = (*this->item_iter).first;
+		if (this->type == AIAbstractList::SORT_BY_VALUE) this->list->UpdateValueOrder();
+		this->generation = this->list->generation;
+		this->index = this->ascending ? 0 : this->Size() - 1;
+		this->SkipRemoved();
 
 		int32 item_current = this->item_next;
-		FindNext();
+		this->FindNext();
 		return item_current;
 	}
 
+	/**
+	 * Stop iterating a sorter.
+	 */
 	void End()
 	{
 		this->has_no_more_items = true;
+		this->at_end = true;
+		this->item_next = 0;
 	}
 
+	/**
+	 * Find the item after 'item_next'.
+	 */
 	void FindNext()
 	{
-		if (this->item_iter == this->list->items.end()) {
+		if (this->at_end) {
 			this->has_no_more_items = true;
 			return;
 		}
-		this->item_iter++;
-		if (this->item_iter != this->list->items.end()) item_next = (*this->item_iter).first;
+
+		this->Sync();
+		if (this->at_end) return;
+
+		this->Step();
+		if (!this->SkipRemoved()) this->at_end = true;
 	}
 
+	/**
+	 * Get the next item of the sorter.
+	 */
 	int32 Next()
 	{
 		if (!this->HasNext()) return 0;
 
+		this->Sync();
 		int32 item_current = this->item_next;
-		FindNext();
+		this->FindNext();
 		return item_current;
 	}
 
-	void Remove(int item) {
+	/**
+	 * Callback from the list if an item gets removed.
+	 */
+	void Remove(int item)
+	{
 		if (!this->HasNext()) return;
 
 		/* If we remove the 'next' item, skip to the next */
 		if (item == this->item_next) {
-			FindNext();
+			this->FindNext();
 			return;
 		}
 	}
 
+	/**
+	 * See if there is a next item of the sorter.
+	 */
 	bool HasNext()
 	{
-		return !(this->list->items.empty() || this->has_no_more_items);
+		return !(this->list->IsEmpty() || this->has_no_more_items);
 	}
 };
 
-/**
- * Sort by item, descending.
- */
-class AIAbstractListSorterItemDescending : public AIAbstractListSorter {
-private:
-	AIAbstractList::AIAbstractListMap::iterator item_iter;
-	bool has_no_more_items;
-	int32 item_next;
-
-public:
-	AIAbstractListSorterItemDescending(AIAbstractList *list)
-	{
-		this->list = list;
-		this->End();
-	}
-
-	int32 Begin()
-	{
-		if (this->list->items.empty()) return 0;
-		this->has_no_more_items = false;
-
-		this->item_iter = this->list->items.begin();
-		for (size_t i = this->list->items.size(); i > 1; i--) this->item_iter++;
-		this->item_next = (*this->item_iter).first;
 
-		int32 item_current = this->item_next;
-		FindNext();
-		return item_current;
-	}
 
-	void End()
-	{
-		this->has_no_more_items = true;
-	}
-
-	void FindNext()
-	{
-		if (this->item_iter == this->list->items.end()) {
-			this->has_no_more_items = true;
-			return;
-		}
-		this->item_iter--;
-		if (this->item_iter != this->list->items.end()) item_next = (*this->item_iter).first;
-	}
+AIAbstractList::AIAbstractList()
+{
+	/* Default sorter */
+	this->sorter            = new AIAbstractListSorter(this, SORT_BY_VALUE, false);
+	this->sorter_type       = SORT_BY_VALUE;
+	this->sort_ascending    = false;
+	this->initialized       = false;
+	this->removed_count     = 0;
+	this->value_order_valid = true;
+	this->generation        = 0;
+}
 
-	int32 Next()
-	{
-		if (!this->HasNext()) return 0;
+AIAbstractList::~AIAbstractList()
+{
+	delete this->sorter;
+}
 
-		int32 item_current = this->item_next;
-		FindNext();
-		return item_current;
-	}
+void AIAbstractList::Flush()
+{
+	if (this->pending_items.empty() && this->removed_count * 2 <= this->items.size()) return;
 
-	void Remove(int item)
-	{
-		if (!this->HasNext()) return;
+	std::vector<int32> new_items;
+	std::vector<int32> new_values;
+	new_items.reserve(this->items.size() - this->removed_count + this->pending_items.size());
+	new_values.reserve(this->items.size() - this->removed_count + this->pending_items.size());
 
-		/* If we remove the 'next' item, skip to the next */
-		if (item == this->item_next) {
-			FindNext();
-			return;
+	/* Pending items are never in 'items', so just merge both */
+	size_t i = 0;
+	size_t j = 0;
+	while (i < this->items.size() || j < this->pending_items.size()) {
+		if (j == this->pending_items.size() || (i < this->items.size() && this->items[i] < this->pending_items[j])) {
+			if (!this->removed[i]) {
+				new_items.push_back(this->items[i]);
+				new_values.push_back(this->values[i]);
+			}
+			i++;
+		} else {
+			new_items.push_back(this->pending_items[j]);
+			new_values.push_back(this->pending_values[j]);
+			j++;
 		}
 	}
 
-	bool HasNext()
-	{
-		return !(this->list->items.empty() || this->has_no_more_items);
-	}
-};
+	this->items.swap(new_items);
+	this->values.swap(new_values);
+	this->removed.assign(this->items.size(), false);
+	this->removed_count = 0;
+	this->pending_items.clear();
+	this->pending_values.clear();
+	this->value_order_valid = false;
+	this->generation++;
+}
 
+size_t AIAbstractList::FindPending(int32 item) const
+{
+	std::vector<int32>::const_iterator iter = std::lower_bound(this->pending_items.begin(), this->pending_items.end(), item);
+	if (iter == this->pending_items.end() || *iter != item) return this->pending_items.size();
+	return iter - this->pending_items.begin();
+}
 
+size_t AIAbstractList::FindPosition(int32 item) const
+{
+	std::vector<int32>::const_iterator iter = std::lower_bound(this->items.begin(), this->items.end(), item);
+	if (iter == this->items.end() || *iter != item) return this->items.size();
+	return iter - this->items.begin();
+}
 
-AIAbstractList::AIAbstractList()
+void AIAbstractList::RemovePosition(size_t pos)
 {
-	/* Default sorter */
-	this->sorter         = new AIAbstractListSorterValueDescending(this);
-	this->sorter_type    = SORT_BY_VALUE;
-	this->sort_ascending = false;
-	this->initialized    = false;
+	this->sorter->Remove(this->items[pos]);
+	this->removed[pos] = true;
+	this->removed_count++;
 }
 
-AIAbstractList::~AIAbstractList()
+void AIAbstractList::UpdateValueOrder()
 {
-	delete this->sorter;
+	if (this->value_order_valid) return;
+
+	this->value_order.clear();
+	this->value_order.reserve(this->items.size() - this->removed_count);
+	for (size_t pos = 0; pos < this->items.size(); pos++) {
+		if (!this->removed[pos]) this->value_order.push_back(MakeValueOrderKey(this->values[pos], pos));
+	}
+	std::sort(this->value_order.begin(), this->value_order.end());
+
+	this->value_order_valid = true;
+	this->generation++;
 }
 
 bool AIAbstractList::HasItem(int32 item)
 {
-	return this->items.count(item) == 1;
+	size_t pos = this->FindPosition(item);
+	if (pos != this->items.size()) return !this->removed[pos];
+
+	return this->FindPending(item) != this->pending_items.size();
 }
 
 void AIAbstractList::Clear()
 {
 	this->items.clear();
-	this->buckets.clear();
+	this->values.clear();
+	this->removed.clear();
+	this->removed_count = 0;
+	this->pending_items.clear();
+	this->pending_values.clear();
+	this->value_order.clear();
+	this->value_order_valid = true;
+	this->generation++;
 	this->sorter->End();
 }
 
 void AIAbstractList::AddItem(int32 item)
 {
-	if (this->HasItem(item)) return;
+	size_t pos = this->FindPosition(item);
+	if (pos != this->items.size()) {
+		if (!this->removed[pos]) return;
 
-	this->items[item] = 0;
-	this->buckets[0].insert(item);
+		/* The item was removed before; just bring it back */
+		this->removed[pos] = false;
+		this->removed_count--;
+		this->values[pos] = 0;
+		this->value_order_valid = false;
+		return;
+	}
+
+	/* Pending items are all lower than the last item, so this can't be one */
+	if (this->items.empty() || item > this->items.back()) {
+		this->items.push_back(item);
+		this->values.push_back(0);
+		this->removed.push_back(false);
+		this->value_order_valid = false;
+		return;
+	}
+
+	std::vector<int32>::iterator iter = std::lower_bound(this->pending_items.begin(), this->pending_items.end(), item);
+	if (iter != this->pending_items.end() && *iter == item) return;
+
+	this->pending_values.insert(this->pending_values.begin() + (iter - this->pending_items.begin()), 0);
+	this->pending_items.insert(iter, item);
+
+	/* Keep the pending items few enough to make inserting and finding them cheap */
+	if (this->pending_items.size() * this->pending_items.size() > this->items.size()) this->Flush();
 }
 
 void AIAbstractList::RemoveItem(int32 item)
 {
-	if (!this->HasItem(item)) return;
+	/* The sorter only knows the items that are merged */
+	if (!this->pending_items.empty() && this->sorter->HasNext()) this->Flush();
 
-	int32 value = this->GetValue(item);
+	size_t pos = this->FindPosition(item);
+	if (pos != this->items.size()) {
+		if (!this->removed[pos]) this->RemovePosition(pos);
+		return;
+	}
 
-	this->sorter->Remove(item);
-	this->buckets[value].erase(item);
-	if (this->buckets[value].empty()) this->buckets.erase(value);
-	this->items.erase(item);
+	pos = this->FindPending(item);
+	if (pos == this->pending_items.size()) return;
+	this->pending_items.erase(this->pending_items.begin() + pos);
+	this->pending_values.erase(this->pending_values.begin() + pos);
 }
 
 int32 AIAbstractList::Begin()
 {
+	this->Flush();
 	this->initialized = true;
 	return this->sorter->Begin();
 }
@@ -426,12 +375,13 @@ int32 AIAbstractList::Next()
 		DEBUG(ai, 0, "ERROR: Next() is invalid as Begin() is never called");
 		return false;
 	}
+	this->Flush();
 	return this->sorter->Next();
 }
 
 bool AIAbstractList::IsEmpty()
 {
-	return this->items.empty();
+	return this->items.size() == this->removed_count && this->pending_items.empty();
 }
 
 bool AIAbstractList::HasNext()
@@ -445,27 +395,55 @@ bool AIAbstractList::HasNext()
 
 int32 AIAbstractList::Count()
 {
-	return (int32)this->items.size();
+	return (int32)(this->items.size() - this->removed_count + this->pending_items.size());
 }
 
 int32 AIAbstractList::GetValue(int32 item)
 {
-	if (!this->HasItem(item)) return 0;
+	size_t pos = this->FindPosition(item);
+	if (pos != this->items.size()) return this->removed[pos] ? 0 : this->values[pos];
 
-	return this->items[item];
+	pos = this->FindPending(item);
+	if (pos == this->pending_items.size()) return 0;
+	return this->pending_values[pos];
 }
 
 bool AIAbstractList::SetValue(int32 item, int32 value)
 {
-	if (!this->HasItem(item)) return false;
+	/* The sorter only knows the items that are merged */
+	if (!this->pending_items.empty() && this->sorter->HasNext()) this->Flush();
 
-	int32 value_old = this->GetValue(item);
+	size_t pos = this->FindPosition(item);
+	if (pos == this->items.size()) {
+		pos = this->FindPending(item);
+		if (pos == this->pending_items.size()) return false;
+
+		this->pending_values[pos] = value;
+		return true;
+	}
+	if (this->removed[pos]) return false;
 
 	this->sorter->Remove(item);
-	this->buckets[value_old].erase(item);
-	if (this->buckets[value_old].empty()) this->buckets.erase(value_old);
-	this->items[item] = value;
-	this->buckets[value].insert(item);
+
+	int32 value_old = this->values[pos];
+	if (value == value_old) return true;
+	this->values[pos] = value;
+
+	if (this->value_order_valid) {
+		/* Move the entry to its new place in the order by value */
+		uint64 key_old = MakeValueOrderKey(value_old, pos);
+		uint64 key_new = MakeValueOrderKey(value, pos);
+		std::vector<uint64>::iterator iter_old = std::lower_bound(this->value_order.begin(), this->value_order.end(), key_old);
+		std::vector<uint64>::iterator iter_new = std::lower_bound(this->value_order.begin(), this->value_order.end(), key_new);
+		if (iter_new > iter_old) {
+			std::copy(iter_old + 1, iter_new, iter_old);
+			*(iter_new - 1) = key_new;
+		} else {
+			std::copy_backward(iter_new, iter_old, iter_old + 1);
+			*iter_new = key_new;
+		}
+		this->generation++;
+	}
 
 	return true;
 }
@@ -476,83 +454,87 @@ void AIAbstractList::Sort(SorterType sorter, bool ascending)
 	if (sorter == this->sorter_type && ascending == this->sort_ascending) return;
 
 	delete this->sorter;
-	switch (sorter) {
-		case SORT_BY_ITEM:
-			if (ascending) this->sorter = new AIAbstractListSorterItemAscending(this);
-			else           this->sorter = new AIAbstractListSorterItemDescending(this);
-			break;
-
-		case SORT_BY_VALUE:
-			if (ascending) this->sorter = new AIAbstractListSorterValueAscending(this);
-			else           this->sorter = new AIAbstractListSorterValueDescending(this);
-			break;
-
-		default:
-			this->Sort(SORT_BY_ITEM, false);
-			return;
-	}
+	this->sorter         = new AIAbstractListSorter(this, sorter, ascending);
 	this->sorter_type    = sorter;
 	this->sort_ascending = ascending;
 }
 
 void AIAbstractList::AddList(AIAbstractList *list)
 {
-	AIAbstractListMap *list_items = &list->items;
-	for (AIAbstractListMap::iterator iter = list_items->begin(); iter != list_items->end(); iter++) {
-		this->AddItem((*iter).first);
-		this->SetValue((*iter).first, (*iter).second);
+	list->Flush();
+	this->Flush();
+
+	if (this->sorter->HasNext()) {
+		/* Which items the sorter skips depends on the order of adding and
+		 *  changing them; keep that order while the list is being walked. */
+		for (size_t i = 0; i < list->items.size(); i++) {
+			if (list->removed[i]) continue;
+
+			this->AddItem(list->items[i]);
+			this->SetValue(list->items[i], list->values[i]);
+		}
+		return;
 	}
+
+	/* Collect the new items in the pending items, which are merged in one go */
+	std::vector<int32> new_items;
+	std::vector<int32> new_values;
+	for (size_t i = 0; i < list->items.size(); i++) {
+		if (list->removed[i]) continue;
+
+		size_t pos = this->FindPosition(list->items[i]);
+		if (pos == this->items.size()) {
+			new_items.push_back(list->items[i]);
+			new_values.push_back(list->values[i]);
+			continue;
+		}
+
+		if (this->removed[pos]) {
+			this->removed[pos] = false;
+			this->removed_count--;
+		}
+		this->values[pos] = list->values[i];
+	}
+	this->value_order_valid = false;
+
+	this->pending_items.swap(new_items);
+	this->pending_values.swap(new_values);
+	this->Flush();
 }
 
 void AIAbstractList::RemoveAboveValue(int32 value)
 {
-	for (AIAbstractListMap::iterator next_iter, iter = this->items.begin(); iter != this->items.end(); iter = next_iter) {
-		next_iter = iter; next_iter++;
-		if ((*iter).second > value) this->items.erase(iter);
-	}
+	this->Flush();
 
-	for (AIAbstractListBucket::iterator next_iter, iter = this->buckets.begin(); iter != this->buckets.end(); iter = next_iter) {
-		next_iter = iter; next_iter++;
-		if ((*iter).first > value) this->buckets.erase(iter);
+	for (size_t pos = 0; pos < this->items.size(); pos++) {
+		if (!this->removed[pos] && this->values[pos] > value) this->RemovePosition(pos);
 	}
 }
 
 void AIAbstractList::RemoveBelowValue(int32 value)
 {
-	for (AIAbstractListMap::iterator next_iter, iter = this->items.begin(); iter != this->items.end(); iter = next_iter) {
-		next_iter = iter; next_iter++;
-		if ((*iter).second < value) this->items.erase(iter);
-	}
+	this->Flush();
 
-	for (AIAbstractListBucket::iterator next_iter, iter = this->buckets.begin(); iter != this->buckets.end(); iter = next_iter) {
-		next_iter = iter; next_iter++;
-		if ((*iter).first < value) this->buckets.erase(iter);
+	for (size_t pos = 0; pos < this->items.size(); pos++) {
+		if (!this->removed[pos] && this->values[pos] < value) this->RemovePosition(pos);
 	}
 }
 
 void AIAbstractList::RemoveBetweenValue(int32 start, int32 end)
 {
-	for (AIAbstractListMap::iterator next_iter, iter = this->items.begin(); iter != this->items.end(); iter = next_iter) {
-		next_iter = iter; next_iter++;
-		if ((*iter).second > start && (*iter).second < end) this->items.erase(iter);
-	}
+	this->Flush();
 
-	for (AIAbstractListBucket::iterator next_iter, iter = this->buckets.begin(); iter != this->buckets.end(); iter = next_iter) {
-		next_iter = iter; next_iter++;
-		if ((*iter).first > start && (*iter).first < end) this->buckets.erase(iter);
+	for (size_t pos = 0; pos < this->items.size(); pos++) {
+		if (!this->removed[pos] && this->values[pos] > start && this->values[pos] < end) this->RemovePosition(pos);
 	}
 }
 
 void AIAbstractList::RemoveValue(int32 value)
 {
-	for (AIAbstractListMap::iterator next_iter, iter = this->items.begin(); iter != this->items.end(); iter = next_iter) {
-		next_iter = iter; next_iter++;
-		if ((*iter).second == value) this->items.erase(iter);
-	}
+	this->Flush();
 
-	for (AIAbstractListBucket::iterator next_iter, iter = this->buckets.begin(); iter != this->buckets.end(); iter = next_iter) {
-		next_iter = iter; next_iter++;
-		if ((*iter).first == value) this->buckets.erase(iter);
+	for (size_t pos = 0; pos < this->items.size(); pos++) {
+		if (!this->removed[pos] && this->values[pos] == value) this->RemovePosition(pos);
 	}
 }
 
@@ -565,27 +547,25 @@ void AIAbstractList::RemoveTop(int32 count)
 		return;
 	}
 
+	this->Flush();
+
 	switch (this->sorter_type) {
 		default: NOT_REACHED();
 		case SORT_BY_VALUE:
-			for (AIAbstractListBucket::iterator iter = this->buckets.begin(); iter != this->buckets.end(); iter = this->buckets.begin()) {
-				AIItemList *items = &(*iter).second;
-				size_t size = items->size();
-				for (AIItemList::iterator iter = items->begin(); iter != items->end(); iter = items->begin()) {
-					if (--count < 0) return;
-					this->RemoveItem(*iter);
-					/* When the last item is removed from the bucket, the bucket itself is removed.
-					 * This means that the iterators can be invalid after a call to RemoveItem.
-					 */
-					if (--size == 0) break;
-				}
+			this->UpdateValueOrder();
+			for (size_t i = 0; i < this->value_order.size(); i++) {
+				size_t pos = (uint32)this->value_order[i];
+				if (this->removed[pos]) continue;
+				if (--count < 0) return;
+				this->RemovePosition(pos);
 			}
 			break;
 
 		case SORT_BY_ITEM:
-			for (AIAbstractListMap::iterator iter = this->items.begin(); iter != this->items.end(); iter = this->items.begin()) {
+			for (size_t pos = 0; pos < this->items.size(); pos++) {
+				if (this->removed[pos]) continue;
 				if (--count < 0) return;
-				this->RemoveItem((*iter).first);
+				this->RemovePosition(pos);
 			}
 			break;
 	}
@@ -600,26 +580,25 @@ void AIAbstractList::RemoveBottom(int32 count)
 		return;
 	}
 
+	this->Flush();
+
 	switch (this->sorter_type) {
 		default: NOT_REACHED();
 		case SORT_BY_VALUE:
-			for (AIAbstractListBucket::reverse_iterator iter = this->buckets.rbegin(); iter != this->buckets.rend(); iter = this->buckets.rbegin()) {
-				AIItemList *items = &(*iter).second;
-				size_t size = items->size();
-				for (AIItemList::reverse_iterator iter = items->rbegin(); iter != items->rend(); iter = items->rbegin()) {
-					if (--count < 0) return;
-					this->RemoveItem(*iter);
-					/* When the last item is removed from the bucket, the bucket itself is removed.
-					 * This means that the iterators can be invalid after a call to RemoveItem.
-					 */
-					if (--size == 0) break;
-				}
+			this->UpdateValueOrder();
+			for (size_t i = this->value_order.size(); i > 0; i--) {
+				size_t pos = (uint32)this->value_order[i - 1];
+				if (this->removed[pos]) continue;
+				if (--count < 0) return;
+				this->RemovePosition(pos);
 			}
+			break;
 
 		case SORT_BY_ITEM:
-			for (AIAbstractListMap::reverse_iterator iter = this->items.rbegin(); iter != this->items.rend(); iter = this->items.rbegin()) {
+			for (size_t pos = this->items.size(); pos > 0; pos--) {
+				if (this->removed[pos - 1]) continue;
 				if (--count < 0) return;
-				this->RemoveItem((*iter).first);
+				this->RemovePosition(pos - 1);
 			}
 			break;
 	}
@@ -627,61 +606,50 @@ void AIAbstractList::RemoveBottom(int32 count)
 
 void AIAbstractList::RemoveList(AIAbstractList *list)
 {
-	AIAbstractListMap *list_items = &list->items;
-	for (AIAbstractListMap::iterator iter = list_items->begin(); iter != list_items->end(); iter++) {
-		this->RemoveItem((*iter).first);
+	list->Flush();
+	this->Flush();
+
+	for (size_t i = 0; i < list->items.size(); i++) {
+		if (list->removed[i]) continue;
+
+		size_t pos = this->FindPosition(list->items[i]);
+		if (pos != this->items.size() && !this->removed[pos]) this->RemovePosition(pos);
 	}
 }
 
 void AIAbstractList::KeepAboveValue(int32 value)
 {
-	for (AIAbstractListMap::iterator next_iter, iter = this->items.begin(); iter != this->items.end(); iter = next_iter) {
-		next_iter = iter; next_iter++;
-		if ((*iter).second <= value) this->items.erase(iter);
-	}
+	this->Flush();
 
-	for (AIAbstractListBucket::iterator next_iter, iter = this->buckets.begin(); iter != this->buckets.end(); iter = next_iter) {
-		next_iter = iter; next_iter++;
-		if ((*iter).first <= value) this->buckets.erase(iter);
+	for (size_t pos = 0; pos < this->items.size(); pos++) {
+		if (!this->removed[pos] && this->values[pos] <= value) this->RemovePosition(pos);
 	}
 }
 
 void AIAbstractList::KeepBelowValue(int32 value)
 {
-	for (AIAbstractListMap::iterator next_iter, iter = this->items.begin(); iter != this->items.end(); iter = next_iter) {
-		next_iter = iter; next_iter++;
-		if ((*iter).second >= value) this->items.erase(iter);
-	}
+	this->Flush();
 
-	for (AIAbstractListBucket::iterator next_iter, iter = this->buckets.begin(); iter != this->buckets.end(); iter = next_iter) {
-		next_iter = iter; next_iter++;
-		if ((*iter).first >= value) this->buckets.erase(iter);
+	for (size_t pos = 0; pos < this->items.size(); pos++) {
+		if (!this->removed[pos] && this->values[pos] >= value) this->RemovePosition(pos);
 	}
 }
 
 void AIAbstractList::KeepBetweenValue(int32 start, int32 end)
 {
-	for (AIAbstractListMap::iterator next_iter, iter = this->items.begin(); iter != this->items.end(); iter = next_iter) {
-		next_iter = iter; next_iter++;
-		if ((*iter).second <= start || (*iter).second >= end) this->items.erase(iter);
-	}
+	this->Flush();
 
-	for (AIAbstractListBucket::iterator next_iter, iter = this->buckets.begin(); iter != this->buckets.end(); iter = next_iter) {
-		next_iter = iter; next_iter++;
-		if ((*iter).first <= start || (*iter).first >= end) this->buckets.erase(iter);
+	for (size_t pos = 0; pos < this->items.size(); pos++) {
+		if (!this->removed[pos] && (this->values[pos] <= start || this->values[pos] >= end)) this->RemovePosition(pos);
 	}
 }
 
 void AIAbstractList::KeepValue(int32 value)
 {
-	for (AIAbstractListMap::iterator next_iter, iter = this->items.begin(); iter != this->items.end(); iter = next_iter) {
-		next_iter = iter; next_iter++;
-		if ((*iter).second != value) this->items.erase(iter);
-	}
+	this->Flush();
 
-	for (AIAbstractListBucket::iterator next_iter, iter = this->buckets.begin(); iter != this->buckets.end(); iter = next_iter) {
-		next_iter = iter; next_iter++;
-		if ((*iter).first != value) this->buckets.erase(iter);
+	for (size_t pos = 0; pos < this->items.size(); pos++) {
+		if (!this->removed[pos] && this->values[pos] != value) this->RemovePosition(pos);
 	}
 }
 
@@ -697,14 +665,34 @@ void AIAbstractList::KeepBottom(int32 count)
 
 void AIAbstractList::KeepList(AIAbstractList *list)
 {
-	AIAbstractList tmp;
-	for (AIAbstractListMap::iterator iter = this->items.begin(); iter != this->items.end(); iter++) {
-		tmp.AddItem((*iter).first);
-		tmp.SetValue((*iter).first, (*iter).second);
+	list->Flush();
+	this->Flush();
+
+	for (size_t pos = 0; pos < this->items.size(); pos++) {
+		if (this->removed[pos]) continue;
+
+		size_t list_pos = list->FindPosition(this->items[pos]);
+		if (list_pos == list->items.size() || list->removed[list_pos]) this->RemovePosition(pos);
+	}
+}
+
+void AIAbstractList::ValuateNative(NativeValuator *valuator, const void *data)
+{
+	this->Flush();
+
+	for (size_t pos = 0; pos < this->items.size(); pos++) {
+		if (!this->removed[pos]) this->values[pos] = valuator(this->items[pos], data);
 	}
+	this->value_order_valid = false;
+}
 
-	tmp.RemoveList(list);
-	this->RemoveList(&tmp);
+void AIAbstractList::FilterNative(NativeFilter *filter, const void *data, bool keep)
+{
+	this->Flush();
+
+	for (size_t pos = 0; pos < this->items.size(); pos++) {
+		if (!this->removed[pos] && filter(this->items[pos], data) != keep) this->RemovePosition(pos);
+	}
 }
 
 SQInteger AIAbstractList::_get(HSQUIRRELVM vm)
@@ -770,12 +758,15 @@ SQInteger AIAbstractList::Valuate(HSQUIRRELVM vm)
 	sq_push(vm, 2);
 
 	/* Walk all items, and query the result */
-	this->buckets.clear();
-	for (AIAbstractListMap::iterator iter = this->items.begin(); iter != this->items.end(); iter++) {
+	this->Flush();
+	this->value_order_valid = false;
+	for (size_t pos = 0; pos < this->items.size(); pos++) {
+		if (this->removed[pos]) continue;
+
 		/* Push the root table as instance object, this is what squirrel does for meta-functions. */
 		sq_pushroottable(vm);
 		/* Push all arguments for the valuator function. */
-		sq_pushinteger(vm, (*iter).first);
+		sq_pushinteger(vm, this->items[pos]);
 		for (int i = 0; i < nparam - 1; i++) {
 			sq_push(vm, i + 3);
 		}
@@ -808,8 +799,7 @@ SQInteger AIAbstractList::Valuate(HSQUIRRELVM vm)
 			}
 		}
 
-		(*iter).second = (int32)value;
-		this->buckets[(int32)value].insert((*iter).first);
+		this->values[pos] = (int32)value;
 
 		/* Pop the return value. */
 		sq_poptop(vm);
@@ -7,8 +7,7 @@
 #define AI_ABSTRACTLIST_HPP
 
 #include "ai_object.hpp"
-#include <map>
-#include <set>
+#include <vector>
 
 class AIAbstractListSorter;
 
@@ -26,18 +25,59 @@ public:
 	};
 
 private:
+	friend class AIAbstractListSorter;
+
 	AIAbstractListSorter *sorter;
 	SorterType sorter_type;
 	bool sort_ascending;
 	bool initialized;
 
-public:
-	typedef std::set<int32> AIItemList;                       //!< The list of items inside the bucket
-	typedef std::map<int32, AIItemList> AIAbstractListBucket; //!< The bucket list per value
-	typedef std::map<int32, int32> AIAbstractListMap;         //!< List per item
+	/* The items and their values are kept in flat arrays, sorted by item.
+	 * Removing an item only marks it as removed; the arrays are compacted
+	 * once enough of them are removed. Items that can not simply be
+	 * appended are kept aside in a small sorted array, which is merged
+	 * when it grows too big or when the list is walked. The order by value
+	 * is only made when it is needed. */
+	std::vector<int32> items;          ///< The items in the list, sorted ascending.
+	std::vector<int32> values;         ///< The value of each of the entries in 'items'.
+	std::vector<bool> removed;         ///< Whether each of the entries in 'items' is removed.
+	size_t removed_count;              ///< The amount of removed entries in 'items'.
+	std::vector<int32> pending_items;  ///< Added items that are not in 'items' yet, sorted ascending.
+	std::vector<int32> pending_values; ///< The value of each of the entries in 'pending_items'.
+	std::vector<uint64> value_order;   ///< Value and position of the entries in 'items', sorted by value.
+	bool value_order_valid;            ///< Whether 'value_order' contains all entries with their current value.
+	uint generation;                   ///< Changed every time entries of 'items' or 'value_order' move.
+
+	/**
+	 * Merge the pending items in the list and throw out the removed ones, if needed.
+	 */
+	void Flush();
+
+	/**
+	 * Find the position of an item in 'pending_items'.
+	 * @param item the item to find.
+	 * @return the position, or the size of 'pending_items' when it is not found.
+	 */
+	size_t FindPending(int32 item) const;
+
+	/**
+	 * Find the position of an item in 'items'.
+	 * @param item the item to find.
+	 * @return the position, or the size of 'items' when it is not found.
+	 * @note the entry at the position might be removed.
+	 */
+	size_t FindPosition(int32 item) const;
+
+	/**
+	 * Remove the entry at a position in 'items'.
+	 * @param pos the position of the entry to remove.
+	 */
+	void RemovePosition(size_t pos);
 
-	AIAbstractListMap items;           //!< The items in the list
-	AIAbstractListBucket buckets;      //!< The items in the list, sorted by value
+	/**
+	 * Make sure 'value_order' is valid.
+	 */
+	void UpdateValueOrder();
 
 protected:
 	/**
@@ -53,6 +93,38 @@ protected:
 	 */
 	void RemoveItem(int32 item);
 
+	/**
+	 * A valuator that runs in C++ instead of in the script.
+	 * @param item the item to get the value for.
+	 * @param data the data given to ValuateNative.
+	 * @return the value of the item.
+	 */
+	typedef int32 NativeValuator(int32 item, const void *data);
+
+	/**
+	 * A filter that runs in C++ instead of in the script.
+	 * @param item the item to check.
+	 * @param data the data given to FilterNative.
+	 * @return true if the item matches the filter.
+	 */
+	typedef bool NativeFilter(int32 item, const void *data);
+
+	/**
+	 * Give all items a value by calling a native valuator, without the
+	 *  overhead of calling into the script for every item.
+	 * @param valuator the function that gives the value of an item.
+	 * @param data passed to the valuator as is.
+	 */
+	void ValuateNative(NativeValuator *valuator, const void *data);
+
+	/**
+	 * Keep or remove all items matching a native filter.
+	 * @param filter the function that checks an item.
+	 * @param data passed to the filter as is.
+	 * @param keep if true, keep the matching items, else remove them.
+	 */
+	void FilterNative(NativeFilter *filter, const void *data, bool keep);
+
 public:
 	AIAbstractList();
 	~AIAbstractList();
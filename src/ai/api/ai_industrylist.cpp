@@ -3,6 +3,7 @@
 /** @file ai_industrylist.cpp Implementation of AIIndustryList and friends. */
 
 #include "ai_industrylist.hpp"
+#include "ai_industry.hpp"
 #include "../../tile_type.h"
 #include "../../industry.h"
 
@@ -14,6 +15,56 @@ AIIndustryList::AIIndustryList()
 	}
 }
 
+static int32 IndustryDistanceManhattanValuator(int32 industry_id, const void *data)
+{
+	return AIIndustry::GetDistanceManhattanToTile(industry_id, *(const TileIndex *)data);
+}
+
+static int32 IndustryDistanceSquareValuator(int32 industry_id, const void *data)
+{
+	return AIIndustry::GetDistanceSquareToTile(industry_id, *(const TileIndex *)data);
+}
+
+static int32 IndustryLastMonthProductionValuator(int32 industry_id, const void *data)
+{
+	return AIIndustry::GetLastMonthProduction(industry_id, *(const CargoID *)data);
+}
+
+static int32 IndustryCargoAcceptedValuator(int32 industry_id, const void *data)
+{
+	return AIIndustry::IsCargoAccepted(industry_id, *(const CargoID *)data) ? 1 : 0;
+}
+
+static int32 IndustryAmountOfStationsAroundValuator(int32 industry_id, const void *data)
+{
+	return AIIndustry::GetAmountOfStationsAround(industry_id);
+}
+
+void AIIndustryList::ValuateDistanceManhattanToTile(TileIndex tile)
+{
+	this->ValuateNative(&IndustryDistanceManhattanValuator, &tile);
+}
+
+void AIIndustryList::ValuateDistanceSquareToTile(TileIndex tile)
+{
+	this->ValuateNative(&IndustryDistanceSquareValuator, &tile);
+}
+
+void AIIndustryList::ValuateLastMonthProduction(CargoID cargo_id)
+{
+	this->ValuateNative(&IndustryLastMonthProductionValuator, &cargo_id);
+}
+
+void AIIndustryList::ValuateCargoAccepted(CargoID cargo_id)
+{
+	this->ValuateNative(&IndustryCargoAcceptedValuator, &cargo_id);
+}
+
+void AIIndustryList::ValuateAmountOfStationsAround()
+{
+	this->ValuateNative(&IndustryAmountOfStationsAroundValuator, NULL);
+}
+
 AIIndustryList_CargoAccepting::AIIndustryList_CargoAccepting(CargoID cargo_id)
 {
 	const Industry *i;
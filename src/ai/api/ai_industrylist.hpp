@@ -15,6 +15,47 @@ class AIIndustryList : public AIAbstractList {
 public:
 	static const char *GetClassName() { return "AIIndustryList"; }
 	AIIndustryList();
+
+	/**
+	 * Give all industries their manhattan distance to a tile as value.
+	 * @param tile The tile to get the distance to.
+	 * @note This is the same as Valuate(AIIndustry.GetDistanceManhattanToTile, tile),
+	 *  but it runs without calling the script for every industry.
+	 */
+	void ValuateDistanceManhattanToTile(TileIndex tile);
+
+	/**
+	 * Give all industries their square distance to a tile as value.
+	 * @param tile The tile to get the distance to.
+	 * @note This is the same as Valuate(AIIndustry.GetDistanceSquareToTile, tile),
+	 *  but it runs without calling the script for every industry.
+	 */
+	void ValuateDistanceSquareToTile(TileIndex tile);
+
+	/**
+	 * Give all industries their production of a cargo last month as value.
+	 * @param cargo_id The cargo to get the production of.
+	 * @pre AICargo::IsValidCargo(cargo_id).
+	 * @note This is the same as Valuate(AIIndustry.GetLastMonthProduction, cargo_id),
+	 *  but it runs without calling the script for every industry.
+	 */
+	void ValuateLastMonthProduction(CargoID cargo_id);
+
+	/**
+	 * Give all industries the value 1 if they accept a cargo, else 0.
+	 * @param cargo_id The cargo to check the acceptance of.
+	 * @pre AICargo::IsValidCargo(cargo_id).
+	 * @note This is the same as Valuate(AIIndustry.IsCargoAccepted, cargo_id),
+	 *  but it runs without calling the script for every industry.
+	 */
+	void ValuateCargoAccepted(CargoID cargo_id);
+
+	/**
+	 * Give all industries the amount of stations around them as value.
+	 * @note This is the same as Valuate(AIIndustry.GetAmountOfStationsAround),
+	 *  but it runs without calling the script for every industry.
+	 */
+	void ValuateAmountOfStationsAround();
 };
 
 /**
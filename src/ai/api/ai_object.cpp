@@ -190,6 +190,8 @@ bool AIObject::DoCommand(TileIndex tile, uint32 p1, uint32 p2, uint cmd, const c
 
 	CommandCost res;
 
+	AIInstance::GetCurrentStats()->commands++;
+
 	/* Set the default callback to return a true/false result of the DoCommand */
 	if (callback == NULL) callback = &AIInstance::DoCommandReturn;
 
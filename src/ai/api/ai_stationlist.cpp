@@ -16,6 +16,46 @@ AIStationList::AIStationList(AIStation::StationType station_type)
 	}
 }
 
+static int32 StationDistanceManhattanValuator(int32 station_id, const void *data)
+{
+	return AIStation::GetDistanceManhattanToTile(station_id, *(const TileIndex *)data);
+}
+
+static int32 StationDistanceSquareValuator(int32 station_id, const void *data)
+{
+	return AIStation::GetDistanceSquareToTile(station_id, *(const TileIndex *)data);
+}
+
+static int32 StationCargoWaitingValuator(int32 station_id, const void *data)
+{
+	return AIStation::GetCargoWaiting(station_id, *(const CargoID *)data);
+}
+
+static int32 StationCargoRatingValuator(int32 station_id, const void *data)
+{
+	return AIStation::GetCargoRating(station_id, *(const CargoID *)data);
+}
+
+void AIStationList::ValuateDistanceManhattanToTile(TileIndex tile)
+{
+	this->ValuateNative(&StationDistanceManhattanValuator, &tile);
+}
+
+void AIStationList::ValuateDistanceSquareToTile(TileIndex tile)
+{
+	this->ValuateNative(&StationDistanceSquareValuator, &tile);
+}
+
+void AIStationList::ValuateCargoWaiting(CargoID cargo_id)
+{
+	this->ValuateNative(&StationCargoWaitingValuator, &cargo_id);
+}
+
+void AIStationList::ValuateCargoRating(CargoID cargo_id)
+{
+	this->ValuateNative(&StationCargoRatingValuator, &cargo_id);
+}
+
 AIStationList_Vehicle::AIStationList_Vehicle(VehicleID vehicle_id)
 {
 	if (!AIVehicle::IsValidVehicle(vehicle_id)) return;
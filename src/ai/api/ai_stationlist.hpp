@@ -20,6 +20,40 @@ public:
 	 * @param station_type The type of station to make a list of stations for.
 	 */
 	AIStationList(AIStation::StationType station_type);
+
+	/**
+	 * Give all stations their manhattan distance to a tile as value.
+	 * @param tile The tile to get the distance to.
+	 * @note This is the same as Valuate(AIStation.GetDistanceManhattanToTile, tile),
+	 *  but it runs without calling the script for every station.
+	 */
+	void ValuateDistanceManhattanToTile(TileIndex tile);
+
+	/**
+	 * Give all stations their square distance to a tile as value.
+	 * @param tile The tile to get the distance to.
+	 * @note This is the same as Valuate(AIStation.GetDistanceSquareToTile, tile),
+	 *  but it runs without calling the script for every station.
+	 */
+	void ValuateDistanceSquareToTile(TileIndex tile);
+
+	/**
+	 * Give all stations the amount of a cargo waiting there as value.
+	 * @param cargo_id The cargo to get the amount of.
+	 * @pre AICargo::IsValidCargo(cargo_id).
+	 * @note This is the same as Valuate(AIStation.GetCargoWaiting, cargo_id),
+	 *  but it runs without calling the script for every station.
+	 */
+	void ValuateCargoWaiting(CargoID cargo_id);
+
+	/**
+	 * Give all stations their rating of a cargo as value.
+	 * @param cargo_id The cargo to get the rating of.
+	 * @pre AICargo::IsValidCargo(cargo_id).
+	 * @note This is the same as Valuate(AIStation.GetCargoRating, cargo_id),
+	 *  but it runs without calling the script for every station.
+	 */
+	void ValuateCargoRating(CargoID cargo_id);
 };
 
 /**
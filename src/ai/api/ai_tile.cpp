@@ -5,6 +5,7 @@
 #include "ai_tile.hpp"
 #include "ai_map.hpp"
 #include "ai_town.hpp"
+#include "ai_cargo.hpp"
 #include "../../station_func.h"
 #include "../../company_func.h"
 #include "../../road_map.h"
@@ -156,6 +157,7 @@
 /* static */ int32 AITile::GetCargoAcceptance(TileIndex tile, CargoID cargo_type, uint width, uint height, uint radius)
 {
 	if (!::IsValidTile(tile)) return false;
+	if (!AICargo::IsValidCargo(cargo_type)) return -1;
 
 	AcceptedCargo accepts;
 	::GetAcceptanceAroundTiles(accepts, tile, width, height, _settings_game.station.modified_catchment ? radius : (uint)CA_UNMODIFIED);
@@ -165,6 +167,7 @@
 /* static */ int32 AITile::GetCargoProduction(TileIndex tile, CargoID cargo_type, uint width, uint height, uint radius)
 {
 	if (!::IsValidTile(tile)) return false;
+	if (!AICargo::IsValidCargo(cargo_type)) return -1;
 
 	AcceptedCargo produced;
 	::GetProductionAroundTiles(produced, tile, width, height, _settings_game.station.modified_catchment ? radius : (uint)CA_UNMODIFIED);
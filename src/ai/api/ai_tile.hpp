@@ -251,6 +251,7 @@ public:
 	 * @param height The height of the station.
 	 * @param radius The radius of the station.
 	 * @pre AIMap::IsValidTile(tile).
+	 * @pre AICargo::IsValidCargo(cargo_type).
 	 * @return Value below 8 means no acceptance; the more the better.
 	 */
 	static int32 GetCargoAcceptance(TileIndex tile, CargoID cargo_type, uint width, uint height, uint radius);
@@ -265,6 +266,7 @@ public:
 	 * @param height The height of the station.
 	 * @param radius The radius of the station.
 	 * @pre AIMap::IsValidTile(tile).
+	 * @pre AICargo::IsValidCargo(cargo_type).
 	 * @return The tiles that produce this cargo within radius of the tile.
 	 * @note Town(houses) are not included in the value.
 	 */
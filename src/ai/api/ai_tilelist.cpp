@@ -4,6 +4,7 @@
 
 #include "ai_tilelist.hpp"
 #include "ai_industry.hpp"
+#include "ai_tile.hpp"
 #include "../../tile_map.h"
 #include "../../industry_map.h"
 #include "../../station_map.h"
@@ -68,6 +69,120 @@ void AITileList::RemoveTile(TileIndex tile)
 	this->RemoveItem(tile);
 }
 
+/** The parameters for the cargo acceptance and production valuators. */
+struct TileCargoAreaData {
+	CargoID cargo_type; ///< The cargo to check.
+	uint width;         ///< The width of the station.
+	uint height;        ///< The height of the station.
+	uint radius;        ///< The radius of the station.
+};
+
+static int32 TileDistanceManhattanValuator(int32 tile, const void *data)
+{
+	return AITile::GetDistanceManhattanToTile(tile, *(const TileIndex *)data);
+}
+
+static int32 TileDistanceSquareValuator(int32 tile, const void *data)
+{
+	return AITile::GetDistanceSquareToTile(tile, *(const TileIndex *)data);
+}
+
+static int32 TileBuildableValuator(int32 tile, const void *data)
+{
+	return AITile::IsBuildable(tile) ? 1 : 0;
+}
+
+static int32 TileSlopeValuator(int32 tile, const void *data)
+{
+	return AITile::GetSlope(tile);
+}
+
+static int32 TileOwnerValuator(int32 tile, const void *data)
+{
+	return AITile::GetOwner(tile);
+}
+
+static int32 TileCargoAcceptanceValuator(int32 tile, const void *data)
+{
+	const TileCargoAreaData *area = (const TileCargoAreaData *)data;
+	return AITile::GetCargoAcceptance(tile, area->cargo_type, area->width, area->height, area->radius);
+}
+
+static int32 TileCargoProductionValuator(int32 tile, const void *data)
+{
+	const TileCargoAreaData *area = (const TileCargoAreaData *)data;
+	return AITile::GetCargoProduction(tile, area->cargo_type, area->width, area->height, area->radius);
+}
+
+static bool TileFilterMatches(int32 tile, const void *data)
+{
+	switch (*(const AITileList::TileFilter *)data) {
+		case AITileList::FILTER_BUILDABLE: return AITile::IsBuildable(tile);
+		case AITileList::FILTER_FLAT:      return AITile::GetSlope(tile) == AITile::SLOPE_FLAT;
+		case AITileList::FILTER_WATER:     return AITile::IsWaterTile(tile);
+		case AITileList::FILTER_COAST:     return AITile::IsCoastTile(tile);
+		case AITileList::FILTER_STATION:   return AITile::IsStationTile(tile);
+		case AITileList::FILTER_TREE:      return AITile::HasTreeOnTile(tile);
+		case AITileList::FILTER_FARM:      return AITile::IsFarmTile(tile);
+		case AITileList::FILTER_ROCK:      return AITile::IsRockTile(tile);
+		case AITileList::FILTER_ROUGH:     return AITile::IsRoughTile(tile);
+		case AITileList::FILTER_SNOW:      return AITile::IsSnowTile(tile);
+		case AITileList::FILTER_DESERT:    return AITile::IsDesertTile(tile);
+		default: NOT_REACHED();
+	}
+}
+
+void AITileList::ValuateDistanceManhattanToTile(TileIndex tile)
+{
+	this->ValuateNative(&TileDistanceManhattanValuator, &tile);
+}
+
+void AITileList::ValuateDistanceSquareToTile(TileIndex tile)
+{
+	this->ValuateNative(&TileDistanceSquareValuator, &tile);
+}
+
+void AITileList::ValuateBuildable()
+{
+	this->ValuateNative(&TileBuildableValuator, NULL);
+}
+
+void AITileList::ValuateSlope()
+{
+	this->ValuateNative(&TileSlopeValuator, NULL);
+}
+
+void AITileList::ValuateOwner()
+{
+	this->ValuateNative(&TileOwnerValuator, NULL);
+}
+
+void AITileList::ValuateCargoAcceptance(CargoID cargo_type, uint width, uint height, uint radius)
+{
+	TileCargoAreaData area = { cargo_type, width, height, radius };
+	this->ValuateNative(&TileCargoAcceptanceValuator, &area);
+}
+
+void AITileList::ValuateCargoProduction(CargoID cargo_type, uint width, uint height, uint radius)
+{
+	TileCargoAreaData area = { cargo_type, width, height, radius };
+	this->ValuateNative(&TileCargoProductionValuator, &area);
+}
+
+void AITileList::KeepTileFilter(TileFilter filter)
+{
+	if (filter < FILTER_BUILDABLE || filter > FILTER_DESERT) return;
+
+	this->FilterNative(&TileFilterMatches, &filter, true);
+}
+
+void AITileList::RemoveTileFilter(TileFilter filter)
+{
+	if (filter < FILTER_BUILDABLE || filter > FILTER_DESERT) return;
+
+	this->FilterNative(&TileFilterMatches, &filter, false);
+}
+
 AITileList_IndustryAccepting::AITileList_IndustryAccepting(IndustryID industry_id, uint radius)
 {
 	if (!AIIndustry::IsValidIndustry(industry_id)) return;
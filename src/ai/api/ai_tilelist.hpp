@@ -16,6 +16,23 @@ class AITileList : public AIAbstractList {
 public:
 	static const char *GetClassName() { return "AITileList"; }
 
+	/**
+	 * The kinds of tiles KeepTileFilter and RemoveTileFilter can filter on.
+	 */
+	enum TileFilter {
+		FILTER_BUILDABLE, //!< Tiles that are buildable, see AITile::IsBuildable.
+		FILTER_FLAT,      //!< Tiles without a slope.
+		FILTER_WATER,     //!< Water tiles, see AITile::IsWaterTile.
+		FILTER_COAST,     //!< Coast tiles, see AITile::IsCoastTile.
+		FILTER_STATION,   //!< Station tiles, see AITile::IsStationTile.
+		FILTER_TREE,      //!< Tiles with trees, see AITile::HasTreeOnTile.
+		FILTER_FARM,      //!< Farm tiles, see AITile::IsFarmTile.
+		FILTER_ROCK,      //!< Rock tiles, see AITile::IsRockTile.
+		FILTER_ROUGH,     //!< Rough tiles, see AITile::IsRoughTile.
+		FILTER_SNOW,      //!< Snow tiles, see AITile::IsSnowTile.
+		FILTER_DESERT,    //!< Desert tiles, see AITile::IsDesertTile.
+	};
+
 private:
 	/**
 	 * Make sure t1.x is smaller than t2.x and t1.y is smaller than t2.y.
@@ -57,6 +74,79 @@ public:
 	 * @pre AIMap::IsValidTile(tile).
 	 */
 	void RemoveTile(TileIndex tile);
+
+	/**
+	 * Give all tiles their manhattan distance to a tile as value.
+	 * @param tile The tile to get the distance to.
+	 * @note This is the same as Valuate(AITile.GetDistanceManhattanToTile, tile),
+	 *  but it runs without calling the script for every tile.
+	 */
+	void ValuateDistanceManhattanToTile(TileIndex tile);
+
+	/**
+	 * Give all tiles their square distance to a tile as value.
+	 * @param tile The tile to get the distance to.
+	 * @note This is the same as Valuate(AITile.GetDistanceSquareToTile, tile),
+	 *  but it runs without calling the script for every tile.
+	 */
+	void ValuateDistanceSquareToTile(TileIndex tile);
+
+	/**
+	 * Give all tiles the value 1 if they are buildable, else 0.
+	 * @note This is the same as Valuate(AITile.IsBuildable), but it runs
+	 *  without calling the script for every tile.
+	 */
+	void ValuateBuildable();
+
+	/**
+	 * Give all tiles their slope as value.
+	 * @note This is the same as Valuate(AITile.GetSlope), but it runs
+	 *  without calling the script for every tile.
+	 */
+	void ValuateSlope();
+
+	/**
+	 * Give all tiles their owner as value.
+	 * @note This is the same as Valuate(AITile.GetOwner), but it runs
+	 *  without calling the script for every tile.
+	 */
+	void ValuateOwner();
+
+	/**
+	 * Give all tiles the acceptance of a cargo around them as value.
+	 * @param cargo_type The cargo to check the acceptance of.
+	 * @param width The width of the station.
+	 * @param height The height of the station.
+	 * @param radius The radius of the station.
+	 * @pre AICargo::IsValidCargo(cargo_type)
+	 * @note This is the same as Valuate(AITile.GetCargoAcceptance, cargo_type, width, height, radius),
+	 *  but it runs without calling the script for every tile.
+	 */
+	void ValuateCargoAcceptance(CargoID cargo_type, uint width, uint height, uint radius);
+
+	/**
+	 * Give all tiles the amount of tiles producing a cargo around them as value.
+	 * @param cargo_type The cargo to check the production of.
+	 * @param width The width of the station.
+	 * @param height The height of the station.
+	 * @param radius The radius of the station.
+	 * @pre AICargo::IsValidCargo(cargo_type)
+	 * @note This is the same as Valuate(AITile.GetCargoProduction, cargo_type, width, height, radius),
+	 *  but it runs without calling the script for every tile.
+	 */
+	void ValuateCargoProduction(CargoID cargo_type, uint width, uint height, uint radius);
+
+	/**
+	 * Keep only the tiles of the given kind.
+	 * @param filter The kind of tiles to keep.
+	 */
+	void KeepTileFilter(TileFilter filter);
+
+	/**
+	 * Remove all tiles of the given kind.
+	 * @param filter The kind of tiles to remove.
+	 */
+	void RemoveTileFilter(TileFilter filter);
 };
 
 /**
@@ -3,6 +3,7 @@
 /** @file ai_townlist.cpp Implementation of AITownList and friends. */
 
 #include "ai_townlist.hpp"
+#include "ai_town.hpp"
 #include "../../town.h"
 
 AITownList::AITownList()
@@ -12,3 +13,43 @@ AITownList::AITownList()
 		this->AddItem(t->index);
 	}
 }
+
+static int32 TownDistanceManhattanValuator(int32 town_id, const void *data)
+{
+	return AITown::GetDistanceManhattanToTile(town_id, *(const TileIndex *)data);
+}
+
+static int32 TownDistanceSquareValuator(int32 town_id, const void *data)
+{
+	return AITown::GetDistanceSquareToTile(town_id, *(const TileIndex *)data);
+}
+
+static int32 TownPopulationValuator(int32 town_id, const void *data)
+{
+	return AITown::GetPopulation(town_id);
+}
+
+static int32 TownLastMonthProductionValuator(int32 town_id, const void *data)
+{
+	return AITown::GetLastMonthProduction(town_id, *(const CargoID *)data);
+}
+
+void AITownList::ValuateDistanceManhattanToTile(TileIndex tile)
+{
+	this->ValuateNative(&TownDistanceManhattanValuator, &tile);
+}
+
+void AITownList::ValuateDistanceSquareToTile(TileIndex tile)
+{
+	this->ValuateNative(&TownDistanceSquareValuator, &tile);
+}
+
+void AITownList::ValuatePopulation()
+{
+	this->ValuateNative(&TownPopulationValuator, NULL);
+}
+
+void AITownList::ValuateLastMonthProduction(CargoID cargo_id)
+{
+	this->ValuateNative(&TownLastMonthProductionValuator, &cargo_id);
+}
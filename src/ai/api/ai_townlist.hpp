@@ -15,6 +15,38 @@ class AITownList : public AIAbstractList {
 public:
 	static const char *GetClassName() { return "AITownList"; }
 	AITownList();
+
+	/**
+	 * Give all towns their manhattan distance to a tile as value.
+	 * @param tile The tile to get the distance to.
+	 * @note This is the same as Valuate(AITown.GetDistanceManhattanToTile, tile),
+	 *  but it runs without calling the script for every town.
+	 */
+	void ValuateDistanceManhattanToTile(TileIndex tile);
+
+	/**
+	 * Give all towns their square distance to a tile as value.
+	 * @param tile The tile to get the distance to.
+	 * @note This is the same as Valuate(AITown.GetDistanceSquareToTile, tile),
+	 *  but it runs without calling the script for every town.
+	 */
+	void ValuateDistanceSquareToTile(TileIndex tile);
+
+	/**
+	 * Give all towns their population as value.
+	 * @note This is the same as Valuate(AITown.GetPopulation), but it runs
+	 *  without calling the script for every town.
+	 */
+	void ValuatePopulation();
+
+	/**
+	 * Give all towns their production of a cargo last month as value.
+	 * @param cargo_id The cargo to get the production of.
+	 * @pre AICargo::IsValidCargo(cargo_id).
+	 * @note This is the same as Valuate(AITown.GetLastMonthProduction, cargo_id),
+	 *  but it runs without calling the script for every town.
+	 */
+	void ValuateLastMonthProduction(CargoID cargo_id);
 };
 
 #endif /* AI_TOWNLIST_HPP */
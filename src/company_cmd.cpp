@@ -29,6 +29,7 @@
 #include "rail.h"
 #include "sprite.h"
 #include "oldpool_func.h"
+#include "state_hash.h"
 
 #include "table/strings.h"
 
@@ -475,6 +476,8 @@ static void MaybeStartNewCompany()
 #ifdef ENABLE_NETWORK
 	if (_networking && ActiveCompanyCount() >= _settings_client.network.max_companies) return;
 #endif /* ENABLE_NETWORK */
+	/* When replaying a command log the start of the new company is in the log */
+	if (_replaying_commands) return;
 
 	Company *c;
 
@@ -25,11 +25,15 @@
 #include "map_func.h"
 #include "date_func.h"
 #include "vehicle_func.h"
+#include "newgrf_engine.h"
 #include "string_func.h"
 #include "company_func.h"
 #include "company_base.h"
 #include "settings_type.h"
 #include "gamelog.h"
+#include "state_hash.h"
+#include "spritecache.h"
+#include "pathfinder_stats.h"
 #include "ai/ai.hpp"
 #include "ai/ai_config.hpp"
 
@@ -1100,6 +1104,221 @@ DEF_CONSOLE_CMD(ConRescanAI)
 	return true;
 }
 
+/**
+ * Open a file in the personal directory to dump figures to. The name may
+ * not refer to a file outside of the personal directory.
+ * @param name     the name of the file as given on the console
+ * @param filename filled with the path of the file
+ * @param last     the last element of filename
+ * @return the opened file, or NULL if the name is not allowed or the file cannot be written
+ */
+static FILE *OpenDumpFile(const char *name, char *filename, const char *last)
+{
+	if (StrEmpty(name) || strchr(name, PATHSEPCHAR) != NULL || strchr(name, '/') != NULL || strstr(name, "..") != NULL) {
+		IConsolePrintF(CC_ERROR, "'%s' is not a valid filename; give the name of a file in the personal directory.", name);
+		return NULL;
+	}
+
+	snprintf(filename, last - filename + 1, "%s%s", _personal_dir, name);
+	FILE *f = fopen(filename, "w");
+	if (f == NULL) IConsolePrintF(CC_ERROR, "Cannot write to '%s'.", filename);
+	return f;
+}
+
+static FILE *_ai_stats_file; ///< The file ai_stats dumps to
+
+static void AIStatsPrintConsoleProc(const char *s)
+{
+	IConsolePrint(CC_DEFAULT, s);
+}
+
+static void AIStatsPrintFileProc(const char *s)
+{
+	fprintf(_ai_stats_file, "%s\n", s);
+}
+
+DEF_CONSOLE_CMD(ConAIStats)
+{
+	if (argc == 0) {
+		IConsoleHelp("Show the resources used by the AIs. Usage: 'ai_stats [reset | dump <filename>]'");
+		IConsoleHelp("Shows the time spent in running the scripts and collecting their garbage, the opcodes and commands they ran and their memory.");
+		IConsoleHelp("'reset' starts counting anew, 'dump' writes the stats to a file in the personal directory instead");
+		return true;
+	}
+
+	if (_networking && !_network_server) {
+		IConsoleWarning("AIs only run on the server.");
+		return true;
+	}
+
+	if (argc == 2 && strcmp(argv[1], "reset") == 0) {
+		AI::ResetStats();
+		IConsolePrint(CC_DEFAULT, "AI stats reset.");
+		return true;
+	}
+
+	if (argc == 3 && strcmp(argv[1], "dump") == 0) {
+		char filename[MAX_PATH];
+		_ai_stats_file = OpenDumpFile(argv[2], filename, lastof(filename));
+		if (_ai_stats_file == NULL) return true;
+		AI::PrintStats(&AIStatsPrintFileProc);
+		fclose(_ai_stats_file);
+		_ai_stats_file = NULL;
+		IConsolePrintF(CC_DEFAULT, "AI stats written to '%s'.", filename);
+		return true;
+	}
+
+	if (argc != 1) return false;
+
+	AI::PrintStats(&AIStatsPrintConsoleProc);
+	return true;
+}
+
+DEF_CONSOLE_CMD(ConAIProfile)
+{
+	if (argc == 0) {
+		IConsoleHelp("Profile which script functions of an AI take the most time. Usage: 'ai_profile <company-id> [<interval> | off]'");
+		IConsoleHelp("Samples the function the AI is running every <interval> opcodes (default 1000); see 'ai_stats' for the results.");
+		return true;
+	}
+
+	if (argc != 2 && argc != 3) return false;
+
+	if (_networking && !_network_server) {
+		IConsoleWarning("AIs only run on the server.");
+		return true;
+	}
+
+	CompanyID company_id = (CompanyID)(atoi(argv[1]) - 1);
+	if (!IsValidCompanyID(company_id)) {
+		IConsolePrintF(CC_DEFAULT, "Unknown company. Company range is between 1 and %d.", MAX_COMPANIES);
+		return true;
+	}
+
+	if (IsHumanCompany(company_id)) {
+		IConsoleWarning("Company is not controlled by an AI.");
+		return true;
+	}
+
+	if (argc == 3 && strcmp(argv[2], "off") == 0) {
+		AI::SetProfileInterval(company_id, 0);
+		IConsolePrint(CC_DEFAULT, "AI profiler stopped.");
+		return true;
+	}
+
+	int interval = (argc == 3) ? atoi(argv[2]) : 1000;
+	if (interval <= 0) {
+		IConsoleError("The interval must be a positive number of opcodes.");
+		return true;
+	}
+
+	AI::SetProfileInterval(company_id, interval);
+	IConsolePrint(CC_DEFAULT, "AI profiler started.");
+	return true;
+}
+
+DEF_CONSOLE_CMD(ConCallbackCache)
+{
+	if (argc == 0) {
+		IConsoleHelp("Show how often vehicle callbacks were answered from the per-tick cache. Usage: 'callback_cache [reset]'");
+		IConsoleHelp("'reset' starts counting anew");
+		return true;
+	}
+
+	if (argc == 2 && strcmp(argv[1], "reset") == 0) {
+		ResetVehicleCallbackCacheStats();
+		IConsolePrint(CC_DEFAULT, "Callback cache stats reset.");
+		return true;
+	}
+
+	if (argc != 1) return false;
+
+	uint hits, misses;
+	GetVehicleCallbackCacheStats(&hits, &misses);
+	uint total = hits + misses;
+	IConsolePrintF(CC_DEFAULT, "Vehicle callbacks: %u cached, %u resolved, hit rate %u%%", hits, misses, total == 0 ? 0 : (uint)((uint64)hits * 100 / total));
+	return true;
+}
+
+DEF_CONSOLE_CMD(ConBenchSprites)
+{
+	if (argc == 0) {
+		IConsoleHelp("Decode all sprites of the loaded GRFs with both GRF sprite decoders, check they give the same sprites and compare their speed. Usage: 'bench_sprites'");
+		IConsoleHelp("Only sprites in files that are mapped into memory can be compared");
+		return true;
+	}
+
+	if (argc != 1) return false;
+
+	SpriteDecoderBenchmark result;
+	BenchmarkSpriteDecoders(&result);
+	if (result.sprites == 0) {
+		IConsolePrint(CC_WARNING, "No sprites in files that are mapped into memory.");
+		return true;
+	}
+
+	IConsolePrintF(CC_DEFAULT, "Decoded %u sprites, %u differ", result.sprites, result.mismatches);
+	IConsolePrintF(CC_DEFAULT, "Byte by byte: %" OTTD_PRINTF64 "u ms, %.2f us per sprite", result.file_us / 1000, (double)result.file_us / result.sprites);
+	IConsolePrintF(CC_DEFAULT, "From memory:  %" OTTD_PRINTF64 "u ms, %.2f us per sprite", result.memory_us / 1000, (double)result.memory_us / result.sprites);
+	return true;
+}
+
+static FILE *_pf_stats_file; ///< The file pf_stats dumps to
+
+static void PathfinderStatsPrintConsoleProc(const char *s)
+{
+	IConsolePrint(CC_DEFAULT, s);
+}
+
+static void PathfinderStatsPrintFileProc(const char *s)
+{
+	fprintf(_pf_stats_file, "%s\n", s);
+}
+
+DEF_CONSOLE_CMD(ConPathfinderStats)
+{
+	if (argc == 0) {
+		IConsoleHelp("Show figures about the searches of the pathfinders. Usage: 'pf_stats [start | stop | reset | dump <filename>]'");
+		IConsoleHelp("Shows the number of searches, the time they took and the nodes they expanded per pathfinder, and the vehicles that took the most time.");
+		IConsoleHelp("'start' and 'stop' the recording, 'reset' starts counting anew, 'dump' writes the figures to a file in the personal directory instead");
+		return true;
+	}
+
+	if (argc == 2 && strcmp(argv[1], "start") == 0) {
+		SetRecordingPathfinderStats(true);
+		IConsolePrint(CC_DEFAULT, "Recording pathfinder stats.");
+		return true;
+	}
+
+	if (argc == 2 && strcmp(argv[1], "stop") == 0) {
+		SetRecordingPathfinderStats(false);
+		IConsolePrint(CC_DEFAULT, "Stopped recording pathfinder stats.");
+		return true;
+	}
+
+	if (argc == 2 && strcmp(argv[1], "reset") == 0) {
+		ResetPathfinderStats();
+		IConsolePrint(CC_DEFAULT, "Pathfinder stats reset.");
+		return true;
+	}
+
+	if (argc == 3 && strcmp(argv[1], "dump") == 0) {
+		char filename[MAX_PATH];
+		_pf_stats_file = OpenDumpFile(argv[2], filename, lastof(filename));
+		if (_pf_stats_file == NULL) return true;
+		PrintPathfinderStats(&PathfinderStatsPrintFileProc);
+		fclose(_pf_stats_file);
+		_pf_stats_file = NULL;
+		IConsolePrintF(CC_DEFAULT, "Pathfinder stats written to '%s'.", filename);
+		return true;
+	}
+
+	if (argc != 1) return false;
+
+	PrintPathfinderStats(&PathfinderStatsPrintConsoleProc);
+	return true;
+}
+
 DEF_CONSOLE_CMD(ConGetSeed)
 {
 	if (argc == 0) {
@@ -1677,6 +1896,25 @@ DEF_CONSOLE_CMD(ConGamelogPrint)
 	return true;
 }
 
+DEF_CONSOLE_CMD(ConReplay)
+{
+	if (argc == 0) {
+		IConsoleHelp("Replay a command log on a savegame and check the logged state hashes. Usage: 'replay <savegame> <command log>'");
+		IConsoleHelp("The command log is written with the desync debug level set to at least 1; use a copy of it, as it is overwritten while replaying");
+		return true;
+	}
+
+	if (argc != 3) return false;
+
+	if (_networking) {
+		IConsoleError("Replaying is not possible in a network game.");
+		return true;
+	}
+
+	if (ReplayCommandLog(argv[1], argv[2])) IConsolePrint(CC_DEFAULT, "No differences found.");
+	return true;
+}
+
 #ifdef _DEBUG
 /*******************************************
  *  debug commands and variables
@@ -1745,6 +1983,12 @@ void IConsoleStdLibRegister()
 	IConsoleCmdRegister("setting",      ConSetting);
 	IConsoleCmdRegister("list_settings",ConListSettings);
 	IConsoleCmdRegister("gamelog",      ConGamelogPrint);
+	IConsoleCmdRegister("replay",       ConReplay);
+	IConsoleCmdRegister("ai_stats",     ConAIStats);
+	IConsoleCmdRegister("ai_profile",   ConAIProfile);
+	IConsoleCmdRegister("pf_stats",     ConPathfinderStats);
+	IConsoleCmdRegister("callback_cache", ConCallbackCache);
+	IConsoleCmdRegister("bench_sprites", ConBenchSprites);
 
 	IConsoleAliasRegister("dir",          "ls");
 	IConsoleAliasRegister("del",          "rm %+");
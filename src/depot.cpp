@@ -10,6 +10,14 @@
 #include "core/bitmath_func.hpp"
 #include "tile_map.h"
 #include "water_map.h"
+#include "depot_map.h"
+#include "depot_func.h"
+#include "map_func.h"
+#include "track_func.h"
+#include "tunnelbridge_map.h"
+#include "tile_cmd.h"
+#include "core/alloc_func.hpp"
+#include "core/smallvec_type.hpp"
 
 DEFINE_OLD_POOL_GENERIC(Depot, Depot)
 
@@ -51,8 +59,100 @@ Depot::~Depot()
 	this->xy = INVALID_TILE;
 }
 
+static byte *_rail_depot_distance = NULL;       ///< distance of each tile to the nearest rail depot, 0xFF if none can be reached
+static bool _rail_depot_distance_valid = false; ///< is _rail_depot_distance up to date with the rail layout?
+
+/**
+ * Forget the distances to the nearest rail depots.
+ * Called whenever rail, depots, stations, tunnels or bridges are built or removed.
+ */
+void InvalidateRailDepotDistances()
+{
+	_rail_depot_distance_valid = false;
+}
+
+/**
+ * Compute the distance of every tile to the nearest rail depot.
+ * The tiles are searched outwards from all rail depots at once. A tile is
+ * connected to its neighbour when both have track at their common side,
+ * whatever the owner, railtype or the way the tracks join inside the tile.
+ * That allows more paths than any train has, so the distances found are
+ * never more than those of the path a train can take.
+ */
+static void UpdateRailDepotDistances()
+{
+	_rail_depot_distance = ReallocT(_rail_depot_distance, MapSize());
+	memset(_rail_depot_distance, 0xFF, MapSize());
+
+	SmallVector<TileIndex, 256> queue;
+
+	const Depot *depot;
+	FOR_ALL_DEPOTS(depot) {
+		if (!IsRailDepotTile(depot->xy)) continue;
+		_rail_depot_distance[depot->xy] = 0;
+		*queue.Append() = depot->xy;
+	}
+
+	for (uint i = 0; i < queue.Length(); i++) {
+		TileIndex tile = queue[i];
+		byte dist = min(_rail_depot_distance[tile] + 1, RAIL_DEPOT_DISTANCE_MAX);
+		TrackBits tracks = TrackStatusToTrackBits(GetTileTrackStatus(tile, TRANSPORT_RAIL, 0));
+
+		for (DiagDirection dir = DIAGDIR_BEGIN; dir < DIAGDIR_END; dir++) {
+			/* any track at the side of the tile we leave? */
+			if ((tracks & DiagdirReachesTracks(ReverseDiagDir(dir))) == TRACK_BIT_NONE) continue;
+
+			TileIndex next = tile + TileOffsByDiagDir(dir);
+			if (IsTileType(tile, MP_TUNNELBRIDGE) && GetTunnelBridgeDirection(tile) == dir) next = GetOtherTunnelBridgeEnd(tile);
+			if (next >= MapSize() || _rail_depot_distance[next] != 0xFF) continue;
+
+			/* any track at the side of the tile we enter? */
+			if ((TrackStatusToTrackBits(GetTileTrackStatus(next, TRANSPORT_RAIL, 0)) & DiagdirReachesTracks(dir)) == TRACK_BIT_NONE) continue;
+
+			_rail_depot_distance[next] = dist;
+			*queue.Append() = next;
+		}
+	}
+
+	_rail_depot_distance_valid = true;
+}
+
+/**
+ * Get the number of tiles a train at the given tile at least passes to
+ * reach any rail depot. The distances only change with the rail layout,
+ * so they are computed once for the whole map and kept until it changes.
+ * @param tile the tile
+ * @return the distance in tiles, at most RAIL_DEPOT_DISTANCE_MAX; UINT_MAX if no rail depot can be reached from the tile
+ */
+uint GetRailDepotDistance(TileIndex tile)
+{
+	if (!_rail_depot_distance_valid) UpdateRailDepotDistances();
+
+	byte dist = _rail_depot_distance[tile];
+	return dist == 0xFF ? UINT_MAX : dist;
+}
+
+/**
+ * Check whether there is any depot of the given kind close to a tile.
+ * @param tile the tile
+ * @param type kind of the depot
+ * @param distance maximal manhattan distance of the depot to the tile
+ * @return true if such a depot exists, of any owner
+ */
+bool IsDepotNearTile(TileIndex tile, TransportType type, uint distance)
+{
+	const Depot *depot;
+	FOR_ALL_DEPOTS(depot) {
+		if (DistanceManhattan(depot->xy, tile) <= distance && IsDepotTypeTile(depot->xy, type)) return true;
+	}
+
+	return false;
+}
+
 void InitializeDepots()
 {
 	_Depot_pool.CleanPool();
 	_Depot_pool.AddBlockToPool();
+
+	InvalidateRailDepotDistances();
 }
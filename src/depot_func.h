@@ -10,10 +10,18 @@
 #include "vehicle_type.h"
 #include "direction_type.h"
 #include "slope_type.h"
+#include "transport_type.h"
 
 void ShowDepotWindow(TileIndex tile, VehicleType type);
 void InitializeDepots();
 
+/** Distances to rail depots of this many tiles or more are all given as this. */
+static const uint RAIL_DEPOT_DISTANCE_MAX = 0xFE;
+
+void InvalidateRailDepotDistances();
+uint GetRailDepotDistance(TileIndex tile);
+bool IsDepotNearTile(TileIndex tile, TransportType type, uint distance);
+
 void DeleteDepotHighlightOfVehicle(const Vehicle *v);
 
 /**
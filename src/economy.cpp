@@ -32,6 +32,7 @@
 #include "autoreplace_func.h"
 #include "company_gui.h"
 #include "signs_base.h"
+#include "signal_func.h"
 
 #include "table/strings.h"
 #include "table/sprites.h"
@@ -374,6 +375,11 @@ void ChangeOwnershipOfCompanyItems(Owner old_owner, Owner new_owner)
 			ChangeTileOwner(tile, old_owner, new_owner);
 		} while (++tile != MapSize());
 
+		/* signal blocks are searched per owner, so they all change */
+		InvalidateSignalBlocks(INVALID_TILE);
+		/* reservations are followed per owner as well */
+		InvalidateFollowedReservations(INVALID_TILE);
+
 		if (new_owner != INVALID_OWNER) {
 			/* Update all signals because there can be new segment that was owned by two companies
 			 * and signals were not propagated
@@ -19,6 +19,13 @@
 
 #include <unistd.h>
 
+/* Map the files in the Fio slots into memory where the OS supports it;
+ * reading is then nothing more than walking through the mapping. */
+#if defined(UNIX) && !defined(N3DS) && !defined(PSP) && !defined(__MORPHOS__) && !defined(__AMIGA__) && !defined(DOS)
+#	define WITH_FIO_MMAP
+#	include <sys/mman.h>
+#endif
+
 
 /*************************************************/
 /* FILE IO ROUTINES ******************************/
@@ -30,11 +37,15 @@ struct Fio {
 	byte *buffer, *buffer_end;             ///< position pointer in local buffer and last valid byte of buffer
 	size_t pos;                            ///< current (system) position in file
 	FILE *cur_fh;                          ///< current file handle
+	byte *cur_map;                         ///< mapping of the current file, or NULL when it is read via the buffer
+	size_t cur_map_size;                   ///< size of the mapping of the current file
 	const char *filename;                  ///< current filename
 	FILE *handles[MAX_FILE_SLOTS];         ///< array of file handles we can have open
 	byte buffer_start[FIO_BUFFER_SIZE];    ///< local buffer when read from file
 	const char *filenames[MAX_FILE_SLOTS]; ///< array of filenames we (should) have open
 	char *shortnames[MAX_FILE_SLOTS];///< array of short names for spriteloader's use
+	byte *maps[MAX_FILE_SLOTS];            ///< array of memory mappings of the files, NULL when not mapped
+	size_t map_sizes[MAX_FILE_SLOTS];      ///< array of sizes of the memory mappings
 #if defined(LIMITED_FDS)
 	uint open_handles;                     ///< current amount of open handles
 	uint usage_count[MAX_FILE_SLOTS];      ///< count how many times this file has been opened
@@ -54,9 +65,96 @@ const char *FioGetFilename(uint8 slot)
 	return _fio.shortnames[slot];
 }
 
+/**
+ * Get the name of the file in a slot as it was passed to FioOpenFile.
+ * @param slot the slot to get the filename of
+ * @return the filename
+ */
+const char *FioGetFullFilename(uint8 slot)
+{
+	return _fio.filenames[slot];
+}
+
+/**
+ * Get the memory mapping of the file in a slot. The mapping stays valid
+ * till the slot is closed or opened again, so it can be read by other
+ * threads as long as the main thread doesn't do that meanwhile.
+ * @param slot the slot to get the mapping of
+ * @param size filled with the size of the mapping
+ * @return the mapping, or NULL when the file isn't mapped
+ */
+const byte *FioGetMapping(uint8 slot, size_t *size)
+{
+#if defined(LIMITED_FDS)
+	/* The file, and thus its mapping, may be closed at any moment */
+	*size = 0;
+	return NULL;
+#else
+	*size = _fio.map_sizes[slot];
+	return _fio.maps[slot];
+#endif /* LIMITED_FDS */
+}
+
+/**
+ * Map the whole of an opened file into memory, read only.
+ * @param f the file to map
+ * @param size filled with the size of the mapping
+ * @return the mapping, or NULL when the file is empty or can't be mapped
+ */
+byte *FioMapFile(FILE *f, size_t *size)
+{
+	*size = 0;
+#if defined(WITH_FIO_MMAP)
+	struct stat sb;
+	if (fstat(fileno(f), &sb) != 0 || sb.st_size == 0) return NULL;
+
+	void *map = mmap(NULL, sb.st_size, PROT_READ, MAP_PRIVATE, fileno(f), 0);
+	if (map == MAP_FAILED) {
+		DEBUG(misc, 6, "Cannot map file of %d bytes", (int)sb.st_size);
+		return NULL;
+	}
+
+	*size = sb.st_size;
+	return (byte *)map;
+#else
+	return NULL;
+#endif /* WITH_FIO_MMAP */
+}
+
+/**
+ * Free the mapping of a file made by FioMapFile.
+ * @param map the mapping, may be NULL
+ * @param size the size of the mapping
+ */
+void FioUnmapFile(byte *map, size_t size)
+{
+#if defined(WITH_FIO_MMAP)
+	if (map != NULL) munmap(map, size);
+#endif /* WITH_FIO_MMAP */
+}
+
 void FioSeekTo(size_t pos, int mode)
 {
 	if (mode == SEEK_CUR) pos += FioGetPos();
+
+	if (_fio.cur_map != NULL) {
+		/* The whole file is the buffer; pos is the end of it */
+		_fio.buffer = _fio.cur_map + min(pos, _fio.cur_map_size);
+		_fio.buffer_end = _fio.cur_map + _fio.cur_map_size;
+		_fio.pos = _fio.cur_map_size;
+		return;
+	}
+
+	/* Stay in the buffer when it already contains the position. An
+	 * invalidated buffer is empty and ends at the end of the buffer. */
+	if (_fio.buffer_end != _fio.buffer_start + FIO_BUFFER_SIZE || _fio.buffer != _fio.buffer_end) {
+		size_t buffer_pos = _fio.pos - (_fio.buffer_end - _fio.buffer_start);
+		if (pos >= buffer_pos && pos < _fio.pos) {
+			_fio.buffer = _fio.buffer_start + (pos - buffer_pos);
+			return;
+		}
+	}
+
 	_fio.buffer = _fio.buffer_end = _fio.buffer_start + FIO_BUFFER_SIZE;
 	_fio.pos = pos;
 	fseek(_fio.cur_fh, _fio.pos, SEEK_SET);
@@ -85,13 +183,21 @@ void FioSeekToFile(uint8 slot, size_t pos)
 	f = _fio.handles[slot];
 	assert(f != NULL);
 	_fio.cur_fh = f;
+	_fio.cur_map = _fio.maps[slot];
+	_fio.cur_map_size = _fio.map_sizes[slot];
 	_fio.filename = _fio.filenames[slot];
+	/* The buffer belongs to the previous file; when that file is mapped it
+	 * points into its mapping, and FioSeekTo would otherwise try to stay in it */
+	_fio.buffer = _fio.buffer_end = _fio.buffer_start + FIO_BUFFER_SIZE;
 	FioSeekTo(pos, SEEK_SET);
 }
 
 byte FioReadByte()
 {
 	if (_fio.buffer == _fio.buffer_end) {
+		/* A mapped file has no more to read when we're at the end of its mapping */
+		if (_fio.cur_map != NULL) return 0;
+
 		_fio.buffer = _fio.buffer_start;
 		size_t size = fread(_fio.buffer, 1, FIO_BUFFER_SIZE, _fio.cur_fh);
 		_fio.pos += size;
@@ -128,13 +234,38 @@ uint32 FioReadDword()
 
 void FioReadBlock(void *ptr, size_t size)
 {
-	FioSeekTo(FioGetPos(), SEEK_SET);
-	_fio.pos += fread(ptr, 1, size, _fio.cur_fh);
+	/* First take what is in the buffer; for mapped files that is the rest of the file */
+	size_t buffered = min<size_t>(_fio.buffer_end - _fio.buffer, size);
+	memcpy(ptr, _fio.buffer, buffered);
+	_fio.buffer += buffered;
+	size -= buffered;
+	if (size == 0) return;
+
+	/* The buffer is empty, so the file handle is exactly at our position */
+	size_t read = 0;
+	if (_fio.cur_map == NULL) {
+		read = fread((byte *)ptr + buffered, 1, size, _fio.cur_fh);
+		_fio.pos += read;
+		/* The buffer is behind the position of the file now */
+		_fio.buffer = _fio.buffer_end = _fio.buffer_start + FIO_BUFFER_SIZE;
+	}
+
+	/* Like FioReadByte, reading beyond the end of the file gives zeros */
+	if (read < size) memset((byte *)ptr + buffered + read, 0, size - read);
 }
 
 static inline void FioCloseFile(int slot)
 {
 	if (_fio.handles[slot] != NULL) {
+		FioUnmapFile(_fio.maps[slot], _fio.map_sizes[slot]);
+		if (_fio.cur_fh == _fio.handles[slot]) {
+			/* For a mapped file the buffer points into the mapping, which is gone now */
+			_fio.cur_map = NULL;
+			_fio.buffer = _fio.buffer_end = _fio.buffer_start + FIO_BUFFER_SIZE;
+		}
+		_fio.maps[slot] = NULL;
+		_fio.map_sizes[slot] = 0;
+
 		fclose(_fio.handles[slot]);
 
 		free(_fio.shortnames[slot]);
@@ -194,6 +325,11 @@ void FioOpenFile(int slot, const char *filename)
 	_fio.handles[slot] = f;
 	_fio.filenames[slot] = filename;
 
+	/* Map the whole file, also when it's inside a tar, as the positions
+	 * we get are in the tar and not in the file within it. When mapping
+	 * fails we simply read via the buffer. */
+	_fio.maps[slot] = FioMapFile(f, &_fio.map_sizes[slot]);
+
 	/* Store the filename without path and extension */
 	const char *t = strrchr(filename, PATHSEPCHAR);
 	_fio.shortnames[slot] = strdup(t == NULL ? filename : t);
@@ -11,6 +11,7 @@ void FioSeekTo(size_t pos, int mode);
 void FioSeekToFile(uint8 slot, size_t pos);
 size_t FioGetPos();
 const char *FioGetFilename(uint8 slot);
+const char *FioGetFullFilename(uint8 slot);
 byte FioReadByte();
 uint16 FioReadWord();
 uint32 FioReadDword();
@@ -19,6 +20,9 @@ void FioOpenFile(int slot, const char *filename);
 void FioReadBlock(void *ptr, size_t size);
 void FioSkipBytes(int n);
 void FioCreateDirectory(const char *filename);
+byte *FioMapFile(FILE *f, size_t *size);
+void FioUnmapFile(byte *map, size_t size);
+const byte *FioGetMapping(uint8 slot, size_t *size);
 
 /**
  * The searchpaths OpenTTD could search through.
@@ -310,6 +310,19 @@ static void LoadSpriteTables()
 }
 
 
+/**
+ * The sprites of the base graphics that are drawn in nearly every game: the
+ * terrain, rails, roads and vehicles. When the warm-up is enabled they are
+ * decoded ahead of their first use.
+ */
+static const SpriteID _sprite_warmup_ranges[][2] = {
+	{ SPR_FLAT_BARE_LAND,          SPR_FLAT_WATER_TILE + 18         }, ///< Terrain and water
+	{ SPR_FLAT_1_QUART_SNOWY_TILE, SPR_FLAT_SNOWY_TILE + 18         }, ///< Snowy terrain
+	{ SPR_RAIL_SINGLE_Y,           SPR_ORIGINAL_SIGNALS_BASE + 47   }, ///< Rails, depots and signals
+	{ SPR_ROAD_Y,                  SPR_EXCAVATION_Y                 }, ///< Roads
+	{ SPR_ORIGINAL_VEHICLES_BASE,  SPR_ROTOR_MOVING_3               }, ///< Trains, road vehicles, ships and aircraft
+};
+
 void GfxLoadSprites()
 {
 	DEBUG(sprite, 2, "Loading sprite set %d", _settings_game.game_creation.landscape);
@@ -317,6 +330,9 @@ void GfxLoadSprites()
 	GfxInitSpriteMem();
 	LoadSpriteTables();
 	GfxInitPalettes();
+
+	StartSpriteWarmup();
+	for (uint i = 0; i < lengthof(_sprite_warmup_ranges); i++) QueueSpriteWarmup(_sprite_warmup_ranges[i][0], _sprite_warmup_ranges[i][1]);
 }
 
 /**
@@ -22,6 +22,7 @@
 #include "effectvehicle_func.h"
 #include "landscape_type.h"
 #include "settings_type.h"
+#include "yapf/yapf.h"
 
 #include "table/sprites.h"
 
@@ -473,6 +474,7 @@ void DoClearSquare(TileIndex tile)
 {
 	MakeClear(tile, CLEAR_GRASS, _generating_world ? 3 : 0);
 	MarkTileDirtyByTile(tile);
+	YapfNotifyWaterLayoutChange(tile);
 }
 
 /** Returns information about trackdirs and signal states.
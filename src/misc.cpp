@@ -24,6 +24,8 @@
 #include "tilehighlight_func.h"
 #include "network/network_func.h"
 #include "window_func.h"
+#include "yapf/yapf.h"
+#include "signal_func.h"
 
 #include "table/sprites.h"
 
@@ -58,6 +60,10 @@ void InitializeGame(uint size_x, uint size_y, bool reset_date)
 	UnInitWindowSystem();
 
 	AllocateMap(size_x, size_y);
+	YapfNotifyTrackLayoutChange(INVALID_TILE, INVALID_TRACK);
+	YapfNotifyWaterLayoutChange(INVALID_TILE);
+	YapfFreeNodeListArenas();
+	InvalidateSignalBlocks(INVALID_TILE);
 
 	SetObjectToPlace(SPR_CURSOR_ZZZ, PAL_NONE, VHM_NONE, WC_MAIN_WINDOW, 0);
 
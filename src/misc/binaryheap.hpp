@@ -5,6 +5,8 @@
 #ifndef  BINARYHEAP_HPP
 #define  BINARYHEAP_HPP
 
+#include "../core/alloc_func.hpp"
+
 /**
  * Binary Heap as C++ template.
  *
@@ -14,6 +16,7 @@
  * Implementation specific notes:
  *
  * 1) It allocates space for item pointers (array). Items are allocated elsewhere.
+ *    The array grows when needed, up to the maximum number of items.
  *
  * 2) ItemPtr [0] is never used. Total array size is max_items + 1, because we
  *    use indices 1..max_items instead of zero based C indexing.
@@ -30,20 +33,29 @@ public:
 private:
 	int                     m_size;     ///< Number of items in the heap
 	int                     m_max_size; ///< Maximum number of items the heap can hold
+	int                     m_capacity; ///< Number of items the heap has room for now
 	ItemPtr                *m_items;    ///< The heap item pointers
 
+	/** Make room for (at least) one more item. */
+	void Grow()
+	{
+		m_capacity = min(max(m_capacity * 2, 1024), m_max_size);
+		m_items = ReallocT(m_items, m_capacity + 1);
+	}
+
 public:
 	explicit CBinaryHeapT(int max_items = 102400)
 		: m_size(0)
 		, m_max_size(max_items)
+		, m_capacity(0)
+		, m_items(NULL)
 	{
-		m_items = new ItemPtr[max_items + 1];
 	}
 
 	~CBinaryHeapT()
 	{
 		Clear();
-		delete [] m_items;
+		free(m_items);
 		m_items = NULL;
 	}
 
@@ -84,6 +96,16 @@ public:
 	 * All remaining items will remain untouched. */
 	void Clear() {m_size = 0;};
 
+	/** Free the room for items beyond the given number of items.
+	 *  @param max_items number of items to keep room for; at least the number of items in the queue */
+	void Compact(int max_items)
+	{
+		assert(max_items >= m_size);
+		if (m_capacity <= max_items) return;
+		m_capacity = max_items;
+		m_items = ReallocT(m_items, m_capacity + 1);
+	}
+
 	/** verifies the heap consistency (added during first YAPF debug phase) */
 	void CheckConsistency();
 };
@@ -93,6 +115,7 @@ template <class Titem_>
 FORCEINLINE bool CBinaryHeapT<Titem_>::Push(Titem_& new_item)
 {
 	if (IsFull()) return false;
+	if (m_size == m_capacity) Grow();
 
 	/* make place for new item */
 	int gap = ++m_size;
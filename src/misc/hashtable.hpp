@@ -11,8 +11,9 @@ struct CHashTableSlotT
 	typedef typename Titem_::Key Key;          // make Titem_::Key a property of HashTable
 
 	Titem_ *m_pFirst;
+	uint    m_generation; ///< generation of the hash table the items of this slot belong to
 
-	CHashTableSlotT() : m_pFirst(NULL) {}
+	CHashTableSlotT() : m_pFirst(NULL), m_generation(0) {}
 
 	/** hash table slot helper - clears the slot by simple forgetting its items */
 	FORCEINLINE void Clear() {m_pFirst = NULL;}
@@ -133,8 +134,9 @@ protected:
 	 *  Titem contains pointer to the next item - GetHashNext(), SetHashNext() */
 	typedef CHashTableSlotT<Titem_> Slot;
 
-	Slot *m_slots;     // here we store our data (array of blobs)
-	int   m_num_items; // item counter
+	Slot *m_slots;      // here we store our data (array of blobs)
+	int   m_num_items;  // item counter
+	uint  m_generation; // slots stamped with another generation are empty
 
 public:
 	/* default constructor */
@@ -143,6 +145,7 @@ public:
 		/* construct all slots */
 		m_slots = new Slot[Tcapacity];
 		m_num_items = 0;
+		m_generation = 0;
 	}
 
 	~CHashTableT() {delete [] m_slots; m_num_items = 0; m_slots = NULL;}
@@ -163,18 +166,41 @@ protected:
 	/** static helper - return hash for the given item modulo number of slots */
 	FORCEINLINE static int CalcHash(const Titem_& item) {return CalcHash(item.GetKey());}
 
+	/** return the slot for the given hash, emptying it first if it belongs to an older generation */
+	FORCEINLINE Slot& GetSlot(int hash)
+	{
+		Slot& slot = m_slots[hash];
+		if (slot.m_generation != m_generation) {
+			slot.Clear();
+			slot.m_generation = m_generation;
+		}
+		return slot;
+	}
+
 public:
 	/** item count */
 	FORCEINLINE int Count() const {return m_num_items;}
 
-	/** simple clear - forget all items - used by CSegmentCostCacheT.Flush() */
-	FORCEINLINE void Clear() const {for (int i = 0; i < Tcapacity; i++) m_slots[i].Clear();}
+	/** simple clear - forget all items by starting a new generation of slots,
+	 *  so the slots themselves are not touched - used by CSegmentCostCacheT.Flush()
+	 *  and by the node lists that are reused between searches */
+	FORCEINLINE void Clear()
+	{
+		m_num_items = 0;
+		if (++m_generation != 0) return;
+		/* the generation wrapped around, so old stamps could become valid again */
+		for (int i = 0; i < Tcapacity; i++) {
+			m_slots[i].Clear();
+			m_slots[i].m_generation = 0;
+		}
+	}
 
 	/** const item search */
 	const Titem_ *Find(const Tkey& key) const
 	{
 		int hash = CalcHash(key);
 		const Slot& slot = m_slots[hash];
+		if (slot.m_generation != m_generation) return NULL;
 		const Titem_ *item = slot.Find(key);
 		return item;
 	}
@@ -184,6 +210,7 @@ public:
 	{
 		int hash = CalcHash(key);
 		Slot& slot = m_slots[hash];
+		if (slot.m_generation != m_generation) return NULL;
 		Titem_ *item = slot.Find(key);
 		return item;
 	}
@@ -192,7 +219,7 @@ public:
 	Titem_ *TryPop(const Tkey& key)
 	{
 		int hash = CalcHash(key);
-		Slot& slot = m_slots[hash];
+		Slot& slot = GetSlot(hash);
 		Titem_ *item = slot.Detach(key);
 		if (item != NULL) {
 			m_num_items--;
@@ -213,7 +240,7 @@ public:
 	{
 		const Tkey& key = item.GetKey();
 		int hash = CalcHash(key);
-		Slot& slot = m_slots[hash];
+		Slot& slot = GetSlot(hash);
 		bool ret = slot.Detach(item);
 		if (ret) {
 			m_num_items--;
@@ -232,7 +259,7 @@ public:
 	void Push(Titem_& new_item)
 	{
 		int hash = CalcHash(new_item);
-		Slot& slot = m_slots[hash];
+		Slot& slot = GetSlot(hash);
 		assert(slot.Find(new_item.GetKey()) == NULL);
 		slot.Attach(new_item);
 		m_num_items++;
@@ -28,6 +28,7 @@ NetworkClientSocket::NetworkClientSocket(ClientID client_id)
 {
 	this->client_id         = client_id;
 	this->status            = STATUS_INACTIVE;
+	this->map_encodings     = 0;
 }
 
 NetworkClientSocket::~NetworkClientSocket()
@@ -92,6 +92,7 @@ public:
 	byte lag_test;            ///< Byte used for lag-testing the client
 
 	ClientStatus status;      ///< Status of this client
+	uint8 map_encodings;      ///< Bitmask of the MapTransferEncodings the client is able to decode
 
 	CommandPacket *command_queue; ///< The command-queue awaiting delivery
 
@@ -457,11 +457,17 @@ void NetworkCloseClient(NetworkClientSocket *cs)
 	}
 
 	if (_network_server) {
+		/* The savegame that was being sent to the client is not needed anymore */
+		if (cs->status == STATUS_MAP) NetworkServerFreeMapTransfer();
+
 		/* We just lost one client :( */
 		if (cs->status >= STATUS_AUTH) _network_game_info.clients_on--;
 		_network_clients_connected--;
 
 		InvalidateWindow(WC_CLIENT_LIST, 0);
+	} else {
+		/* Nor is the savegame that was being received from the server */
+		NetworkClientFreeMapTransfer();
 	}
 
 	delete cs->GetInfo();
@@ -23,9 +23,14 @@
 #include "../company_gui.h"
 #include "../settings_type.h"
 #include "../rev.h"
+#include "../core/alloc_func.hpp"
 
 #include "table/strings.h"
 
+#if defined(WITH_ZLIB)
+#include <zlib.h>
+#endif /* WITH_ZLIB */
+
 /* This file handles all the client-commands */
 
 
@@ -174,10 +179,16 @@ DEF_CLIENT_SEND_COMMAND(PACKET_CLIENT_GETMAP)
 	 * Packet: CLIENT_GETMAP
 	 * Function: Request the map from the server
 	 * Data:
-	 *    <none>
+	 *    uint8:  Bitmask of the MapTransferEncodings the client can decode
 	 */
 
+	uint8 encodings = 1 << MAP_ENCODING_NONE;
+#if defined(WITH_ZLIB)
+	SetBit(encodings, MAP_ENCODING_ZLIB);
+#endif /* WITH_ZLIB */
+
 	Packet *p = NetworkSend_Init(PACKET_CLIENT_GETMAP);
+	p->Send_uint8(encodings);
 	MY_CLIENT->Send_Packet(p);
 }
 
@@ -334,7 +345,7 @@ DEF_CLIENT_SEND_COMMAND_PARAM(PACKET_CLIENT_MOVE)(CompanyID company, const char
  *   DEF_CLIENT_RECEIVE_COMMAND has parameter: Packet *p
  ************/
 
-extern bool SafeSaveOrLoad(const char *filename, int mode, GameMode newgm, Subdirectory subdir);
+extern bool SafeLoadFromStream(LoadStreamProc *proc, GameMode newgm);
 extern StringID _switch_mode_errorstr;
 
 DEF_CLIENT_RECEIVE_COMMAND(PACKET_SERVER_FULL)
@@ -549,10 +560,129 @@ DEF_CLIENT_RECEIVE_COMMAND(PACKET_SERVER_WAIT)
 	return NETWORK_RECV_STATUS_OKAY;
 }
 
-DEF_CLIENT_RECEIVE_COMMAND(PACKET_SERVER_MAP)
+/** The number of bytes of the encoded savegame that are kept together. */
+static const size_t MAP_TRANSFER_CHUNK_SIZE = 16384;
+
+/** A part of the encoded savegame that is being received from the server. */
+struct MapTransferChunk {
+	MapTransferChunk *next;             ///< The next part of the encoded savegame
+	size_t size;                        ///< The number of bytes in data
+	byte data[MAP_TRANSFER_CHUNK_SIZE]; ///< The encoded savegame bytes
+};
+
+/**
+ * State of the savegame that is being received from the server. It is kept
+ * encoded, as that is a lot smaller, and only decoded while it is loaded.
+ */
+static struct {
+	MapTransferChunk *first;      ///< The first part of the encoded savegame that has not been loaded yet
+	MapTransferChunk *last;       ///< The last part of the encoded savegame
+	size_t read;                  ///< The number of bytes of the first part that have been loaded
+	bool decoded;                 ///< Whether the end of the encoded savegame has been decoded
+	MapTransferEncoding encoding; ///< The encoding of the savegame
+#if defined(WITH_ZLIB)
+	z_stream z;                   ///< The inflater for MAP_ENCODING_ZLIB
+#endif /* WITH_ZLIB */
+} _map_transfer;
+
+/** Free the savegame that is being received and stop decoding it. */
+void NetworkClientFreeMapTransfer()
+{
+#if defined(WITH_ZLIB)
+	if (_map_transfer.encoding == MAP_ENCODING_ZLIB) inflateEnd(&_map_transfer.z);
+#endif /* WITH_ZLIB */
+	while (_map_transfer.first != NULL) {
+		MapTransferChunk *c = _map_transfer.first;
+		_map_transfer.first = c->next;
+		delete c;
+	}
+	memset(&_map_transfer, 0, sizeof(_map_transfer));
+}
+
+/**
+ * Keep a part of the encoded savegame as it arrives.
+ * @param buf the encoded bytes
+ * @param len the number of encoded bytes
+ */
+static void NetworkAppendMapTransfer(const byte *buf, size_t len)
+{
+	while (len != 0) {
+		MapTransferChunk *c = _map_transfer.last;
+		if (c == NULL || c->size == MAP_TRANSFER_CHUNK_SIZE) {
+			c = new MapTransferChunk;
+			c->next = NULL;
+			c->size = 0;
+
+			if (_map_transfer.last == NULL) {
+				_map_transfer.first = c;
+			} else {
+				_map_transfer.last->next = c;
+			}
+			_map_transfer.last = c;
+		}
+
+		size_t n = min(len, MAP_TRANSFER_CHUNK_SIZE - c->size);
+		memcpy(c->data + c->size, buf, n);
+		c->size += n;
+		buf += n;
+		len -= n;
+	}
+}
+
+/**
+ * Decode the savegame for the loader, freeing every part of
+ * the encoded savegame as soon as it has been decoded.
+ * @param buf the buffer to read the savegame bytes into
+ * @param len the maximum number of bytes to read
+ * @return the number of bytes read
+ */
+static size_t NetworkMapTransferReader(byte *buf, size_t len)
 {
-	static FILE *file_pointer;
+	size_t n = 0;
+
+	while (n != len && !_map_transfer.decoded) {
+		MapTransferChunk *c = _map_transfer.first;
+		const byte *in = (c == NULL) ? NULL : c->data + _map_transfer.read;
+		size_t avail = (c == NULL) ? 0 : c->size - _map_transfer.read;
+
+#if defined(WITH_ZLIB)
+		if (_map_transfer.encoding == MAP_ENCODING_ZLIB) {
+			z_streamp z = &_map_transfer.z;
+			z->next_in = (Bytef *)in;
+			z->avail_in = (uInt)avail;
+			z->next_out = buf + n;
+			z->avail_out = (uInt)(len - n);
+
+			int r = inflate(z, Z_NO_FLUSH);
+			n = len - z->avail_out;
+			_map_transfer.read += avail - z->avail_in;
+
+			/* Anything else means the savegame is broken or has been read completely */
+			if (r != Z_OK) _map_transfer.decoded = true;
+		} else
+#endif /* WITH_ZLIB */
+		{
+			if (c == NULL) break;
+
+			size_t m = min(avail, len - n);
+			memcpy(buf + n, in, m);
+			n += m;
+			_map_transfer.read += m;
+		}
+
+		if (c != NULL && _map_transfer.read == c->size) {
+			_map_transfer.first = c->next;
+			if (_map_transfer.first == NULL) _map_transfer.last = NULL;
+			_map_transfer.read = 0;
+			delete c;
+		}
+	}
+
+	return n;
+}
 
+DEF_CLIENT_RECEIVE_COMMAND(PACKET_SERVER_MAP)
+{
 	byte maptype;
 
 	maptype = p->Recv_uint8();
@@ -561,11 +691,7 @@ DEF_CLIENT_RECEIVE_COMMAND(PACKET_SERVER_MAP)
 
 	/* First packet, init some stuff */
 	if (maptype == MAP_PACKET_START) {
-		file_pointer = FioFOpenFile("network_client.tmp", "wb", AUTOSAVE_DIR);;
-		if (file_pointer == NULL) {
-			_switch_mode_errorstr = STR_NETWORK_ERR_SAVEGAMEERROR;
-			return NETWORK_RECV_STATUS_SAVEGAME;
-		}
+		NetworkClientFreeMapTransfer();
 
 		_frame_counter = _frame_counter_server = _frame_counter_max = p->Recv_uint32();
 
@@ -580,6 +706,23 @@ DEF_CLIENT_RECEIVE_COMMAND(PACKET_SERVER_MAP)
 		if (MY_CLIENT->has_quit) return NETWORK_RECV_STATUS_CONN_LOST;
 		if (_network_join_bytes_total == 0) return NETWORK_RECV_STATUS_MALFORMED_PACKET;
 
+		uint8 encoding = p->Recv_uint8();
+		switch (encoding) {
+			case MAP_ENCODING_NONE: break;
+
+#if defined(WITH_ZLIB)
+			case MAP_ENCODING_ZLIB:
+				if (inflateInit(&_map_transfer.z) != Z_OK) {
+					_switch_mode_errorstr = STR_NETWORK_ERR_SAVEGAMEERROR;
+					return NETWORK_RECV_STATUS_SAVEGAME;
+				}
+				break;
+#endif /* WITH_ZLIB */
+
+			default: return NETWORK_RECV_STATUS_MALFORMED_PACKET;
+		}
+		_map_transfer.encoding = (MapTransferEncoding)encoding;
+
 		_network_join_status = NETWORK_JOIN_STATUS_DOWNLOADING;
 		InvalidateWindow(WC_NETWORK_STATUS_WINDOW, 0);
 
@@ -588,25 +731,24 @@ DEF_CLIENT_RECEIVE_COMMAND(PACKET_SERVER_MAP)
 	}
 
 	if (maptype == MAP_PACKET_NORMAL) {
-		/* We are still receiving data, put it to the file */
-		if (fwrite(p->buffer + p->pos, 1, p->size - p->pos, file_pointer) != (size_t)(p->size - p->pos)) {
-			_switch_mode_errorstr = STR_NETWORK_ERR_SAVEGAMEERROR;
-			return NETWORK_RECV_STATUS_SAVEGAME;
-		}
+		/* We are still receiving data, keep it until it is loaded */
+		_network_join_bytes = min(p->Recv_uint32(), _network_join_bytes_total);
+		NetworkAppendMapTransfer(p->buffer + p->pos, p->size - p->pos);
 
-		_network_join_bytes = ftell(file_pointer);
 		InvalidateWindow(WC_NETWORK_STATUS_WINDOW, 0);
 	}
 
 	/* Check if this was the last packet */
 	if (maptype == MAP_PACKET_END) {
-		fclose(file_pointer);
-
+		_network_join_bytes = _network_join_bytes_total;
 		_network_join_status = NETWORK_JOIN_STATUS_PROCESSING;
 		InvalidateWindow(WC_NETWORK_STATUS_WINDOW, 0);
 
 		/* The map is done downloading, load it */
-		if (!SafeSaveOrLoad("network_client.tmp", SL_LOAD, GM_NORMAL, AUTOSAVE_DIR)) {
+		bool loaded = SafeLoadFromStream(&NetworkMapTransferReader, GM_NORMAL);
+		NetworkClientFreeMapTransfer();
+
+		if (!loaded) {
 			DeleteWindowById(WC_NETWORK_STATUS_WINDOW, 0);
 			_switch_mode_errorstr = STR_NETWORK_ERR_SAVEGAMEERROR;
 			return NETWORK_RECV_STATUS_SAVEGAME;
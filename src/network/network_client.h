@@ -22,6 +22,7 @@ DEF_CLIENT_SEND_COMMAND_PARAM(PACKET_CLIENT_MOVE)(CompanyID company, const char
 
 NetworkRecvStatus NetworkClient_ReadPackets(NetworkClientSocket *cs);
 void NetworkClient_Connected();
+void NetworkClientFreeMapTransfer();
 
 #endif /* ENABLE_NETWORK */
 
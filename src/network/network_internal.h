@@ -41,6 +41,13 @@ enum MapPacket {
 	MAP_PACKET_END,
 };
 
+/** Encodings of the savegame that is sent with PACKET_SERVER_MAP. */
+enum MapTransferEncoding {
+	MAP_ENCODING_NONE,   ///< The savegame as it is written by the LZO compressor
+	MAP_ENCODING_ZLIB,   ///< An uncompressed savegame, deflated while it is being written
+	MAP_ENCODING_END,    ///< Used for iterations
+};
+
 
 enum NetworkJoinStatus {
 	NETWORK_JOIN_STATUS_CONNECTING,
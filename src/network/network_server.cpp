@@ -26,6 +26,10 @@
 
 #include "table/strings.h"
 
+#if defined(WITH_ZLIB)
+#include <zlib.h>
+#endif /* WITH_ZLIB */
+
 /* This file handles all the server-commands */
 
 static void NetworkHandleCommandQueue(NetworkClientSocket *cs);
@@ -280,6 +284,201 @@ DEF_SERVER_SEND_COMMAND(PACKET_SERVER_WAIT)
 	cs->Send_Packet(p);
 }
 
+/** The number of bytes of the savegame in memory that are encoded at once. */
+static const uint MAP_TRANSFER_STEP = 8192;
+
+/** State of the savegame that is being transferred to a client. */
+static struct {
+	Packet *first;                ///< The first packet of the encoded savegame that still has to be sent
+	Packet *last;                 ///< The last packet of the encoded savegame, which is being filled
+	uint32 bytes;                 ///< The number of encoded bytes in all packets
+	uint32 size;                  ///< The number of bytes of the savegame in memory
+	uint32 encoded;               ///< The number of bytes of the savegame in memory that have been encoded
+	bool finished;                ///< Whether the whole savegame has been encoded
+	MapTransferEncoding encoding; ///< The encoding of the savegame
+#if defined(WITH_ZLIB)
+	z_stream z;                   ///< The deflater for MAP_ENCODING_ZLIB
+#endif /* WITH_ZLIB */
+} _map_transfer;
+
+/** Stop encoding the savegame that is being transferred and remove all its packets. */
+void NetworkServerFreeMapTransfer()
+{
+	AbortSaveToStream();
+#if defined(WITH_ZLIB)
+	if (_map_transfer.encoding == MAP_ENCODING_ZLIB && !_map_transfer.finished) deflateEnd(&_map_transfer.z);
+#endif /* WITH_ZLIB */
+
+	while (_map_transfer.first != NULL) {
+		Packet *p = _map_transfer.first;
+		_map_transfer.first = p->next;
+		delete p;
+	}
+	_map_transfer.last = NULL;
+	_map_transfer.bytes = 0;
+	_map_transfer.size = 0;
+	_map_transfer.encoded = 0;
+	_map_transfer.finished = false;
+	_map_transfer.encoding = MAP_ENCODING_NONE;
+}
+
+/**
+ * Get the packet the encoded savegame has to be appended to.
+ * @return a MAP_PACKET_NORMAL packet that has room for at least one byte
+ */
+static Packet *NetworkGetMapTransferPacket()
+{
+	if (_map_transfer.last == NULL || _map_transfer.last->size == SEND_MTU) {
+		Packet *p = NetworkSend_Init(PACKET_SERVER_MAP);
+		p->Send_uint8 (MAP_PACKET_NORMAL);
+		p->Send_uint32(_map_transfer.encoded);
+
+		if (_map_transfer.last == NULL) {
+			_map_transfer.first = p;
+		} else {
+			_map_transfer.last->next = p;
+		}
+		_map_transfer.last = p;
+	}
+
+	return _map_transfer.last;
+}
+
+/**
+ * Append encoded savegame bytes to the packets.
+ * @param buf the bytes to append
+ * @param len the number of bytes to append
+ */
+static void NetworkAppendMapTransfer(const byte *buf, size_t len)
+{
+	while (len != 0) {
+		Packet *p = NetworkGetMapTransferPacket();
+		size_t n = min<size_t>(len, SEND_MTU - p->size);
+
+		memcpy(p->buffer + p->size, buf, n);
+		p->size += (PacketSize)n;
+		_map_transfer.bytes += (uint32)n;
+		buf += n;
+		len -= n;
+	}
+}
+
+#if defined(WITH_ZLIB)
+/**
+ * Deflate savegame bytes directly into the packets.
+ * @param buf  the bytes to deflate
+ * @param len  the number of bytes to deflate
+ * @param mode the flush mode for deflate()
+ */
+static void NetworkDeflateMapTransfer(const byte *buf, size_t len, int mode)
+{
+	z_streamp z = &_map_transfer.z;
+	z->next_in = (Bytef *)buf;
+	z->avail_in = (uInt)len;
+
+	for (;;) {
+		Packet *p = NetworkGetMapTransferPacket();
+		z->next_out = p->buffer + p->size;
+		z->avail_out = SEND_MTU - p->size;
+
+		int r = deflate(z, mode);
+
+		uint n = SEND_MTU - p->size - z->avail_out;
+		p->size += n;
+		_map_transfer.bytes += n;
+
+		if (r == Z_STREAM_END) break;
+		if (r != Z_OK && r != Z_BUF_ERROR) usererror("network savedump failed - deflate() returned %d", r);
+		/* Everything is consumed and the output did not run out of room, so deflate has nothing pending */
+		if (z->avail_in == 0 && z->avail_out != 0 && mode != Z_FINISH) break;
+	}
+}
+#endif /* WITH_ZLIB */
+
+/**
+ * Receives the savegame while it is being written and encodes it into the packets.
+ * @param buf the savegame bytes
+ * @param len the number of bytes in buf
+ */
+static void NetworkMapTransferWriter(const byte *buf, size_t len)
+{
+	switch (_map_transfer.encoding) {
+#if defined(WITH_ZLIB)
+		case MAP_ENCODING_ZLIB: NetworkDeflateMapTransfer(buf, len, Z_NO_FLUSH); break;
+#endif /* WITH_ZLIB */
+		default: NetworkAppendMapTransfer(buf, len); break;
+	}
+}
+
+/**
+ * Save the game and start encoding it for the given client.
+ * @param cs the client that is going to receive the savegame
+ */
+static void NetworkPrepareMapTransfer(NetworkClientSocket *cs)
+{
+	NetworkServerFreeMapTransfer();
+
+	/* Use the best encoding the client understands; this does not depend on
+	 * the format the server writes its own savegames with */
+	const char *format = "lzo";
+#if defined(WITH_ZLIB)
+	if (HasBit(cs->map_encodings, MAP_ENCODING_ZLIB)) {
+		memset(&_map_transfer.z, 0, sizeof(_map_transfer.z));
+		if (deflateInit(&_map_transfer.z, 6) == Z_OK) {
+			_map_transfer.encoding = MAP_ENCODING_ZLIB;
+			format = "none";
+		}
+	}
+#endif /* WITH_ZLIB */
+
+	/* The savegame is encoded in parts while it is being sent, without temporary file */
+	uint size;
+	if (BeginSaveToStream(&NetworkMapTransferWriter, format, &size) != SL_OK) usererror("network savedump failed");
+	if (size == 0) usererror("network savedump failed - zero sized savegame?");
+	_map_transfer.size = size;
+
+	DEBUG(net, 3, "[%d] encoding map of %d bytes with %s", cs->client_id, size, format);
+}
+
+/** Encode the next part of the savegame into packets. */
+static void NetworkEncodeMapTransfer()
+{
+	bool finished;
+	if (ContinueSaveToStream(MAP_TRANSFER_STEP, &finished) != SL_OK) usererror("network savedump failed");
+	_map_transfer.encoded = min(_map_transfer.encoded + MAP_TRANSFER_STEP, _map_transfer.size);
+	if (!finished) return;
+
+#if defined(WITH_ZLIB)
+	if (_map_transfer.encoding == MAP_ENCODING_ZLIB) {
+		NetworkDeflateMapTransfer(NULL, 0, Z_FINISH);
+		deflateEnd(&_map_transfer.z);
+	}
+#endif /* WITH_ZLIB */
+	_map_transfer.finished = true;
+
+	DEBUG(net, 3, "map encoded into %d bytes", _map_transfer.bytes);
+}
+
+/**
+ * Get the next packet of the savegame to send, encoding more of the savegame when needed.
+ * @return the packet, or NULL when the whole savegame has been sent
+ */
+static Packet *NetworkNextMapTransferPacket()
+{
+	/* The last packet is still being filled until the whole savegame is encoded */
+	while (!_map_transfer.finished && _map_transfer.first == _map_transfer.last) {
+		NetworkEncodeMapTransfer();
+	}
+
+	Packet *p = _map_transfer.first;
+	if (p != NULL) {
+		_map_transfer.first = p->next;
+		if (_map_transfer.first == NULL) _map_transfer.last = NULL;
+		p->next = NULL;
+	}
+	return p;
+}
+
 /* This sends the map to the client */
 DEF_SERVER_SEND_COMMAND(PACKET_SERVER_MAP)
 {
@@ -291,13 +490,15 @@ DEF_SERVER_SEND_COMMAND(PACKET_SERVER_MAP)
 	 *    uint8:  packet-type (MAP_PACKET_START, MAP_PACKET_NORMAL and MAP_PACKET_END)
 	 *  if MAP_PACKET_START:
 	 *    uint32: The current FrameCounter
+	 *    uint32: The number of bytes of the savegame before it is encoded
+	 *    uint8:  The MapTransferEncoding of the savegame
 	 *  if MAP_PACKET_NORMAL:
-	 *    piece of the map (till max-size of packet)
+	 *    uint32: The number of bytes of the savegame that had been encoded before this packet
+	 *    piece of the encoded savegame (till max-size of packet)
 	 *  if MAP_PACKET_END:
 	 *    nothing
 	 */
 
-	static FILE *file_pointer;
 	static uint sent_packets; // How many packets we did send succecfully last time
 
 	if (cs->status < STATUS_AUTH) {
@@ -307,26 +508,19 @@ DEF_SERVER_SEND_COMMAND(PACKET_SERVER_MAP)
 	}
 
 	if (cs->status == STATUS_AUTH) {
-		const char *filename = "network_server.tmp";
 		Packet *p;
 
 		/* Make a dump of the current game */
-		if (SaveOrLoad(filename, SL_SAVE, AUTOSAVE_DIR) != SL_OK) usererror("network savedump failed");
+		NetworkPrepareMapTransfer(cs);
 
-		file_pointer = FioFOpenFile(filename, "rb", AUTOSAVE_DIR);
-		fseek(file_pointer, 0, SEEK_END);
-
-		if (ftell(file_pointer) == 0) usererror("network savedump failed - zero sized savegame?");
-
-		/* Now send the _frame_counter and how many packets are coming */
+		/* Now send the _frame_counter and how large the savegame is */
 		p = NetworkSend_Init(PACKET_SERVER_MAP);
 		p->Send_uint8 (MAP_PACKET_START);
 		p->Send_uint32(_frame_counter);
-		p->Send_uint32(ftell(file_pointer));
+		p->Send_uint32(_map_transfer.size);
+		p->Send_uint8 (_map_transfer.encoding);
 		cs->Send_Packet(p);
 
-		fseek(file_pointer, 0, SEEK_SET);
-
 		sent_packets = 4; // We start with trying 4 packets
 
 		cs->status = STATUS_MAP;
@@ -337,18 +531,14 @@ DEF_SERVER_SEND_COMMAND(PACKET_SERVER_MAP)
 
 	if (cs->status == STATUS_MAP) {
 		uint i;
-		int res;
 		for (i = 0; i < sent_packets; i++) {
-			Packet *p = NetworkSend_Init(PACKET_SERVER_MAP);
-			p->Send_uint8(MAP_PACKET_NORMAL);
-			res = (int)fread(p->buffer + p->size, 1, SEND_MTU - p->size, file_pointer);
+			Packet *p = NetworkNextMapTransferPacket();
+			if (p != NULL) cs->Send_Packet(p);
 
-			if (ferror(file_pointer)) usererror("Error reading temporary network savegame!");
+			if (_map_transfer.finished && _map_transfer.first == NULL) {
+				/* Done sending! */
+				NetworkServerFreeMapTransfer();
 
-			p->size += res;
-			cs->Send_Packet(p);
-			if (feof(file_pointer)) {
-				/* Done reading! */
 				Packet *p = NetworkSend_Init(PACKET_SERVER_MAP);
 				p->Send_uint8(MAP_PACKET_END);
 				cs->Send_Packet(p);
@@ -356,7 +546,6 @@ DEF_SERVER_SEND_COMMAND(PACKET_SERVER_MAP)
 				/* Set the status to DONE_MAP, no we will wait for the client
 				 *  to send it is ready (maybe that happens like never ;)) */
 				cs->status = STATUS_DONE_MAP;
-				fclose(file_pointer);
 
 				{
 					NetworkClientSocket *new_cs;
@@ -774,6 +963,8 @@ DEF_SERVER_RECEIVE_COMMAND(PACKET_CLIENT_GETMAP)
 		return;
 	}
 
+	cs->map_encodings = p->Recv_uint8();
+
 	/* Check if someone else is receiving the map */
 	FOR_ALL_CLIENT_SOCKETS(new_cs) {
 		if (new_cs->status == STATUS_MAP) {
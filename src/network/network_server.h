@@ -17,6 +17,7 @@ DEF_SERVER_SEND_COMMAND_PARAM(PACKET_SERVER_MOVE)(NetworkClientSocket *cs, uint1
 
 bool NetworkServer_ReadPackets(NetworkClientSocket *cs);
 void NetworkServer_Tick(bool send_frame);
+void NetworkServerFreeMapTransfer();
 
 #else /* ENABLE_NETWORK */
 /* Network function stubs when networking is disabled */
@@ -28,6 +28,7 @@
 #include "newgrf_commons.h"
 #include "newgrf_townname.h"
 #include "newgrf_industries.h"
+#include "newgrf_profile.h"
 #include "rev.h"
 #include "fios.h"
 #include "rail.h"
@@ -41,6 +42,7 @@
 #include "map_func.h"
 #include <map>
 #include "core/alloc_type.hpp"
+#include "core/smallvec_type.hpp"
 
 #include "table/strings.h"
 #include "table/build_industry.h"
@@ -229,6 +231,72 @@ static GRFFile *GetFileByFilename(const char *filename)
 	return file;
 }
 
+/** A sprite of a NewGRF file as recorded in its sprite index. */
+struct GRFSpriteIndexEntry {
+	uint32 data_offset; ///< Offset of the content of a pseudo sprite in GRFSpriteIndex::data
+	uint32 end_pos;     ///< Position in the file right after the sprite
+	uint16 num;         ///< Size of the sprite
+	byte type;          ///< Type of the sprite, 0xFF for pseudo sprites
+};
+
+/**
+ * The sprites of a NewGRF file and the content of its pseudo sprites. It is
+ * recorded by the first loading stage, so the other stages do not have to
+ * walk through all (real) sprites in the file again.
+ */
+struct GRFSpriteIndex {
+	SmallVector<GRFSpriteIndexEntry, 256> sprites; ///< The sprites, in the order of their nfo line
+	byte *data;                                     ///< The content of the pseudo sprites
+	size_t data_size;                               ///< Number of bytes used in data
+	size_t data_capacity;                           ///< Number of bytes allocated for data
+
+	GRFSpriteIndex() : data(NULL), data_size(0), data_capacity(0) {}
+	~GRFSpriteIndex() { free(this->data); }
+
+	/**
+	 * Add a sprite to the index.
+	 * @param num the size of the sprite
+	 * @param type the type of the sprite
+	 * @return the entry of the sprite; only its end position is not set yet
+	 */
+	GRFSpriteIndexEntry *Append(uint16 num, byte type)
+	{
+		GRFSpriteIndexEntry *entry = this->sprites.Append();
+		entry->data_offset = (uint32)this->data_size;
+		entry->num = num;
+		entry->type = type;
+
+		if (type == 0xFF) {
+			if (this->data_size + num > this->data_capacity) {
+				this->data_capacity = max<size_t>(this->data_capacity * 2, this->data_size + num);
+				this->data = ReallocT(this->data, this->data_capacity);
+			}
+			this->data_size += num;
+		}
+		return entry;
+	}
+
+	/**
+	 * Get the content of a pseudo sprite.
+	 * @param entry the sprite
+	 * @return the content
+	 */
+	byte *GetData(const GRFSpriteIndexEntry *entry) const
+	{
+		return this->data + entry->data_offset;
+	}
+};
+
+/**
+ * Free the sprite index of a file.
+ * @param gf the file to free the index of
+ */
+static void ClearGRFSpriteIndex(GRFFile *gf)
+{
+	delete gf->sprite_index;
+	gf->sprite_index = NULL;
+}
+
 /** Reset all NewGRFData that was used only while processing data */
 static void ClearTemporaryNewGRFData(GRFFile *gf)
 {
@@ -5909,6 +5977,8 @@ static void FinaliseIndustriesArray()
 	}
 }
 
+extern uint64 ottd_microseconds();
+
 /* Here we perform initial decoding of some special sprites (as are they
  * described at http://www.ttdpatch.net/src/newgrf.txt, but this is only a very
  * partial implementation yet).
@@ -5952,20 +6022,16 @@ static void DecodeSpecialSprite(byte *buf, uint num, GrfLoadingStage stage)
 		/* 0x13 */ { NULL,     NULL,      NULL,            NULL,           NULL,              TranslateGRFStrings, },
 	};
 
+	uint64 start = IsNewGRFProfiling() ? ottd_microseconds() : 0;
+
 	GRFLocation location(_cur_grfconfig->grfid, _nfo_line);
 
 	GRFLineToSpriteOverride::iterator it = _grf_line_to_action6_sprite_override.find(location);
-	if (it == _grf_line_to_action6_sprite_override.end()) {
-		/* No preloaded sprite to work with; read the
-		 * pseudo sprite content. */
-		FioReadBlock(buf, num);
-	} else {
-		/* Use the preloaded sprite data. */
-		buf = _grf_line_to_action6_sprite_override[location];
+	if (it != _grf_line_to_action6_sprite_override.end()) {
+		/* Use the preloaded sprite data instead of the real (original)
+		 * content of this action. */
+		buf = (*it).second;
 		grfmsg(7, "DecodeSpecialSprite: Using preloaded pseudo sprite data");
-
-		/* Skip the real (original) content of this action. */
-		FioSeekTo(num, SEEK_CUR);
 	}
 
 	byte action = buf[0];
@@ -5984,13 +6050,81 @@ static void DecodeSpecialSprite(byte *buf, uint num, GrfLoadingStage stage)
 		grfmsg(7, "DecodeSpecialSprite: Handling action 0x%02X in stage %d", action, stage);
 		handlers[action][stage](buf, num);
 	}
+
+	if (IsNewGRFProfiling()) NewGRFProfileAction(action, num, ottd_microseconds() - start);
 }
 
 
+/**
+ * Disable a NewGRF because it has a real sprite where a pseudo sprite is expected.
+ * @param config the NewGRF to disable
+ */
+static void UnexpectedSprite(GRFConfig *config)
+{
+	grfmsg(0, "LoadNewGRFFile: Unexpected sprite, disabling");
+	config->status = GCS_DISABLED;
+	config->error  = CallocT<GRFError>(1);
+	config->error->severity = STR_NEWGRF_ERROR_MSG_FATAL;
+	config->error->message  = STR_NEWGRF_ERROR_UNEXPECTED_SPRITE;
+}
+
+/**
+ * Load a stage of a NewGRF from the sprite index recorded by the first stage,
+ * instead of walking through the whole file again. The nfo line is the index
+ * in the sprite index, so jumps and the sprites read by the handlers
+ * themselves are followed like they are when reading the file.
+ * @param config the NewGRF to load
+ * @param stage the loading stage
+ * @param index the sprite index of the NewGRF
+ * @param pseudo_sprites incremented for every pseudo sprite walked over
+ * @param real_sprites incremented for every real sprite walked over
+ */
+static void LoadNewGRFFileFromIndex(GRFConfig *config, GrfLoadingStage stage, const GRFSpriteIndex *index, uint *pseudo_sprites, uint *real_sprites)
+{
+	_skip_sprites = 0; // XXX
+	_nfo_line = 0;
+
+	ReusableBuffer<byte> buf;
+
+	while (_nfo_line < index->sprites.Length()) {
+		const GRFSpriteIndexEntry *entry = index->sprites.Get(_nfo_line);
+		_nfo_line++;
+
+		if (entry->type == 0xFF) {
+			(*pseudo_sprites)++;
+			if (_skip_sprites == 0) {
+				byte *data = buf.Allocate(entry->num);
+				memcpy(data, index->GetData(entry), entry->num);
+
+				/* During activation the handlers load the real sprites
+				 * following their pseudo sprite from the file, and action 6
+				 * reads the next pseudo sprite; for them the file has to be
+				 * right after the pseudo sprite. */
+				if (stage == GLS_ACTIVATION || data[0] == 0x06) FioSeekTo(entry->end_pos, SEEK_SET);
+
+				DecodeSpecialSprite(data, entry->num, stage);
+
+				/* Stop all processing if we are to skip the remaining sprites */
+				if (_skip_sprites == -1) break;
+
+				continue;
+			}
+		} else {
+			(*real_sprites)++;
+			if (_skip_sprites == 0) {
+				UnexpectedSprite(config);
+				break;
+			}
+		}
+
+		if (_skip_sprites > 0) _skip_sprites--;
+	}
+}
+
 void LoadNewGRFFile(GRFConfig *config, uint file_index, GrfLoadingStage stage)
 {
 	const char *filename = config->filename;
-	uint16 num;
+	uint16 num = 0;
 
 	/* A .grf file is activated only if it was active when the game was
 	 * started.  If a game is loaded, only its active .grfs will be
@@ -6026,6 +6160,18 @@ void LoadNewGRFFile(GRFConfig *config, uint file_index, GrfLoadingStage stage)
 
 	DEBUG(grf, 2, "LoadNewGRFFile: Reading NewGRF-file '%s'", filename);
 
+	/* The file can be inside a tar, so its first byte is not at position 0 */
+	size_t start_pos = FioGetPos();
+	if (IsNewGRFProfiling()) NewGRFProfileBeginFile(config, stage);
+
+	uint pseudo_sprites = 0;
+	uint real_sprites = 0;
+	if (stage > GLS_LABELSCAN && _cur_grffile->sprite_index != NULL) {
+		LoadNewGRFFileFromIndex(config, stage, _cur_grffile->sprite_index, &pseudo_sprites, &real_sprites);
+		if (IsNewGRFProfiling()) NewGRFProfileEndFile(0, pseudo_sprites, real_sprites);
+		return;
+	}
+
 	/* Skip the first sprite; we don't care about how many sprites this
 	 * does contain; newest TTDPatches and George's longvehicles don't
 	 * neither, apparently. */
@@ -6033,9 +6179,17 @@ void LoadNewGRFFile(GRFConfig *config, uint file_index, GrfLoadingStage stage)
 		FioReadDword();
 	} else {
 		DEBUG(grf, 7, "LoadNewGRFFile: Custom .grf has invalid format");
+		if (IsNewGRFProfiling()) NewGRFProfileEndFile(FioGetPos() - start_pos, 0, 0);
 		return;
 	}
 
+	/* The first stage of LoadNewGRF records the sprites for the later ones */
+	GRFSpriteIndex *index = NULL;
+	if (stage == GLS_LABELSCAN) {
+		ClearGRFSpriteIndex(_cur_grffile);
+		index = new GRFSpriteIndex();
+	}
+
 	_skip_sprites = 0; // XXX
 	_nfo_line = 0;
 
@@ -6046,32 +6200,56 @@ void LoadNewGRFFile(GRFConfig *config, uint file_index, GrfLoadingStage stage)
 		_nfo_line++;
 
 		if (type == 0xFF) {
-			if (_skip_sprites == 0) {
-				DecodeSpecialSprite(buf.Allocate(num), num, stage);
+			pseudo_sprites++;
+			byte *data = NULL;
+			if (index != NULL) {
+				/* Keep the content, even when it is skipped now */
+				GRFSpriteIndexEntry *entry = index->Append(num, type);
+				FioReadBlock(index->GetData(entry), num);
+				entry->end_pos = (uint32)FioGetPos();
+
+				if (_skip_sprites == 0) {
+					data = buf.Allocate(num);
+					memcpy(data, index->GetData(entry), num);
+				}
+			} else if (_skip_sprites == 0) {
+				data = buf.Allocate(num);
+				FioReadBlock(data, num);
+			} else {
+				FioSkipBytes(num);
+			}
+
+			if (data != NULL) {
+				DecodeSpecialSprite(data, num, stage);
 
 				/* Stop all processing if we are to skip the remaining sprites */
 				if (_skip_sprites == -1) break;
 
 				continue;
-			} else {
-				FioSkipBytes(num);
 			}
 		} else {
+			real_sprites++;
 			if (_skip_sprites == 0) {
-				grfmsg(0, "LoadNewGRFFile: Unexpected sprite, disabling");
-				config->status = GCS_DISABLED;
-				config->error  = CallocT<GRFError>(1);
-				config->error->severity = STR_NEWGRF_ERROR_MSG_FATAL;
-				config->error->message  = STR_NEWGRF_ERROR_UNEXPECTED_SPRITE;
+				UnexpectedSprite(config);
 				break;
 			}
 
 			FioSkipBytes(7);
 			SkipSpriteData(type, num - 8);
+			if (index != NULL) index->Append(num, type)->end_pos = (uint32)FioGetPos();
 		}
 
 		if (_skip_sprites > 0) _skip_sprites--;
 	}
+
+	/* Only a completely walked file gives a usable index */
+	if (index != NULL && num == 0) {
+		_cur_grffile->sprite_index = index;
+	} else {
+		delete index;
+	}
+
+	if (IsNewGRFProfiling()) NewGRFProfileEndFile(FioGetPos() - start_pos, pseudo_sprites, real_sprites);
 }
 
 /**
@@ -6132,6 +6310,9 @@ static void AfterLoadGRFs()
 	}
 	_grf_line_to_action6_sprite_override.clear();
 
+	/* Prepare the sprite groups for fast resolving. */
+	OptimiseSpriteGroups();
+
 	/* Pre-calculate all refit masks after loading GRF files. */
 	CalculateRefitMasks();
 
@@ -6191,6 +6372,8 @@ void LoadNewGRF(uint load_index, uint file_index)
 		_display_opt  = 0;
 	}
 
+	NewGRFProfileBeginLoad();
+
 	InitializeGRFSpecial();
 
 	ResetNewGRFData();
@@ -6236,18 +6419,25 @@ void LoadNewGRF(uint load_index, uint file_index)
 				ClrBit(c->flags, GCF_RESERVED);
 				assert(GetFileByGRFID(c->grfid) == _cur_grffile);
 				ClearTemporaryNewGRFData(_cur_grffile);
+				ClearGRFSpriteIndex(_cur_grffile);
 				BuildCargoTranslationMap();
 				DEBUG(sprite, 2, "LoadNewGRF: Currently %i sprites are loaded", _cur_spriteid);
 			} else if (stage == GLS_INIT && HasBit(c->flags, GCF_INIT_ONLY)) {
 				/* We're not going to activate this, so free whatever data we allocated */
 				ClearTemporaryNewGRFData(_cur_grffile);
+				ClearGRFSpriteIndex(_cur_grffile);
 			}
 		}
 	}
 
+	/* Free the sprite indices of the files that did not get activated */
+	for (GRFFile *file = _first_grffile; file != NULL; file = file->next) ClearGRFSpriteIndex(file);
+
 	/* Call any functions that should be run after GRFs have been loaded. */
 	AfterLoadGRFs();
 
+	NewGRFProfileEndLoad();
+
 	/* Now revert back to the original situation */
 	_cur_year     = year;
 	_date         = date;
@@ -97,6 +97,7 @@ struct GRFFile {
 	uint param_end;  ///< one more than the highest set parameter
 
 	GRFLabel *label; ///< Pointer to the first label. This is a linked list, not an array.
+	struct GRFSpriteIndex *sprite_index; ///< The sprites of the file, recorded while loading it
 
 	uint8 cargo_max;
 	CargoLabel *cargo_list;
@@ -13,6 +13,13 @@
 
 #include "fileio_func.h"
 #include "fios.h"
+#include "thread.h"
+#include "core/alloc_func.hpp"
+#include "core/smallvec_type.hpp"
+#include "core/string_compare_type.hpp"
+
+#include <map>
+#include <sys/stat.h>
 
 
 GRFConfig *_all_grfs;
@@ -60,8 +67,8 @@ static bool CalcGRFMD5Sum(GRFConfig *config)
 }
 
 
-/* Find the GRFID and calculate the md5sum */
-bool FillGRFDetails(GRFConfig *config, bool is_static)
+/* Find the GRFID and the other Action 8 information */
+static bool FillGRFInfo(GRFConfig *config, bool is_static)
 {
 	if (!FioCheckFileExists(config->filename)) {
 		config->status = GCS_NOT_FOUND;
@@ -84,7 +91,13 @@ bool FillGRFDetails(GRFConfig *config, bool is_static)
 
 	config->windows_paletted = (_use_palette == PAL_WINDOWS);
 
-	return CalcGRFMD5Sum(config);
+	return true;
+}
+
+/* Find the GRFID and calculate the md5sum */
+bool FillGRFDetails(GRFConfig *config, bool is_static)
+{
+	return FillGRFInfo(config, is_static) && CalcGRFMD5Sum(config);
 }
 
 
@@ -277,8 +290,269 @@ compatible_grf:
 	return res;
 }
 
-/** Helper for scanning for files with GRF as extension */
+/** The version of the NewGRF scan cache file; increase it when the format changes. */
+static const uint32 GRF_SCAN_CACHE_VERSION = 2;
+/** The number of threads calculating the md5sums of new and changed NewGRFs. */
+static const uint GRF_MD5_THREADS = 4;
+
+/** What a previous scan found out about a file, so it does not need to be scanned again. */
+struct GRFScanCacheEntry {
+	uint64 size;      ///< Size of the file when it was scanned
+	int64 mtime;      ///< Modification time of the file when it was scanned
+	bool valid;       ///< Whether the file is a NewGRF that can be used
+	uint8 flags;      ///< GCF_Flags of the file
+	uint32 grfid;     ///< GRF ID of the file
+	uint8 md5sum[16]; ///< MD5 checksum of the file
+	char *name;       ///< GRF name of the file, may be NULL
+	char *info;       ///< GRF info of the file, may be NULL
+};
+
+/**
+ * The cache of scanned files, indexed by the full path of the file; the same
+ * filename relative to the search path can exist in several search paths.
+ */
+typedef std::map<const char *, GRFScanCacheEntry, StringCompare> GRFScanCache;
+
+/** A file found while scanning for NewGRFs. */
+struct ScannedGRF {
+	GRFConfig *config; ///< The details of the file
+	char *path;        ///< Full path of the file
+	uint64 size;       ///< Size of the file
+	int64 mtime;       ///< Modification time of the file, 0 when it could not be determined
+	bool valid;        ///< Whether the file is a NewGRF that can be used
+	bool calc_md5sum;  ///< Whether the md5sum still has to be calculated
+};
+
+/** Get the name of the NewGRF scan cache file. */
+static char *GetGRFScanCacheFilename()
+{
+	return str_fmt("%sgrfscan.dat", _personal_dir);
+}
+
+/**
+ * Read a string of the NewGRF scan cache.
+ * @param f the file to read from
+ * @param str filled with the string, or NULL
+ * @return false when the file is corrupted
+ */
+static bool ReadGRFScanCacheString(FILE *f, char **str)
+{
+	uint16 length;
+	if (fread(&length, sizeof(length), 1, f) != 1) return false;
+
+	*str = NULL;
+	if (length == UINT16_MAX) return true;
+
+	*str = MallocT<char>(length + 1);
+	if (length != 0 && fread(*str, length, 1, f) != 1) return false;
+	(*str)[length] = '\0';
+	return true;
+}
+
+/**
+ * Write a string to the NewGRF scan cache.
+ * @param f the file to write to
+ * @param str the string, may be NULL
+ */
+static void WriteGRFScanCacheString(FILE *f, const char *str)
+{
+	uint16 length = (str == NULL) ? UINT16_MAX : (uint16)min(strlen(str), UINT16_MAX - 1);
+	fwrite(&length, sizeof(length), 1, f);
+	if (str != NULL && length != 0) fwrite(str, length, 1, f);
+}
+
+/**
+ * Free the memory of the NewGRF scan cache.
+ * @param cache the cache to clear
+ */
+static void ClearGRFScanCache(GRFScanCache *cache)
+{
+	for (GRFScanCache::iterator it = cache->begin(); it != cache->end(); it++) {
+		free((void*)it->first);
+		free(it->second.name);
+		free(it->second.info);
+	}
+	cache->clear();
+}
+
+/**
+ * Load the NewGRF scan cache from the personal directory. A missing,
+ * outdated or corrupted cache simply means all files are scanned again.
+ * @param cache the cache to fill
+ */
+static void LoadGRFScanCache(GRFScanCache *cache)
+{
+	char *filename = GetGRFScanCacheFilename();
+	FILE *f = fopen(filename, "rb");
+	free(filename);
+	if (f == NULL) return;
+
+	uint32 version, count;
+	if (fread(&version, sizeof(version), 1, f) != 1 || version != GRF_SCAN_CACHE_VERSION ||
+			fread(&count, sizeof(count), 1, f) != 1) {
+		fclose(f);
+		return;
+	}
+
+	for (uint i = 0; i < count; i++) {
+		char *file;
+		GRFScanCacheEntry entry;
+		entry.name = NULL;
+		entry.info = NULL;
+
+		bool ok = ReadGRFScanCacheString(f, &file);
+		if (ok) {
+			byte valid;
+			ok = fread(&entry.size, sizeof(entry.size), 1, f) == 1 &&
+					fread(&entry.mtime, sizeof(entry.mtime), 1, f) == 1 &&
+					fread(&valid, sizeof(valid), 1, f) == 1 &&
+					fread(&entry.flags, sizeof(entry.flags), 1, f) == 1 &&
+					fread(&entry.grfid, sizeof(entry.grfid), 1, f) == 1 &&
+					fread(entry.md5sum, sizeof(entry.md5sum), 1, f) == 1 &&
+					ReadGRFScanCacheString(f, &entry.name) &&
+					ReadGRFScanCacheString(f, &entry.info);
+			entry.valid = valid != 0;
+		}
+
+		if (!ok || file == NULL) {
+			DEBUG(grf, 1, "NewGRF scan cache corrupted, scanning all files");
+			free(file);
+			free(entry.name);
+			free(entry.info);
+			ClearGRFScanCache(cache);
+			break;
+		}
+
+		/* A file found twice while scanning is written twice; both entries are the same */
+		if (cache->find(file) != cache->end()) {
+			free(file);
+			free(entry.name);
+			free(entry.info);
+			continue;
+		}
+
+		(*cache)[file] = entry;
+	}
+
+	fclose(f);
+}
+
+/**
+ * Save the results of a scan for NewGRFs in the personal directory.
+ * @param files the scanned files
+ * @param count the number of scanned files
+ */
+static void SaveGRFScanCache(const ScannedGRF *files, uint count)
+{
+	char *filename = GetGRFScanCacheFilename();
+	FILE *f = fopen(filename, "wb");
+	if (f == NULL) {
+		DEBUG(grf, 1, "Cannot write the NewGRF scan cache to '%s'", filename);
+		free(filename);
+		return;
+	}
+	free(filename);
+
+	/* Files we could not get the modification time of can't be validated */
+	uint32 num = 0;
+	for (uint i = 0; i < count; i++) {
+		if (files[i].mtime != 0) num++;
+	}
+
+	fwrite(&GRF_SCAN_CACHE_VERSION, sizeof(GRF_SCAN_CACHE_VERSION), 1, f);
+	fwrite(&num, sizeof(num), 1, f);
+
+	for (uint i = 0; i < count; i++) {
+		const ScannedGRF *s = &files[i];
+		if (s->mtime == 0) continue;
+
+		byte valid = s->valid;
+		WriteGRFScanCacheString(f, s->path);
+		fwrite(&s->size, sizeof(s->size), 1, f);
+		fwrite(&s->mtime, sizeof(s->mtime), 1, f);
+		fwrite(&valid, sizeof(valid), 1, f);
+		fwrite(&s->config->flags, sizeof(s->config->flags), 1, f);
+		fwrite(&s->config->grfid, sizeof(s->config->grfid), 1, f);
+		fwrite(s->config->md5sum, sizeof(s->config->md5sum), 1, f);
+		WriteGRFScanCacheString(f, s->config->name);
+		WriteGRFScanCacheString(f, s->config->info);
+	}
+
+	fclose(f);
+}
+
+/** The md5sums that still have to be calculated, shared by the threads calculating them. */
+struct GRFMD5SumJobs {
+	ScannedGRF *files;  ///< The scanned files
+	uint count;         ///< The number of scanned files
+	uint next;          ///< The next file to take a look at
+	ThreadMutex *mutex; ///< Mutex protecting next
+};
+
+/**
+ * Calculate md5sums of scanned files till there are none left.
+ * @param data the GRFMD5SumJobs to work on
+ */
+static void CalcGRFMD5SumThread(void *data)
+{
+	GRFMD5SumJobs *jobs = (GRFMD5SumJobs *)data;
+
+	for (;;) {
+		jobs->mutex->BeginCritical();
+		uint i = jobs->next++;
+		jobs->mutex->EndCritical();
+		if (i >= jobs->count) return;
+
+		ScannedGRF *s = &jobs->files[i];
+		if (s->calc_md5sum && !CalcGRFMD5Sum(s->config)) s->valid = false;
+	}
+}
+
+/**
+ * Add a scanned NewGRF to the list of all NewGRFs, unless it is already known.
+ * @param c the NewGRF to add
+ * @return true if the NewGRF was added
+ */
+static bool AddGRFToList(GRFConfig *c)
+{
+	if (_all_grfs == NULL) {
+		_all_grfs = c;
+		return true;
+	}
+
+	/* Insert file into list at a position determined by its
+	 * name, so the list is sorted as we go along */
+	GRFConfig **pd, *d;
+	bool added = true;
+	bool stop = false;
+	for (pd = &_all_grfs; (d = *pd) != NULL; pd = &d->next) {
+		if (c->grfid == d->grfid && memcmp(c->md5sum, d->md5sum, sizeof(c->md5sum)) == 0) added = false;
+		/* Because there can be multiple grfs with the same name, make sure we checked all grfs with the same name,
+		 *  before inserting the entry. So insert a new grf at the end of all grfs with the same name, instead of
+		 *  just after the first with the same name. Avoids doubles in the list. */
+		if (strcasecmp(c->name, d->name) <= 0) {
+			stop = true;
+		} else if (stop) {
+			break;
+		}
+	}
+	if (added) {
+		c->next = d;
+		*pd = c;
+	}
+
+	return added;
+}
+
+/**
+ * Helper for scanning for files with GRF as extension.
+ * Files that did not change since the previous scan are taken from the
+ * scan cache; for the others the Action 8 is read while scanning and the
+ * md5sums are calculated by several threads afterwards.
+ */
 class GRFFileScanner : FileScanner {
+	GRFScanCache cache;                ///< The results of the previous scan
+	SmallVector<ScannedGRF, 64> files; ///< The files found in this scan
 public:
 	/* virtual */ bool AddFile(const char *filename, size_t basepath_length);
 
@@ -286,54 +560,92 @@ public:
 	static uint DoScan()
 	{
 		GRFFileScanner fs;
-		return fs.Scan(".grf", DATA_DIR);
+		LoadGRFScanCache(&fs.cache);
+		fs.Scan(".grf", DATA_DIR);
+		ClearGRFScanCache(&fs.cache);
+
+		/* Calculate the missing md5sums, on this and some other threads */
+		GRFMD5SumJobs jobs;
+		jobs.files = fs.files.Begin();
+		jobs.count = fs.files.Length();
+		jobs.next = 0;
+		jobs.mutex = ThreadMutex::New();
+
+		uint hashes = 0;
+		for (uint i = 0; i < jobs.count; i++) {
+			if (jobs.files[i].calc_md5sum) hashes++;
+		}
+
+		ThreadObject *threads[GRF_MD5_THREADS - 1];
+		uint num_threads = 0;
+		while (num_threads + 1 < min(hashes, GRF_MD5_THREADS) && ThreadObject::New(&CalcGRFMD5SumThread, &jobs, &threads[num_threads])) num_threads++;
+		CalcGRFMD5SumThread(&jobs);
+		for (uint i = 0; i < num_threads; i++) {
+			threads[i]->Join();
+			delete threads[i];
+		}
+		delete jobs.mutex;
+
+		DEBUG(grf, 1, "Calculated the md5sum of %d new or changed files on %d threads", hashes, num_threads + 1);
+
+		SaveGRFScanCache(fs.files.Begin(), fs.files.Length());
+
+		uint num = 0;
+		for (ScannedGRF *s = fs.files.Begin(); s != fs.files.End(); s++) {
+			free(s->path);
+			if (s->valid && AddGRFToList(s->config)) {
+				num++;
+				continue;
+			}
+
+			/* File couldn't be opened, or is either not a NewGRF or is a
+			 * 'system' NewGRF or it's already known, so forget about it. */
+			free(s->config->filename);
+			free(s->config->name);
+			free(s->config->info);
+			free(s->config);
+		}
+		return num;
 	}
 };
 
 bool GRFFileScanner::AddFile(const char *filename, size_t basepath_length)
 {
-	GRFConfig *c = CallocT<GRFConfig>(1);
-	c->filename = strdup(filename + basepath_length);
-
-	bool added = true;
-	if (FillGRFDetails(c, false)) {
-		if (_all_grfs == NULL) {
-			_all_grfs = c;
-		} else {
-			/* Insert file into list at a position determined by its
-			 * name, so the list is sorted as we go along */
-			GRFConfig **pd, *d;
-			bool stop = false;
-			for (pd = &_all_grfs; (d = *pd) != NULL; pd = &d->next) {
-				if (c->grfid == d->grfid && memcmp(c->md5sum, d->md5sum, sizeof(c->md5sum)) == 0) added = false;
-				/* Because there can be multiple grfs with the same name, make sure we checked all grfs with the same name,
-				 *  before inserting the entry. So insert a new grf at the end of all grfs with the same name, instead of
-				 *  just after the first with the same name. Avoids doubles in the list. */
-				if (strcasecmp(c->name, d->name) <= 0) {
-					stop = true;
-				} else if (stop) {
-					break;
-				}
-			}
-			if (added) {
-				c->next = d;
-				*pd = c;
-			}
-		}
-	} else {
-		added = false;
+	ScannedGRF *s = this->files.Append();
+	s->config = CallocT<GRFConfig>(1);
+	s->config->filename = strdup(filename + basepath_length);
+	s->path = strdup(filename);
+	s->size = 0;
+	s->mtime = 0;
+	s->calc_md5sum = false;
+
+#ifdef WIN32
+	struct _stat sb;
+	if (_tstat(OTTD2FS(filename), &sb) == 0) {
+#else
+	struct stat sb;
+	if (stat(filename, &sb) == 0) {
+#endif
+		s->size = sb.st_size;
+		s->mtime = sb.st_mtime;
 	}
 
-	if (!added) {
-		/* File couldn't be opened, or is either not a NewGRF or is a
-		 * 'system' NewGRF or it's already known, so forget about it. */
-		free(c->filename);
-		free(c->name);
-		free(c->info);
-		free(c);
+	GRFScanCache::iterator it = this->cache.find(s->path);
+	if (s->mtime != 0 && it != this->cache.end() && it->second.size == s->size && it->second.mtime == s->mtime) {
+		const GRFScanCacheEntry *entry = &it->second;
+		s->valid = entry->valid;
+		s->config->flags = entry->flags;
+		s->config->grfid = entry->grfid;
+		memcpy(s->config->md5sum, entry->md5sum, sizeof(s->config->md5sum));
+		if (entry->name != NULL) s->config->name = strdup(entry->name);
+		if (entry->info != NULL) s->config->info = strdup(entry->info);
+		s->config->windows_paletted = (_use_palette == PAL_WINDOWS);
+		return s->valid;
 	}
 
-	return added;
+	s->valid = FillGRFInfo(s->config, false);
+	s->calc_md5sum = s->valid;
+	return s->valid;
 }
 
 /**
@@ -351,17 +663,38 @@ static int CDECL GRFSorter(const void *p1, const void *p2)
 		c2->name != NULL ? c2->name : c2->filename);
 }
 
-/* Scan for all NewGRFs */
-void ScanNewGRFFiles()
+/** Number of buckets of the index of NewGRFs; GetGRFIndexBucket depends on it being 256. */
+static const uint GRF_INDEX_BUCKETS = 256;
+/** Index of the scanned NewGRFs by GRF ID; the NewGRFs in a bucket are in the order of _all_grfs. */
+static SmallVector<const GRFConfig *, 4> _grf_index[GRF_INDEX_BUCKETS];
+
+/**
+ * Get the bucket of the index of NewGRFs a GRF ID belongs to.
+ * @param grfid the GRF ID
+ * @return the bucket
+ */
+static inline uint GetGRFIndexBucket(uint32 grfid)
 {
-	ClearGRFConfigList(&_all_grfs);
+	/* Multiplicative hashing, as GRF IDs of a set often only differ in a single byte */
+	return (uint32)(grfid * 2654435761U) >> 24;
+}
 
-	DEBUG(grf, 1, "Scanning for NewGRFs");
-	uint num = GRFFileScanner::DoScan();
+/** Rebuild the index of the scanned NewGRFs after _all_grfs changed. */
+static void BuildGRFIndex()
+{
+	for (uint i = 0; i < GRF_INDEX_BUCKETS; i++) _grf_index[i].Clear();
 
-	DEBUG(grf, 1, "Scan complete, found %d files", num);
-	if (num == 0 || _all_grfs == NULL) return;
+	for (const GRFConfig *c = _all_grfs; c != NULL; c = c->next) {
+		*_grf_index[GetGRFIndexBucket(c->grfid)].Append() = c;
+	}
+}
 
+/**
+ * Sort the list of scanned NewGRFs by their name.
+ * @param num the (approximate) number of NewGRFs in the list
+ */
+static void SortGRFList(uint num)
+{
 	/* Sort the linked list using quicksort.
 	 * For that we first have to make an array, the qsort and
 	 * then remake the linked list. */
@@ -385,11 +718,27 @@ void ScanNewGRFFiles()
 	free(to_sort);
 }
 
+/* Scan for all NewGRFs */
+void ScanNewGRFFiles()
+{
+	ClearGRFConfigList(&_all_grfs);
+
+	DEBUG(grf, 1, "Scanning for NewGRFs");
+	uint num = GRFFileScanner::DoScan();
+
+	DEBUG(grf, 1, "Scan complete, found %d files", num);
+	if (num != 0 && _all_grfs != NULL) SortGRFList(num);
+
+	BuildGRFIndex();
+}
+
 
 /* Find a NewGRF in the scanned list, if md5sum is NULL, we don't care about it*/
 const GRFConfig *FindGRFConfig(uint32 grfid, const uint8 *md5sum)
 {
-	for (const GRFConfig *c = _all_grfs; c != NULL; c = c->next) {
+	const SmallVector<const GRFConfig *, 4> &bucket = _grf_index[GetGRFIndexBucket(grfid)];
+	for (const GRFConfig * const *it = bucket.Begin(); it != bucket.End(); it++) {
+		const GRFConfig *c = *it;
 		if (c->grfid == grfid) {
 			if (md5sum == NULL) return c;
 
@@ -428,9 +777,11 @@ struct UnknownGRF : public GRFIdentifier {
 char *FindUnknownGRFName(uint32 grfid, uint8 *md5sum, bool create)
 {
 	UnknownGRF *grf;
-	static UnknownGRF *unknown_grfs = NULL;
+	/* The unknown GRFs, hashed like the index of the scanned NewGRFs */
+	static UnknownGRF *unknown_grfs[GRF_INDEX_BUCKETS];
+	UnknownGRF **bucket = &unknown_grfs[GetGRFIndexBucket(grfid)];
 
-	for (grf = unknown_grfs; grf != NULL; grf = grf->next) {
+	for (grf = *bucket; grf != NULL; grf = grf->next) {
 		if (grf->grfid == grfid) {
 			if (memcmp(md5sum, grf->md5sum, sizeof(grf->md5sum)) == 0) return grf->name;
 		}
@@ -440,11 +791,11 @@ char *FindUnknownGRFName(uint32 grfid, uint8 *md5sum, bool create)
 
 	grf = CallocT<UnknownGRF>(1);
 	grf->grfid = grfid;
-	grf->next  = unknown_grfs;
+	grf->next  = *bucket;
 	strecpy(grf->name, UNKNOWN_GRF_NAME_PLACEHOLDER, lastof(grf->name));
 	memcpy(grf->md5sum, md5sum, sizeof(grf->md5sum));
 
-	unknown_grfs = grf;
+	*bucket = grf;
 	return grf->name;
 }
 
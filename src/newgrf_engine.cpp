@@ -950,8 +950,77 @@ bool UsesWagonOverride(const Vehicle *v)
 	return v->u.rail.cached_override != NULL;
 }
 
+/** The generation of the vehicle callback cache; entries of other generations are stale. */
+static uint32 _vehicle_cb_cache_generation = 1;
+/** Whether results of vehicle callbacks may be taken from and stored in the cache. */
+static bool _vehicle_cb_cache_active = false;
+static uint _vehicle_cb_cache_hits;   ///< Number of callbacks answered from the cache
+static uint _vehicle_cb_cache_misses; ///< Number of cacheable callbacks that had to be resolved
+
 /**
- * Evaluate a newgrf callback for vehicles
+ * Enable or disable the vehicle callback cache. The cache is only enabled
+ * while the vehicles are ticking, so the results are reused in the same
+ * order on all clients. Everything else, like the GUI or commands from the
+ * network, always resolves the callbacks itself and never touches the cache.
+ * Enabling the cache starts a new generation, so nothing survives a tick.
+ * @param active whether to enable the cache
+ */
+void SetVehicleCallbackCacheActive(bool active)
+{
+	if (active) InvalidateVehicleCallbackCache();
+	_vehicle_cb_cache_active = active;
+}
+
+/**
+ * Forget all memoised vehicle callback results, e.g. because a consist
+ * changed or the random bits of a vehicle were reseeded.
+ */
+void InvalidateVehicleCallbackCache()
+{
+	/* Generation 0 is what new vehicles start with, so skip it */
+	if (++_vehicle_cb_cache_generation == 0) _vehicle_cb_cache_generation = 1;
+}
+
+/**
+ * Get the hit rate of the vehicle callback cache.
+ * @param hits   filled with the number of callbacks taken from the cache
+ * @param misses filled with the number of cacheable callbacks that were resolved
+ */
+void GetVehicleCallbackCacheStats(uint *hits, uint *misses)
+{
+	*hits = _vehicle_cb_cache_hits;
+	*misses = _vehicle_cb_cache_misses;
+}
+
+/** Start counting the hits and misses of the vehicle callback cache anew. */
+void ResetVehicleCallbackCacheStats()
+{
+	_vehicle_cb_cache_hits = 0;
+	_vehicle_cb_cache_misses = 0;
+}
+
+/**
+ * Check whether the result of a callback only depends on the state of the
+ * vehicle, so it may be reused for the rest of the tick.
+ * @param callback the callback to check
+ * @return true when the callback may be cached
+ */
+static inline bool IsCacheableVehicleCallback(CallbackID callback)
+{
+	switch (callback) {
+		case CBID_TRAIN_WAGON_POWER:
+		case CBID_VEHICLE_LENGTH:
+		case CBID_VEHICLE_REFIT_CAPACITY:
+		case CBID_VEHICLE_MODIFY_PROPERTY:
+			return true;
+
+		default:
+			return false;
+	}
+}
+
+/**
+ * Resolve a vehicle callback.
  * @param callback The callback to evalute
  * @param param1   First parameter of the callback
  * @param param2   Second parameter of the callback
@@ -959,7 +1028,7 @@ bool UsesWagonOverride(const Vehicle *v)
  * @param v        The vehicle to evaluate the callback for, or NULL if it doesnt exist yet
  * @return The value the callback returned, or CALLBACK_FAILED if it failed
  */
-uint16 GetVehicleCallback(CallbackID callback, uint32 param1, uint32 param2, EngineID engine, const Vehicle *v)
+static uint16 ResolveVehicleCallback(CallbackID callback, uint32 param1, uint32 param2, EngineID engine, const Vehicle *v)
 {
 	const SpriteGroup *group;
 	ResolverObject object;
@@ -976,6 +1045,36 @@ uint16 GetVehicleCallback(CallbackID callback, uint32 param1, uint32 param2, Eng
 	return group->g.callback.result;
 }
 
+/**
+ * Evaluate a newgrf callback for vehicles
+ * @param callback The callback to evalute
+ * @param param1   First parameter of the callback
+ * @param param2   Second parameter of the callback
+ * @param engine   Engine type of the vehicle to evaluate the callback for
+ * @param v        The vehicle to evaluate the callback for, or NULL if it doesnt exist yet
+ * @return The value the callback returned, or CALLBACK_FAILED if it failed
+ */
+uint16 GetVehicleCallback(CallbackID callback, uint32 param1, uint32 param2, EngineID engine, const Vehicle *v)
+{
+	if (!_vehicle_cb_cache_active || v == NULL || engine != v->engine_type || param1 > 0xFFFF || param2 != 0 || !IsCacheableVehicleCallback(callback)) {
+		return ResolveVehicleCallback(callback, param1, param2, engine, v);
+	}
+
+	/* The cache is direct mapped; a colliding callback simply replaces the entry */
+	VehicleCallbackCacheEntry *entry = &v->cb_cache[(callback ^ param1) % lengthof(v->cb_cache)];
+	if (entry->generation == _vehicle_cb_cache_generation && entry->callback == callback && entry->param == param1) {
+		_vehicle_cb_cache_hits++;
+		return entry->result;
+	}
+
+	_vehicle_cb_cache_misses++;
+	entry->generation = _vehicle_cb_cache_generation;
+	entry->callback   = callback;
+	entry->param      = param1;
+	entry->result     = ResolveVehicleCallback(callback, param1, param2, engine, v);
+	return entry->result;
+}
+
 /**
  * Evaluate a newgrf callback for vehicles with a different vehicle for parent scope.
  * @param callback The callback to evalute
@@ -1042,6 +1141,7 @@ static void DoTriggerVehicle(Vehicle *v, VehicleTrigger trigger, byte base_rando
 	if (group == NULL) return;
 
 	new_random_bits = Random();
+	if (object.reseed != 0) InvalidateVehicleCallbackCache();
 	v->random_bits &= ~object.reseed;
 	v->random_bits |= (first ? new_random_bits : base_random_bits) & object.reseed;
 
@@ -40,6 +40,11 @@ bool UsesWagonOverride(const Vehicle *v);
 uint GetVehicleProperty(const Vehicle *v, uint8 property, uint orig_value);
 uint GetEngineProperty(EngineID engine, uint8 property, uint orig_value);
 
+void SetVehicleCallbackCacheActive(bool active);
+void InvalidateVehicleCallbackCache();
+void GetVehicleCallbackCacheStats(uint *hits, uint *misses);
+void ResetVehicleCallbackCacheStats();
+
 enum VehicleTrigger {
 	VEHICLE_TRIGGER_NEW_CARGO     = 0x01,
 	/* Externally triggered only for the first vehicle in chain */
@@ -0,0 +1,284 @@
+/* $Id$ */
+
+/** @file newgrf_profile.cpp Profiling of the loading of NewGRFs.
+ *
+ * When the newgrf_profile setting is enabled the time spent in every
+ * loading stage of every NewGRF, the bytes read and the number of sprites
+ * walked over are recorded while loading the NewGRFs, as well as the time
+ * spent in every action and the number of sprite groups each NewGRF
+ * allocates. Afterwards the report is written to newgrf_profile.txt in the
+ * personal directory and the most expensive NewGRFs are shown on the grf
+ * debug output. Times are in microseconds, as measured by ottd_microseconds().
+ */
+
+#include "stdafx.h"
+#include "debug.h"
+#include "fileio_func.h"
+#include "newgrf_config.h"
+#include "newgrf_spritegroup.h"
+#include "newgrf_profile.h"
+#include "core/alloc_func.hpp"
+#include "core/math_func.hpp"
+#include "core/smallvec_type.hpp"
+#include "string_func.h"
+
+extern uint64 ottd_microseconds();
+
+bool _newgrf_profile = false;
+bool _newgrf_profiling = false;
+
+/** Number of actions that are profiled separately; import blocks, data blocks and unknown actions go to the last three. */
+static const uint NUM_PROFILE_ACTIONS = 0x17;
+
+/** Names of the loading stages in the report. */
+static const char * const _grf_loading_stage_names[GLS_END] = {
+	"filescan",
+	"safetyscan",
+	"labelscan",
+	"init",
+	"reserve",
+	"activation",
+};
+
+/** Time and size spent in a single loading stage of a NewGRF. */
+struct GRFStageProfile {
+	uint64 us;           ///< Microseconds spent in the stage
+	uint64 bytes;        ///< Bytes of the file walked over
+	uint pseudo_sprites; ///< Number of pseudo sprites walked over
+	uint real_sprites;   ///< Number of real sprites walked over
+};
+
+/** Time and size spent in a single action of a NewGRF, over all stages. */
+struct GRFActionProfile {
+	uint64 us;     ///< Microseconds spent handling the action
+	uint64 bytes;  ///< Bytes of the pseudo sprites of the action
+	uint count;    ///< Number of times the action has been handled
+};
+
+/** The profile of a single NewGRF. */
+struct GRFLoadProfile {
+	const GRFConfig *config;                          ///< The NewGRF
+	uint32 grfid;                                     ///< GRF ID of the NewGRF
+	char *filename;                                   ///< Filename of the NewGRF
+	GRFStageProfile stages[GLS_END];                  ///< Profile per loading stage
+	GRFActionProfile actions[NUM_PROFILE_ACTIONS];    ///< Profile per action
+	uint sprite_groups;                               ///< Number of sprite groups allocated by the NewGRF
+
+	/** Get the number of microseconds spent in all stages. */
+	uint64 GetTotalTime() const
+	{
+		uint64 total = 0;
+		for (uint i = 0; i < GLS_END; i++) total += this->stages[i].us;
+		return total;
+	}
+};
+
+static SmallVector<GRFLoadProfile, 16> _grf_load_profiles; ///< The profiles of the NewGRFs being loaded
+static GRFLoadProfile *_cur_grf_profile;                    ///< The profile of the NewGRF being loaded now
+static GrfLoadingStage _cur_grf_profile_stage;              ///< The stage of the NewGRF being loaded now
+static uint64 _cur_grf_profile_start;                       ///< Time at the start of the stage of the NewGRF
+static uint _cur_grf_profile_groups;                        ///< Number of sprite groups at the start of the stage of the NewGRF
+static uint64 _grf_load_profile_start;                      ///< Time at the start of the loading of all NewGRFs
+
+/** Free the profiles of the previous load. */
+static void ClearNewGRFProfiles()
+{
+	for (GRFLoadProfile *p = _grf_load_profiles.Begin(); p != _grf_load_profiles.End(); p++) free(p->filename);
+	_grf_load_profiles.Clear();
+	_cur_grf_profile = NULL;
+}
+
+/** Start profiling the loading of all NewGRFs, if that is enabled. */
+void NewGRFProfileBeginLoad()
+{
+	ClearNewGRFProfiles();
+	_newgrf_profiling = _newgrf_profile;
+	if (!_newgrf_profiling) return;
+
+	_grf_load_profile_start = ottd_microseconds();
+}
+
+/**
+ * Start profiling a stage of a NewGRF.
+ * @param config the NewGRF that is going to be loaded
+ * @param stage the stage it is loaded in
+ */
+void NewGRFProfileBeginFile(const GRFConfig *config, GrfLoadingStage stage)
+{
+	_cur_grf_profile = NULL;
+	for (GRFLoadProfile *p = _grf_load_profiles.Begin(); p != _grf_load_profiles.End(); p++) {
+		if (p->config == config) {
+			_cur_grf_profile = p;
+			break;
+		}
+	}
+
+	if (_cur_grf_profile == NULL) {
+		_cur_grf_profile = _grf_load_profiles.Append();
+		memset(_cur_grf_profile, 0, sizeof(*_cur_grf_profile));
+		_cur_grf_profile->config = config;
+		_cur_grf_profile->filename = strdup(config->filename);
+	}
+	_cur_grf_profile->grfid = config->grfid;
+
+	_cur_grf_profile_stage = stage;
+	_cur_grf_profile_groups = GetSpriteGroupCount();
+	_cur_grf_profile_start = ottd_microseconds();
+}
+
+/**
+ * Stop profiling the stage of the current NewGRF.
+ * @param bytes the number of bytes of the file walked over
+ * @param pseudo_sprites the number of pseudo sprites walked over
+ * @param real_sprites the number of real sprites walked over
+ */
+void NewGRFProfileEndFile(size_t bytes, uint pseudo_sprites, uint real_sprites)
+{
+	if (_cur_grf_profile == NULL) return;
+
+	GRFStageProfile *stage = &_cur_grf_profile->stages[_cur_grf_profile_stage];
+	stage->us += ottd_microseconds() - _cur_grf_profile_start;
+	stage->bytes += bytes;
+	stage->pseudo_sprites += pseudo_sprites;
+	stage->real_sprites += real_sprites;
+	_cur_grf_profile->sprite_groups += GetSpriteGroupCount() - _cur_grf_profile_groups;
+
+	_cur_grf_profile = NULL;
+}
+
+/**
+ * Add the handling of an action to the profile of the current NewGRF.
+ * @param action the action that has been handled
+ * @param size the size of its pseudo sprite
+ * @param us the microseconds spent handling it
+ */
+void NewGRFProfileAction(byte action, uint size, uint64 us)
+{
+	if (_cur_grf_profile == NULL) return;
+
+	uint index;
+	switch (action) {
+		case 0xFE: index = NUM_PROFILE_ACTIONS - 3; break;
+		case 0xFF: index = NUM_PROFILE_ACTIONS - 2; break;
+		/* Actions 0x14 and higher don't exist (yet); don't mix them with the import and data blocks */
+		default:   index = (action < NUM_PROFILE_ACTIONS - 3) ? action : NUM_PROFILE_ACTIONS - 1; break;
+	}
+
+	GRFActionProfile *p = &_cur_grf_profile->actions[index];
+	p->us += us;
+	p->bytes += size;
+	p->count++;
+}
+
+/**
+ * Get the name of a profiled action.
+ * @param index the index in GRFLoadProfile::actions
+ * @param buf the buffer to write the name to
+ * @param last the last element of the buffer
+ * @return buf
+ */
+static const char *GetProfileActionName(uint index, char *buf, const char *last)
+{
+	if (index == NUM_PROFILE_ACTIONS - 3) {
+		strecpy(buf, "import", last);
+	} else if (index == NUM_PROFILE_ACTIONS - 2) {
+		strecpy(buf, "data", last);
+	} else if (index == NUM_PROFILE_ACTIONS - 1) {
+		strecpy(buf, "unknown", last);
+	} else {
+		snprintf(buf, last - buf + 1, "action %02X", index);
+	}
+	return buf;
+}
+
+/**
+ * Get the share of a time in the total, in tenths of percents.
+ * @param us the microseconds to get the share of
+ * @param total the total number of microseconds
+ * @return the share
+ */
+static uint GetTimeShare(uint64 us, uint64 total)
+{
+	return total == 0 ? 0 : (uint)(us * 1000 / total);
+}
+
+/**
+ * Write the report of the profile of the last load.
+ * @param f the file to write to
+ * @param total the microseconds spent in loading all NewGRFs
+ */
+static void WriteNewGRFProfile(FILE *f, uint64 total)
+{
+	uint pool_size;
+	uint sprite_groups = GetSpriteGroupCount(&pool_size);
+	fprintf(f, "NewGRF load profile; %u NewGRFs; %" OTTD_PRINTF64 "u.%03u ms; %u sprite groups in a pool of %u\n\n",
+			_grf_load_profiles.Length(), total / 1000, (uint)(total % 1000), sprite_groups, pool_size);
+
+	fprintf(f, "Per NewGRF and stage:\n");
+	fprintf(f, "%-8s  %-11s  %20s  %6s  %12s  %8s  %8s\n", "grfid", "stage", "us", "share", "bytes", "pseudo", "real");
+	for (const GRFLoadProfile *p = _grf_load_profiles.Begin(); p != _grf_load_profiles.End(); p++) {
+		uint64 us = p->GetTotalTime();
+		uint share = GetTimeShare(us, total);
+		fprintf(f, "%08X  %-11s  %20" OTTD_PRINTF64 "u  %3u.%u%%  %s\n", BSWAP32(p->grfid), "total", us, share / 10, share % 10, p->filename);
+
+		for (uint i = 0; i < GLS_END; i++) {
+			const GRFStageProfile *s = &p->stages[i];
+			if (s->us == 0 && s->bytes == 0) continue;
+			share = GetTimeShare(s->us, total);
+			fprintf(f, "%8s  %-11s  %20" OTTD_PRINTF64 "u  %3u.%u%%  %12" OTTD_PRINTF64 "u  %8u  %8u\n",
+					"", _grf_loading_stage_names[i], s->us, share / 10, share % 10, s->bytes, s->pseudo_sprites, s->real_sprites);
+		}
+	}
+
+	fprintf(f, "\nPer NewGRF and action:\n");
+	fprintf(f, "%-8s  %-11s  %20s  %6s  %12s  %8s\n", "grfid", "action", "us", "share", "bytes", "count");
+	for (const GRFLoadProfile *p = _grf_load_profiles.Begin(); p != _grf_load_profiles.End(); p++) {
+		fprintf(f, "%08X  %u sprite groups\n", BSWAP32(p->grfid), p->sprite_groups);
+
+		for (uint i = 0; i < NUM_PROFILE_ACTIONS; i++) {
+			const GRFActionProfile *a = &p->actions[i];
+			if (a->count == 0) continue;
+			char name[16];
+			uint share = GetTimeShare(a->us, total);
+			fprintf(f, "%8s  %-11s  %20" OTTD_PRINTF64 "u  %3u.%u%%  %12" OTTD_PRINTF64 "u  %8u\n",
+					"", GetProfileActionName(i, name, lastof(name)), a->us, share / 10, share % 10, a->bytes, a->count);
+		}
+	}
+}
+
+/** Stop profiling the loading of all NewGRFs and write the report. */
+void NewGRFProfileEndLoad()
+{
+	if (!_newgrf_profiling) return;
+	_newgrf_profiling = false;
+
+	uint64 total = ottd_microseconds() - _grf_load_profile_start;
+
+	char *filename = str_fmt("%snewgrf_profile.txt", _personal_dir);
+	FILE *f = fopen(filename, "w");
+	if (f != NULL) {
+		WriteNewGRFProfile(f, total);
+		fclose(f);
+		DEBUG(grf, 0, "NewGRF load profile written to '%s'", filename);
+	} else {
+		DEBUG(grf, 0, "Cannot write NewGRF load profile to '%s'", filename);
+	}
+	free(filename);
+
+	/* Show the most expensive NewGRFs on the debug output too */
+	const GRFLoadProfile *shown[5];
+	uint num_shown = 0;
+	for (const GRFLoadProfile *p = _grf_load_profiles.Begin(); p != _grf_load_profiles.End(); p++) {
+		uint i = num_shown;
+		if (i < lengthof(shown)) num_shown++;
+		for (; i > 0 && shown[i - 1]->GetTotalTime() < p->GetTotalTime(); i--) {
+			if (i < lengthof(shown)) shown[i] = shown[i - 1];
+		}
+		if (i < lengthof(shown)) shown[i] = p;
+	}
+	for (uint i = 0; i < num_shown; i++) {
+		uint64 us = shown[i]->GetTotalTime();
+		uint share = GetTimeShare(us, total);
+		DEBUG(grf, 0, "  %3u.%u%% %6" OTTD_PRINTF64 "u ms %08X %s", share / 10, share % 10, us / 1000, BSWAP32(shown[i]->grfid), shown[i]->filename);
+	}
+}
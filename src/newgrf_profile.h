@@ -0,0 +1,30 @@
+/* $Id$ */
+
+/** @file newgrf_profile.h Profiling of the loading of NewGRFs. */
+
+#ifndef NEWGRF_PROFILE_H
+#define NEWGRF_PROFILE_H
+
+#include "newgrf.h"
+
+struct GRFConfig;
+
+extern bool _newgrf_profile;
+
+void NewGRFProfileBeginLoad();
+void NewGRFProfileEndLoad();
+void NewGRFProfileBeginFile(const GRFConfig *config, GrfLoadingStage stage);
+void NewGRFProfileEndFile(size_t bytes, uint pseudo_sprites, uint real_sprites);
+void NewGRFProfileAction(byte action, uint size, uint64 us);
+
+/**
+ * Whether the loading of NewGRFs is being profiled at the moment.
+ * @return true when the profile hooks have to be called
+ */
+static inline bool IsNewGRFProfiling()
+{
+	extern bool _newgrf_profiling;
+	return _newgrf_profiling;
+}
+
+#endif /* NEWGRF_PROFILE_H */
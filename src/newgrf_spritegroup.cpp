@@ -3,11 +3,14 @@
 /** @file newgrf_spritegroup.cpp Handling of primarily NewGRF action 2. */
 
 #include "stdafx.h"
+#include "debug.h"
 #include "oldpool.h"
 #include "newgrf.h"
 #include "newgrf_spritegroup.h"
 #include "sprite.h"
 
+#include <algorithm>
+
 static void SpriteGroupPoolCleanBlock(uint start_item, uint end_item);
 
 static uint _spritegroup_count = 0;
@@ -26,6 +29,8 @@ static void DestroySpriteGroup(SpriteGroup *group)
 		case SGT_DETERMINISTIC:
 			free(group->g.determ.adjusts);
 			free(group->g.determ.ranges);
+			free(group->g.determ.compiled_ranges);
+			free((SpriteGroup**)group->g.determ.jump_table);
 			break;
 
 		case SGT_RANDOMIZED:
@@ -64,6 +69,17 @@ SpriteGroup *AllocateSpriteGroup()
 }
 
 
+/**
+ * Get the usage of the sprite group pool.
+ * @param pool_size filled with the number of sprite groups the pool has room for
+ * @return the number of sprite groups that are allocated
+ */
+uint GetSpriteGroupCount(uint *pool_size)
+{
+	if (pool_size != NULL) *pool_size = GetSpriteGroupPoolSize();
+	return _spritegroup_count;
+}
+
 void InitializeSpriteGroupPool()
 {
 	_SpriteGroup_pool.CleanPool();
@@ -158,29 +174,85 @@ static U EvalAdjustT(const DeterministicSpriteGroupAdjust *adjust, ResolverObjec
 }
 
 
+/**
+ * Resolve a var 0x7E procedure call. Resolving only changes a few members
+ * of the resolver object, so only those are restored afterwards instead of
+ * resolving with a copy of the whole object.
+ * @param subroutine the group to call
+ * @param object the resolver object of the caller
+ * @return the callback result of the procedure, or CALLBACK_FAILED
+ */
+static uint32 ResolveProcedure(const SpriteGroup *subroutine, ResolverObject *object)
+{
+	VarSpriteGroupScope scope = object->scope;
+	uint32 last_value = object->last_value;
+	uint32 reseed = object->reseed;
+	byte count = object->count;
+	bool procedure_call = object->procedure_call;
+
+	object->procedure_call = true;
+	const SpriteGroup *subgroup = Resolve(subroutine, object);
+
+	object->scope = scope;
+	object->last_value = last_value;
+	object->reseed = reseed;
+	object->count = count;
+	object->procedure_call = procedure_call;
+
+	if (subgroup == NULL || subgroup->type != SGT_CALLBACK) return CALLBACK_FAILED;
+	return subgroup->g.callback.result;
+}
+
+/**
+ * Find the group of the range a value is in, in the ranges compiled by OptimiseSpriteGroups().
+ * @param determ the group to look in
+ * @param value the value to look for
+ * @return the group to continue with
+ */
+static inline const SpriteGroup *FindCompiledRange(const DeterministicSpriteGroup *determ, uint32 value)
+{
+	if (determ->jump_table != NULL) return determ->jump_table[value];
+
+	const DeterministicSpriteGroupRange *ranges = determ->compiled_ranges;
+	uint low = 0;
+	uint high = determ->num_compiled_ranges - 1;
+	while (low < high) {
+		uint mid = (low + high + 1) / 2;
+		if (ranges[mid].low <= value) {
+			low = mid;
+		} else {
+			high = mid - 1;
+		}
+	}
+	return ranges[low].group;
+}
+
+/**
+ * Evaluate a deterministic group.
+ * @param group the group to evaluate
+ * @param object the object to evaluate it for
+ * @return the group to continue resolving with
+ */
 static inline const SpriteGroup *ResolveVariable(const SpriteGroup *group, ResolverObject *object)
 {
 	static SpriteGroup nvarzero;
-	uint32 last_value = 0;
-	uint32 value = 0;
+	const DeterministicSpriteGroup *determ = &group->g.determ;
+
+	if (determ->collapsed) return determ->collapsed_group;
+
+	uint32 last_value = determ->folded_value;
+	uint32 value = last_value;
 	uint i;
 
-	object->scope = group->g.determ.var_scope;
+	object->scope = determ->var_scope;
 
-	for (i = 0; i < group->g.determ.num_adjusts; i++) {
-		DeterministicSpriteGroupAdjust *adjust = &group->g.determ.adjusts[i];
+	for (i = determ->num_folded_adjusts; i < determ->num_adjusts; i++) {
+		DeterministicSpriteGroupAdjust *adjust = &determ->adjusts[i];
 
 		/* Try to get the variable. We shall assume it is available, unless told otherwise. */
 		bool available = true;
 		if (adjust->variable == 0x7E) {
-			ResolverObject subobject = *object;
-			subobject.procedure_call = true;
-			const SpriteGroup *subgroup = Resolve(adjust->subroutine, &subobject);
-			if (subgroup == NULL || subgroup->type != SGT_CALLBACK) {
-				value = CALLBACK_FAILED;
-			} else {
-				value = subgroup->g.callback.result;
-			}
+			value = ResolveProcedure(adjust->subroutine, object);
 		} else {
 			value = GetVariable(object, adjust->variable, adjust->parameter, &available);
 		}
@@ -188,10 +260,10 @@ static inline const SpriteGroup *ResolveVariable(const SpriteGroup *group, Resol
 		if (!available) {
 			/* Unsupported property: skip further processing and return either
 			 * the group from the first range or the default group. */
-			return Resolve(group->g.determ.num_ranges > 0 ? group->g.determ.ranges[0].group : group->g.determ.default_group, object);
+			return determ->num_ranges > 0 ? determ->ranges[0].group : determ->default_group;
 		}
 
-		switch (group->g.determ.size) {
+		switch (determ->size) {
 			case DSG_SIZE_BYTE:  value = EvalAdjustT<uint8,  int8> (adjust, object, last_value, value); break;
 			case DSG_SIZE_WORD:  value = EvalAdjustT<uint16, int16>(adjust, object, last_value, value); break;
 			case DSG_SIZE_DWORD: value = EvalAdjustT<uint32, int32>(adjust, object, last_value, value); break;
@@ -202,7 +274,7 @@ static inline const SpriteGroup *ResolveVariable(const SpriteGroup *group, Resol
 
 	object->last_value = last_value;
 
-	if (group->g.determ.num_ranges == 0) {
+	if (determ->num_ranges == 0) {
 		/* nvar == 0 is a special case -- we turn our value into a callback result */
 		if (value != CALLBACK_FAILED) value = GB(value, 0, 15);
 		nvarzero.type = SGT_CALLBACK;
@@ -210,16 +282,24 @@ static inline const SpriteGroup *ResolveVariable(const SpriteGroup *group, Resol
 		return &nvarzero;
 	}
 
-	for (i = 0; i < group->g.determ.num_ranges; i++) {
-		if (group->g.determ.ranges[i].low <= value && value <= group->g.determ.ranges[i].high) {
-			return Resolve(group->g.determ.ranges[i].group, object);
+	if (determ->compiled_ranges != NULL) return FindCompiledRange(determ, value);
+
+	for (i = 0; i < determ->num_ranges; i++) {
+		if (determ->ranges[i].low <= value && value <= determ->ranges[i].high) {
+			return determ->ranges[i].group;
 		}
 	}
 
-	return Resolve(group->g.determ.default_group, object);
+	return determ->default_group;
 }
 
 
+/**
+ * Evaluate a randomized group.
+ * @param group the group to evaluate
+ * @param object the object to evaluate it for
+ * @return the group to continue resolving with
+ */
 static inline const SpriteGroup *ResolveRandom(const SpriteGroup *group, ResolverObject *object)
 {
 	uint32 mask;
@@ -251,20 +331,300 @@ static inline const SpriteGroup *ResolveRandom(const SpriteGroup *group, Resolve
 	mask  = (group->g.random.num_groups - 1) << group->g.random.lowest_randbit;
 	index = (object->GetRandomBits(object) & mask) >> group->g.random.lowest_randbit;
 
-	return Resolve(group->g.random.groups[index], object);
+	return group->g.random.groups[index];
 }
 
 
 /* ResolverObject (re)entry point */
 const SpriteGroup *Resolve(const SpriteGroup *group, ResolverObject *object)
 {
-	/* We're called even if there is no group, so quietly return nothing */
-	if (group == NULL) return NULL;
+	/* Follow the chain of deterministic and randomized groups iteratively */
+	for (;;) {
+		/* We're called even if there is no group, so quietly return nothing */
+		if (group == NULL) return NULL;
+
+		switch (group->type) {
+			case SGT_REAL:          return object->ResolveReal(object, group);
+			case SGT_DETERMINISTIC: group = ResolveVariable(group, object); break;
+			case SGT_RANDOMIZED:    group = ResolveRandom(group, object); break;
+			default:                return group;
+		}
+	}
+}
 
-	switch (group->type) {
-		case SGT_REAL:          return object->ResolveReal(object, group);
-		case SGT_DETERMINISTIC: return ResolveVariable(group, object);
-		case SGT_RANDOMIZED:    return ResolveRandom(group, object);
-		default:                return group;
+
+/** The number of compiled ranges from which on byte sized groups get a jump table. */
+static const uint JUMP_TABLE_MIN_RANGES = 8;
+
+/**
+ * Get the highest value a deterministic group can compare with its ranges.
+ * @param size the size of the variable of the group
+ * @return the highest value
+ */
+static uint32 GetDeterministicMaxValue(DeterministicSpriteGroupSize size)
+{
+	switch (size) {
+		case DSG_SIZE_BYTE: return 0xFF;
+		case DSG_SIZE_WORD: return 0xFFFF;
+		default:            return 0xFFFFFFFF;
 	}
 }
+
+/**
+ * Check whether an adjust only depends on constants and has no side effects,
+ * so it can be evaluated while loading.
+ * @param adjust the adjust to check
+ * @param size the size of the variable of the group
+ * @return true when the adjust can be folded
+ */
+static bool IsFoldableAdjust(const DeterministicSpriteGroupAdjust *adjust, DeterministicSpriteGroupSize size)
+{
+	/* Variable 0x1A is always -1; it is how constants are written */
+	if (adjust->variable != 0x1A) return false;
+
+	switch (adjust->operation) {
+		case DSGA_OP_STO:
+		case DSGA_OP_STOP:
+		/* The check for division by zero is done before truncating the value */
+		case DSGA_OP_SDIV:
+		case DSGA_OP_SMOD:
+		case DSGA_OP_UDIV:
+		case DSGA_OP_UMOD:
+			return false;
+
+		default:
+			break;
+	}
+
+	/* Do not divide by zero while loading */
+	return adjust->type == DSGA_TYPE_NONE || (adjust->divmod_val & GetDeterministicMaxValue(size)) != 0;
+}
+
+/**
+ * Check whether an adjust has side effects, i.e. whether it must be evaluated
+ * even when the result of the group is already known.
+ * @param adjust the adjust to check
+ * @return true when the adjust has side effects
+ */
+static bool HasSideEffects(const DeterministicSpriteGroupAdjust *adjust)
+{
+	return adjust->variable == 0x7E || adjust->operation == DSGA_OP_STO || adjust->operation == DSGA_OP_STOP;
+}
+
+/**
+ * Fold the leading adjusts of a deterministic group that only use constants.
+ * @param determ the group to fold
+ */
+static void FoldDeterministicAdjusts(DeterministicSpriteGroup *determ)
+{
+	uint32 value = 0;
+	uint i;
+	for (i = 0; i < determ->num_adjusts && IsFoldableAdjust(&determ->adjusts[i], determ->size); i++) {
+		const DeterministicSpriteGroupAdjust *adjust = &determ->adjusts[i];
+		switch (determ->size) {
+			case DSG_SIZE_BYTE:  value = EvalAdjustT<uint8,  int8> (adjust, NULL, value, UINT_MAX); break;
+			case DSG_SIZE_WORD:  value = EvalAdjustT<uint16, int16>(adjust, NULL, value, UINT_MAX); break;
+			case DSG_SIZE_DWORD: value = EvalAdjustT<uint32, int32>(adjust, NULL, value, UINT_MAX); break;
+			default: NOT_REACHED(); break;
+		}
+	}
+
+	determ->num_folded_adjusts = i;
+	determ->folded_value = value;
+}
+
+/**
+ * Compile the ranges of a deterministic group into sorted, disjoint ranges
+ * that cover all values the group can compare, so the range of a value can
+ * be found with a binary search. Overlapping ranges are resolved like the
+ * original ranges are evaluated: the first range wins.
+ * @param determ the group to compile
+ */
+static void CompileDeterministicRanges(DeterministicSpriteGroup *determ)
+{
+	uint32 max_value = GetDeterministicMaxValue(determ->size);
+
+	/* Collect all values where the range a value is in can change */
+	uint32 *bounds = MallocT<uint32>(2 * determ->num_ranges + 1);
+	uint num_bounds = 0;
+	bounds[num_bounds++] = 0;
+	for (uint i = 0; i < determ->num_ranges; i++) {
+		const DeterministicSpriteGroupRange *range = &determ->ranges[i];
+		if (range->low > range->high || range->low > max_value) continue;
+		bounds[num_bounds++] = range->low;
+		if (range->high < max_value) bounds[num_bounds++] = range->high + 1;
+	}
+	std::sort(bounds, bounds + num_bounds);
+	num_bounds = std::unique(bounds, bounds + num_bounds) - bounds;
+
+	DeterministicSpriteGroupRange *compiled = MallocT<DeterministicSpriteGroupRange>(num_bounds);
+	uint num_compiled = 0;
+	for (uint b = 0; b < num_bounds; b++) {
+		const SpriteGroup *target = determ->default_group;
+		for (uint i = 0; i < determ->num_ranges; i++) {
+			if (determ->ranges[i].low <= bounds[b] && bounds[b] <= determ->ranges[i].high) {
+				target = determ->ranges[i].group;
+				break;
+			}
+		}
+
+		uint32 high = (b + 1 < num_bounds) ? bounds[b + 1] - 1 : max_value;
+		if (num_compiled > 0 && compiled[num_compiled - 1].group == target) {
+			/* Merge with the previous range */
+			compiled[num_compiled - 1].high = high;
+			continue;
+		}
+
+		compiled[num_compiled].group = target;
+		compiled[num_compiled].low   = bounds[b];
+		compiled[num_compiled].high  = high;
+		num_compiled++;
+	}
+	free(bounds);
+
+	determ->compiled_ranges = ReallocT(compiled, num_compiled);
+	determ->num_compiled_ranges = num_compiled;
+
+	if (determ->size == DSG_SIZE_BYTE && num_compiled >= JUMP_TABLE_MIN_RANGES) {
+		const SpriteGroup **table = MallocT<const SpriteGroup *>(max_value + 1);
+		for (uint i = 0; i < num_compiled; i++) {
+			for (uint32 v = compiled[i].low; v <= compiled[i].high; v++) table[v] = compiled[i].group;
+		}
+		determ->jump_table = table;
+	}
+}
+
+/**
+ * Find out whether a deterministic group always resolves to the same group,
+ * without side effects, so it can be skipped when resolving.
+ * @param determ the group to check
+ * @param target is set to the group it always resolves to
+ * @return true when the group always resolves to target
+ */
+static bool IsSingleTargetGroup(const DeterministicSpriteGroup *determ, const SpriteGroup **target)
+{
+	/* This turns the value into a callback result; that is not a single group */
+	if (determ->num_ranges == 0) return false;
+
+	for (uint i = determ->num_folded_adjusts; i < determ->num_adjusts; i++) {
+		if (HasSideEffects(&determ->adjusts[i])) return false;
+	}
+
+	if (determ->num_folded_adjusts == determ->num_adjusts) {
+		/* Only constants, so the value is always the same */
+		*target = FindCompiledRange(determ, determ->folded_value);
+		return true;
+	}
+
+	/* The group of the first range is used when a variable is not available */
+	*target = determ->ranges[0].group;
+	for (uint i = 0; i < determ->num_compiled_ranges; i++) {
+		if (determ->compiled_ranges[i].group != *target) return false;
+	}
+	return true;
+}
+
+/**
+ * Follow a chain of collapsed groups to the group it ends in.
+ * @param group the group to start at
+ * @return the group the chain ends in
+ */
+static const SpriteGroup *FollowCollapsedGroups(const SpriteGroup *group)
+{
+	/* Bounded, as the groups of a broken NewGRF can form a loop */
+	for (uint i = 0; i < 256; i++) {
+		if (group == NULL || group->type != SGT_DETERMINISTIC || !group->g.determ.collapsed) return group;
+		group = group->g.determ.collapsed_group;
+	}
+	return group;
+}
+
+/**
+ * Optimise the sprite groups for resolving, after all NewGRFs are loaded:
+ * - leading adjusts of deterministic groups that only use constants are folded,
+ * - the ranges of deterministic groups are compiled into sorted ranges, or a
+ *   jump table for byte sized groups with many ranges,
+ * - deterministic groups that always resolve to the same group are skipped.
+ * The result of resolving stays exactly the same.
+ */
+void OptimiseSpriteGroups()
+{
+	uint folded = 0;
+	uint jump_tables = 0;
+	uint collapsed = 0;
+
+	/* Skipping groups changes the 'last computed value' (variable 0x1C), so
+	 * that is only possible when none of the groups reads it. */
+	bool can_collapse = true;
+
+	for (uint i = 0; i < _spritegroup_count; i++) {
+		SpriteGroup *group = GetSpriteGroup(i);
+		if (group->type != SGT_DETERMINISTIC) continue;
+
+		DeterministicSpriteGroup *determ = &group->g.determ;
+		for (uint j = 0; j < determ->num_adjusts; j++) {
+			if (determ->adjusts[j].variable == 0x1C) can_collapse = false;
+		}
+
+		FoldDeterministicAdjusts(determ);
+		if (determ->num_folded_adjusts > 0) folded++;
+
+		if (determ->num_ranges == 0) continue;
+		CompileDeterministicRanges(determ);
+		if (determ->jump_table != NULL) jump_tables++;
+	}
+
+	if (can_collapse) {
+		for (uint i = 0; i < _spritegroup_count; i++) {
+			SpriteGroup *group = GetSpriteGroup(i);
+			if (group->type != SGT_DETERMINISTIC) continue;
+
+			const SpriteGroup *target;
+			if (!IsSingleTargetGroup(&group->g.determ, &target) || target == group) continue;
+
+			group->g.determ.collapsed = true;
+			group->g.determ.collapsed_group = target;
+			collapsed++;
+		}
+
+		/* Let the groups that get resolved further refer to the end of the chain
+		 * of collapsed groups directly. Real groups are not resolved further. */
+		for (uint i = 0; i < _spritegroup_count; i++) {
+			SpriteGroup *group = GetSpriteGroup(i);
+			switch (group->type) {
+				case SGT_DETERMINISTIC: {
+					DeterministicSpriteGroup *determ = &group->g.determ;
+					if (determ->collapsed) {
+						determ->collapsed_group = FollowCollapsedGroups(determ->collapsed_group);
+						break;
+					}
+					for (uint j = 0; j < determ->num_adjusts; j++) {
+						if (determ->adjusts[j].variable == 0x7E) determ->adjusts[j].subroutine = FollowCollapsedGroups(determ->adjusts[j].subroutine);
+					}
+					for (uint j = 0; j < determ->num_ranges; j++) {
+						determ->ranges[j].group = FollowCollapsedGroups(determ->ranges[j].group);
+					}
+					for (uint j = 0; j < determ->num_compiled_ranges; j++) {
+						determ->compiled_ranges[j].group = FollowCollapsedGroups(determ->compiled_ranges[j].group);
+					}
+					if (determ->jump_table != NULL) {
+						for (uint j = 0; j <= 0xFF; j++) determ->jump_table[j] = FollowCollapsedGroups(determ->jump_table[j]);
+					}
+					determ->default_group = FollowCollapsedGroups(determ->default_group);
+					break;
+				}
+
+				case SGT_RANDOMIZED:
+					for (uint j = 0; j < group->g.random.num_groups; j++) {
+						group->g.random.groups[j] = FollowCollapsedGroups(group->g.random.groups[j]);
+					}
+					break;
+
+				default:
+					break;
+			}
+		}
+	}
+
+	DEBUG(grf, 2, "Optimised sprite groups: %d with folded constants, %d jump tables, %d collapsed", folded, jump_tables, collapsed);
+}
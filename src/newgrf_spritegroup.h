@@ -123,6 +123,15 @@ struct DeterministicSpriteGroup {
 
 	/* Dynamically allocated, this is the sole owner */
 	const SpriteGroup *default_group;
+
+	/* Filled by OptimiseSpriteGroups() after loading, to speed up resolving */
+	byte num_folded_adjusts;   ///< Number of leading adjusts only using constants, folded into folded_value
+	uint32 folded_value;       ///< The value after evaluating the folded adjusts
+	uint16 num_compiled_ranges;                     ///< Number of compiled ranges
+	DeterministicSpriteGroupRange *compiled_ranges; ///< Sorted, disjoint ranges covering all values, including the default group
+	const SpriteGroup **jump_table;                 ///< For byte sized groups with many ranges, the group of every value
+	bool collapsed;            ///< Whether this group always resolves to collapsed_group
+	const SpriteGroup *collapsed_group;             ///< The group this group always resolves to
 };
 
 enum RandomizedSpriteGroupCompareMode {
@@ -199,7 +208,9 @@ struct SpriteGroup {
 
 
 SpriteGroup *AllocateSpriteGroup();
+uint GetSpriteGroupCount(uint *pool_size = NULL);
 void InitializeSpriteGroupPool();
+void OptimiseSpriteGroups();
 
 
 struct ResolverObject {
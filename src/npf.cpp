@@ -16,6 +16,7 @@
 #include "pbs.h"
 #include "settings_type.h"
 #include "pathfind.h"
+#include "pathfinder_stats.h"
 
 static AyStar _npf_aystar;
 
@@ -891,10 +892,21 @@ static NPFFoundTargetData NPFRouteInternal(AyStarNode *start1, bool ignore_start
 	_npf_aystar.user_data[NPF_OWNER] = owner;
 	_npf_aystar.user_data[NPF_RAILTYPES] = railtypes;
 
+	extern uint64 ottd_microseconds();
+	bool recording = IsRecordingPathfinderStats();
+	uint64 stats_start = recording ? ottd_microseconds() : 0;
+
 	/* GO! */
 	r = AyStarMain_Main(&_npf_aystar);
 	assert(r != AYSTAR_STILL_BUSY);
 
+	if (recording) {
+		extern int _aystar_stats_closed_size;
+		uint nodes = _aystar_stats_closed_size;
+		bool limit_reached = _npf_aystar.max_search_nodes != 0 && nodes >= _npf_aystar.max_search_nodes;
+		RecordPathfinderSearch(VPF_NPF, type, _pathfinder_stats_vehicle, ottd_microseconds() - stats_start, nodes, result.best_bird_dist == 0, limit_reached);
+	}
+
 	if (result.best_bird_dist != 0) {
 		if (target != NULL) {
 			DEBUG(npf, 1, "Could not find route to tile 0x%X from 0x%X.", target->dest_coords, start1->tile);
@@ -44,6 +44,7 @@
 #include "date_func.h"
 #include "vehicle_func.h"
 #include "gamelog.h"
+#include "state_hash.h"
 #include "cheat_type.h"
 #include "animated_tile_func.h"
 #include "functions.h"
@@ -343,6 +344,7 @@ static void ShutdownGame()
 	free(_config_file);
 
 	/* Close all and any open filehandles */
+	StopSpriteWarmup();
 	FioCloseAll();
 }
 
@@ -854,21 +856,16 @@ static void StartScenario()
 	MarkWholeScreenDirty();
 }
 
-/** Load the specified savegame but on error do different things.
- * If loading fails due to corrupt savegame, bad version, etc. go back to
- * a previous correct state. In the menu for example load the intro game again.
- * @param filename file to be loaded
- * @param mode mode of loading, either SL_LOAD or SL_OLD_LOAD
- * @param newgm switch to this mode of loading fails due to some unknown error
- * @param subdir default directory to look for filename, set to 0 if not needed
+/**
+ * Handle the result of loading a game; on a failure that left the game
+ * state broken go back to a previous correct state.
+ * @param result the result of the load
+ * @param ogm the game mode before loading
+ * @return true when the game was loaded
  */
-bool SafeSaveOrLoad(const char *filename, int mode, GameMode newgm, Subdirectory subdir)
+static bool HandleSafeLoadResult(SaveOrLoadResult result, GameMode ogm)
 {
-	GameMode ogm = _game_mode;
-
-	_game_mode = newgm;
-	assert(mode == SL_LOAD || mode == SL_OLD_LOAD);
-	switch (SaveOrLoad(filename, mode, subdir)) {
+	switch (result) {
 		case SL_OK: return true;
 
 		case SL_REINIT:
@@ -885,6 +882,36 @@ bool SafeSaveOrLoad(const char *filename, int mode, GameMode newgm, Subdirectory
 	}
 }
 
+/** Load the specified savegame but on error do different things.
+ * If loading fails due to corrupt savegame, bad version, etc. go back to
+ * a previous correct state. In the menu for example load the intro game again.
+ * @param filename file to be loaded
+ * @param mode mode of loading, either SL_LOAD or SL_OLD_LOAD
+ * @param newgm switch to this mode of loading fails due to some unknown error
+ * @param subdir default directory to look for filename, set to 0 if not needed
+ */
+bool SafeSaveOrLoad(const char *filename, int mode, GameMode newgm, Subdirectory subdir)
+{
+	GameMode ogm = _game_mode;
+
+	_game_mode = newgm;
+	assert(mode == SL_LOAD || mode == SL_OLD_LOAD);
+	return HandleSafeLoadResult(SaveOrLoad(filename, mode, subdir), ogm);
+}
+
+/** Load a savegame from a stream, going back to a previous correct state on errors.
+ * @param proc the function that provides the savegame
+ * @param newgm switch to this mode of loading fails due to some unknown error
+ * @see SafeSaveOrLoad
+ */
+bool SafeLoadFromStream(LoadStreamProc *proc, GameMode newgm)
+{
+	GameMode ogm = _game_mode;
+
+	_game_mode = newgm;
+	return HandleSafeLoadResult(LoadFromStream(proc), ogm);
+}
+
 void SwitchToMode(SwitchMode new_mode)
 {
 #ifdef ENABLE_NETWORK
@@ -1117,6 +1144,8 @@ void StateGameLoop()
 
 		AI::GameLoop();
 
+		StateHashLoop();
+
 		CallWindowTickEvent();
 		NewsLoop();
 		_current_company = old_company;
@@ -1171,6 +1200,7 @@ void GameLoop()
 	}
 
 	IncreaseSpriteLRU();
+	ProcessSpriteWarmup();
 	InteractiveRandom();
 
 	extern int _caret_timer;
@@ -67,3 +67,36 @@ uint64 ottd_rdtsc()
 # endif
 uint64 ottd_rdtsc() {return 0;}
 #endif
+
+/* A monotonic clock in microseconds. Unlike ottd_rdtsc() it works on every
+ * platform, so it is used for the timings that are shown to the user. */
+#if defined(N3DS)
+#include <3ds.h>
+uint64 ottd_microseconds()
+{
+	uint64 ticks = svcGetSystemTick();
+	return ticks / SYSCLOCK_ARM11 * 1000000 + ticks % SYSCLOCK_ARM11 * 1000000 / SYSCLOCK_ARM11;
+}
+#elif defined(WIN32)
+#include <windows.h>
+uint64 ottd_microseconds()
+{
+	LARGE_INTEGER ticks, frequency;
+	QueryPerformanceCounter(&ticks);
+	QueryPerformanceFrequency(&frequency);
+	return ticks.QuadPart / frequency.QuadPart * 1000000 + ticks.QuadPart % frequency.QuadPart * 1000000 / frequency.QuadPart;
+}
+#else
+#include <time.h>
+#include <sys/time.h>
+uint64 ottd_microseconds()
+{
+#if defined(CLOCK_MONOTONIC)
+	struct timespec ts;
+	if (clock_gettime(CLOCK_MONOTONIC, &ts) == 0) return (uint64)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#endif
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return (uint64)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+#endif
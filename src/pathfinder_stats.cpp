@@ -0,0 +1,229 @@
+/* $Id$ */
+
+/** @file pathfinder_stats.cpp Figures about the searches of the pathfinders.
+ *
+ * While recording, every search of YAPF and NPF is accounted to the
+ * pathfinder and the kind of transport it searched for: the number of
+ * searches, how many found no path and how many ran into the
+ * max_search_nodes limit, and histograms of the time spent and the nodes
+ * expanded. The time is also summed per vehicle, so the vehicles that
+ * cost the most can be listed. Times are in microseconds, as measured by
+ * ottd_microseconds().
+ */
+
+#include "stdafx.h"
+#include "debug.h"
+#include "vehicle_base.h"
+#include "pathfinder_stats.h"
+#include "core/bitmath_func.hpp"
+#include "core/math_func.hpp"
+
+#include <map>
+#include <vector>
+#include <algorithm>
+
+bool _pathfinder_stats_enabled = false;
+const Vehicle *_pathfinder_stats_vehicle = NULL;
+
+/** Number of pathfinders searches are recorded of, indexed by VPF_NPF etc. */
+static const uint PFS_PATHFINDERS = VPF_YAPF + 1;
+/** Number of buckets of the histograms; bucket i holds values of 2^i up to 2^(i+1), the last one also all above. */
+static const uint PFS_HISTOGRAM_BUCKETS = 20;
+/** Number of vehicles that are listed. */
+static const uint PFS_PRINT_VEHICLES = 10;
+
+/** Names of the pathfinders, indexed by VPF_NPF etc. */
+static const char * const _pathfinder_names[PFS_PATHFINDERS] = { "OPF", "NPF", "YAPF" };
+/** Names of the kinds of transport, indexed by TransportType. */
+static const char * const _transport_names[TRANSPORT_END] = { "rail", "road", "water", "air" };
+
+/** The figures of all searches of a pathfinder for a kind of transport. */
+struct PathfinderSearchStats {
+	uint searches;                                ///< Number of searches
+	uint not_found;                               ///< Number of searches that did not find the destination
+	uint limit_reached;                           ///< Number of searches that stopped at max_search_nodes
+	uint64 us;                                    ///< Microseconds spent in all searches
+	uint64 nodes;                                 ///< Nodes expanded in all searches
+	uint us_histogram[PFS_HISTOGRAM_BUCKETS];     ///< Number of searches by the microseconds they took
+	uint nodes_histogram[PFS_HISTOGRAM_BUCKETS];  ///< Number of searches by the nodes they expanded
+};
+
+/** The figures of all searches for a single vehicle. */
+struct PathfinderVehicleStats {
+	VehicleType type;   ///< Type of the vehicle
+	Owner owner;        ///< Owner of the vehicle
+	UnitID unitnumber;  ///< Unit number of the vehicle
+	uint searches;      ///< Number of searches
+	uint not_found;     ///< Number of searches that did not find the destination
+	uint limit_reached; ///< Number of searches that stopped at max_search_nodes
+	uint64 us;          ///< Microseconds spent in all searches
+	uint64 nodes;       ///< Nodes expanded in all searches
+};
+
+typedef std::map<VehicleID, PathfinderVehicleStats> PathfinderVehicleStatsMap;
+
+static PathfinderSearchStats _pathfinder_search_stats[PFS_PATHFINDERS][TRANSPORT_END];
+static PathfinderVehicleStatsMap _pathfinder_vehicle_stats;
+
+/**
+ * Get the histogram bucket of a value.
+ * @param value the value
+ * @return the index of the bucket
+ */
+static inline uint GetHistogramBucket(uint64 value)
+{
+	return value == 0 ? 0 : min<uint>(FindLastBit(value), PFS_HISTOGRAM_BUCKETS - 1);
+}
+
+/**
+ * Account a search of a pathfinder.
+ * When searches run on several threads, the caller has to make sure only
+ * one of them records a search at a time.
+ * @param pathfinder the pathfinder, e.g. VPF_YAPF
+ * @param type the kind of transport searched for
+ * @param v the vehicle searched for, may be NULL
+ * @param us the microseconds the search took
+ * @param nodes the number of nodes expanded
+ * @param found whether the destination was found
+ * @param limit_reached whether the search stopped because it expanded max_search_nodes nodes
+ */
+void RecordPathfinderSearch(uint pathfinder, TransportType type, const Vehicle *v, uint64 us, uint nodes, bool found, bool limit_reached)
+{
+	assert(pathfinder < PFS_PATHFINDERS && type < TRANSPORT_END);
+
+	PathfinderSearchStats *stats = &_pathfinder_search_stats[pathfinder][type];
+	stats->searches++;
+	if (!found) stats->not_found++;
+	if (limit_reached) stats->limit_reached++;
+	stats->us += us;
+	stats->nodes += nodes;
+	stats->us_histogram[GetHistogramBucket(us)]++;
+	stats->nodes_histogram[GetHistogramBucket(nodes)]++;
+
+	if (v == NULL) return;
+
+	PathfinderVehicleStatsMap::iterator it = _pathfinder_vehicle_stats.find(v->index);
+	if (it == _pathfinder_vehicle_stats.end()) {
+		PathfinderVehicleStats vstats;
+		memset(&vstats, 0, sizeof(vstats));
+		vstats.type = v->type;
+		vstats.owner = v->owner;
+		vstats.unitnumber = v->unitnumber;
+		it = _pathfinder_vehicle_stats.insert(std::make_pair(v->index, vstats)).first;
+	}
+
+	PathfinderVehicleStats *vstats = &it->second;
+	vstats->searches++;
+	if (!found) vstats->not_found++;
+	if (limit_reached) vstats->limit_reached++;
+	vstats->us += us;
+	vstats->nodes += nodes;
+}
+
+/**
+ * Drop the figures of a vehicle that is deleted, so they are
+ * not accounted to the next vehicle with the same index.
+ * @param v the vehicle
+ */
+void ForgetPathfinderStatsVehicle(const Vehicle *v)
+{
+	if (_pathfinder_stats_vehicle == v) _pathfinder_stats_vehicle = NULL;
+	if (!_pathfinder_vehicle_stats.empty()) _pathfinder_vehicle_stats.erase(v->index);
+}
+
+/**
+ * Start or stop recording the searches of the pathfinders.
+ * @param record whether to record them
+ */
+void SetRecordingPathfinderStats(bool record)
+{
+	_pathfinder_stats_enabled = record;
+}
+
+/** Forget all recorded searches. */
+void ResetPathfinderStats()
+{
+	memset(_pathfinder_search_stats, 0, sizeof(_pathfinder_search_stats));
+	_pathfinder_vehicle_stats.clear();
+}
+
+/**
+ * Print the non-empty buckets of a histogram.
+ * @param proc the function to print with
+ * @param name the name of the histogram
+ * @param unit the unit of the values
+ * @param histogram the histogram
+ */
+static void PrintHistogram(PathfinderStatsPrintProc *proc, const char *name, const char *unit, const uint *histogram)
+{
+	char buf[512];
+	char *p = buf + snprintf(buf, lengthof(buf), "    %-7s", name);
+
+	for (uint i = 0; i < PFS_HISTOGRAM_BUCKETS; i++) {
+		if (histogram[i] == 0) continue;
+		if (i == PFS_HISTOGRAM_BUCKETS - 1) {
+			p += snprintf(p, lastof(buf) - p, " >=%u%s:%u", 1U << i, unit, histogram[i]);
+		} else {
+			p += snprintf(p, lastof(buf) - p, " <%u%s:%u", 2U << i, unit, histogram[i]);
+		}
+		if (p >= lastof(buf)) break;
+	}
+	proc(buf);
+}
+
+/** Sorts vehicle figures on the time spent for them, most first. */
+static bool PathfinderVehicleStatsSorter(PathfinderVehicleStatsMap::const_iterator a, PathfinderVehicleStatsMap::const_iterator b)
+{
+	return a->second.us > b->second.us;
+}
+
+/**
+ * Print the recorded figures.
+ * @param proc the function to print each line with
+ */
+void PrintPathfinderStats(PathfinderStatsPrintProc *proc)
+{
+	static const char * const vehicle_names[] = { "Train", "Road vehicle", "Ship", "Aircraft" };
+
+	char buf[256];
+
+	proc("---- Pathfinder stats start ----");
+	if (!_pathfinder_stats_enabled) proc("(not recording)");
+
+	uint64 total = 0;
+	for (uint pf = 0; pf < PFS_PATHFINDERS; pf++) {
+		for (uint type = 0; type < TRANSPORT_END; type++) {
+			const PathfinderSearchStats *stats = &_pathfinder_search_stats[pf][type];
+			if (stats->searches == 0) continue;
+			total += stats->us;
+
+			snprintf(buf, lengthof(buf), "%s %s: %u searches, %u not found, %u hit the node limit",
+					_pathfinder_names[pf], _transport_names[type], stats->searches, stats->not_found, stats->limit_reached);
+			proc(buf);
+			snprintf(buf, lengthof(buf), "  %" OTTD_PRINTF64 "u ms, %" OTTD_PRINTF64 "u nodes; on average %" OTTD_PRINTF64 "u us, %" OTTD_PRINTF64 "u nodes",
+					stats->us / 1000, stats->nodes, stats->us / stats->searches, stats->nodes / stats->searches);
+			proc(buf);
+			PrintHistogram(proc, "time", "us", stats->us_histogram);
+			PrintHistogram(proc, "nodes", "", stats->nodes_histogram);
+		}
+	}
+
+	if (!_pathfinder_vehicle_stats.empty()) {
+		std::vector<PathfinderVehicleStatsMap::const_iterator> entries;
+		for (PathfinderVehicleStatsMap::const_iterator it = _pathfinder_vehicle_stats.begin(); it != _pathfinder_vehicle_stats.end(); it++) {
+			entries.push_back(it);
+		}
+		std::sort(entries.begin(), entries.end(), &PathfinderVehicleStatsSorter);
+
+		proc("Vehicles that took the most time:");
+		for (uint i = 0; i < entries.size() && i < PFS_PRINT_VEHICLES; i++) {
+			const PathfinderVehicleStats *vstats = &entries[i]->second;
+			snprintf(buf, lengthof(buf), "  %5.1f%% %10" OTTD_PRINTF64 "u ms %6u searches %6u not found %6u at limit  %s %u of company %d (vehicle %u)",
+					total == 0 ? 0.0 : vstats->us * 100.0 / total, vstats->us / 1000, vstats->searches, vstats->not_found, vstats->limit_reached,
+					vehicle_names[min<uint>(vstats->type, VEH_AIRCRAFT)], vstats->unitnumber, vstats->owner + 1, entries[i]->first);
+			proc(buf);
+		}
+	}
+
+	proc("---- Pathfinder stats end ----");
+}
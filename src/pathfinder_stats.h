@@ -0,0 +1,37 @@
+/* $Id$ */
+
+/** @file pathfinder_stats.h Figures about the searches of the pathfinders. */
+
+#ifndef PATHFINDER_STATS_H
+#define PATHFINDER_STATS_H
+
+#include "transport_type.h"
+#include "vehicle_type.h"
+
+void RecordPathfinderSearch(uint pathfinder, TransportType type, const Vehicle *v, uint64 us, uint nodes, bool found, bool limit_reached);
+void ForgetPathfinderStatsVehicle(const Vehicle *v);
+void SetRecordingPathfinderStats(bool record);
+
+/** Function to print a single line of the pathfinder stats with. */
+typedef void PathfinderStatsPrintProc(const char *s);
+
+void PrintPathfinderStats(PathfinderStatsPrintProc *proc);
+void ResetPathfinderStats();
+
+/**
+ * Whether the searches of the pathfinders are being recorded at the moment.
+ * @return true when RecordPathfinderSearch has to be called
+ */
+static inline bool IsRecordingPathfinderStats()
+{
+	extern bool _pathfinder_stats_enabled;
+	return _pathfinder_stats_enabled;
+}
+
+/**
+ * The vehicle that is being ticked; searches of pathfinders that are not
+ * told which vehicle they search for are accounted to it.
+ */
+extern const Vehicle *_pathfinder_stats_vehicle;
+
+#endif /* PATHFINDER_STATS_H */
@@ -5,7 +5,14 @@
 #include "pbs.h"
 #include "functions.h"
 #include "vehicle_func.h"
+#include "thread.h"
 #include "yapf/follow_track.hpp"
+#include "core/smallvec_type.hpp"
+
+#include <map>
+#include <set>
+
+extern ThreadMutex *_yapf_node_list_mutex;
 
 /**
  * Get the reserved trackbits for any tile, regardless of type.
@@ -166,18 +173,316 @@ bool TryReserveRailTrack(TileIndex tile, Track t)
 }
 
 
-/** Follow a reservation starting from a specific tile to the end. */
-static PBSTileInfo FollowReservation(Owner o, RailTypes rts, TileIndex tile, Trackdir trackdir, bool ignore_oneway = false)
+/** Tile and trackdir of a followed reservation */
+struct FollowedTile {
+	TileIndex tile;     ///< the tile
+	Trackdir trackdir;  ///< the reserved trackdir on the tile
+};
+
+/**
+ * Reservation of a train as followed by FollowReservation().
+ * Where a reservation ends only depends on the map and on the tile and
+ * trackdir following starts at, so it is kept until track is built or
+ * removed anywhere. When the reservation changes at one of its tiles, only
+ * the part from that tile on is forgotten and followed again; when it
+ * changes at the tile after its end, following simply goes on from there.
+ * A kept reservation also tells the end for following from any other of
+ * its tiles, which is all a train needs after moving on.
+ */
+struct FollowedReservation {
+	Owner owner;                         ///< owner the reservation was followed for
+	RailTypes railtypes;                 ///< rail types the reservation was followed for
+	bool complete;                       ///< is the end of the reservation known?
+	bool oneway_end;                     ///< does the reservation end at a one-way signal against it?
+	uint first;                          ///< first position in tiles following can still start at; changes before it don't matter anymore
+	TileIndex next_tile;                 ///< tile after the end whose reservation ended the reservation, INVALID_TILE if none
+	SmallVector<FollowedTile, 16> tiles; ///< tiles of the reservation, from the start to the end
+	byte safe_end;                       ///< is the end a safe waiting position: bit 0 with 90 degree turns allowed, bit 1 with them forbidden
+	byte safe_end_known;                 ///< which bits of safe_end are known
+};
+
+/**
+ * Key of a tile of a followed reservation: the tile in the upper 32 bits,
+ * then the vehicle the reservation is kept for and the position of the tile
+ * in the reservation in 16 bits each. The position of the tile after the
+ * end is the number of tiles.
+ */
+typedef uint64 FollowedTileKey;
+typedef std::set<FollowedTileKey> FollowedTileSet;
+typedef std::map<VehicleID, FollowedReservation *> FollowedReservationMap;
+
+static FollowedTileSet _followed_tiles;                 ///< tiles of all kept reservations
+static FollowedReservationMap _followed_reservations;   ///< kept reservations, by the train they were followed for
+static SmallVector<FollowedReservation *, 16> _free_followed_reservations; ///< forgotten reservations, kept to follow reservations without allocating memory
+
+/** Maximum number of tiles of a reservation that is kept; the position of the tile after the end has to fit the key */
+static const uint FOLLOWED_RESERVATION_MAX_TILES = 0xFFFF;
+
+static inline FollowedTileKey MakeFollowedTileKey(TileIndex tile, VehicleID veh, uint pos)
+{
+	return ((FollowedTileKey)tile << 32) | ((FollowedTileKey)veh << 16) | pos;
+}
+
+/**
+ * Forget the tiles of a kept reservation from a position on, so it has to be followed from there again.
+ * @param res the reservation
+ * @param veh the train the reservation is kept for
+ * @param pos the first position to forget
+ */
+static void TruncateFollowedReservation(FollowedReservation *res, VehicleID veh, uint pos)
+{
+	if (res->next_tile != INVALID_TILE) _followed_tiles.erase(MakeFollowedTileKey(res->next_tile, veh, res->tiles.Length()));
+	while (res->tiles.Length() > pos) {
+		FollowedTile *last = res->tiles.End() - 1;
+		_followed_tiles.erase(MakeFollowedTileKey(last->tile, veh, res->tiles.Length() - 1));
+		res->tiles.Erase(last);
+	}
+
+	res->complete = false;
+	res->oneway_end = false;
+	res->next_tile = INVALID_TILE;
+	res->safe_end_known = 0;
+}
+
+/**
+ * Forget the reservation kept for a train.
+ * @param veh the train
+ */
+static void DeleteFollowedReservation(VehicleID veh)
+{
+	FollowedReservationMap::iterator it = _followed_reservations.find(veh);
+	if (it == _followed_reservations.end()) return;
+
+	FollowedReservation *res = it->second;
+	TruncateFollowedReservation(res, veh, 0);
+	_followed_reservations.erase(it);
+	*_free_followed_reservations.Append() = res;
+}
+
+/**
+ * Forget the parts of the kept reservations that change when the
+ * reservation at the given tile changes. This is called for every change
+ * of a reservation; building or removing track calls it with INVALID_TILE.
+ * @param tile tile whose reservation changed, INVALID_TILE to forget all reservations
+ */
+void InvalidateFollowedReservations(TileIndex tile)
+{
+	if (tile == INVALID_TILE) {
+		while (!_followed_reservations.empty()) DeleteFollowedReservation(_followed_reservations.begin()->first);
+		return;
+	}
+
+	FollowedTileSet::iterator it = _followed_tiles.lower_bound(MakeFollowedTileKey(tile, 0, 0));
+	while (it != _followed_tiles.end() && *it >> 32 == tile) {
+		VehicleID veh = GB(*it, 16, 16);
+		uint pos = GB(*it, 0, 16);
+		FollowedReservation *res = _followed_reservations[veh];
+		if (pos < res->first) {
+			/* the train already left this part of the reservation behind */
+			++it;
+			continue;
+		}
+
+		if (pos == res->first) {
+			DeleteFollowedReservation(veh);
+		} else {
+			TruncateFollowedReservation(res, veh, pos);
+		}
+		it = _followed_tiles.lower_bound(MakeFollowedTileKey(tile, veh + 1, 0));
+	}
+}
+
+/**
+ * Forget the reservation kept for a train that is deleted.
+ * @param v the vehicle
+ */
+void ForgetFollowedReservation(const Vehicle *v)
+{
+	if (!_followed_reservations.empty()) DeleteFollowedReservation(v->index);
+}
+
+/**
+ * Append a tile to a kept reservation.
+ * @param res the reservation
+ * @param veh the train the reservation is kept for
+ * @param tile the tile
+ * @param trackdir the reserved trackdir on the tile
+ */
+static void AppendFollowedTile(FollowedReservation *res, VehicleID veh, TileIndex tile, Trackdir trackdir)
+{
+	_followed_tiles.insert(MakeFollowedTileKey(tile, veh, res->tiles.Length()));
+	FollowedTile *ft = res->tiles.Append();
+	ft->tile = tile;
+	ft->trackdir = trackdir;
+}
+
+/**
+ * Start keeping the reservation of a train, replacing the one kept before.
+ * @param o owner the reservation is followed for
+ * @param rts rail types the reservation is followed for
+ * @param veh the train
+ * @param tile tile following starts at
+ * @param trackdir trackdir following starts at
+ * @return the reservation, it still has to be followed
+ */
+static FollowedReservation *NewFollowedReservation(Owner o, RailTypes rts, VehicleID veh, TileIndex tile, Trackdir trackdir)
+{
+	DeleteFollowedReservation(veh);
+
+	FollowedReservation *res;
+	if (_free_followed_reservations.Length() != 0) {
+		/* reuse a forgotten reservation, its list keeps its memory */
+		res = *(_free_followed_reservations.End() - 1);
+		_free_followed_reservations.Erase(_free_followed_reservations.End() - 1);
+	} else {
+		res = new FollowedReservation();
+	}
+
+	res->owner = o;
+	res->railtypes = rts;
+	res->complete = false;
+	res->oneway_end = false;
+	res->first = 0;
+	res->next_tile = INVALID_TILE;
+	res->safe_end = 0;
+	res->safe_end_known = 0;
+	AppendFollowedTile(res, veh, tile, trackdir);
+
+	_followed_reservations[veh] = res;
+	return res;
+}
+
+/**
+ * Find a kept reservation following can start at.
+ * @param o owner to follow the reservation for
+ * @param rts rail types to follow the reservation for
+ * @param tile tile to start at
+ * @param trackdir trackdir to start at
+ * @param ignore_oneway whether one-way signals against the reservation are passed
+ * @param veh train following its reservation, INVALID_VEHICLE if none
+ * @return the kept reservation, or NULL if there is none; only the reservation of the train itself may be incomplete
+ */
+static FollowedReservation *FindFollowedReservation(Owner o, RailTypes rts, TileIndex tile, Trackdir trackdir, bool ignore_oneway, VehicleID veh)
+{
+	if (veh != INVALID_VEHICLE) {
+		/* Most of the time the train only moved on along the reservation kept for it. */
+		FollowedReservationMap::iterator it = _followed_reservations.find(veh);
+		if (it != _followed_reservations.end()) {
+			FollowedReservation *res = it->second;
+			if (res->owner != o || res->railtypes != rts || ignore_oneway) return NULL;
+			for (uint pos = res->first; pos < res->tiles.Length(); pos++) {
+				const FollowedTile *ft = res->tiles.Get(pos);
+				if (ft->tile != tile || ft->trackdir != trackdir) continue;
+				res->first = pos;
+				return res;
+			}
+		}
+	}
+
+	for (FollowedTileSet::const_iterator it = _followed_tiles.lower_bound(MakeFollowedTileKey(tile, 0, 0)); it != _followed_tiles.end() && *it >> 32 == tile; ++it) {
+		FollowedReservation *res = _followed_reservations[GB(*it, 16, 16)];
+		uint pos = GB(*it, 0, 16);
+		if (!res->complete || pos < res->first || pos >= res->tiles.Length() || res->tiles.Get(pos)->trackdir != trackdir) continue;
+		if (res->owner != o || res->railtypes != rts || (ignore_oneway && res->oneway_end)) continue;
+		return res;
+	}
+	return NULL;
+}
+
+/**
+ * Follow a kept reservation from its last known tile to the end.
+ * @param res the reservation
+ * @param veh the train the reservation is kept for
+ * @return false if the reservation can't be kept, because it loops
+ */
+static bool ContinueFollowedReservation(FollowedReservation *res, VehicleID veh)
+{
+	const FollowedTile *last = res->tiles.End() - 1;
+	TileIndex tile = last->tile;
+	Trackdir  trackdir = last->trackdir;
+
+	/* Do not disallow 90 deg turns as the setting might have changed between reserving and now. */
+	CFollowTrackRail ft(res->owner, res->railtypes);
+	while (ft.Follow(tile, trackdir)) {
+		TrackdirBits reserved = ft.m_new_td_bits & TrackBitsToTrackdirBits(GetReservedTrackbits(ft.m_new_tile));
+
+		/* No reservation --> path end found */
+		if (reserved == TRACKDIR_BIT_NONE) {
+			res->next_tile = ft.m_new_tile;
+			break;
+		}
+
+		/* Can't have more than one reserved trackdir */
+		Trackdir new_trackdir = FindFirstTrackdir(reserved);
+
+		/* One-way signal against us. */
+		if (HasOnewaySignalBlockingTrackdir(ft.m_new_tile, new_trackdir)) {
+			res->oneway_end = true;
+			res->next_tile = ft.m_new_tile;
+			break;
+		}
+
+		tile = ft.m_new_tile;
+		trackdir = new_trackdir;
+
+		/* Loop encountered? Where it is left depends on where following starts. */
+		if (res->tiles.Length() > res->first + 1) {
+			const FollowedTile *loop = res->tiles.Get(res->first + 1);
+			if (tile == loop->tile && trackdir == loop->trackdir) return false;
+		}
+		if (res->tiles.Length() == FOLLOWED_RESERVATION_MAX_TILES) return false;
+
+		AppendFollowedTile(res, veh, tile, trackdir);
+
+		/* Depot tile? Can't continue. */
+		if (IsRailDepotTile(tile)) break;
+		/* Non-pbs signal? Reservation can't continue. */
+		if (IsTileType(tile, MP_RAILWAY) && HasSignalOnTrackdir(tile, trackdir) && !IsPbsSignal(GetSignalType(tile, TrackdirToTrack(trackdir)))) break;
+	}
+
+	if (res->next_tile != INVALID_TILE) _followed_tiles.insert(MakeFollowedTileKey(res->next_tile, veh, res->tiles.Length()));
+	res->complete = true;
+	return true;
+}
+
+/**
+ * Follow a reservation starting from a specific tile to the end.
+ * @param o owner to follow the reservation for
+ * @param rts rail types to follow the reservation for
+ * @param tile tile to start at
+ * @param trackdir trackdir to start at
+ * @param ignore_oneway whether one-way signals against the reservation are passed
+ * @param veh train following its reservation, the reservation is kept for it; INVALID_VEHICLE if none
+ * @param followed [out] if not NULL, the kept reservation the end was found with, or NULL if none
+ * @return the end of the reservation
+ */
+static PBSTileInfo FollowReservation(Owner o, RailTypes rts, TileIndex tile, Trackdir trackdir, bool ignore_oneway = false, VehicleID veh = INVALID_VEHICLE, FollowedReservation **followed = NULL)
 {
 	TileIndex start_tile = tile;
 	Trackdir  start_trackdir = trackdir;
 	bool      first_loop = true;
 
+	if (followed != NULL) *followed = NULL;
+
 	/* Start track not reserved? This can happen if two trains
 	 * are on the same tile. The reservation on the next tile
 	 * is not ours in this case, so exit. */
 	if (!HasReservedTracks(tile, TrackToTrackBits(TrackdirToTrack(trackdir)))) return PBSTileInfo(tile, trackdir, false);
 
+	/* Pathfinders running on several threads only read the map; they don't share the kept reservations. */
+	if (_yapf_node_list_mutex == NULL) {
+		FollowedReservation *res = FindFollowedReservation(o, rts, tile, trackdir, ignore_oneway, veh);
+		if (res == NULL && veh != INVALID_VEHICLE && !ignore_oneway) res = NewFollowedReservation(o, rts, veh, tile, trackdir);
+		if (res != NULL) {
+			if (res->complete || ContinueFollowedReservation(res, veh)) {
+				if (followed != NULL) *followed = res;
+				const FollowedTile *last = res->tiles.End() - 1;
+				return PBSTileInfo(last->tile, last->trackdir, false);
+			}
+			DeleteFollowedReservation(veh);
+		}
+	}
+
 	/* Do not disallow 90 deg turns as the setting might have changed between reserving and now. */
 	CFollowTrackRail ft(o, rts);
 	while (ft.Follow(tile, trackdir)) {
@@ -261,8 +566,20 @@ PBSTileInfo FollowTrainReservation(const Vehicle *v, bool *train_on_res)
 	if (IsRailDepotTile(tile) && !GetRailDepotReservation(tile)) return PBSTileInfo(tile, trackdir, false);
 
 	FindTrainOnTrackInfo ftoti;
-	ftoti.res = FollowReservation(v->owner, GetRailTypeInfo(v->u.rail.railtype)->compatible_railtypes, tile, trackdir);
-	ftoti.res.okay = IsSafeWaitingPosition(v, ftoti.res.tile, ftoti.res.trackdir, true, _settings_game.pf.forbid_90_deg);
+	FollowedReservation *followed;
+	ftoti.res = FollowReservation(v->owner, GetRailTypeInfo(v->u.rail.railtype)->compatible_railtypes, tile, trackdir, false, v->index, &followed);
+
+	/* Whether the end is safe only depends on the track layout, which doesn't change while the reservation is kept. */
+	bool forbid_90deg = _settings_game.pf.forbid_90_deg;
+	if (followed != NULL && HasBit(followed->safe_end_known, forbid_90deg)) {
+		ftoti.res.okay = HasBit(followed->safe_end, forbid_90deg);
+	} else {
+		ftoti.res.okay = IsSafeWaitingPosition(v, ftoti.res.tile, ftoti.res.trackdir, true, forbid_90deg);
+		if (followed != NULL) {
+			SetBit(followed->safe_end_known, forbid_90deg);
+			SB(followed->safe_end, forbid_90deg, 1, ftoti.res.okay);
+		}
+	}
 	if (train_on_res != NULL) *train_on_res = HasVehicleOnPos(ftoti.res.tile, &ftoti, FindTrainOnTrackEnum);
 	return ftoti.res;
 }
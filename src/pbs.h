@@ -33,6 +33,9 @@ bool IsWaitingPositionFree(const Vehicle *v, TileIndex tile, Trackdir trackdir,
 
 Vehicle *GetTrainForReservation(TileIndex tile, Track track);
 
+void InvalidateFollowedReservations(TileIndex tile);
+void ForgetFollowedReservation(const Vehicle *v);
+
 /**
  * Check whether some of tracks is reserved on a tile.
  *
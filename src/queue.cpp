@@ -99,34 +99,12 @@ void init_InsSort(Queue *q)
 
 static void BinaryHeap_Clear(Queue *q, bool free_values)
 {
-	/* Free all items if needed and free all but the first blocks of memory */
-	uint i;
-	uint j;
-
-	for (i = 0; i < q->data.binaryheap.blocks; i++) {
-		if (q->data.binaryheap.elements[i] == NULL) {
-			/* No more allocated blocks */
-			break;
-		}
-		/* For every allocated block */
-		if (free_values) {
-			for (j = 0; j < (1 << BINARY_HEAP_BLOCKSIZE_BITS); j++) {
-				/* For every element in the block */
-				if ((q->data.binaryheap.size >> BINARY_HEAP_BLOCKSIZE_BITS) == i &&
-						(q->data.binaryheap.size & BINARY_HEAP_BLOCKSIZE_MASK) == j) {
-					break; // We're past the last element
-				}
-				free(q->data.binaryheap.elements[i][j].item);
-			}
-		}
-		if (i != 0) {
-			/* Leave the first block of memory alone */
-			free(q->data.binaryheap.elements[i]);
-			q->data.binaryheap.elements[i] = NULL;
-		}
+	/* Free all items if needed, but keep the allocated blocks of memory
+	 * for the next use of the queue */
+	if (free_values) {
+		for (uint i = 1; i <= q->data.binaryheap.size; i++) free(BIN_HEAP_ARR(i).item);
 	}
 	q->data.binaryheap.size = 0;
-	q->data.binaryheap.blocks = 1;
 }
 
 static void BinaryHeap_Free(Queue *q, bool free_values)
@@ -296,53 +274,68 @@ void init_BinaryHeap(Queue *q, uint max_size)
  * Hash
  */
 
-void init_Hash(Hash *h, Hash_HashProc *hash, uint num_buckets)
+/** Returns the node a key pair is looked for first. The hash function only
+ * spreads the keys over num_buckets buckets, so when the hash has grown
+ * beyond that some more bits of the keys select one of the copies of the
+ * buckets. */
+static inline uint Hash_FirstNode(const Hash *h, uint key1, uint key2)
 {
-	/* Allocate space for the Hash, the buckets and the bucket flags */
-	uint i;
+	uint hash = h->hash(key1, key2);
+	assert(hash < h->num_buckets);
+
+	uint copies = h->num_nodes / h->num_buckets;
+	if (copies == 1) return hash;
+
+	uint mix = key1 ^ (key2 * 0x9E3779B1);
+	mix ^= mix >> 15;
+	mix *= 0x2C1B3C6D;
+	mix ^= mix >> 12;
+	return hash + h->num_buckets * (mix & (copies - 1));
+}
+
+/** Returns the node following the given one in the probe sequence */
+static inline uint Hash_NextNode(const Hash *h, uint index)
+{
+	return (index + 1 == h->num_nodes) ? 0 : index + 1;
+}
 
+/** Allocates the given number of empty nodes for the hash */
+static void Hash_AllocNodes(Hash *h, uint num_nodes)
+{
+	h->num_nodes = num_nodes;
+	h->nodes = MallocT<HashNode>(num_nodes);
+	for (uint i = 0; i < num_nodes; i++) h->nodes[i].generation = 0;
+	h->generation = 1;
+}
+
+void init_Hash(Hash *h, Hash_HashProc *hash, uint num_buckets)
+{
 	assert(h != NULL);
+	assert(num_buckets > 0);
 #ifdef HASH_DEBUG
 	debug("Allocated hash: %p", h);
 #endif
 	h->hash = hash;
 	h->size = 0;
 	h->num_buckets = num_buckets;
-	h->buckets = (HashNode*)MallocT<byte>(num_buckets * (sizeof(*h->buckets) + sizeof(*h->buckets_in_use)));
+	Hash_AllocNodes(h, num_buckets);
 #ifdef HASH_DEBUG
-	debug("Buckets = %p", h->buckets);
+	debug("Nodes = %p", h->nodes);
 #endif
-	h->buckets_in_use = (bool*)(h->buckets + num_buckets);
-	for (i = 0; i < num_buckets; i++) h->buckets_in_use[i] = false;
 }
 
+/** Frees the values of all nodes in use */
+static void Hash_FreeValues(Hash *h)
+{
+	for (uint i = 0; i < h->num_nodes; i++) {
+		if (h->nodes[i].generation == h->generation) free(h->nodes[i].value);
+	}
+}
 
 void delete_Hash(Hash *h, bool free_values)
 {
-	uint i;
-
-	/* Iterate all buckets */
-	for (i = 0; i < h->num_buckets; i++) {
-		if (h->buckets_in_use[i]) {
-			HashNode *node;
-
-			/* Free the first value */
-			if (free_values) free(h->buckets[i].value);
-			node = h->buckets[i].next;
-			while (node != NULL) {
-				HashNode *prev = node;
-
-				node = node->next;
-				/* Free the value */
-				if (free_values) free(prev->value);
-				/* Free the node */
-				free(prev);
-			}
-		}
-	}
-	free(h->buckets);
-	/* No need to free buckets_in_use, it is always allocated in one
-	 * malloc with buckets */
+	if (free_values && h->size != 0) Hash_FreeValues(h);
+	free(h->nodes);
 #ifdef HASH_DEBUG
 	debug("Freeing Hash: %p", h);
 #endif
@@ -351,182 +344,119 @@ void delete_Hash(Hash *h, bool free_values)
 #ifdef HASH_STATS
 static void stat_Hash(const Hash *h)
 {
-	uint used_buckets = 0;
-	uint max_collision = 0;
-	uint max_usage = 0;
-	uint usage[200];
+	uint max_distance = 0;
+	uint total_distance = 0;
 	uint i;
 
-	for (i = 0; i < lengthof(usage); i++) usage[i] = 0;
-	for (i = 0; i < h->num_buckets; i++) {
-		uint collision = 0;
-		if (h->buckets_in_use[i]) {
-			const HashNode *node;
+	for (i = 0; i < h->num_nodes; i++) {
+		const HashNode *node = &h->nodes[i];
+		if (node->generation != h->generation) continue;
 
-			used_buckets++;
-			for (node = &h->buckets[i]; node != NULL; node = node->next) collision++;
-			if (collision > max_collision) max_collision = collision;
-		}
-		if (collision >= lengthof(usage)) collision = lengthof(usage) - 1;
-		usage[collision]++;
-		if (collision > 0 && usage[collision] >= max_usage) {
-			max_usage = usage[collision];
-		}
+		uint first = Hash_FirstNode(h, node->key1, node->key2);
+		uint distance = (i >= first) ? i - first : i + h->num_nodes - first;
+		total_distance += distance;
+		if (distance > max_distance) max_distance = distance;
 	}
 	printf(
 		"---\n"
 		"Hash size: %d\n"
+		"Nodes allocated: %d\n"
 		"Nodes used: %d\n"
-		"Non empty buckets: %d\n"
-		"Max collision: %d\n",
-		h->num_buckets, h->size, used_buckets, max_collision
+		"Max probe distance: %d\n"
+		"Total probe distance: %d\n",
+		h->num_buckets, h->num_nodes, h->size, max_distance, total_distance
 	);
-	printf("{ ");
-	for (i = 0; i <= max_collision; i++) {
-		if (usage[i] > 0) {
-			printf("%d:%d ", i, usage[i]);
-#if 0
-			if (i > 0) {
-				uint j;
-
-				for (j = 0; j < usage[i] * 160 / 800; j++) putchar('#');
-			}
-			printf("\n");
-#endif
-		}
-	}
-	printf ("}\n");
 }
 #endif
 
 void clear_Hash(Hash *h, bool free_values)
 {
-	uint i;
-
 #ifdef HASH_STATS
 	if (h->size > 2000) stat_Hash(h);
 #endif
 
-	/* Iterate all buckets */
-	for (i = 0; i < h->num_buckets; i++) {
-		if (h->buckets_in_use[i]) {
-			HashNode *node;
-
-			h->buckets_in_use[i] = false;
-			/* Free the first value */
-			if (free_values) free(h->buckets[i].value);
-			node = h->buckets[i].next;
-			while (node != NULL) {
-				HashNode *prev = node;
-
-				node = node->next;
-				if (free_values) free(prev->value);
-				free(prev);
-			}
-		}
-	}
+	if (free_values && h->size != 0) Hash_FreeValues(h);
 	h->size = 0;
+
+	/* Forget all nodes at once by starting a new generation */
+	if (++h->generation != 0) return;
+	for (uint i = 0; i < h->num_nodes; i++) h->nodes[i].generation = 0;
+	h->generation = 1;
 }
 
-/** Finds the node that that saves this key pair. If it is not
- * found, returns NULL. If it is found, *prev is set to the
- * node before the one found, or if the node found was the first in the bucket
- * to NULL. If it is not found, *prev is set to the last HashNode in the
- * bucket, or NULL if it is empty. prev can also be NULL, in which case it is
- * not used for output.
- */
-static HashNode *Hash_FindNode(const Hash *h, uint key1, uint key2, HashNode** prev_out)
+/** Doubles the number of nodes of the hash and moves the nodes in use over */
+static void Hash_Grow(Hash *h)
 {
-	uint hash = h->hash(key1, key2);
-	HashNode *result = NULL;
+	HashNode *old_nodes = h->nodes;
+	uint old_num_nodes = h->num_nodes;
+	uint old_generation = h->generation;
+
+	Hash_AllocNodes(h, old_num_nodes * 2);
+	for (uint i = 0; i < old_num_nodes; i++) {
+		const HashNode *old = &old_nodes[i];
+		if (old->generation != old_generation) continue;
+
+		uint index = Hash_FirstNode(h, old->key1, old->key2);
+		while (h->nodes[index].generation == h->generation) index = Hash_NextNode(h, index);
+		h->nodes[index] = *old;
+		h->nodes[index].generation = h->generation;
+	}
+	free(old_nodes);
+}
 
+/** Finds the node that saves this key pair. If it is not found, returns NULL. */
+static HashNode *Hash_FindNode(const Hash *h, uint key1, uint key2)
+{
 #ifdef HASH_DEBUG
 	debug("Looking for %u, %u", key1, key2);
 #endif
-	/* Check if the bucket is empty */
-	if (!h->buckets_in_use[hash]) {
-		if (prev_out != NULL) *prev_out = NULL;
-		result = NULL;
-	/* Check the first node specially */
-	} else if (h->buckets[hash].key1 == key1 && h->buckets[hash].key2 == key2) {
-		/* Save the value */
-		result = h->buckets + hash;
-		if (prev_out != NULL) *prev_out = NULL;
-#ifdef HASH_DEBUG
-		debug("Found in first node: %p", result);
-#endif
-	/* Check all other nodes */
-	} else {
-		HashNode *prev = h->buckets + hash;
-		HashNode *node;
-
-		for (node = prev->next; node != NULL; node = node->next) {
-			if (node->key1 == key1 && node->key2 == key2) {
-				/* Found it */
-				result = node;
+	/* The hash is never full, so there is always an empty node ending the search */
+	for (uint i = Hash_FirstNode(h, key1, key2);; i = Hash_NextNode(h, i)) {
+		HashNode *node = &h->nodes[i];
+		if (node->generation != h->generation) break;
+		if (node->key1 == key1 && node->key2 == key2) {
 #ifdef HASH_DEBUG
-				debug("Found in other node: %p", result);
+			debug("Found in node: %p", node);
 #endif
-				break;
-			}
-			prev = node;
+			return node;
 		}
-		if (prev_out != NULL) *prev_out = prev;
 	}
 #ifdef HASH_DEBUG
-	if (result == NULL) debug("Not found");
+	debug("Not found");
 #endif
-	return result;
+	return NULL;
 }
 
 void *Hash_Delete(Hash *h, uint key1, uint key2)
 {
-	void *result;
-	HashNode *prev; // Used as output var for below function call
-	HashNode *node = Hash_FindNode(h, key1, key2, &prev);
-
-	if (node == NULL) {
-		/* not found */
-		result = NULL;
-	} else if (prev == NULL) {
-		/* It is in the first node, we can't free that one, so we free
-		 * the next one instead (if there is any)*/
-		/* Save the value */
-		result = node->value;
-		if (node->next != NULL) {
-			HashNode *next = node->next;
-			/* Copy the second to the first */
-			*node = *next;
-			/* Free the second */
-#ifndef NOFREE
-			free(next);
-#endif
-		} else {
-			/* This was the last in this bucket
-			 * Mark it as empty */
-			uint hash = h->hash(key1, key2);
-			h->buckets_in_use[hash] = false;
+	HashNode *node = Hash_FindNode(h, key1, key2);
+	if (node == NULL) return NULL;
+
+	void *result = node->value;
+
+	/* Move the following nodes of the probe sequence into the gap when the
+	 * gap lies between the node they are looked for first and their own node,
+	 * so searches for them don't stop at the gap. */
+	uint gap = node - h->nodes;
+	for (uint i = Hash_NextNode(h, gap);; i = Hash_NextNode(h, i)) {
+		const HashNode *next = &h->nodes[i];
+		if (next->generation != h->generation) break;
+
+		uint first = Hash_FirstNode(h, next->key1, next->key2);
+		if (gap < i ? (first <= gap || first > i) : (first <= gap && first > i)) {
+			h->nodes[gap] = *next;
+			gap = i;
 		}
-	} else {
-		/* It is in another node
-		 * Save the value */
-		result = node->value;
-		/* Link previous and next nodes */
-		prev->next = node->next;
-		/* Free the node */
-#ifndef NOFREE
-		free(node);
-#endif
 	}
-	if (result != NULL) h->size--;
+	h->nodes[gap].generation = 0;
+	h->size--;
 	return result;
 }
 
 
 void *Hash_Set(Hash *h, uint key1, uint key2, void *value)
 {
-	HashNode *prev;
-	HashNode *node = Hash_FindNode(h, key1, key2, &prev);
+	HashNode *node = Hash_FindNode(h, key1, key2);
 
 	if (node != NULL) {
 		/* Found it */
@@ -535,28 +465,25 @@ void *Hash_Set(Hash *h, uint key1, uint key2, void *value)
 		node->value = value;
 		return result;
 	}
-	/* It is not yet present, let's add it */
-	if (prev == NULL) {
-		/* The bucket is still empty */
-		uint hash = h->hash(key1, key2);
-		h->buckets_in_use[hash] = true;
-		node = h->buckets + hash;
-	} else {
-		/* Add it after prev */
-		node = MallocT<HashNode>(1);
-		prev->next = node;
-	}
-	node->next = NULL;
+
+	/* It is not yet present, let's add it; keep the hash at most 3/4 full */
+	if ((h->size + 1) * 4 > h->num_nodes * 3) Hash_Grow(h);
+
+	uint index = Hash_FirstNode(h, key1, key2);
+	while (h->nodes[index].generation == h->generation) index = Hash_NextNode(h, index);
+
+	node = &h->nodes[index];
 	node->key1 = key1;
 	node->key2 = key2;
 	node->value = value;
+	node->generation = h->generation;
 	h->size++;
 	return NULL;
 }
 
 void *Hash_Get(const Hash *h, uint key1, uint key2)
 {
-	HashNode *node = Hash_FindNode(h, key1, key2, NULL);
+	HashNode *node = Hash_FindNode(h, key1, key2);
 
 #ifdef HASH_DEBUG
 	debug("Found node: %p", node);
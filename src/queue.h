@@ -5,7 +5,6 @@
 #ifndef QUEUE_H
 #define QUEUE_H
 
-//#define NOFREE
 //#define QUEUE_DEBUG
 //#define HASH_DEBUG
 //#define HASH_STATS
@@ -98,12 +97,15 @@ void init_BinaryHeap(Queue *q, uint max_size);
 
 /*
  * Hash
+ * Open addressing with linear probing. The nodes are kept when the hash
+ * is cleared, so it only allocates memory when it has to grow.
  */
 struct HashNode {
 	uint key1;
 	uint key2;
 	void *value;
-	HashNode *next;
+	/* The node is in use when this equals the generation of the hash */
+	uint generation;
 };
 /**
  * Generates a hash code from the given key pair. You should make sure that
@@ -115,13 +117,14 @@ struct Hash {
 	Hash_HashProc *hash;
 	/* The amount of items in the hash */
 	uint size;
-	/* The number of buckets allocated */
+	/* The number of buckets the hash function spreads the keys over */
 	uint num_buckets;
-	/* A pointer to an array of num_buckets buckets. */
-	HashNode *buckets;
-	/* A pointer to an array of numbuckets booleans, which will be true if
-	 * there are any Nodes in the bucket */
-	bool *buckets_in_use;
+	/* The number of nodes allocated, num_buckets times a power of two */
+	uint num_nodes;
+	/* A pointer to an array of num_nodes nodes. */
+	HashNode *nodes;
+	/* The current generation; nodes of any other generation are empty */
+	uint generation;
 };
 
 /* Call these function to manipulate a hash */
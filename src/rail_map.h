@@ -12,6 +12,7 @@
 #include "tile_map.h"
 #include "signal_type.h"
 #include "waypoint_type.h"
+#include "pbs.h"
 
 
 /** Different types of Rail-related tiles */
@@ -263,6 +264,7 @@ static inline void SetTrackReservation(TileIndex t, TrackBits b)
 	Track track = RemoveFirstTrack(&b);
 	SB(_m[t].m2, 8, 3, track == INVALID_TRACK ? 0 : track+1);
 	SB(_m[t].m2, 11, 1, (byte)(b != TRACK_BIT_NONE));
+	InvalidateFollowedReservations(t);
 }
 
 /**
@@ -322,6 +324,7 @@ static inline void SetDepotWaypointReservation(TileIndex t, bool b)
 {
 	assert(IsRailWaypoint(t) || IsRailDepot(t));
 	SB(_m[t].m5, 4, 1, (byte)b);
+	InvalidateFollowedReservations(t);
 }
 
 /**
@@ -10,6 +10,7 @@
 #include "town_type.h"
 #include "road_func.h"
 #include "tile_map.h"
+#include "pbs.h"
 
 
 enum RoadTileType {
@@ -236,6 +237,7 @@ static inline void SetCrossingReservation(TileIndex t, bool b)
 {
 	assert(IsLevelCrossingTile(t));
 	SB(_m[t].m5, 4, 1, b ? 1 : 0);
+	InvalidateFollowedReservations(t);
 }
 
 /**
@@ -28,6 +28,7 @@
 #include "gfx_func.h"
 #include "ai/ai.hpp"
 #include "depot_base.h"
+#include "depot_func.h"
 #include "effectvehicle_func.h"
 #include "settings_type.h"
 
@@ -137,6 +138,9 @@ void RoadVehUpdateCache(Vehicle *v)
 	assert(v->type == VEH_ROAD);
 	assert(IsRoadVehFront(v));
 
+	/* The properties of the vehicles might be different in the new consist */
+	InvalidateVehicleCallbackCache();
+
 	for (Vehicle *u = v; u != NULL; u = u->Next()) {
 		/* Check the v->first cache. */
 		assert(u->First() == v);
@@ -1067,7 +1071,8 @@ static Trackdir RoadFindPathToDest(Vehicle *v, TileIndex tile, DiagDirection ent
 	/* Remove tracks unreachable from the enter dir */
 	trackdirs &= _road_enter_dir_to_reachable_trackdirs[enterdir];
 	if (trackdirs == TRACKDIR_BIT_NONE) {
-		/* No reachable tracks, so we'll reverse */
+		/* No reachable tracks, so we'll reverse; the path we found before is blocked */
+		v->u.road.path_length = 0;
 		return_track(_road_reverse_table[enterdir]);
 	}
 
@@ -1083,6 +1088,7 @@ static Trackdir RoadFindPathToDest(Vehicle *v, TileIndex tile, DiagDirection ent
 		}
 		if (reverse) {
 			v->u.road.reverse_ctr = 0;
+			v->u.road.path_length = 0;
 			if (v->tile != tile) {
 				return_track(_road_reverse_table[enterdir]);
 			}
@@ -1846,8 +1852,9 @@ static void CheckIfRoadVehNeedsService(Vehicle *v)
 		return;
 	}
 
-	/* XXX If we already have a depot order, WHY do we search over and over? */
-	const Depot *depot = FindClosestRoadDepot(v);
+	/* XXX If we already have a depot order, WHY do we search over and over?
+	 * At least do not search when no depot is close enough to be accepted. */
+	const Depot *depot = IsDepotNearTile(v->tile, TRANSPORT_ROAD, 12) ? FindClosestRoadDepot(v) : NULL;
 
 	if (depot == NULL || DistanceManhattan(v->tile, depot->xy) > 12) {
 		if (v->current_order.IsType(OT_GOTO_DEPOT)) {
@@ -19,6 +19,7 @@
 #include "../vehicle_func.h"
 #include "../newgrf_station.h"
 #include "../yapf/yapf.hpp"
+#include "../signal_func.h"
 #include "../elrail_func.h"
 #include "../signs_func.h"
 #include "../aircraft.h"
@@ -1042,6 +1043,8 @@ bool AfterLoadGame()
 	}
 
 	YapfNotifyTrackLayoutChange(INVALID_TILE, INVALID_TRACK);
+	YapfNotifyWaterLayoutChange(INVALID_TILE);
+	InvalidateSignalBlocks(INVALID_TILE);
 
 	if (CheckSavegameVersion(34)) FOR_ALL_COMPANIES(c) ResetCompanyLivery(c);
 
@@ -40,7 +40,7 @@
 
 #include "saveload_internal.h"
 
-extern const uint16 SAVEGAME_VERSION = 116;
+extern const uint16 SAVEGAME_VERSION = 119;
 
 SavegameType _savegame_type; ///< type of savegame we are loading
 
@@ -78,6 +78,9 @@ static struct {
 	byte *buf_ori;                       ///< pointer to the original memory location of buf, used to free it afterwards
 	uint bufsize;                        ///< the size of the temporary memory *buf
 	FILE *fh;                            ///< the file from which is read or written to
+	SaveStreamProc *write_stream;        ///< when not NULL, the (compressed) savegame is handed to this function instead of written to fh
+	LoadStreamProc *read_stream;         ///< when not NULL, the (compressed) savegame is read through this function instead of from fh
+	const char *format;                  ///< name of the format to write the savegame with
 
 	void (*excpt_uninit)();              ///< the function to execute on any encountered error
 	StringID error_str;                  ///< the translateable error message to show
@@ -98,6 +101,35 @@ static void NORETURN SlError(StringID string, const char *extra_msg = NULL)
 	throw std::exception();
 }
 
+/**
+ * Write a part of the (compressed) savegame to its destination,
+ * being either the savegame file or the stream set by BeginSaveToStream.
+ * @param ptr the data to write
+ * @param len the number of bytes to write
+ * @return the number of bytes that were written
+ */
+static size_t SlWriteOutput(const void *ptr, size_t len)
+{
+	if (_sl.write_stream != NULL) {
+		_sl.write_stream((const byte *)ptr, len);
+		return len;
+	}
+	return fwrite(ptr, 1, len, _sl.fh);
+}
+
+/**
+ * Read a part of the (compressed) savegame from its source,
+ * being either the savegame file or the stream set by LoadFromStream.
+ * @param ptr the buffer to read into
+ * @param len the maximum number of bytes to read
+ * @return the number of bytes that were read
+ */
+static size_t SlReadInput(void *ptr, size_t len)
+{
+	if (_sl.read_stream != NULL) return _sl.read_stream((byte *)ptr, len);
+	return fread(ptr, 1, len, _sl.fh);
+}
+
 typedef void (*AsyncSaveFinishProc)();
 static AsyncSaveFinishProc _async_save_finish = NULL;
 static ThreadObject *_save_thread;
@@ -1082,7 +1114,7 @@ static size_t ReadLZO()
 	uint len;
 
 	/* Read header*/
-	if (fread(tmp, sizeof(tmp), 1, _sl.fh) != 1) SlError(STR_GAME_SAVELOAD_ERROR_FILE_NOT_READABLE, "File read failed");
+	if (SlReadInput(tmp, sizeof(tmp)) != sizeof(tmp)) SlError(STR_GAME_SAVELOAD_ERROR_FILE_NOT_READABLE, "File read failed");
 
 	/* Check if size is bad */
 	((uint32*)out)[0] = size = tmp[1];
@@ -1095,7 +1127,7 @@ static size_t ReadLZO()
 	if (size >= sizeof(out)) SlError(STR_GAME_SAVELOAD_ERROR_BROKEN_SAVEGAME, "Inconsistent size");
 
 	/* Read block */
-	if (fread(out + sizeof(uint32), size, 1, _sl.fh) != 1) SlError(STR_GAME_SAVELOAD_ERROR_FILE_NOT_READABLE);
+	if (SlReadInput(out + sizeof(uint32), size) != size) SlError(STR_GAME_SAVELOAD_ERROR_FILE_NOT_READABLE);
 
 	/* Verify checksum */
 	if (tmp[0] != lzo_adler32(0, out, size + sizeof(uint32))) SlError(STR_GAME_SAVELOAD_ERROR_BROKEN_SAVEGAME, "Bad checksum");
@@ -1116,7 +1148,7 @@ static void WriteLZO(size_t size)
 	lzo1x_1_compress(_sl.buf, (lzo_uint)size, out + sizeof(uint32) * 2, &outlen, wrkmem);
 	((uint32*)out)[1] = TO_BE32(outlen);
 	((uint32*)out)[0] = TO_BE32(lzo_adler32(0, out + sizeof(uint32), outlen + sizeof(uint32)));
-	if (fwrite(out, outlen + sizeof(uint32) * 2, 1, _sl.fh) != 1) SlError(STR_GAME_SAVELOAD_ERROR_FILE_NOT_WRITEABLE);
+	if (SlWriteOutput(out, outlen + sizeof(uint32) * 2) != outlen + sizeof(uint32) * 2) SlError(STR_GAME_SAVELOAD_ERROR_FILE_NOT_WRITEABLE);
 }
 
 static bool InitLZO()
@@ -1136,12 +1168,12 @@ static void UninitLZO()
  *********************************************/
 static size_t ReadNoComp()
 {
-	return fread(_sl.buf, 1, LZO_SIZE, _sl.fh);
+	return SlReadInput(_sl.buf, LZO_SIZE);
 }
 
 static void WriteNoComp(size_t size)
 {
-	if (fwrite(_sl.buf, 1, size, _sl.fh) != size) SlError(STR_GAME_SAVELOAD_ERROR_FILE_NOT_WRITEABLE);
+	if (SlWriteOutput(_sl.buf, size) != size) SlError(STR_GAME_SAVELOAD_ERROR_FILE_NOT_WRITEABLE);
 }
 
 static bool InitNoComp()
@@ -1164,6 +1196,7 @@ static void UninitNoComp()
 
 struct ThreadedSave {
 	uint count;
+	uint written;
 	byte ff_state;
 	bool saveinprogress;
 	CursorID cursor;
@@ -1172,6 +1205,9 @@ struct ThreadedSave {
 /* A maximum size of of 128K * 500 = 64.000KB savegames */
 STATIC_OLD_POOL(Savegame, byte, 17, 500, NULL, NULL)
 static ThreadedSave _ts;
+static bool _save_stream_flushed; ///< Whether the rest of the streamed savegame has been handed over by FlushSaveToStream
+
+static void FlushSaveToStream();
 
 static bool InitMem()
 {
@@ -1180,7 +1216,7 @@ static bool InitMem()
 	_Savegame_pool.CleanPool();
 	_Savegame_pool.AddBlockToPool();
 
-	/* A block from the pool is a contigious area of memory, so it is safe to write to it sequentially */
+	/* A block from the pool is a contiguous area of memory, so it is safe to write to it sequentially */
 	_sl.bufsize = GetSavegamePoolSize();
 	_sl.buf = GetSavegame(_ts.count);
 	return true;
@@ -1228,7 +1264,7 @@ static size_t ReadZlib()
 	do {
 		/* read more bytes from the file? */
 		if (_z.avail_in == 0) {
-			_z.avail_in = (uint)fread(_z.next_in = _sl.buf + 4096, 1, 4096, _sl.fh);
+			_z.avail_in = (uint)SlReadInput(_z.next_in = _sl.buf + 4096, 4096);
 		}
 
 		/* inflate the data */
@@ -1280,7 +1316,7 @@ static void WriteZlibLoop(z_streamp z, byte *p, size_t len, int mode)
 
 		/* bytes were emitted? */
 		if ((n = sizeof(buf) - z->avail_out) != 0) {
-			if (fwrite(buf, n, 1, _sl.fh) != 1) SlError(STR_GAME_SAVELOAD_ERROR_FILE_NOT_WRITEABLE);
+			if (SlWriteOutput(buf, n) != n) SlError(STR_GAME_SAVELOAD_ERROR_FILE_NOT_WRITEABLE);
 		}
 		if (r == Z_STREAM_END)
 			break;
@@ -1296,7 +1332,7 @@ static void WriteZlib(size_t len)
 static void UninitWriteZlib()
 {
 	/* flush any pending output. */
-	if (_sl.fh) WriteZlibLoop(&_z, NULL, 0, Z_FINISH);
+	if (_sl.fh != NULL || _sl.write_stream != NULL) WriteZlibLoop(&_z, NULL, 0, Z_FINISH);
 	deflateEnd(&_z);
 	free(_sl.buf_ori);
 }
@@ -1526,6 +1562,8 @@ static inline SaveOrLoadResult AbortSaveLoad()
 	if (_sl.fh != NULL) fclose(_sl.fh);
 
 	_sl.fh = NULL;
+	_sl.write_stream = NULL;
+	_sl.read_stream = NULL;
 	return SL_ERROR;
 }
 
@@ -1578,45 +1616,77 @@ static void SaveFileError()
 	SaveFileDone();
 }
 
-/** We have written the whole game into memory, _Savegame_pool, now find
- * and appropiate compressor and start writing to file.
+/**
+ * Write the header of the savegame and start the writer of its format.
+ * @return the format the savegame is written with
  */
-static SaveOrLoadResult SaveFileToDisk(bool threaded)
+static const SaveLoadFormat *SlStartWriteFormat()
 {
-	const SaveLoadFormat *fmt;
+	const SaveLoadFormat *fmt = GetSavegameFormat(_sl.format);
 	uint32 hdr[2];
 
-	_sl.excpt_uninit = NULL;
-	try {
-		fmt = GetSavegameFormat(_savegame_format);
+	/* We have written our stuff to memory, now write it to file! */
+	hdr[0] = fmt->tag;
+	hdr[1] = TO_BE32(SAVEGAME_VERSION << 16);
+	if (SlWriteOutput(hdr, sizeof(hdr)) != sizeof(hdr)) SlError(STR_GAME_SAVELOAD_ERROR_FILE_NOT_WRITEABLE);
 
-		/* We have written our stuff to memory, now write it to file! */
-		hdr[0] = fmt->tag;
-		hdr[1] = TO_BE32(SAVEGAME_VERSION << 16);
-		if (fwrite(hdr, sizeof(hdr), 1, _sl.fh) != 1) SlError(STR_GAME_SAVELOAD_ERROR_FILE_NOT_WRITEABLE);
+	if (!fmt->init_write()) SlError(STR_GAME_SAVELOAD_ERROR_BROKEN_INTERNAL_ERROR, "cannot initialize compressor");
 
-		if (!fmt->init_write()) SlError(STR_GAME_SAVELOAD_ERROR_BROKEN_INTERNAL_ERROR, "cannot initialize compressor");
+	if (_ts.count != _sl.offs_base) SlError(STR_GAME_SAVELOAD_ERROR_BROKEN_SAVEGAME, "Unexpected size of chunk");
+	_ts.written = 0;
 
-		{
-			uint i;
-			uint count = 1 << Savegame_POOL_BLOCK_SIZE_BITS;
+	return fmt;
+}
 
-			if (_ts.count != _sl.offs_base) SlError(STR_GAME_SAVELOAD_ERROR_BROKEN_SAVEGAME, "Unexpected size of chunk");
-			for (i = 0; i != _Savegame_pool.GetBlockCount() - 1; i++) {
-				_sl.buf = _Savegame_pool.blocks[i];
-				fmt->writer(count);
-			}
+/**
+ * Hand the next part of the savegame in memory to the writer of its format.
+ * @param fmt the format the savegame is written with
+ * @param len the maximum number of bytes to write
+ * @return true when the whole savegame has been written
+ */
+static bool SlWriteMemoryPart(const SaveLoadFormat *fmt, uint len)
+{
+	uint count = 1 << Savegame_POOL_BLOCK_SIZE_BITS;
 
-			/* The last block is (almost) always not fully filled, so only write away
-			 * as much data as it is in there */
-			_sl.buf = _Savegame_pool.blocks[i];
-			fmt->writer(_ts.count - (i * count));
-		}
+	/* A block from the pool is a contiguous area of memory, but the
+	 * blocks aren't, so never write beyond the end of a block at once */
+	while (len != 0 && _ts.written != _ts.count) {
+		uint offset = _ts.written % count;
+		uint n = min(min(len, count - offset), _ts.count - _ts.written);
 
-		fmt->uninit_write();
-		if (_ts.count != _sl.offs_base) SlError(STR_GAME_SAVELOAD_ERROR_BROKEN_SAVEGAME, "Unexpected size of chunk");
-		GetSavegameFormat("memory")->uninit_write(); // clean the memorypool
-		fclose(_sl.fh);
+		_sl.buf = _Savegame_pool.blocks[_ts.written / count] + offset;
+		fmt->writer(n);
+
+		_ts.written += n;
+		len -= n;
+	}
+
+	return _ts.written == _ts.count;
+}
+
+/**
+ * Stop the writer of the format of the savegame and free the savegame in memory.
+ * @param fmt the format the savegame is written with
+ */
+static void SlFinishWriteFormat(const SaveLoadFormat *fmt)
+{
+	fmt->uninit_write();
+	GetSavegameFormat("memory")->uninit_write(); // clean the memorypool
+	if (_sl.fh != NULL) fclose(_sl.fh);
+	_sl.fh = NULL;
+	_sl.write_stream = NULL;
+}
+
+/** We have written the whole game into memory, _Savegame_pool, now find
+ * and appropiate compressor and start writing to file.
+ */
+static SaveOrLoadResult SaveFileToDisk(bool threaded)
+{
+	_sl.excpt_uninit = NULL;
+	try {
+		const SaveLoadFormat *fmt = SlStartWriteFormat();
+		SlWriteMemoryPart(fmt, UINT_MAX);
+		SlFinishWriteFormat(fmt);
 
 		if (threaded) SetAsyncSaveFinish(SaveFileDone);
 
@@ -1652,6 +1722,154 @@ void WaitTillSaved()
 	_save_thread = NULL;
 }
 
+/**
+ * Save the game to memory, _Savegame_pool.
+ * @return false when the writer to memory could not be initialised
+ */
+static bool SlSaveToMemory()
+{
+	const SaveLoadFormat *fmt = GetSavegameFormat("memory"); // write to memory
+
+	_sl.write_bytes = fmt->writer;
+	_sl.excpt_uninit = fmt->uninit_write;
+	if (!fmt->init_write()) {
+		DEBUG(sl, 0, "Initializing writer '%s' failed.", fmt->name);
+		return false;
+	}
+
+	_sl_version = SAVEGAME_VERSION;
+
+	SaveViewportBeforeSaveGame();
+	SlSaveChunks();
+	SlWriteFill(); // flush the save buffer
+
+	return true;
+}
+
+/**
+ * Save the game to memory and hand it over to the writer of the configured
+ * format; either in a separate thread or, when that is not possible or not
+ * wanted, right away.
+ * @param threaded whether the game may be written in a separate thread
+ * @return Return the result of the action. SL_OK or SL_ERROR
+ */
+static SaveOrLoadResult DoSave(bool threaded)
+{
+	if (!SlSaveToMemory()) return AbortSaveLoad();
+
+	SaveFileStart();
+	if (!threaded || !ThreadObject::New(&SaveFileToDiskThread, NULL, &_save_thread)) {
+		if (threaded) DEBUG(sl, 1, "Cannot create savegame thread, reverting to single-threaded mode...");
+
+		SaveOrLoadResult result = SaveFileToDisk(false);
+		SaveFileDone();
+
+		return result;
+	}
+
+	return SL_OK;
+}
+
+/**
+ * Find the format a savegame has been written with.
+ * @param hdr the header of the savegame
+ * @return the format, or NULL when the header is not known
+ */
+static const SaveLoadFormat *DetermineSavegameFormat(const uint32 *hdr)
+{
+	for (const SaveLoadFormat *fmt = _saveload_formats; fmt != endof(_saveload_formats); fmt++) {
+		if (fmt->tag != hdr[0]) continue;
+
+		/* check version number */
+		_sl_version = TO_BE32(hdr[1]) >> 16;
+		/* Minor is not used anymore from version 18.0, but it is still needed
+		 * in versions before that (4 cases) which can't be removed easy.
+		 * Therefor it is loaded, but never saved (or, it saves a 0 in any scenario).
+		 * So never EVER use this minor version again. -- TrueLight -- 22-11-2005 */
+		_sl_minor_version = (TO_BE32(hdr[1]) >> 8) & 0xFF;
+
+		DEBUG(sl, 1, "Loading savegame version %d", _sl_version);
+
+		/* Is the version higher than the current? */
+		if (_sl_version > SAVEGAME_VERSION) SlError(STR_GAME_SAVELOAD_ERROR_TOO_NEW_SAVEGAME);
+		return fmt;
+	}
+
+	return NULL;
+}
+
+/**
+ * Load the chunks of the savegame with the given format, the header
+ * has already been read.
+ * @param fmt the format the savegame is written with
+ * @return Return the result of the action. SL_OK or SL_REINIT
+ */
+static SaveOrLoadResult DoLoad(const SaveLoadFormat *fmt)
+{
+	_sl.read_bytes = fmt->reader;
+	_sl.excpt_uninit = fmt->uninit_read;
+
+	/* loader for this savegame type is not implemented? */
+	if (fmt->init_read == NULL) {
+		char err_str[64];
+		snprintf(err_str, lengthof(err_str), "Loader for '%s' is not available.", fmt->name);
+		SlError(STR_GAME_SAVELOAD_ERROR_BROKEN_INTERNAL_ERROR, err_str);
+	}
+
+	if (!fmt->init_read()) {
+		char err_str[64];
+		snprintf(err_str, lengthof(err_str), "Initializing loader '%s' failed", fmt->name);
+		SlError(STR_GAME_SAVELOAD_ERROR_BROKEN_INTERNAL_ERROR, err_str);
+	}
+
+	_engine_mngr.ResetToDefaultMapping();
+
+	/* Old maps were hardcoded to 256x256 and thus did not contain
+	 * any mapsize information. Pre-initialize to 256x256 to not to
+	 * confuse old games */
+	InitializeGame(256, 256, true);
+
+	GamelogReset();
+
+	SlLoadChunks();
+	fmt->uninit_read();
+	if (_sl.fh != NULL) fclose(_sl.fh);
+	_sl.fh = NULL;
+	_sl.read_stream = NULL;
+
+	GamelogStartAction(GLAT_LOAD);
+
+	_savegame_type = SGT_OTTD;
+
+	/* After loading fix up savegame for any internal changes that
+	 * might've occured since then. If it fails, load back the old game */
+	if (!AfterLoadGame()) {
+		GamelogStopAction();
+		return SL_REINIT;
+	}
+
+	GamelogStopAction();
+
+	return SL_OK;
+}
+
+/**
+ * Prepare the saveload struct for a new save or load.
+ * @param save whether we are going to save
+ */
+static void SlResetState(bool save)
+{
+	_next_offs = 0;
+	_sl.fh = NULL;
+	_sl.write_stream = NULL;
+	_sl.read_stream = NULL;
+	_sl.excpt_uninit = NULL;
+	_sl.bufe = _sl.bufp = NULL;
+	_sl.offs_base = 0;
+	_sl.save = save;
+	_sl.chs = _chunk_handlers;
+}
+
 /**
  * Main Save or Load function where the high-level saveload functions are
  * handled. It opens the savegame, selects format and checks versions
@@ -1671,6 +1889,12 @@ SaveOrLoadResult SaveOrLoad(const char *filename, int mode, Subdirectory sb)
 		return SL_OK;
 	}
 	WaitTillSaved();
+	/* Saving uses the same memory as the savegame being handed over */
+	if (mode == SL_SAVE) {
+		FlushSaveToStream();
+	} else {
+		AbortSaveToStream();
+	}
 
 	_next_offs = 0;
 
@@ -1691,7 +1915,7 @@ SaveOrLoadResult SaveOrLoad(const char *filename, int mode, Subdirectory sb)
 		return SL_OK;
 	}
 
-	_sl.excpt_uninit = NULL;
+	SlResetState(mode != 0);
 	try {
 		_sl.fh = (mode == SL_SAVE) ? FioFOpenFile(filename, "wb", sb) : FioFOpenFile(filename, "rb", sb);
 
@@ -1703,122 +1927,181 @@ SaveOrLoadResult SaveOrLoad(const char *filename, int mode, Subdirectory sb)
 			SlError(mode == SL_SAVE ? STR_GAME_SAVELOAD_ERROR_FILE_NOT_WRITEABLE : STR_GAME_SAVELOAD_ERROR_FILE_NOT_READABLE);
 		}
 
-		_sl.bufe = _sl.bufp = NULL;
-		_sl.offs_base = 0;
-		_sl.save = (mode != 0);
-		_sl.chs = _chunk_handlers;
-
 		/* General tactic is to first save the game to memory, then use an available writer
 		 * to write it to file, either in threaded mode if possible, or single-threaded */
 		if (mode == SL_SAVE) { // SAVE game
 			DEBUG(desync, 1, "save: %s\n", filename);
-			fmt = GetSavegameFormat("memory"); // write to memory
+			_sl.format = _savegame_format;
 
-			_sl.write_bytes = fmt->writer;
-			_sl.excpt_uninit = fmt->uninit_write;
-			if (!fmt->init_write()) {
-				DEBUG(sl, 0, "Initializing writer '%s' failed.", fmt->name);
-				return AbortSaveLoad();
-			}
+			return DoSave(!_network_server);
+		}
 
-			_sl_version = SAVEGAME_VERSION;
+		assert(mode == SL_LOAD);
+		DEBUG(desync, 1, "load: %s\n", filename);
 
-			SaveViewportBeforeSaveGame();
-			SlSaveChunks();
-			SlWriteFill(); // flush the save buffer
+		/* Can't fseek to 0 as in tar files that is not correct */
+		long pos = ftell(_sl.fh);
+		if (fread(hdr, sizeof(hdr), 1, _sl.fh) != 1) SlError(STR_GAME_SAVELOAD_ERROR_FILE_NOT_READABLE);
 
-			SaveFileStart();
-			if (_network_server ||
-						!ThreadObject::New(&SaveFileToDiskThread, NULL, &_save_thread)) {
-				if (!_network_server) DEBUG(sl, 1, "Cannot create savegame thread, reverting to single-threaded mode...");
+		/* see if we have any loader for this type. */
+		fmt = DetermineSavegameFormat(hdr);
+		if (fmt == NULL) {
+			/* No loader found, treat as version 0 and use LZO format */
+			DEBUG(sl, 0, "Unknown savegame type, trying to load it as the buggy format");
+			clearerr(_sl.fh);
+			fseek(_sl.fh, pos, SEEK_SET);
+			_sl_version = 0;
+			_sl_minor_version = 0;
+			fmt = _saveload_formats + 1; // LZO
+		}
 
-				SaveOrLoadResult result = SaveFileToDisk(false);
-				SaveFileDone();
+		return DoLoad(fmt);
+	}
+	catch (...) {
+		AbortSaveLoad();
 
-				return result;
-			}
-		} else { // LOAD game
-			assert(mode == SL_LOAD);
-			DEBUG(desync, 1, "load: %s\n", filename);
-
-			/* Can't fseek to 0 as in tar files that is not correct */
-			long pos = ftell(_sl.fh);
-			if (fread(hdr, sizeof(hdr), 1, _sl.fh) != 1) SlError(STR_GAME_SAVELOAD_ERROR_FILE_NOT_READABLE);
-
-			/* see if we have any loader for this type. */
-			for (fmt = _saveload_formats; ; fmt++) {
-				/* No loader found, treat as version 0 and use LZO format */
-				if (fmt == endof(_saveload_formats)) {
-					DEBUG(sl, 0, "Unknown savegame type, trying to load it as the buggy format");
-					clearerr(_sl.fh);
-					fseek(_sl.fh, pos, SEEK_SET);
-					_sl_version = 0;
-					_sl_minor_version = 0;
-					fmt = _saveload_formats + 1; // LZO
-					break;
-				}
+		/* deinitialize compressor. */
+		if (_sl.excpt_uninit != NULL) _sl.excpt_uninit();
 
-				if (fmt->tag == hdr[0]) {
-					/* check version number */
-					_sl_version = TO_BE32(hdr[1]) >> 16;
-					/* Minor is not used anymore from version 18.0, but it is still needed
-					 * in versions before that (4 cases) which can't be removed easy.
-					 * Therefor it is loaded, but never saved (or, it saves a 0 in any scenario).
-					 * So never EVER use this minor version again. -- TrueLight -- 22-11-2005 */
-					_sl_minor_version = (TO_BE32(hdr[1]) >> 8) & 0xFF;
+		/* Skip the "colour" character */
+		DEBUG(sl, 0, GetSaveLoadErrorString() + 3);
 
-					DEBUG(sl, 1, "Loading savegame version %d", _sl_version);
+		/* A saver/loader exception!! reinitialize all variables to prevent crash! */
+		return (mode == SL_LOAD) ? SL_REINIT : SL_ERROR;
+	}
+}
 
-					/* Is the version higher than the current? */
-					if (_sl_version > SAVEGAME_VERSION) SlError(STR_GAME_SAVELOAD_ERROR_TOO_NEW_SAVEGAME);
-					break;
-				}
-			}
+/**
+ * Save the game to memory and start handing it over to the given function
+ * instead of writing it to a file, for example to send it over the network.
+ * The savegame is handed over in parts by ContinueSaveToStream, so the
+ * caller can get rid of each part before the next one is written.
+ * When another game is saved before the whole savegame has been handed
+ * over, the rest of it is handed over at once first.
+ * @param proc   the function that gets handed the savegame bytes
+ * @param format the name of the format to write the savegame with
+ * @param size   [out] the number of bytes of the savegame in memory
+ * @return Return the results of the action. SL_OK or SL_ERROR
+ */
+SaveOrLoadResult BeginSaveToStream(SaveStreamProc *proc, const char *format, uint *size)
+{
+	/* Saving to the stream resets the memory pool; wait for any threaded save to finish */
+	WaitTillSaved();
+	AbortSaveToStream();
 
-			_sl.read_bytes = fmt->reader;
-			_sl.excpt_uninit = fmt->uninit_read;
+	SlResetState(true);
+	try {
+		DEBUG(desync, 1, "save: stream\n");
+		_sl.write_stream = proc;
+		_sl.format = format;
 
-			/* loader for this savegame type is not implemented? */
-			if (fmt->init_read == NULL) {
-				char err_str[64];
-				snprintf(err_str, lengthof(err_str), "Loader for '%s' is not available.", fmt->name);
-				SlError(STR_GAME_SAVELOAD_ERROR_BROKEN_INTERNAL_ERROR, err_str);
-			}
+		if (!SlSaveToMemory()) return AbortSaveLoad();
 
-			if (!fmt->init_read()) {
-				char err_str[64];
-				snprintf(err_str, lengthof(err_str), "Initializing loader '%s' failed", fmt->name);
-				SlError(STR_GAME_SAVELOAD_ERROR_BROKEN_INTERNAL_ERROR, err_str);
-			}
+		_sl.excpt_uninit = NULL;
+		SlStartWriteFormat();
 
-			_engine_mngr.ResetToDefaultMapping();
+		*size = _ts.count;
+		return SL_OK;
+	}
+	catch (...) {
+		AbortSaveLoad();
 
-			/* Old maps were hardcoded to 256x256 and thus did not contain
-			 * any mapsize information. Pre-initialize to 256x256 to not to
-			 * confuse old games */
-			InitializeGame(256, 256, true);
+		/* deinitialize compressor. */
+		if (_sl.excpt_uninit != NULL) _sl.excpt_uninit();
+		GetSavegameFormat("memory")->uninit_write(); // clean the memorypool
 
-			GamelogReset();
+		/* Skip the "colour" character */
+		DEBUG(sl, 0, GetSaveLoadErrorString() + 3);
 
-			SlLoadChunks();
-			fmt->uninit_read();
-			fclose(_sl.fh);
+		return SL_ERROR;
+	}
+}
 
-			GamelogStartAction(GLAT_LOAD);
+/**
+ * Hand the next part of the savegame to the function given to BeginSaveToStream.
+ * @param len      the maximum number of bytes of the savegame in memory to write
+ * @param finished [out] whether the whole savegame has been handed over
+ * @return Return the results of the action. SL_OK or SL_ERROR
+ */
+SaveOrLoadResult ContinueSaveToStream(uint len, bool *finished)
+{
+	*finished = false;
+	if (_sl.write_stream == NULL) {
+		/* Saving another game made the rest be handed over already */
+		if (!_save_stream_flushed) return SL_ERROR;
+		_save_stream_flushed = false;
+		*finished = true;
+		return SL_OK;
+	}
 
-			_savegame_type = SGT_OTTD;
+	try {
+		const SaveLoadFormat *fmt = GetSavegameFormat(_sl.format);
+		if (!SlWriteMemoryPart(fmt, len)) return SL_OK;
 
-			/* After loading fix up savegame for any internal changes that
-			 * might've occured since then. If it fails, load back the old game */
-			if (!AfterLoadGame()) {
-				GamelogStopAction();
-				return SL_REINIT;
-			}
+		SlFinishWriteFormat(fmt);
+		*finished = true;
+		return SL_OK;
+	}
+	catch (...) {
+		/* Skip the "colour" character */
+		DEBUG(sl, 0, GetSaveLoadErrorString() + 3);
 
-			GamelogStopAction();
-		}
+		AbortSaveToStream();
+		return SL_ERROR;
+	}
+}
 
-		return SL_OK;
+/** Stop handing the savegame over to the function given to BeginSaveToStream and free it. */
+void AbortSaveToStream()
+{
+	_save_stream_flushed = false;
+	if (_sl.write_stream == NULL) return;
+
+	/* Don't hand the end of the savegame over when stopping the writer */
+	_sl.write_stream = NULL;
+	GetSavegameFormat(_sl.format)->uninit_write();
+	GetSavegameFormat("memory")->uninit_write(); // clean the memorypool
+}
+
+/**
+ * Hand the rest of the savegame over to the function given to
+ * BeginSaveToStream at once, so its memory can be used to save another game.
+ * The next ContinueSaveToStream then tells the whole savegame has been handed over.
+ */
+static void FlushSaveToStream()
+{
+	if (_sl.write_stream == NULL) return;
+
+	DEBUG(sl, 1, "Handing over the rest of the streamed savegame to save another game");
+	bool finished;
+	if (ContinueSaveToStream(UINT_MAX, &finished) == SL_OK) _save_stream_flushed = true;
+}
+
+/**
+ * Load a game from a savegame that is read by the given function instead
+ * of from a file, for example a savegame received over the network.
+ * @param proc the function that provides the savegame bytes
+ * @return Return the results of the action. SL_OK or SL_REINIT ("unload" the game)
+ */
+SaveOrLoadResult LoadFromStream(LoadStreamProc *proc)
+{
+	uint32 hdr[2];
+
+	WaitTillSaved();
+	AbortSaveToStream();
+
+	SlResetState(false);
+	try {
+		DEBUG(desync, 1, "load: stream\n");
+		_sl.read_stream = proc;
+
+		if (SlReadInput(hdr, sizeof(hdr)) != sizeof(hdr)) SlError(STR_GAME_SAVELOAD_ERROR_FILE_NOT_READABLE);
+
+		/* A stream can't be rewound, so the buggy format can't be tried */
+		const SaveLoadFormat *fmt = DetermineSavegameFormat(hdr);
+		if (fmt == NULL) SlError(STR_GAME_SAVELOAD_ERROR_BROKEN_INTERNAL_ERROR, "Unknown savegame type");
+
+		return DoLoad(fmt);
 	}
 	catch (...) {
 		AbortSaveLoad();
@@ -1829,8 +2112,7 @@ SaveOrLoadResult SaveOrLoad(const char *filename, int mode, Subdirectory sb)
 		/* Skip the "colour" character */
 		DEBUG(sl, 0, GetSaveLoadErrorString() + 3);
 
-		/* A saver/loader exception!! reinitialize all variables to prevent crash! */
-		return (mode == SL_LOAD) ? SL_REINIT : SL_ERROR;
+		return SL_REINIT;
 	}
 }
 
@@ -37,10 +37,29 @@ enum SavegameType {
 	SGT_INVALID = 0xFF ///< broken savegame (used internally)
 };
 
+/**
+ * Function that gets handed the (compressed) savegame when saving to a stream.
+ * @param buf the savegame bytes
+ * @param len the number of bytes in buf
+ */
+typedef void SaveStreamProc(const byte *buf, size_t len);
+
+/**
+ * Function that provides the (compressed) savegame when loading from a stream.
+ * @param buf the buffer to read the savegame bytes into
+ * @param len the maximum number of bytes to read
+ * @return the number of bytes read; less than len only at the end of the stream
+ */
+typedef size_t LoadStreamProc(byte *buf, size_t len);
+
 void GenerateDefaultSaveName(char *buf, const char *last);
 void SetSaveLoadError(uint16 str);
 const char *GetSaveLoadErrorString();
 SaveOrLoadResult SaveOrLoad(const char *filename, int mode, Subdirectory sb);
+SaveOrLoadResult BeginSaveToStream(SaveStreamProc *proc, const char *format, uint *size);
+SaveOrLoadResult ContinueSaveToStream(uint len, bool *finished);
+void AbortSaveToStream();
+SaveOrLoadResult LoadFromStream(LoadStreamProc *proc);
 void WaitTillSaved();
 void DoExitSave();
 
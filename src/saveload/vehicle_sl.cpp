@@ -539,6 +539,11 @@ const SaveLoad *GetVehicleDescription(VehicleType vt)
 		SLE_CONDREFX(cpp_offsetof(Vehicle, u) + cpp_offsetof(VehicleRoad, slot),                 REF_ROADSTOPS,                6, SL_MAX_VERSION),
 		SLE_CONDNULL(1,                                                            6, SL_MAX_VERSION),
 		SLE_CONDVARX(cpp_offsetof(Vehicle, u) + cpp_offsetof(VehicleRoad, slot_age),             SLE_UINT8,                    6, SL_MAX_VERSION),
+		SLE_CONDVARX(cpp_offsetof(Vehicle, u) + cpp_offsetof(VehicleRoad, path_dest),            SLE_UINT32,                 117, SL_MAX_VERSION),
+		SLE_CONDARRX(cpp_offsetof(Vehicle, u) + cpp_offsetof(VehicleRoad, path_tile),            SLE_UINT32, RV_PATH_CACHE_LENGTH, 117, SL_MAX_VERSION),
+		SLE_CONDARRX(cpp_offsetof(Vehicle, u) + cpp_offsetof(VehicleRoad, path_trackdir),        SLE_UINT8,  RV_PATH_CACHE_LENGTH, 117, SL_MAX_VERSION),
+		SLE_CONDVARX(cpp_offsetof(Vehicle, u) + cpp_offsetof(VehicleRoad, path_length),          SLE_UINT8,                  117, SL_MAX_VERSION),
+		SLE_CONDVARX(cpp_offsetof(Vehicle, u) + cpp_offsetof(VehicleRoad, path_pos),             SLE_UINT8,                  117, SL_MAX_VERSION),
 		/* reserve extra space in savegame here. (currently 16 bytes) */
 		SLE_CONDNULL(16,                                                           2, SL_MAX_VERSION),
 
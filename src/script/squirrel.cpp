@@ -180,6 +180,11 @@ bool Squirrel::Resume(int suspend)
 	return this->vm->_suspended != 0;
 }
 
+int Squirrel::GetOpsTillSuspend()
+{
+	return (int)this->vm->_ops_till_suspend;
+}
+
 void Squirrel::CollectGarbage()
 {
 	sq_collectgarbage(this->vm);
@@ -100,6 +100,12 @@ public:
 	 */
 	bool Resume(int suspend = -1);
 
+	/**
+	 * Get the number of opcodes the VM may still run before it suspends;
+	 *  this is negative when it ran more than it was allowed to.
+	 */
+	int GetOpsTillSuspend();
+
 	/**
 	 * Tell the VM to do a garbage collection run.
 	 */
@@ -244,6 +244,8 @@ struct YAPFSettings {
 	uint32 rail_pbs_station_penalty;         ///< penalty for crossing a reserved station tile
 	uint32 rail_pbs_signal_back_penalty;     ///< penalty for passing a pbs signal from the backside
 	uint32 rail_doubleslip_penalty;          ///< penalty for passing a double slip switch
+	bool   rail_parallel_pathfinding;        ///< choose the tracks of trains that don't reserve paths ahead of moving them, on several threads
+	bool   rail_use_landmarks;               ///< use the distances from landmarks on the rail network for the estimate of the remaining path; this may change the chosen paths
 
 	uint32 rail_longer_platform_penalty;           ///< penalty for longer  station platform than train
 	uint32 rail_longer_platform_per_tile_penalty;  ///< penalty for longer  station platform than train (per tile)
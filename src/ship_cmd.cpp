@@ -12,6 +12,7 @@
 #include "company_func.h"
 #include "npf.h"
 #include "depot_base.h"
+#include "depot_func.h"
 #include "vehicle_gui.h"
 #include "newgrf_engine.h"
 #include "yapf/yapf.h"
@@ -133,7 +134,8 @@ static void CheckIfShipNeedsService(Vehicle *v)
 		return;
 	}
 
-	const Depot *depot = FindClosestShipDepot(v);
+	/* Do not search when no depot is close enough to be accepted. */
+	const Depot *depot = IsDepotNearTile(v->tile, TRANSPORT_WATER, 12) ? FindClosestShipDepot(v) : NULL;
 
 	if (depot == NULL || DistanceManhattan(v->tile, depot->xy) > 12) {
 		if (v->current_order.IsType(OT_GOTO_DEPOT)) {
@@ -942,6 +944,7 @@ CommandCost CmdRefitShip(TileIndex tile, DoCommandFlag flags, uint32 p1, uint32
 		v->cargo_type = new_cid;
 		v->cargo_subtype = new_subtype;
 		v->colourmap = PAL_NONE; // invalidate vehicle colour map
+		InvalidateVehicleCallbackCache();
 		InvalidateWindow(WC_VEHICLE_DETAILS, v->index);
 		InvalidateWindow(WC_VEHICLE_DEPOT, v->tile);
 		InvalidateWindowClassesData(WC_SHIPS_LIST, 0);
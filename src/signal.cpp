@@ -9,12 +9,15 @@
 #include "vehicle_func.h"
 #include "vehicle_base.h"
 #include "functions.h"
+#include "signal_func.h"
+#include "core/smallvec_type.hpp"
+#include "core/sort_func.hpp"
+
+#include <map>
 
 
 /** these are the maximums used for updating signal blocks */
 enum {
-	SIG_TBU_SIZE    =  64, ///< number of signals entering to block
-	SIG_TBD_SIZE    = 256, ///< number of intersections - open nodes in current block
 	SIG_GLOB_SIZE   = 128, ///< number of open blocks (block can be opened more times until detected)
 	SIG_GLOB_UPDATE =  64, ///< how many items need to be in _globset to force update
 };
@@ -122,6 +125,29 @@ public:
 		return false;
 	}
 
+	/**
+	 * Removes the element at the given position, the last element takes its place
+	 * @param index position of the element, less than Items()
+	 */
+	void RemoveAt(uint index)
+	{
+		assert(index < this->n);
+		this->data[index] = this->data[--this->n];
+	}
+
+	/**
+	 * Reads the element at the given position
+	 * @param index position of the element, less than Items()
+	 * @param tile pointer where tile is written to
+	 * @param dir pointer where dir is written to
+	 */
+	void GetAt(uint index, TileIndex *tile, Tdir *dir)
+	{
+		assert(index < this->n);
+		*tile = this->data[index].tile;
+		*dir = this->data[index].dir;
+	}
+
 	/**
 	 * Tries to find given tile and dir in the set
 	 * @param tile tile
@@ -177,11 +203,215 @@ public:
 	}
 };
 
-static SmallSet<Trackdir, SIG_TBU_SIZE> _tbuset("_tbuset");         ///< set of signals that will be updated
-static SmallSet<DiagDirection, SIG_TBD_SIZE> _tbdset("_tbdset");    ///< set of open nodes in current signal block
 static SmallSet<DiagDirection, SIG_GLOB_SIZE> _globset("_globset"); ///< set of places to be updated in following runs
 
 
+/**
+ * Tile side of a signal block, together with the owner whose signals are
+ * updated; the whole signal block is known from any of its tile sides.
+ */
+typedef uint64 SignalBlockKey;
+
+/**
+ * Make the key of a tile side of a signal block
+ * @param tile tile
+ * @param dir side of the tile, INVALID_DIAGDIR for the inside of a depot or the wormhole
+ * @param owner owner whose signals are updated
+ * @return the key
+ */
+static inline SignalBlockKey MakeSignalBlockKey(TileIndex tile, DiagDirection dir, Owner owner)
+{
+	return (SignalBlockKey)tile << 16 | owner << 8 | dir;
+}
+
+/**
+ * Signal block as found by ExploreSegment().
+ * The layout of the block is kept until track is built or removed at any of
+ * its tiles, so a train entering or leaving the block only has to look at the
+ * tiles and signals stored here instead of searching the whole block again.
+ */
+struct SignalBlock {
+	/** Tile trains are looked for on */
+	struct TrainTile {
+		TileIndex tile;   ///< the tile
+		TrackBits tracks; ///< tracks of the tile the train has to be on, TRACK_BIT_NONE for any track outside of a depot
+	};
+
+	/** Signal at the border of the block */
+	struct Signal {
+		TileIndex tile;     ///< tile of the signal
+		Trackdir trackdir;  ///< trackdir of the signal
+	};
+
+	Owner owner;                         ///< owner whose signals bound the block
+	bool pbs;                            ///< is there any pbs or two-way signal at the border of the block?
+	SmallVector<TrainTile, 16> tiles;    ///< tiles trains are looked for on
+	SmallVector<Signal, 4> signals;      ///< conventional signals leading into the block, they are updated with the block
+	SmallVector<Signal, 4> exits;        ///< presignal exits leading out of the block
+	SmallVector<SignalBlockKey, 16> keys; ///< tile sides the block is reached from
+};
+
+typedef std::map<SignalBlockKey, SignalBlock *> SignalBlockMap;
+static SignalBlockMap _signal_blocks; ///< all known signal blocks, by their tile sides
+static SmallVector<SignalBlock *, 16> _free_signal_blocks; ///< forgotten signal blocks, kept to search blocks without allocating memory
+
+/** Open node of the search of a signal block: a tile and the side it is entered from */
+struct SignalSearchNode {
+	TileIndex tile;
+	DiagDirection dir;
+};
+
+static SmallVector<SignalSearchNode, 64> _tbdset; ///< set of open nodes in current signal block
+
+
+/**
+ * Get an empty signal block
+ * @param owner owner whose signals bound the block
+ * @return the signal block
+ */
+static SignalBlock *NewSignalBlock(Owner owner)
+{
+	SignalBlock *block;
+	if (_free_signal_blocks.Length() != 0) {
+		/* reuse a forgotten block, its lists keep their memory */
+		block = *(_free_signal_blocks.End() - 1);
+		_free_signal_blocks.Erase(_free_signal_blocks.End() - 1);
+		block->tiles.Clear();
+		block->signals.Clear();
+		block->exits.Clear();
+		block->keys.Clear();
+	} else {
+		block = new SignalBlock();
+	}
+
+	block->owner = owner;
+	block->pbs = false;
+	return block;
+}
+
+/**
+ * Find the known signal block a tile side belongs to
+ * @param tile tile
+ * @param dir side of the tile
+ * @param owner owner whose signals are updated
+ * @return the signal block, or NULL if it has to be searched
+ */
+static SignalBlock *FindSignalBlock(TileIndex tile, DiagDirection dir, Owner owner)
+{
+	SignalBlockMap::iterator it = _signal_blocks.find(MakeSignalBlockKey(tile, dir, owner));
+	return it == _signal_blocks.end() ? NULL : it->second;
+}
+
+/**
+ * Forget a signal block
+ * @param block block to delete
+ */
+static void DeleteSignalBlock(SignalBlock *block)
+{
+	for (const SignalBlockKey *key = block->keys.Begin(); key != block->keys.End(); key++) {
+		SignalBlockMap::iterator it = _signal_blocks.find(*key);
+		if (it != _signal_blocks.end() && it->second == block) _signal_blocks.erase(it);
+	}
+	*_free_signal_blocks.Append() = block;
+}
+
+/**
+ * Forget all signal blocks with a side on the given tile
+ * @param tile tile
+ */
+static void DeleteSignalBlocksOnTile(TileIndex tile)
+{
+	SignalBlockMap::iterator it = _signal_blocks.lower_bound((SignalBlockKey)tile << 16);
+	while (it != _signal_blocks.end() && it->first >> 16 == tile) {
+		DeleteSignalBlock(it->second);
+		it = _signal_blocks.lower_bound((SignalBlockKey)tile << 16);
+	}
+}
+
+/**
+ * Forget the signal blocks whose layout changes by building or removing
+ * track, signals, stations and the like at the given tile.
+ * Only blocks reaching the tile have a side on it, so the blocks on the
+ * tile itself are all that have to be searched again.
+ * @param tile tile that changed, INVALID_TILE to forget all signal blocks
+ */
+void InvalidateSignalBlocks(TileIndex tile)
+{
+	if (tile == INVALID_TILE) {
+		while (!_signal_blocks.empty()) DeleteSignalBlock(_signal_blocks.begin()->second);
+		return;
+	}
+
+	DeleteSignalBlocksOnTile(tile);
+	/* building a tunnel or bridge connects the blocks at both of its ends */
+	if (IsTileType(tile, MP_TUNNELBRIDGE)) DeleteSignalBlocksOnTile(GetOtherTunnelBridgeEnd(tile));
+}
+
+/** Compare two tile sides of a signal block, for sorting */
+static int CDECL SignalBlockKeySorter(const SignalBlockKey *a, const SignalBlockKey *b)
+{
+	return *a < *b ? -1 : *a > *b;
+}
+
+/** Compare two tiles of a signal block, for sorting */
+static int CDECL TrainTileSorter(const SignalBlock::TrainTile *a, const SignalBlock::TrainTile *b)
+{
+	if (a->tile != b->tile) return a->tile < b->tile ? -1 : 1;
+	return (int)a->tracks - (int)b->tracks;
+}
+
+/** Compare two signals of a signal block, for sorting */
+static int CDECL SignalSorter(const SignalBlock::Signal *a, const SignalBlock::Signal *b)
+{
+	if (a->tile != b->tile) return a->tile < b->tile ? -1 : 1;
+	return (int)a->trackdir - (int)b->trackdir;
+}
+
+/**
+ * Sort the items of a list and remove the duplicates.
+ * The order of the items then does not depend on where the block
+ * was searched from, so neither does the order of signal updates.
+ * @param list list to sort
+ * @param comparator function comparing two items
+ */
+template <typename T, uint S>
+static void SortUnique(SmallVector<T, S> &list, int (CDECL *comparator)(const T*, const T*))
+{
+	if (list.Length() < 2) return;
+
+	QSortT(list.Begin(), list.Length(), comparator);
+
+	T *last = list.Begin();
+	for (T *item = last + 1; item != list.End(); item++) {
+		if (comparator(last, item) != 0) *++last = *item;
+	}
+	while (list.End() != last + 1) list.Erase(list.End() - 1);
+}
+
+/**
+ * Remember a signal block found by ExploreSegment()
+ * Blocks an earlier search found with any of the same tile sides are forgotten.
+ * @param block block to add
+ */
+static void AddSignalBlock(SignalBlock *block)
+{
+	SortUnique(block->keys, &SignalBlockKeySorter);
+	SortUnique(block->tiles, &TrainTileSorter);
+	SortUnique(block->signals, &SignalSorter);
+	SortUnique(block->exits, &SignalSorter);
+
+	for (const SignalBlockKey *key = block->keys.Begin(); key != block->keys.End(); key++) {
+		SignalBlockMap::iterator it = _signal_blocks.lower_bound(*key);
+		if (it != _signal_blocks.end() && it->first == *key) {
+			DeleteSignalBlock(it->second);
+			_signal_blocks[*key] = block;
+		} else {
+			_signal_blocks.insert(it, SignalBlockMap::value_type(*key, block));
+		}
+	}
+}
+
+
 /** Check whether there is a train on rail, not in a depot */
 static Vehicle *TrainOnTileEnum(Vehicle *v, void *)
 {
@@ -191,50 +421,99 @@ static Vehicle *TrainOnTileEnum(Vehicle *v, void *)
 }
 
 
+/**
+ * Add tile and dir to the Todo set, without any checks
+ * Used for the nodes the search starts at.
+ * @param tile tile
+ * @param dir direction (tile side) we are entering from
+ * @param block block being searched
+ */
+static inline void AddToTodoSet(TileIndex tile, DiagDirection dir, SignalBlock *block)
+{
+	SignalSearchNode *node = _tbdset.Append();
+	node->tile = tile;
+	node->dir = dir;
+
+	*block->keys.Append() = MakeSignalBlockKey(tile, dir, block->owner);
+}
+
+
+/**
+ * Reads the last added node of the Todo set
+ * @param tile pointer where tile is written to
+ * @param dir pointer where dir is written to
+ * @return false iff the set was empty
+ */
+static inline bool GetFromTodoSet(TileIndex *tile, DiagDirection *dir)
+{
+	if (_tbdset.Length() == 0) return false;
+
+	SignalSearchNode *node = _tbdset.End() - 1;
+	*tile = node->tile;
+	*dir = node->dir;
+	_tbdset.Erase(node);
+
+	return true;
+}
+
+
+/**
+ * Tries to remove given tile and dir from the Todo set
+ * The set is small in most usual cases, so no tree structure is used
+ * @param tile tile
+ * @param dir and dir to remove
+ * @return element was found and removed
+ */
+static inline bool RemoveFromTodoSet(TileIndex tile, DiagDirection dir)
+{
+	for (SignalSearchNode *node = _tbdset.Begin(); node != _tbdset.End(); node++) {
+		if (node->tile == tile && node->dir == dir) {
+			_tbdset.Erase(node);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
 /**
  * Perform some operations before adding data into Todo set
- * The new and reverse direction is removed from _globset, because we are sure
- * it doesn't need to be checked again
- * Also, remove reverse direction from _tbdset
+ * The new and reverse direction are remembered as sides of the block, because
+ * the block has to be searched again when any of them changes
+ * Also, remove reverse direction from Todo set
  * This is the 'core' part so the graph seaching won't enter any tile twice
  *
  * @param t1 tile we are entering
  * @param d1 direction (tile side) we are entering
  * @param t2 tile we are leaving
  * @param d2 direction (tile side) we are leaving
+ * @param block block being searched
  * @return false iff reverse direction was in Todo set
  */
-static inline bool CheckAddToTodoSet(TileIndex t1, DiagDirection d1, TileIndex t2, DiagDirection d2)
+static inline bool CheckAddToTodoSet(TileIndex t1, DiagDirection d1, TileIndex t2, DiagDirection d2, SignalBlock *block)
 {
-	_globset.Remove(t1, d1); // it can be in Global but not in Todo
-	_globset.Remove(t2, d2); // remove in all cases
-
-	assert(!_tbdset.IsIn(t1, d1)); // it really shouldn't be there already
+	*block->keys.Append() = MakeSignalBlockKey(t1, d1, block->owner);
+	*block->keys.Append() = MakeSignalBlockKey(t2, d2, block->owner);
 
-	if (_tbdset.Remove(t2, d2)) return false;
+	if (RemoveFromTodoSet(t2, d2)) return false;
 
 	return true;
 }
 
 
 /**
- * Perform some operations before adding data into Todo set
- * The new and reverse direction is removed from Global set, because we are sure
- * it doesn't need to be checked again
- * Also, remove reverse direction from Todo set
- * This is the 'core' part so the graph seaching won't enter any tile twice
+ * Add data into Todo set, unless the tile side was already searched from the other side
  *
  * @param t1 tile we are entering
  * @param d1 direction (tile side) we are entering
  * @param t2 tile we are leaving
  * @param d2 direction (tile side) we are leaving
- * @return false iff the Todo buffer would be overrun
+ * @param block block being searched
  */
-static inline bool MaybeAddToTodoSet(TileIndex t1, DiagDirection d1, TileIndex t2, DiagDirection d2)
+static inline void MaybeAddToTodoSet(TileIndex t1, DiagDirection d1, TileIndex t2, DiagDirection d2, SignalBlock *block)
 {
-	if (!CheckAddToTodoSet(t1, d1, t2, d2)) return true;
-
-	return _tbdset.Add(t1, d1);
+	if (CheckAddToTodoSet(t1, d1, t2, d2, block)) AddToTodoSet(t1, d1, block);
 }
 
 
@@ -246,27 +525,53 @@ enum SigFlags {
 	SF_EXIT2  = 1 << 2, ///< two or more exits found
 	SF_GREEN  = 1 << 3, ///< green exitsignal found
 	SF_GREEN2 = 1 << 4, ///< two or more green exits found
-	SF_FULL   = 1 << 5, ///< some of buffers was full, do not continue
-	SF_PBS    = 1 << 6, ///< pbs signal found
+	SF_PBS    = 1 << 5, ///< pbs signal found
 };
 
 DECLARE_ENUM_AS_BIT_SET(SigFlags)
 
 
 /**
- * Search signal block
+ * Remember a tile trains are looked for on
+ * @param block block being searched
+ * @param tile tile
+ * @param tracks tracks the train has to be on, TRACK_BIT_NONE for any track outside of a depot
+ */
+static inline void AddTrainTile(SignalBlock *block, TileIndex tile, TrackBits tracks)
+{
+	SignalBlock::TrainTile *tt = block->tiles.Append();
+	tt->tile = tile;
+	tt->tracks = tracks;
+}
+
+
+/**
+ * Remember a signal at the border of the block
+ * @param list list of signals to add to
+ * @param tile tile of the signal
+ * @param trackdir trackdir of the signal
+ */
+static inline void AddSignal(SmallVector<SignalBlock::Signal, 4> &list, TileIndex tile, Trackdir trackdir)
+{
+	SignalBlock::Signal *s = list.Append();
+	s->tile = tile;
+	s->trackdir = trackdir;
+}
+
+
+/**
+ * Search signal block, starting at the nodes in the Todo set
  *
- * @param owner owner whose signals we are updating
- * @return SigFlags
+ * @param block block to store the tiles and signals found in
  */
-static SigFlags ExploreSegment(Owner owner)
+static void ExploreSegment(SignalBlock *block)
 {
-	SigFlags flags = SF_NONE;
+	Owner owner = block->owner;
 
 	TileIndex tile;
 	DiagDirection enterdir;
 
-	while (_tbdset.Get(&tile, &enterdir)) {
+	while (GetFromTodoSet(&tile, &enterdir)) {
 		TileIndex oldtile = tile; // tile we are leaving
 		DiagDirection exitdir = enterdir == INVALID_DIAGDIR ? INVALID_DIAGDIR : ReverseDiagDir(enterdir); // expected new exit direction (for straight line)
 
@@ -276,13 +581,13 @@ static SigFlags ExploreSegment(Owner owner)
 
 				if (IsRailDepot(tile)) {
 					if (enterdir == INVALID_DIAGDIR) { // from 'inside' - train just entered or left the depot
-						if (!(flags & SF_TRAIN) && HasVehicleOnPos(tile, NULL, &TrainOnTileEnum)) flags |= SF_TRAIN;
+						AddTrainTile(block, tile, TRACK_BIT_NONE);
 						exitdir = GetRailDepotDirection(tile);
 						tile += TileOffsByDiagDir(exitdir);
 						enterdir = ReverseDiagDir(exitdir);
 						break;
 					} else if (enterdir == GetRailDepotDirection(tile)) { // entered a depot
-						if (!(flags & SF_TRAIN) && HasVehicleOnPos(tile, NULL, &TrainOnTileEnum)) flags |= SF_TRAIN;
+						AddTrainTile(block, tile, TRACK_BIT_NONE);
 						continue;
 					} else {
 						continue;
@@ -291,7 +596,7 @@ static SigFlags ExploreSegment(Owner owner)
 
 				if (GetRailTileType(tile) == RAIL_TILE_WAYPOINT) {
 					if (GetWaypointAxis(tile) != DiagDirToAxis(enterdir)) continue;
-					if (!(flags & SF_TRAIN) && HasVehicleOnPos(tile, NULL, &TrainOnTileEnum)) flags |= SF_TRAIN;
+					AddTrainTile(block, tile, TRACK_BIT_NONE);
 					tile += TileOffsByDiagDir(exitdir);
 					/* enterdir and exitdir stay the same */
 					break;
@@ -302,10 +607,10 @@ static SigFlags ExploreSegment(Owner owner)
 
 				if (tracks == TRACK_BIT_HORZ || tracks == TRACK_BIT_VERT) { // there is exactly one incidating track, no need to check
 					tracks = tracks_masked;
-					if (!(flags & SF_TRAIN) && HasVehicleOnPos(tile, &tracks, &EnsureNoTrainOnTrackProc)) flags |= SF_TRAIN;
+					AddTrainTile(block, tile, tracks);
 				} else {
 					if (tracks_masked == TRACK_BIT_NONE) continue; // no incidating track
-					if (!(flags & SF_TRAIN) && HasVehicleOnPos(tile, NULL, &TrainOnTileEnum)) flags |= SF_TRAIN;
+					AddTrainTile(block, tile, TRACK_BIT_NONE);
 				}
 
 				if (HasSignals(tile)) { // there is exactly one track - not zero, because there is exit from this tile
@@ -314,27 +619,20 @@ static SigFlags ExploreSegment(Owner owner)
 						SignalType sig = GetSignalType(tile, track);
 						Trackdir trackdir = (Trackdir)FindFirstBit((tracks * 0x101) & _enterdir_to_trackdirbits[enterdir]);
 						Trackdir reversedir = ReverseTrackdir(trackdir);
-						/* add (tile, reversetrackdir) to 'to-be-updated' set when there is
+						/* add (tile, reversetrackdir) to 'to-be-updated' list when there is
 						 * ANY conventional signal in REVERSE direction
 						 * (if it is a presignal EXIT and it changes, it will be added to 'to-be-done' set later) */
 						if (HasSignalOnTrackdir(tile, reversedir)) {
 							if (IsPbsSignal(sig)) {
-								flags |= SF_PBS;
-							} else if (!_tbuset.Add(tile, reversedir)) {
-								return flags | SF_FULL;
-							}
-						}
-						if (HasSignalOnTrackdir(tile, trackdir) && !IsOnewaySignal(tile, track)) flags |= SF_PBS;
-
-						/* if it is a presignal EXIT in OUR direction and we haven't found 2 green exits yes, do special check */
-						if (!(flags & SF_GREEN2) && IsPresignalExit(tile, track) && HasSignalOnTrackdir(tile, trackdir)) { // found presignal exit
-							if (flags & SF_EXIT) flags |= SF_EXIT2; // found two (or more) exits
-							flags |= SF_EXIT; // found at least one exit - allow for compiler optimizations
-							if (GetSignalStateByTrackdir(tile, trackdir) == SIGNAL_STATE_GREEN) { // found green presignal exit
-								if (flags & SF_GREEN) flags |= SF_GREEN2;
-								flags |= SF_GREEN;
+								block->pbs = true;
+							} else {
+								AddSignal(block->signals, tile, reversedir);
 							}
 						}
+						if (HasSignalOnTrackdir(tile, trackdir) && !IsOnewaySignal(tile, track)) block->pbs = true;
+
+						/* if it is a presignal EXIT in OUR direction, its state is checked when updating the block */
+						if (IsPresignalExit(tile, track) && HasSignalOnTrackdir(tile, trackdir)) AddSignal(block->exits, tile, trackdir);
 
 						continue;
 					}
@@ -344,7 +642,7 @@ static SigFlags ExploreSegment(Owner owner)
 					if (dir != enterdir && tracks & _enterdir_to_trackbits[dir]) { // any track incidating?
 						TileIndex newtile = tile + TileOffsByDiagDir(dir);  // new tile to check
 						DiagDirection newdir = ReverseDiagDir(dir); // direction we are entering from
-						if (!MaybeAddToTodoSet(newtile, newdir, tile, dir)) return flags | SF_FULL;
+						MaybeAddToTodoSet(newtile, newdir, tile, dir, block);
 					}
 				}
 
@@ -357,7 +655,7 @@ static SigFlags ExploreSegment(Owner owner)
 				if (DiagDirToAxis(enterdir) != GetRailStationAxis(tile)) continue; // different axis
 				if (IsStationTileBlocked(tile)) continue; // 'eye-candy' station tile
 
-				if (!(flags & SF_TRAIN) && HasVehicleOnPos(tile, NULL, &TrainOnTileEnum)) flags |= SF_TRAIN;
+				AddTrainTile(block, tile, TRACK_BIT_NONE);
 				tile += TileOffsByDiagDir(exitdir);
 				break;
 
@@ -366,7 +664,7 @@ static SigFlags ExploreSegment(Owner owner)
 				if (GetTileOwner(tile) != owner) continue;
 				if (DiagDirToAxis(enterdir) == GetCrossingRoadAxis(tile)) continue; // different axis
 
-				if (!(flags & SF_TRAIN) && HasVehicleOnPos(tile, NULL, &TrainOnTileEnum)) flags |= SF_TRAIN;
+				AddTrainTile(block, tile, TRACK_BIT_NONE);
 				tile += TileOffsByDiagDir(exitdir);
 				break;
 
@@ -376,13 +674,13 @@ static SigFlags ExploreSegment(Owner owner)
 				DiagDirection dir = GetTunnelBridgeDirection(tile);
 
 				if (enterdir == INVALID_DIAGDIR) { // incoming from the wormhole
-					if (!(flags & SF_TRAIN) && HasVehicleOnPos(tile, NULL, &TrainOnTileEnum)) flags |= SF_TRAIN;
+					AddTrainTile(block, tile, TRACK_BIT_NONE);
 					enterdir = dir;
 					exitdir = ReverseDiagDir(dir);
 					tile += TileOffsByDiagDir(exitdir); // just skip to next tile
 				} else { // NOT incoming from the wormhole!
 					if (ReverseDiagDir(enterdir) != dir) continue;
-					if (!(flags & SF_TRAIN) && HasVehicleOnPos(tile, NULL, &TrainOnTileEnum)) flags |= SF_TRAIN;
+					AddTrainTile(block, tile, TRACK_BIT_NONE);
 					tile = GetOtherTunnelBridgeEnd(tile); // just skip to exit tile
 					enterdir = INVALID_DIAGDIR;
 					exitdir = INVALID_DIAGDIR;
@@ -394,7 +692,41 @@ static SigFlags ExploreSegment(Owner owner)
 				continue; // continue the while() loop
 		}
 
-		if (!MaybeAddToTodoSet(tile, enterdir, oldtile, exitdir)) return flags | SF_FULL;
+		MaybeAddToTodoSet(tile, enterdir, oldtile, exitdir, block);
+	}
+}
+
+
+/**
+ * Determine the current state of a signal block
+ *
+ * @param block the signal block
+ * @param find_train whether to look for trains in the block
+ * @return SigFlags
+ */
+static SigFlags GetSignalBlockFlags(const SignalBlock *block, bool find_train)
+{
+	SigFlags flags = SF_NONE;
+
+	if (block->pbs) flags |= SF_PBS;
+
+	for (const SignalBlock::Signal *s = block->exits.Begin(); s != block->exits.End() && !(flags & SF_GREEN2); s++) {
+		if (flags & SF_EXIT) flags |= SF_EXIT2; // found two (or more) exits
+		flags |= SF_EXIT; // found at least one exit - allow for compiler optimizations
+		if (GetSignalStateByTrackdir(s->tile, s->trackdir) == SIGNAL_STATE_GREEN) { // found green presignal exit
+			if (flags & SF_GREEN) flags |= SF_GREEN2;
+			flags |= SF_GREEN;
+		}
+	}
+
+	if (!find_train) return flags;
+
+	for (const SignalBlock::TrainTile *tt = block->tiles.Begin(); tt != block->tiles.End(); tt++) {
+		TrackBits tracks = tt->tracks;
+		if (tracks == TRACK_BIT_NONE ? HasVehicleOnPos(tt->tile, NULL, &TrainOnTileEnum) : HasVehicleOnPos(tt->tile, &tracks, &EnsureNoTrainOnTrackProc)) {
+			flags |= SF_TRAIN;
+			break;
+		}
 	}
 
 	return flags;
@@ -402,16 +734,17 @@ static SigFlags ExploreSegment(Owner owner)
 
 
 /**
- * Update signals around segment in _tbuset
+ * Update signals around segment
  *
+ * @param block the signal block
  * @param flags info about segment
  */
-static void UpdateSignalsAroundSegment(SigFlags flags)
+static void UpdateSignalsAroundSegment(const SignalBlock *block, SigFlags flags)
 {
-	TileIndex tile;
-	Trackdir trackdir;
+	for (const SignalBlock::Signal *s = block->signals.Begin(); s != block->signals.End(); s++) {
+		TileIndex tile = s->tile;
+		Trackdir trackdir = s->trackdir;
 
-	while (_tbuset.Get(&tile, &trackdir)) {
 		assert(HasSignalOnTrackdir(tile, trackdir));
 
 		SignalType sig = GetSignalType(tile, TrackdirToTrack(trackdir));
@@ -452,12 +785,157 @@ static void UpdateSignalsAroundSegment(SigFlags flags)
 }
 
 
-/** Reset all sets after one set overflowed */
-static inline void ResetSets()
+/**
+ * Remove all tile sides of a signal block from _globset,
+ * we are sure they don't need to be checked again
+ *
+ * @param block the signal block
+ */
+static void RemoveFromGlobalSet(const SignalBlock *block)
+{
+	for (uint i = 0; i < _globset.Items();) {
+		TileIndex tile;
+		DiagDirection dir;
+		_globset.GetAt(i, &tile, &dir);
+
+		if (FindSignalBlock(tile, dir, block->owner) == block) {
+			_globset.RemoveAt(i);
+		} else {
+			i++;
+		}
+	}
+}
+
+
+/**
+ * Add the nodes the search of the signal block the given tile side belongs to starts at
+ *
+ * @param tile tile from _globset
+ * @param dir side of the tile from _globset
+ * @param block block to search
+ * @return false iff there is no track at the tile side
+ */
+static bool StartSignalBlockSearch(TileIndex tile, DiagDirection dir, SignalBlock *block)
+{
+	assert(_tbdset.Length() == 0);
+
+	/* the block is found by the tile side from _globset again, even when the search starts at the next tile */
+	*block->keys.Append() = MakeSignalBlockKey(tile, dir, block->owner);
+
+	/* After updating signal, data stored are always MP_RAILWAY with signals.
+	 * Other situations happen when data are from outside functions -
+	 * modification of railbits (including both rail building and removal),
+	 * train entering/leaving block, train leaving depot...
+	 */
+	switch (GetTileType(tile)) {
+		case MP_TUNNELBRIDGE:
+			/* 'optimization assert' - do not try to update signals when it is not needed */
+			assert(GetTunnelBridgeTransportType(tile) == TRANSPORT_RAIL);
+			assert(dir == INVALID_DIAGDIR || dir == ReverseDiagDir(GetTunnelBridgeDirection(tile)));
+			AddToTodoSet(tile, INVALID_DIAGDIR, block);  // we can safely start from wormhole centre
+			AddToTodoSet(GetOtherTunnelBridgeEnd(tile), INVALID_DIAGDIR, block);
+			return true;
+
+		case MP_RAILWAY:
+			if (IsRailDepot(tile)) {
+				/* 'optimization assert' do not try to update signals in other cases */
+				assert(dir == INVALID_DIAGDIR || dir == GetRailDepotDirection(tile));
+				AddToTodoSet(tile, INVALID_DIAGDIR, block); // start from depot inside
+				return true;
+			}
+			/* FALLTHROUGH */
+		case MP_STATION:
+		case MP_ROAD:
+			if ((TrackStatusToTrackBits(GetTileTrackStatus(tile, TRANSPORT_RAIL, 0)) & _enterdir_to_trackbits[dir]) != TRACK_BIT_NONE) {
+				/* only add to set when there is some 'interesting' track */
+				AddToTodoSet(tile, dir, block);
+				AddToTodoSet(tile + TileOffsByDiagDir(dir), ReverseDiagDir(dir), block);
+				return true;
+			}
+			/* FALLTHROUGH */
+		default:
+			/* jump to next tile */
+			tile = tile + TileOffsByDiagDir(dir);
+			dir = ReverseDiagDir(dir);
+			if ((TrackStatusToTrackBits(GetTileTrackStatus(tile, TRANSPORT_RAIL, 0)) & _enterdir_to_trackbits[dir]) != TRACK_BIT_NONE) {
+				AddToTodoSet(tile, dir, block);
+				return true;
+			}
+			/* happens when removing a rail that wasn't connected at one or both sides */
+			return false;
+	}
+}
+
+
+/**
+ * Search the signal block the given tile side belongs to, and remember it
+ *
+ * @param tile tile from _globset
+ * @param dir side of the tile from _globset
+ * @param owner company whose signals we are updating
+ * @return the found signal block, or NULL when there is no track at the tile side
+ */
+static SignalBlock *SearchSignalBlock(TileIndex tile, DiagDirection dir, Owner owner)
+{
+	SignalBlock *block = NewSignalBlock(owner);
+
+	if (!StartSignalBlockSearch(tile, dir, block)) {
+		*_free_signal_blocks.Append() = block;
+		return NULL;
+	}
+
+	ExploreSegment(block);
+	AddSignalBlock(block);
+
+	return block;
+}
+
+
+/**
+ * Check whether two lists of signals of a signal block are the same
+ * @param a first list
+ * @param b second list
+ * @return true iff both lists contain the same signals
+ */
+static bool SignalsEqual(const SmallVector<SignalBlock::Signal, 4> &a, const SmallVector<SignalBlock::Signal, 4> &b)
 {
-	_tbuset.Reset();
-	_tbdset.Reset();
-	_globset.Reset();
+	if (a.Length() != b.Length()) return false;
+	for (uint i = 0; i < a.Length(); i++) {
+		if (SignalSorter(&a[i], &b[i]) != 0) return false;
+	}
+	return true;
+}
+
+
+/**
+ * Check whether searching a known signal block again finds the same block.
+ * Signal states are part of the game state, so a difference means a desync.
+ *
+ * @param block the known signal block
+ * @param tile tile from _globset the block was found by
+ * @param dir side of the tile from _globset the block was found by
+ */
+static void CheckSignalBlock(const SignalBlock *block, TileIndex tile, DiagDirection dir)
+{
+	SignalBlock found;
+	found.owner = block->owner;
+	found.pbs = false;
+
+	if (StartSignalBlockSearch(tile, dir, &found)) ExploreSegment(&found);
+
+	SortUnique(found.tiles, &TrainTileSorter);
+	SortUnique(found.signals, &SignalSorter);
+	SortUnique(found.exits, &SignalSorter);
+
+	bool same_tiles = found.tiles.Length() == block->tiles.Length();
+	for (uint i = 0; same_tiles && i < found.tiles.Length(); i++) {
+		same_tiles = TrainTileSorter(&found.tiles[i], &block->tiles[i]) == 0;
+	}
+
+	if (!same_tiles || found.pbs != block->pbs || !SignalsEqual(found.signals, block->signals) || !SignalsEqual(found.exits, block->exits)) {
+		DEBUG(desync, 0, "signal block mismatch: tile %x, dir %d, %d/%d tiles, %d/%d signals, %d/%d exits", tile, dir,
+				found.tiles.Length(), block->tiles.Length(), found.signals.Length(), block->signals.Length(), found.exits.Length(), block->exits.Length());
+	}
 }
 
 
@@ -479,74 +957,31 @@ static SigSegState UpdateSignalsInBuffer(Owner owner)
 	DiagDirection dir;
 
 	while (_globset.Get(&tile, &dir)) {
-		assert(_tbuset.IsEmpty());
-		assert(_tbdset.IsEmpty());
-
-		/* After updating signal, data stored are always MP_RAILWAY with signals.
-		 * Other situations happen when data are from outside functions -
-		 * modification of railbits (including both rail building and removal),
-		 * train entering/leaving block, train leaving depot...
-		 */
-		switch (GetTileType(tile)) {
-			case MP_TUNNELBRIDGE:
-				/* 'optimization assert' - do not try to update signals when it is not needed */
-				assert(GetTunnelBridgeTransportType(tile) == TRANSPORT_RAIL);
-				assert(dir == INVALID_DIAGDIR || dir == ReverseDiagDir(GetTunnelBridgeDirection(tile)));
-				_tbdset.Add(tile, INVALID_DIAGDIR);  // we can safely start from wormhole centre
-				_tbdset.Add(GetOtherTunnelBridgeEnd(tile), INVALID_DIAGDIR);
-				break;
+		SignalBlock *block = FindSignalBlock(tile, dir, owner);
 
-			case MP_RAILWAY:
-				if (IsRailDepot(tile)) {
-					/* 'optimization assert' do not try to update signals in other cases */
-					assert(dir == INVALID_DIAGDIR || dir == GetRailDepotDirection(tile));
-					_tbdset.Add(tile, INVALID_DIAGDIR); // start from depot inside
-					break;
-				}
-				/* FALLTHROUGH */
-			case MP_STATION:
-			case MP_ROAD:
-				if ((TrackStatusToTrackBits(GetTileTrackStatus(tile, TRANSPORT_RAIL, 0)) & _enterdir_to_trackbits[dir]) != TRACK_BIT_NONE) {
-					/* only add to set when there is some 'interesting' track */
-					_tbdset.Add(tile, dir);
-					_tbdset.Add(tile + TileOffsByDiagDir(dir), ReverseDiagDir(dir));
-					break;
-				}
-				/* FALLTHROUGH */
-			default:
-				/* jump to next tile */
-				tile = tile + TileOffsByDiagDir(dir);
-				dir = ReverseDiagDir(dir);
-				if ((TrackStatusToTrackBits(GetTileTrackStatus(tile, TRANSPORT_RAIL, 0)) & _enterdir_to_trackbits[dir]) != TRACK_BIT_NONE) {
-					_tbdset.Add(tile, dir);
-					break;
-				}
-				/* happens when removing a rail that wasn't connected at one or both sides */
-				continue; // continue the while() loop
+		if (block == NULL) {
+			block = SearchSignalBlock(tile, dir, owner);
+			if (block == NULL) continue; // continue the while() loop
+		} else if (_debug_desync_level >= 2) {
+			CheckSignalBlock(block, tile, dir);
 		}
 
-		assert(!_tbdset.Overflowed()); // it really shouldn't overflow by these one or two items
-		assert(!_tbdset.IsEmpty()); // it wouldn't hurt anyone, but shouldn't happen too
+		RemoveFromGlobalSet(block);
 
-		SigFlags flags = ExploreSegment(owner);
+		/* the trains only matter when there are signals to update */
+		SigFlags flags = GetSignalBlockFlags(block, first || block->signals.Length() != 0);
 
 		if (first) {
 			first = false;
 			/* SIGSEG_FREE is set by default */
 			if (flags & SF_PBS) {
 				state = SIGSEG_PBS;
-			} else if (flags & SF_TRAIN || (flags & SF_EXIT && !(flags & SF_GREEN)) || flags & SF_FULL) {
+			} else if (flags & SF_TRAIN || (flags & SF_EXIT && !(flags & SF_GREEN))) {
 				state = SIGSEG_FULL;
 			}
 		}
 
-		/* do not do anything when some buffer was full */
-		if (flags & SF_FULL) {
-			ResetSets(); // free all sets
-			break;
-		}
-
-		UpdateSignalsAroundSegment(flags);
+		UpdateSignalsAroundSegment(block, flags);
 	}
 
 	return state;
@@ -571,6 +1006,7 @@ void UpdateSignalsInBuffer()
 
 /**
  * Add track to signal update buffer
+ * Called after track or signals were built or removed at the tile.
  *
  * @param tile tile where we start
  * @param track track at which ends we will update signals
@@ -590,6 +1026,8 @@ void AddTrackToSignalBuffer(TileIndex tile, Track track, Owner owner)
 
 	_last_owner = owner;
 
+	InvalidateSignalBlocks(tile);
+
 	_globset.Add(tile, _search_dir_1[track]);
 	_globset.Add(tile, _search_dir_2[track]);
 
@@ -603,6 +1041,7 @@ void AddTrackToSignalBuffer(TileIndex tile, Track track, Owner owner)
 
 /**
  * Add side of tile to signal update buffer
+ * Called after a depot, tunnel or bridge was built or removed at the tile.
  *
  * @param tile tile where we start
  * @param side side of tile
@@ -615,6 +1054,8 @@ void AddSideToSignalBuffer(TileIndex tile, DiagDirection side, Owner owner)
 
 	_last_owner = owner;
 
+	InvalidateSignalBlocks(tile);
+
 	_globset.Add(tile, side);
 
 	if (_globset.Items() >= SIG_GLOB_UPDATE) {
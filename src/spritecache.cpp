@@ -13,11 +13,23 @@
 #endif /* WITH_PNG */
 #include "blitter/factory.hpp"
 #include "core/math_func.hpp"
+#include "debug.h"
+#include "md5.h"
+#include "fios.h"
+#include "string_func.h"
+#include "thread.h"
+#include "core/smallvec_type.hpp"
 
 #include "table/sprites.h"
 
+#include <map>
+
 /* Default of 4MB spritecache */
 uint _sprite_cache_size = 4;
+/* Whether to keep the encoded sprites in files in the personal directory */
+bool _sprite_disk_cache = false;
+/* Whether to decode frequently used sprites ahead of their first use */
+bool _sprite_warmup = false;
 
 typedef SimpleTinyEnumT<SpriteType, byte> SpriteTypeByte;
 
@@ -29,6 +41,7 @@ struct SpriteCache {
 	int16 lru;
 	SpriteTypeByte type; ///< In some cases a single sprite is misused by two NewGRFs. Once as real sprite and once as recolour sprite. If the recolour sprite gets into the cache it might be drawn as real sprite which causes enormous trouble.
 	bool warned;         ///< True iff the user has been warned about incorrect use of this sprite
+	bool warmup;         ///< True iff the sprite is queued to be decoded ahead of its first use
 };
 
 
@@ -75,6 +88,253 @@ static MemBlock *_spritecache_ptr;
 static int _compact_cache_counter;
 
 static void CompactSpriteCache();
+void *AllocSprite(size_t);
+extern uint64 ottd_microseconds();
+
+/** The version of the sprite disk cache files; increase it when the format changes. */
+static const uint32 SPRITE_DISK_CACHE_VERSION = 1;
+/** Size of the header of a record in a sprite disk cache file: file_pos, type and size. */
+static const uint SPRITE_DISK_CACHE_RECORD_HEADER = 9;
+
+/** Where an encoded sprite is stored in a sprite disk cache file. */
+struct SpriteDiskCacheRecord {
+	size_t offset; ///< Offset of the encoded sprite in the cache file
+	uint32 size;   ///< Size of the encoded sprite
+};
+
+/** The records of a sprite disk cache file, indexed by (position in the GRF << 8 | sprite type). */
+typedef std::map<uint64, SpriteDiskCacheRecord> SpriteDiskCacheRecords;
+
+/**
+ * The encoded sprites of the GRF in one of the Fio slots, for the current
+ * blitter. The cache file is named after the md5sum of the GRF, the blitter
+ * and whether the GRF is palette remapped, so a cache file never has to be
+ * invalidated. The part of the file that exists when it is opened is
+ * mapped into memory when possible; sprites appended during this session
+ * are read back from the file itself.
+ */
+struct SpriteDiskCache {
+	char *grf;                      ///< The GRF this cache is opened for, NULL if it isn't opened
+	size_t grf_start;               ///< Position of the start of the GRF in the Fio slot (non zero inside tars)
+	FILE *file;                     ///< The cache file, NULL if it can't be used
+	byte *map;                      ///< Mapping of the cache file as it was when it was opened, may be NULL
+	size_t map_size;                ///< Size of the mapping
+	size_t file_size;               ///< Size of the cache file, including what we appended to it
+	SpriteDiskCacheRecords records; ///< The sprites in the cache file
+};
+
+static SpriteDiskCache _sprite_disk_caches[MAX_FILE_SLOTS];
+static size_t _encoded_sprite_size; ///< Size of the last sprite encoded with AllocEncodedSprite
+
+/**
+ * Close the sprite disk cache of a slot.
+ * @param cache the cache to close
+ */
+static void CloseSpriteDiskCache(SpriteDiskCache *cache)
+{
+	FioUnmapFile(cache->map, cache->map_size);
+	if (cache->file != NULL) fclose(cache->file);
+	free(cache->grf);
+
+	cache->grf = NULL;
+	cache->file = NULL;
+	cache->map = NULL;
+	cache->map_size = 0;
+	cache->records.clear();
+}
+
+/** Close the sprite disk caches of all slots. */
+static void CloseSpriteDiskCaches()
+{
+	for (uint i = 0; i < lengthof(_sprite_disk_caches); i++) CloseSpriteDiskCache(&_sprite_disk_caches[i]);
+}
+
+/**
+ * Read the records of a sprite disk cache file.
+ * @param cache the cache to read the records of
+ * @param f the cache file
+ * @return false when the file is corrupted
+ */
+static bool ReadSpriteDiskCacheRecords(SpriteDiskCache *cache, FILE *f)
+{
+	uint32 version;
+	if (fread(&version, sizeof(version), 1, f) != 1 || version != SPRITE_DISK_CACHE_VERSION) return false;
+
+	size_t offset = sizeof(version);
+	for (;;) {
+		uint32 pos, size;
+		byte type;
+		if (fread(&pos, sizeof(pos), 1, f) != 1) break;
+		if (fread(&type, sizeof(type), 1, f) != 1 || fread(&size, sizeof(size), 1, f) != 1) return false;
+		offset += SPRITE_DISK_CACHE_RECORD_HEADER;
+
+		if (offset + size > cache->file_size) return false;
+		SpriteDiskCacheRecord *record = &cache->records[(uint64)pos << 8 | type];
+		record->offset = offset;
+		record->size = size;
+
+		offset += size;
+		fseek(f, offset, SEEK_SET);
+	}
+
+	return offset == cache->file_size;
+}
+
+/**
+ * Get the sprite disk cache of the GRF in a slot, opening it when needed.
+ * @param file_slot the slot of the GRF
+ * @return the cache, or NULL when there is no usable cache file
+ */
+static SpriteDiskCache *GetSpriteDiskCache(uint8 file_slot)
+{
+	SpriteDiskCache *cache = &_sprite_disk_caches[file_slot];
+	const char *grf = FioGetFullFilename(file_slot);
+	if (cache->grf != NULL && strcmp(cache->grf, grf) == 0) return cache->file != NULL ? cache : NULL;
+
+	CloseSpriteDiskCache(cache);
+	cache->grf = strdup(grf);
+
+	/* Identify the GRF by its md5sum; the positions of the sprites are
+	 * relative to the start of the GRF, which is not 0 for GRFs in tars. */
+	size_t size;
+	FILE *f = FioFOpenFile(grf, "rb", DATA_DIR, &size);
+	if (f == NULL) return NULL;
+	cache->grf_start = ftell(f);
+
+	Md5 checksum;
+	uint8 buffer[1024];
+	uint8 md5sum[16];
+	size_t len;
+	while (size != 0 && (len = fread(buffer, 1, min(size, sizeof(buffer)), f)) != 0) {
+		size -= len;
+		checksum.Append(buffer, len);
+	}
+	checksum.Finish(md5sum);
+	FioFCloseFile(f);
+
+	char filename[MAX_PATH];
+	char *p = filename + snprintf(filename, lengthof(filename), "%sspritecache" PATHSEP, _personal_dir);
+	FioCreateDirectory(filename);
+	for (uint i = 0; i < lengthof(md5sum); i++) p += snprintf(p, lastof(filename) - p, "%02x", md5sum[i]);
+	snprintf(p, lastof(filename) - p, "-%s%s.dat", BlitterFactoryBase::GetCurrentBlitter()->GetName(), _palette_remap_grf[file_slot] ? "-remap" : "");
+
+	/* Appending keeps what's already there, and thus the mapping, intact */
+	cache->file = fopen(filename, "a+b");
+	if (cache->file == NULL) {
+		DEBUG(sprite, 1, "Cannot open sprite disk cache '%s'", filename);
+		return NULL;
+	}
+
+	fseek(cache->file, 0, SEEK_END);
+	cache->file_size = ftell(cache->file);
+	rewind(cache->file);
+
+	if (cache->file_size != 0 && !ReadSpriteDiskCacheRecords(cache, cache->file)) {
+		DEBUG(sprite, 1, "Sprite disk cache '%s' is corrupted, starting anew", filename);
+		fclose(cache->file);
+		cache->records.clear();
+		cache->file = fopen(filename, "w+b");
+		cache->file_size = 0;
+		if (cache->file == NULL) return NULL;
+	}
+
+	if (cache->file_size == 0) {
+		fwrite(&SPRITE_DISK_CACHE_VERSION, sizeof(SPRITE_DISK_CACHE_VERSION), 1, cache->file);
+		cache->file_size = sizeof(SPRITE_DISK_CACHE_VERSION);
+	}
+
+	cache->map = FioMapFile(cache->file, &cache->map_size);
+	DEBUG(sprite, 3, "Opened sprite disk cache '%s' with %d sprites", filename, (int)cache->records.size());
+	return cache;
+}
+
+/**
+ * Try to load an encoded sprite from the sprite disk cache.
+ * @param file_slot the slot of the GRF the sprite is in
+ * @param file_pos the position of the sprite in the slot
+ * @param sprite_type the type of the sprite
+ * @return the encoded sprite in the sprite cache, or NULL when it isn't in the disk cache
+ */
+static void *LoadSpriteFromDiskCache(uint8 file_slot, size_t file_pos, SpriteType sprite_type)
+{
+	SpriteDiskCache *cache = GetSpriteDiskCache(file_slot);
+	if (cache == NULL) return NULL;
+
+	SpriteDiskCacheRecords::const_iterator it = cache->records.find((uint64)(file_pos - cache->grf_start) << 8 | sprite_type);
+	if (it == cache->records.end()) return NULL;
+
+	const SpriteDiskCacheRecord &record = it->second;
+	if (record.offset + record.size <= cache->map_size) {
+		void *ptr = AllocSprite(record.size);
+		memcpy(ptr, cache->map + record.offset, record.size);
+		return ptr;
+	}
+
+	/* Added to the cache in this session, so it's not in the mapping. Read it
+	 * aside first, as a block of the sprite cache can't be given back. */
+	byte *buffer = MallocT<byte>(record.size);
+	if (fseek(cache->file, record.offset, SEEK_SET) == 0 && fread(buffer, record.size, 1, cache->file) == 1) {
+		void *ptr = AllocSprite(record.size);
+		memcpy(ptr, buffer, record.size);
+		free(buffer);
+		return ptr;
+	}
+	free(buffer);
+
+	/* Read it from the GRF after all */
+	DEBUG(sprite, 1, "Cannot read sprite at %d from the sprite disk cache of '%s'", (int)file_pos, cache->grf);
+	cache->records.erase((uint64)(file_pos - cache->grf_start) << 8 | sprite_type);
+	return NULL;
+}
+
+/**
+ * Add an encoded sprite to the sprite disk cache.
+ * @param file_slot the slot of the GRF the sprite is in
+ * @param file_pos the position of the sprite in the slot
+ * @param sprite_type the type of the sprite
+ * @param ptr the encoded sprite
+ * @param size the size of the encoded sprite
+ */
+static void SaveSpriteToDiskCache(uint8 file_slot, size_t file_pos, SpriteType sprite_type, const void *ptr, size_t size)
+{
+	SpriteDiskCache *cache = GetSpriteDiskCache(file_slot);
+	if (cache == NULL) return;
+
+	uint32 pos = (uint32)(file_pos - cache->grf_start);
+	byte type = sprite_type;
+	uint32 size32 = (uint32)size;
+
+	/* The file is opened for appending, so all writes go to its end */
+	fseek(cache->file, 0, SEEK_END);
+	if (fwrite(&pos, sizeof(pos), 1, cache->file) != 1 || fwrite(&type, sizeof(type), 1, cache->file) != 1 ||
+			fwrite(&size32, sizeof(size32), 1, cache->file) != 1 || fwrite(ptr, size, 1, cache->file) != 1) {
+		DEBUG(sprite, 1, "Cannot write to the sprite disk cache of '%s', not using it anymore", cache->grf);
+		FioUnmapFile(cache->map, cache->map_size);
+		fclose(cache->file);
+		cache->file = NULL;
+		cache->map = NULL;
+		cache->map_size = 0;
+		cache->records.clear();
+		return;
+	}
+
+	SpriteDiskCacheRecord *record = &cache->records[(uint64)pos << 8 | type];
+	record->offset = cache->file_size + SPRITE_DISK_CACHE_RECORD_HEADER;
+	record->size = size32;
+	cache->file_size = record->offset + size;
+}
+
+/**
+ * Allocator for the blitter that also remembers the size of the encoded
+ * sprite, so it can be written to the sprite disk cache.
+ * @param size the size of the sprite
+ * @return the memory for the sprite
+ */
+static void *AllocEncodedSprite(size_t size)
+{
+	_encoded_sprite_size = size;
+	return AllocSprite(size);
+}
 
 /**
  * Skip the given amount of sprite graphics data.
@@ -135,8 +395,6 @@ bool SpriteExists(SpriteID id)
 	return !(GetSpriteCache(id)->file_pos == 0 && GetSpriteCache(id)->file_slot == 0);
 }
 
-void *AllocSprite(size_t);
-
 static void *ReadSprite(SpriteCache *sc, SpriteID id, SpriteType sprite_type)
 {
 	uint8 file_slot = sc->file_slot;
@@ -248,6 +506,11 @@ static void *ReadSprite(SpriteCache *sc, SpriteID id, SpriteType sprite_type)
 
 	assert(sprite_type == ST_NORMAL || sprite_type == ST_FONT);
 
+	if (_sprite_disk_cache) {
+		sc->ptr = LoadSpriteFromDiskCache(file_slot, file_pos, sprite_type);
+		if (sc->ptr != NULL) return sc->ptr;
+	}
+
 	SpriteLoaderGrf sprite_loader;
 	SpriteLoader::Sprite sprite;
 
@@ -255,7 +518,13 @@ static void *ReadSprite(SpriteCache *sc, SpriteID id, SpriteType sprite_type)
 		if (id == SPR_IMG_QUERY) usererror("Okay... something went horribly wrong. I couldn't load the fallback sprite. What should I do?");
 		return (void*)GetRawSprite(SPR_IMG_QUERY, ST_NORMAL);
 	}
-	sc->ptr = BlitterFactoryBase::GetCurrentBlitter()->Encode(&sprite, &AllocSprite);
+
+	if (_sprite_disk_cache) {
+		sc->ptr = BlitterFactoryBase::GetCurrentBlitter()->Encode(&sprite, &AllocEncodedSprite);
+		SaveSpriteToDiskCache(file_slot, file_pos, sprite_type, sc->ptr, _encoded_sprite_size);
+	} else {
+		sc->ptr = BlitterFactoryBase::GetCurrentBlitter()->Encode(&sprite, &AllocSprite);
+	}
 
 	return sc->ptr;
 }
@@ -288,6 +557,7 @@ bool LoadNextSprite(int load_index, byte file_slot, uint file_sprite_id)
 	sc->id = file_sprite_id;
 	sc->type = type;
 	sc->warned = false;
+	sc->warmup = false;
 
 	return true;
 }
@@ -304,6 +574,7 @@ void DupSprite(SpriteID old_spr, SpriteID new_spr)
 	scnew->id = scold->id;
 	scnew->type = scold->type;
 	scnew->warned = false;
+	scnew->warmup = false;
 }
 
 
@@ -472,6 +743,369 @@ void *AllocSprite(size_t mem_req)
 	}
 }
 
+/** Number of threads decoding the sprites of the warm-up, besides the main thread. */
+static const uint SPRITE_WARMUP_THREADS = 3;
+/** Maximum number of sprites waiting to be decoded for the warm-up. */
+static const uint SPRITE_WARMUP_MAX_QUEUED = 4096;
+/** Number of sprites the main thread loads per game loop for the warm-up, when it has to do that itself. */
+static const uint SPRITE_WARMUP_MAIN_THREAD_BUDGET = 16;
+/** When a sprite has to be loaded, the other sprites in the aligned block of this many sprites around it are decoded ahead. */
+static const uint SPRITE_WARMUP_LOAD_AHEAD = 16;
+
+/** A sprite that is decoded ahead of its first use. */
+struct SpriteWarmupJob {
+	SpriteID id;                 ///< The sprite
+	uint8 file_slot;             ///< The file the sprite is in
+	size_t file_pos;             ///< The location of the sprite in the file
+	SpriteType type;             ///< The type of the sprite
+	const byte *map;             ///< The mapping of the file
+	size_t map_size;             ///< The size of the mapping
+	SpriteLoader::Sprite sprite; ///< The decoded sprite; its data is malloced, or NULL when decoding failed
+};
+
+/**
+ * The sprites that are decoded ahead of their first use. The sprites are
+ * decoded straight from the mappings of the GRFs by the warm-up threads;
+ * encoding them for the blitter and putting them in the sprite cache is
+ * left to the main thread, as that isn't thread safe. Sprites that can't
+ * be decoded from a mapping are loaded a few at a time by the main thread.
+ */
+struct SpriteWarmup {
+	ThreadMutex *mutex;                           ///< Mutex protecting queue, next, decoded, running and stop
+	SmallVector<SpriteWarmupJob, 64> queue;       ///< Sprites to decode by the threads
+	uint next;                                    ///< The first sprite in the queue no thread has taken yet
+	SmallVector<SpriteWarmupJob, 64> decoded;     ///< Sprites decoded by the threads, to be put in the sprite cache
+	uint running;                                 ///< Number of threads that still work on the queue
+	bool stop;                                    ///< Whether the threads have to stop as soon as possible
+	ThreadObject *threads[SPRITE_WARMUP_THREADS]; ///< The threads started for the queue
+	uint num_threads;                             ///< Number of threads started for the queue
+	SmallVector<SpriteID, 64> main_queue;         ///< Sprites to be loaded by the main thread
+	uint main_next;                               ///< The first sprite in main_queue that hasn't been loaded yet
+	bool enabled;                                 ///< Whether sprites may be queued; not while the GRFs are being (re)loaded
+};
+
+static SpriteWarmup _sprite_warmup_jobs;
+
+static void ClearSpriteWarmup();
+
+/**
+ * Decode a sprite for the warm-up from the mapping of its GRF.
+ * @param job the sprite to decode
+ * @param buffer the buffer to decode the pixels in
+ */
+static void DecodeWarmupSprite(SpriteWarmupJob *job, ReusableBuffer<SpriteLoader::CommonPixel> *buffer)
+{
+	SpriteLoader::Sprite *sprite = &job->sprite;
+	sprite->data = NULL;
+	if (job->file_pos >= job->map_size) return;
+	if (!SpriteLoaderGrf::DecodeSprite(sprite, buffer, job->map + job->file_pos, job->map_size - job->file_pos, job->file_slot, job->type)) return;
+
+	/* The buffer is reused for the next sprite, so the decoded one needs its own copy */
+	size_t size = sprite->width * sprite->height;
+	SpriteLoader::CommonPixel *data = size == 0 ? NULL : MallocT<SpriteLoader::CommonPixel>(size);
+	if (data != NULL) memcpy(data, sprite->data, size * sizeof(*data));
+	sprite->data = data;
+}
+
+/**
+ * Decode the sprites in the warm-up queue till there are none left.
+ * @param data unused
+ */
+static void SpriteWarmupThread(void *data)
+{
+	SpriteWarmup *w = &_sprite_warmup_jobs;
+	ReusableBuffer<SpriteLoader::CommonPixel> buffer;
+
+	for (;;) {
+		w->mutex->BeginCritical();
+		if (w->stop || w->next == w->queue.Length()) {
+			w->running--;
+			w->mutex->EndCritical();
+			return;
+		}
+		SpriteWarmupJob job = *w->queue.Get(w->next++);
+		w->mutex->EndCritical();
+
+		DecodeWarmupSprite(&job, &buffer);
+
+		w->mutex->BeginCritical();
+		*w->decoded.Append() = job;
+		w->mutex->EndCritical();
+	}
+}
+
+/** Wait for the warm-up threads to finish and free them. */
+static void JoinSpriteWarmupThreads()
+{
+	SpriteWarmup *w = &_sprite_warmup_jobs;
+	for (uint i = 0; i < w->num_threads; i++) {
+		w->threads[i]->Join();
+		delete w->threads[i];
+	}
+	w->num_threads = 0;
+}
+
+/** Start the warm-up threads for the sprites in the queue; no threads may be running. */
+static void StartSpriteWarmupThreads()
+{
+	SpriteWarmup *w = &_sprite_warmup_jobs;
+	JoinSpriteWarmupThreads();
+
+	while (w->num_threads < SPRITE_WARMUP_THREADS) {
+		w->mutex->BeginCritical();
+		w->running++;
+		w->mutex->EndCritical();
+
+		if (!ThreadObject::New(&SpriteWarmupThread, NULL, &w->threads[w->num_threads])) {
+			w->mutex->BeginCritical();
+			w->running--;
+			w->mutex->EndCritical();
+			break;
+		}
+		w->num_threads++;
+	}
+}
+
+/**
+ * Put a sprite decoded for the warm-up in the sprite cache, unless the
+ * sprite has been loaded or replaced meanwhile.
+ * @param job the decoded sprite
+ * @return the sprite in the sprite cache, or NULL when it isn't used
+ */
+static void *InstallWarmupSprite(SpriteWarmupJob *job)
+{
+	void *ptr = NULL;
+	SpriteCache *sc = GetSpriteCache(job->id);
+	sc->warmup = false;
+
+	if (job->sprite.data != NULL && sc->ptr == NULL && sc->type == job->type && sc->file_slot == job->file_slot && sc->file_pos == job->file_pos) {
+		ptr = BlitterFactoryBase::GetCurrentBlitter()->Encode(&job->sprite, &AllocSprite);
+		sc->ptr = ptr;
+	}
+
+	free(job->sprite.data);
+	return ptr;
+}
+
+/**
+ * Get a sprite that has to be loaded now from the warm-up, when it has
+ * already been decoded.
+ * @param sc the sprite cache entry of the sprite
+ * @param id the sprite
+ * @return the sprite in the sprite cache, or NULL when it has not been decoded yet
+ */
+static void *TakeWarmupSprite(SpriteCache *sc, SpriteID id)
+{
+	SpriteWarmup *w = &_sprite_warmup_jobs;
+	if (w->mutex == NULL) return NULL;
+
+	SpriteWarmupJob job;
+	bool found = false;
+	w->mutex->BeginCritical();
+	for (SpriteWarmupJob *j = w->decoded.Begin(); j != w->decoded.End(); j++) {
+		if (j->id == id) {
+			job = *j;
+			w->decoded.Erase(j);
+			found = true;
+			break;
+		}
+	}
+	w->mutex->EndCritical();
+
+	return found ? InstallWarmupSprite(&job) : NULL;
+}
+
+/**
+ * Queue sprites to be decoded ahead of their first use, when the warm-up
+ * is enabled. Sprites that are loaded, queued already or that aren't
+ * normal sprites are skipped.
+ * @param first the first sprite
+ * @param last the last sprite
+ */
+void QueueSpriteWarmup(SpriteID first, SpriteID last)
+{
+	SpriteWarmup *w = &_sprite_warmup_jobs;
+	if (!_sprite_warmup || !w->enabled) return;
+
+	/* 32bpp graphics might come from PNGs, and sprites in the disk cache
+	 * are cheap to load; leave those to ReadSprite on the main thread. */
+	bool main_thread = _sprite_disk_cache || BlitterFactoryBase::GetCurrentBlitter()->GetScreenDepth() == 32;
+
+	w->mutex->BeginCritical();
+	for (SpriteID id = first; id <= last && id < _spritecache_items; id++) {
+		if (w->queue.Length() - w->next + w->main_queue.Length() - w->main_next >= SPRITE_WARMUP_MAX_QUEUED) break;
+
+		SpriteCache *sc = GetSpriteCache(id);
+		if (sc->ptr != NULL || sc->warmup || sc->type != ST_NORMAL || !SpriteExists(id)) continue;
+		sc->warmup = true;
+
+		size_t map_size;
+		const byte *map = FioGetMapping(sc->file_slot, &map_size);
+		if (main_thread || map == NULL) {
+			*w->main_queue.Append() = id;
+			continue;
+		}
+
+		SpriteWarmupJob *job = w->queue.Append();
+		job->id = id;
+		job->file_slot = sc->file_slot;
+		job->file_pos = sc->file_pos;
+		job->type = sc->type;
+		job->map = map;
+		job->map_size = map_size;
+	}
+	bool start = w->running == 0 && w->next != w->queue.Length();
+	w->mutex->EndCritical();
+
+	if (start) StartSpriteWarmupThreads();
+}
+
+/**
+ * Put the sprites decoded by the warm-up threads in the sprite cache, and
+ * load some of the sprites the warm-up threads can't handle. Called every
+ * game loop.
+ */
+void ProcessSpriteWarmup()
+{
+	SpriteWarmup *w = &_sprite_warmup_jobs;
+	if (w->mutex == NULL) return;
+	if (!_sprite_warmup) {
+		ClearSpriteWarmup();
+		return;
+	}
+
+	static SmallVector<SpriteWarmupJob, 64> decoded;
+	w->mutex->BeginCritical();
+	for (const SpriteWarmupJob *j = w->decoded.Begin(); j != w->decoded.End(); j++) *decoded.Append() = *j;
+	w->decoded.Clear();
+	bool running = w->running != 0;
+	if (!running && w->next == w->queue.Length()) {
+		w->queue.Clear();
+		w->next = 0;
+	}
+	w->mutex->EndCritical();
+
+	uint installed = 0;
+	for (SpriteWarmupJob *j = decoded.Begin(); j != decoded.End(); j++) {
+		if (InstallWarmupSprite(j) != NULL) installed++;
+	}
+	if (decoded.Length() != 0) DEBUG(sprite, 4, "Sprite warm-up: %d of %d decoded sprites put in the cache", installed, decoded.Length());
+	decoded.Clear();
+
+	uint budget = SPRITE_WARMUP_MAIN_THREAD_BUDGET;
+	if (!running) {
+		/* No threads could be started; nothing else touches the queue */
+		JoinSpriteWarmupThreads();
+		for (; budget > 0 && w->next != w->queue.Length(); budget--) {
+			SpriteWarmupJob *job = w->queue.Get(w->next++);
+			static ReusableBuffer<SpriteLoader::CommonPixel> buffer;
+			DecodeWarmupSprite(job, &buffer);
+			InstallWarmupSprite(job);
+		}
+	}
+
+	for (; budget > 0 && w->main_next != w->main_queue.Length(); budget--) {
+		SpriteID id = *w->main_queue.Get(w->main_next++);
+		SpriteCache *sc = GetSpriteCache(id);
+		sc->warmup = false;
+		if (sc->ptr == NULL && sc->type == ST_NORMAL) ReadSprite(sc, id, ST_NORMAL);
+	}
+	if (w->main_next == w->main_queue.Length()) {
+		w->main_queue.Clear();
+		w->main_next = 0;
+	}
+}
+
+/** Stop the warm-up threads and forget about the sprites that are queued for the warm-up. */
+static void ClearSpriteWarmup()
+{
+	SpriteWarmup *w = &_sprite_warmup_jobs;
+	if (w->mutex == NULL) return;
+
+	w->mutex->BeginCritical();
+	w->stop = true;
+	w->mutex->EndCritical();
+	JoinSpriteWarmupThreads();
+
+	for (SpriteWarmupJob *j = w->queue.Begin() + w->next; j != w->queue.End(); j++) {
+		if (j->id < _spritecache_items) GetSpriteCache(j->id)->warmup = false;
+	}
+	for (SpriteWarmupJob *j = w->decoded.Begin(); j != w->decoded.End(); j++) {
+		if (j->id < _spritecache_items) GetSpriteCache(j->id)->warmup = false;
+		free(j->sprite.data);
+	}
+	for (SpriteID *id = w->main_queue.Begin() + w->main_next; id != w->main_queue.End(); id++) {
+		if (*id < _spritecache_items) GetSpriteCache(*id)->warmup = false;
+	}
+
+	w->queue.Clear();
+	w->next = 0;
+	w->decoded.Clear();
+	w->main_queue.Clear();
+	w->main_next = 0;
+	w->stop = false;
+}
+
+/** Allow sprites to be queued for the warm-up, now all GRFs are loaded. */
+void StartSpriteWarmup()
+{
+	SpriteWarmup *w = &_sprite_warmup_jobs;
+	if (w->mutex == NULL) w->mutex = ThreadMutex::New();
+	w->enabled = true;
+}
+
+/**
+ * Stop the warm-up and don't allow sprites to be queued for it anymore.
+ * Must be called before the files of the sprites are closed or opened
+ * again, as the warm-up threads read their mappings.
+ */
+void StopSpriteWarmup()
+{
+	ClearSpriteWarmup();
+	_sprite_warmup_jobs.enabled = false;
+}
+
+/**
+ * Decode all normal sprites of the files that are mapped into memory with
+ * both the decoder that works on the mapping and the one that reads the
+ * sprite byte by byte via Fio, to compare their speed and check they give
+ * the same sprites.
+ * @param result filled with the results
+ */
+void BenchmarkSpriteDecoders(SpriteDecoderBenchmark *result)
+{
+	memset(result, 0, sizeof(*result));
+
+	ReusableBuffer<SpriteLoader::CommonPixel> buffer;
+	for (SpriteID id = 0; id < _spritecache_items; id++) {
+		const SpriteCache *sc = GetSpriteCache(id);
+		if (sc->type != ST_NORMAL || !SpriteExists(id)) continue;
+
+		size_t map_size;
+		const byte *map = FioGetMapping(sc->file_slot, &map_size);
+		if (map == NULL || sc->file_pos >= map_size) continue;
+
+		SpriteLoader::Sprite file_sprite, memory_sprite;
+		uint64 start = ottd_microseconds();
+		bool file_ok = SpriteLoaderGrf::LoadSpriteFromFile(&file_sprite, sc->file_slot, sc->file_pos, ST_NORMAL);
+		uint64 middle = ottd_microseconds();
+		bool memory_ok = SpriteLoaderGrf::DecodeSprite(&memory_sprite, &buffer, map + sc->file_pos, map_size - sc->file_pos, sc->file_slot, ST_NORMAL);
+		uint64 end = ottd_microseconds();
+
+		result->sprites++;
+		result->file_us += middle - start;
+		result->memory_us += end - middle;
+
+		if (file_ok != memory_ok) {
+			result->mismatches++;
+		} else if (file_ok && (file_sprite.width != memory_sprite.width || file_sprite.height != memory_sprite.height ||
+				file_sprite.x_offs != memory_sprite.x_offs || file_sprite.y_offs != memory_sprite.y_offs ||
+				memcmp(file_sprite.data, memory_sprite.data, file_sprite.width * file_sprite.height * sizeof(*file_sprite.data)) != 0)) {
+			result->mismatches++;
+		}
+	}
+}
+
 /** Handles the case when a sprite of different type is requested than is present in the SpriteCache.
  * For ST_FONT sprites, it is normal. In other cases, default sprite is loaded instead.
  * @param sprite ID of loaded sprite
@@ -537,7 +1171,13 @@ const void *GetRawSprite(SpriteID sprite, SpriteType type)
 	void *p = sc->ptr;
 
 	/* Load the sprite, if it is not loaded, yet */
-	if (p == NULL) p = ReadSprite(sc, sprite, type);
+	if (p == NULL) {
+		if (sc->warmup) p = TakeWarmupSprite(sc, sprite);
+		if (p == NULL) p = ReadSprite(sc, sprite, type);
+
+		/* Sprites with IDs close to each other tend to be drawn together */
+		QueueSpriteWarmup(sprite & ~(SPRITE_WARMUP_LOAD_AHEAD - 1), sprite | (SPRITE_WARMUP_LOAD_AHEAD - 1));
+	}
 
 	return p;
 }
@@ -562,6 +1202,10 @@ void GfxInitSpriteMem()
 	/* Sentinel block (identified by size == 0) */
 	NextBlock(_spritecache_ptr)->size = 0;
 
+	/* The GRFs will be opened again, maybe in other slots */
+	StopSpriteWarmup();
+	CloseSpriteDiskCaches();
+
 	/* Reset the spritecache 'pool' */
 	free(_spritecache);
 	_spritecache_items = 0;
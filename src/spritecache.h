@@ -16,6 +16,8 @@ struct Sprite {
 };
 
 extern uint _sprite_cache_size;
+extern bool _sprite_disk_cache;
+extern bool _sprite_warmup;
 
 const void *GetRawSprite(SpriteID sprite, SpriteType type);
 bool SpriteExists(SpriteID sprite);
@@ -35,6 +37,21 @@ static inline const byte *GetNonSprite(SpriteID sprite, SpriteType type)
 void GfxInitSpriteMem();
 void IncreaseSpriteLRU();
 
+void QueueSpriteWarmup(SpriteID first, SpriteID last);
+void ProcessSpriteWarmup();
+void StartSpriteWarmup();
+void StopSpriteWarmup();
+
+/** The results of BenchmarkSpriteDecoders. */
+struct SpriteDecoderBenchmark {
+	uint sprites;         ///< Number of sprites decoded by both decoders
+	uint mismatches;      ///< Number of sprites the decoders don't agree on
+	uint64 file_us;       ///< Microseconds spent decoding the sprites byte by byte via Fio
+	uint64 memory_us;     ///< Microseconds spent decoding the sprites from the mappings
+};
+
+void BenchmarkSpriteDecoders(SpriteDecoderBenchmark *result);
+
 bool LoadNextSprite(int load_index, byte file_index, uint file_sprite_id);
 void DupSprite(SpriteID old_spr, SpriteID new_spr);
 
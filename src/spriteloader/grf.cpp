@@ -7,6 +7,7 @@
 #include "../fileio_func.h"
 #include "../debug.h"
 #include "../core/alloc_func.hpp"
+#include "../core/math_func.hpp"
 #include "../strings_func.h"
 #include "table/strings.h"
 #include "../gui.h"
@@ -32,22 +33,65 @@ static bool WarnCorruptSprite(uint8 file_slot, size_t file_pos, int line)
 	return false;
 }
 
-bool SpriteLoaderGrf::LoadSprite(SpriteLoader::Sprite *sprite, uint8 file_slot, size_t file_pos, SpriteType sprite_type)
-{
-	/* Open the right file and go to the correct position */
-	FioSeekToFile(file_slot, file_pos);
+/**
+ * Reads the data of a sprite via the Fio functions, byte by byte; only for
+ * use on the main thread. Used for files that aren't mapped into memory.
+ */
+class FioSpriteReader {
+	uint8 file_slot; ///< The file the sprite is in
+	size_t file_pos; ///< The location of the sprite in the file
+public:
+	FioSpriteReader(uint8 file_slot, size_t file_pos) : file_slot(file_slot), file_pos(file_pos)
+	{
+		FioSeekToFile(file_slot, file_pos);
+	}
+
+	FORCEINLINE byte ReadByte() { return FioReadByte(); }
+	FORCEINLINE uint16 ReadWord() { return FioReadWord(); }
+	FORCEINLINE void ReadBlock(void *ptr, size_t size) { FioReadBlock(ptr, size); }
+	FORCEINLINE void AllocateData(SpriteLoader::Sprite *sprite, size_t size) { sprite->AllocateData(size); }
+
+	/**
+	 * Tell the user about a corrupted sprite.
+	 * @param line the line where the error occurs
+	 * @return always false
+	 */
+	bool Corrupt(int line) { return WarnCorruptSprite(this->file_slot, this->file_pos, line); }
+
+	/**
+	 * Tell about data after the pixels of an uncompressed sprite.
+	 * @param bytes the number of unused bytes
+	 */
+	void ExtraBytes(int bytes)
+	{
+		static byte warning_level = 0;
+		DEBUG(sprite, warning_level, "Ignoring %i unused extra bytes from the sprite from %s at position %i", bytes, FioGetFilename(this->file_slot), (int)this->file_pos);
+		warning_level = 6;
+	}
+};
 
+/**
+ * Decode a sprite from a (New)GRF, reading it byte by byte.
+ * @param reader the reader positioned at the start of the sprite
+ * @param sprite the sprite to decode into
+ * @param file_slot the file the sprite is in
+ * @param sprite_type the type of the sprite
+ * @return true if the sprite is decoded
+ */
+template <class T>
+static bool DecodeGrfSprite(T &reader, SpriteLoader::Sprite *sprite, uint8 file_slot, SpriteType sprite_type)
+{
 	/* Read the size and type */
-	int num = FioReadWord();
-	byte type = FioReadByte();
+	int num = reader.ReadWord();
+	byte type = reader.ReadByte();
 
 	/* Type 0xFF indicates either a colourmap or some other non-sprite info; we do not handle them here */
 	if (type == 0xFF) return false;
 
-	sprite->height = FioReadByte();
-	sprite->width  = FioReadWord();
-	sprite->x_offs = FioReadWord();
-	sprite->y_offs = FioReadWord();
+	sprite->height = reader.ReadByte();
+	sprite->width  = reader.ReadWord();
+	sprite->x_offs = reader.ReadWord();
+	sprite->y_offs = reader.ReadWord();
 
 	/* 0x02 indicates it is a compressed sprite, so we can't rely on 'num' to be valid.
 	 *  In case it is uncompressed, the size is 'num' - 8 (header-size). */
@@ -59,24 +103,22 @@ bool SpriteLoaderGrf::LoadSprite(SpriteLoader::Sprite *sprite, uint8 file_slot,
 
 	/* Read the file, which has some kind of compression */
 	while (num > 0) {
-		int8 code = FioReadByte();
+		int8 code = reader.ReadByte();
 
 		if (code >= 0) {
 			/* Plain bytes to read */
 			int size = (code == 0) ? 0x80 : code;
 			num -= size;
-			if (num < 0) return WarnCorruptSprite(file_slot, file_pos, __LINE__);
-			for (; size > 0; size--) {
-				*dest = FioReadByte();
-				dest++;
-			}
+			if (num < 0) return reader.Corrupt(__LINE__);
+			reader.ReadBlock(dest, size);
+			dest += size;
 		} else {
 			/* Copy bytes from earlier in the sprite */
-			const uint data_offset = ((code & 7) << 8) | FioReadByte();
-			if (dest - data_offset < dest_orig) return WarnCorruptSprite(file_slot, file_pos, __LINE__);
+			const uint data_offset = ((code & 7) << 8) | reader.ReadByte();
+			if (dest - data_offset < dest_orig) return reader.Corrupt(__LINE__);
 			int size = -(code >> 3);
 			num -= size;
-			if (num < 0) return WarnCorruptSprite(file_slot, file_pos, __LINE__);
+			if (num < 0) return reader.Corrupt(__LINE__);
 			for (; size > 0; size--) {
 				*dest = *(dest - data_offset);
 				dest++;
@@ -84,12 +126,14 @@ bool SpriteLoaderGrf::LoadSprite(SpriteLoader::Sprite *sprite, uint8 file_slot,
 		}
 	}
 
-	if (num != 0) return WarnCorruptSprite(file_slot, file_pos, __LINE__);
+	if (num != 0) return reader.Corrupt(__LINE__);
 
-	sprite->AllocateData(sprite->width * sprite->height);
+	reader.AllocateData(sprite, sprite->width * sprite->height);
 
 	/* When there are transparency pixels, this format has an other trick.. decode it */
 	if (type & 0x08) {
+		if (dest_size < sprite->height * 2) return reader.Corrupt(__LINE__);
+
 		for (int y = 0; y < sprite->height; y++) {
 			bool last_item = false;
 			/* Look up in the header-table where the real data is stored for this row */
@@ -99,10 +143,7 @@ bool SpriteLoaderGrf::LoadSprite(SpriteLoader::Sprite *sprite, uint8 file_slot,
 			dest = dest_orig + offset;
 
 			do {
-				if (dest + 2 > dest_orig + dest_size) {
-					free(sprite->data);
-					return WarnCorruptSprite(file_slot, file_pos, __LINE__);
-				}
+				if (dest + 2 > dest_orig + dest_size) return reader.Corrupt(__LINE__);
 
 				SpriteLoader::CommonPixel *data;
 				/* Read the header:
@@ -115,10 +156,7 @@ bool SpriteLoaderGrf::LoadSprite(SpriteLoader::Sprite *sprite, uint8 file_slot,
 
 				data = &sprite->data[y * sprite->width + skip];
 
-				if (skip + length > sprite->width || dest + length > dest_orig + dest_size) {
-					free(sprite->data);
-					return WarnCorruptSprite(file_slot, file_pos, __LINE__);
-				}
+				if (skip + length > sprite->width || dest + length > dest_orig + dest_size) return reader.Corrupt(__LINE__);
 
 				for (int x = 0; x < length; x++) {
 					data->m = ((sprite_type == ST_NORMAL && _palette_remap_grf[file_slot]) ? _palette_remap[*dest] : *dest);
@@ -128,16 +166,9 @@ bool SpriteLoaderGrf::LoadSprite(SpriteLoader::Sprite *sprite, uint8 file_slot,
 			} while (!last_item);
 		}
 	} else {
-		if (dest_size < sprite->width * sprite->height) {
-			free(sprite->data);
-			return WarnCorruptSprite(file_slot, file_pos, __LINE__);
-		}
+		if (dest_size < sprite->width * sprite->height) return reader.Corrupt(__LINE__);
 
-		if (dest_size > sprite->width * sprite->height) {
-			static byte warning_level = 0;
-			DEBUG(sprite, warning_level, "Ignoring %i unused extra bytes from the sprite from %s at position %i", dest_size - sprite->width * sprite->height, FioGetFilename(file_slot), (int)file_pos);
-			warning_level = 6;
-		}
+		if (dest_size > sprite->width * sprite->height) reader.ExtraBytes(dest_size - sprite->width * sprite->height);
 
 		dest = dest_orig;
 
@@ -152,3 +183,195 @@ bool SpriteLoaderGrf::LoadSprite(SpriteLoader::Sprite *sprite, uint8 file_slot,
 
 	return true;
 }
+
+/**
+ * Tell about a corrupted sprite, when we may do so on this thread.
+ * @param warn whether to warn the user
+ * @param file_slot the file the errored sprite is in
+ * @param file_pos the location in the file of the errored sprite
+ * @param line the line where the error occurs.
+ * @return always false (to tell loading the sprite failed)
+ */
+static inline bool CorruptSprite(bool warn, uint8 file_slot, size_t file_pos, int line)
+{
+	return warn ? WarnCorruptSprite(file_slot, file_pos, line) : false;
+}
+
+/** Frees a block of memory when it goes out of scope. */
+struct ScopedFree {
+	void *ptr; ///< The memory to free, may be NULL
+
+	ScopedFree(void *ptr) : ptr(ptr) {}
+	~ScopedFree() { free(this->ptr); }
+};
+
+/**
+ * Decode a sprite from a (New)GRF that is in memory. It gives the same
+ * result as DecodeGrfSprite, but as the whole sprite is available the
+ * literal runs and the back-references that don't overlap the bytes they
+ * produce are copied with memcpy. The pixels are allocated zeroed, so the
+ * transparent spans are already filled and only the pixels that are
+ * actually in the sprite are written, remapped and made opaque in one go.
+ * @param data the start of the sprite
+ * @param size the number of bytes from the start of the sprite till the end of the memory
+ * @param sprite the sprite to decode into
+ * @param buffer the buffer to decode the pixels in, NULL for the buffer shared by all sprites
+ * @param file_slot the file the sprite is in
+ * @param file_pos the location of the sprite in the file
+ * @param sprite_type the type of the sprite
+ * @param warn whether to warn the user about corrupted sprites; only on the main thread
+ * @return true if the sprite is decoded
+ */
+static bool DecodeGrfSpriteFromMemory(const byte *data, size_t size, SpriteLoader::Sprite *sprite, ReusableBuffer<SpriteLoader::CommonPixel> *buffer, uint8 file_slot, size_t file_pos, SpriteType sprite_type, bool warn)
+{
+	/* The header: size, type, height, width, x and y offset */
+	static const size_t HEADER_SIZE = 10;
+	if (size < HEADER_SIZE) return CorruptSprite(warn, file_slot, file_pos, __LINE__);
+
+	const byte *src = data;
+	const byte *src_end = data + size;
+
+	int num = src[0] | src[1] << 8;
+	byte type = src[2];
+
+	/* Type 0xFF indicates either a colourmap or some other non-sprite info; we do not handle them here */
+	if (type == 0xFF) return false;
+
+	sprite->height = src[3];
+	sprite->width  = src[4] | src[5] << 8;
+	sprite->x_offs = (int16)(src[6] | src[7] << 8);
+	sprite->y_offs = (int16)(src[8] | src[9] << 8);
+	src += HEADER_SIZE;
+
+	/* 0x02 indicates it is a compressed sprite, so we can't rely on 'num' to be valid.
+	 *  In case it is uncompressed, the size is 'num' - 8 (header-size). */
+	num = (type & 0x02) ? sprite->width * sprite->height : num - 8;
+
+	/* Every byte of the compressed data gives at most 8 bytes of output */
+	if (num < 0 || (size_t)num > (size_t)(src_end - src) * 8) return CorruptSprite(warn, file_slot, file_pos, __LINE__);
+
+	/* Big sprites are decompressed on the heap, as threads may have little stack */
+	static const int MAX_DECOMPRESS_ON_STACK = 64 * 1024;
+	byte *dest_orig = (num <= MAX_DECOMPRESS_ON_STACK) ? AllocaM(byte, num) : MallocT<byte>(num);
+	ScopedFree dest_free(num <= MAX_DECOMPRESS_ON_STACK ? NULL : dest_orig);
+	byte *dest = dest_orig;
+	const int dest_size = num;
+
+	while (num > 0) {
+		if (src == src_end) return CorruptSprite(warn, file_slot, file_pos, __LINE__);
+		int8 code = *src++;
+
+		if (code >= 0) {
+			/* Plain bytes to read */
+			int size = (code == 0) ? 0x80 : code;
+			num -= size;
+			if (num < 0 || src_end - src < size) return CorruptSprite(warn, file_slot, file_pos, __LINE__);
+			memcpy(dest, src, size);
+			src += size;
+			dest += size;
+		} else {
+			/* Copy bytes from earlier in the sprite */
+			if (src == src_end) return CorruptSprite(warn, file_slot, file_pos, __LINE__);
+			const uint data_offset = ((code & 7) << 8) | *src++;
+			if (dest - data_offset < dest_orig) return CorruptSprite(warn, file_slot, file_pos, __LINE__);
+			int size = -(code >> 3);
+			num -= size;
+			if (num < 0) return CorruptSprite(warn, file_slot, file_pos, __LINE__);
+
+			if (data_offset >= (uint)size) {
+				memcpy(dest, dest - data_offset, size);
+				dest += size;
+			} else if (data_offset == 1) {
+				/* A run of the same byte */
+				memset(dest, dest[-1], size);
+				dest += size;
+			} else {
+				/* The copy overlaps the bytes it produces */
+				for (; size > 0; size--) {
+					*dest = *(dest - data_offset);
+					dest++;
+				}
+			}
+		}
+	}
+
+	if (buffer == NULL) {
+		sprite->AllocateData(sprite->width * sprite->height);
+	} else {
+		sprite->AllocateData(sprite->width * sprite->height, buffer);
+	}
+
+	const byte *remap = (sprite_type == ST_NORMAL && _palette_remap_grf[file_slot]) ? _palette_remap : NULL;
+
+	/* When there are transparency pixels, this format has an other trick.. decode it */
+	if (type & 0x08) {
+		if (dest_size < sprite->height * 2) return CorruptSprite(warn, file_slot, file_pos, __LINE__);
+
+		for (int y = 0; y < sprite->height; y++) {
+			bool last_item = false;
+			/* Look up in the header-table where the real data is stored for this row */
+			int offset = (dest_orig[y * 2 + 1] << 8) | dest_orig[y * 2];
+
+			/* Go to that row */
+			dest = dest_orig + offset;
+
+			do {
+				if (dest + 2 > dest_orig + dest_size) return CorruptSprite(warn, file_slot, file_pos, __LINE__);
+
+				/* Read the header:
+				 *  0 .. 14  - length
+				 *  15       - last_item
+				 *  16 .. 31 - transparency bytes */
+				last_item  = ((*dest) & 0x80) != 0;
+				int length =  (*dest++) & 0x7F;
+				int skip   =   *dest++;
+
+				if (skip + length > sprite->width || dest + length > dest_orig + dest_size) return CorruptSprite(warn, file_slot, file_pos, __LINE__);
+
+				SpriteLoader::CommonPixel *pixel = &sprite->data[y * sprite->width + skip];
+				for (int x = 0; x < length; x++, pixel++) {
+					byte m = (remap != NULL) ? remap[*dest++] : *dest++;
+					pixel->m = m;
+					pixel->a = (m != 0) ? 0xFF : 0;
+				}
+			} while (!last_item);
+		}
+	} else {
+		if (dest_size < sprite->width * sprite->height) return CorruptSprite(warn, file_slot, file_pos, __LINE__);
+
+		if (dest_size > sprite->width * sprite->height && warn) {
+			static byte warning_level = 0;
+			DEBUG(sprite, warning_level, "Ignoring %i unused extra bytes from the sprite from %s at position %i", dest_size - sprite->width * sprite->height, FioGetFilename(file_slot), (int)file_pos);
+			warning_level = 6;
+		}
+
+		SpriteLoader::CommonPixel *pixel = sprite->data;
+		for (int i = 0; i < sprite->width * sprite->height; i++, pixel++) {
+			byte m = (remap != NULL) ? remap[dest_orig[i]] : dest_orig[i];
+			pixel->m = m;
+			pixel->a = (m != 0) ? 0xFF : 0;
+		}
+	}
+
+	return true;
+}
+
+bool SpriteLoaderGrf::LoadSprite(SpriteLoader::Sprite *sprite, uint8 file_slot, size_t file_pos, SpriteType sprite_type)
+{
+	size_t map_size;
+	const byte *map = FioGetMapping(file_slot, &map_size);
+	if (map == NULL || file_pos >= map_size) return SpriteLoaderGrf::LoadSpriteFromFile(sprite, file_slot, file_pos, sprite_type);
+
+	return DecodeGrfSpriteFromMemory(map + file_pos, map_size - file_pos, sprite, NULL, file_slot, file_pos, sprite_type, true);
+}
+
+/* static */ bool SpriteLoaderGrf::LoadSpriteFromFile(SpriteLoader::Sprite *sprite, uint8 file_slot, size_t file_pos, SpriteType sprite_type)
+{
+	FioSpriteReader reader(file_slot, file_pos);
+	return DecodeGrfSprite(reader, sprite, file_slot, sprite_type);
+}
+
+/* static */ bool SpriteLoaderGrf::DecodeSprite(SpriteLoader::Sprite *sprite, ReusableBuffer<SpriteLoader::CommonPixel> *buffer, const byte *data, size_t size, uint8 file_slot, SpriteType sprite_type)
+{
+	return DecodeGrfSpriteFromMemory(data, size, sprite, buffer, file_slot, 0, sprite_type, false);
+}
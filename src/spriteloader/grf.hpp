@@ -11,8 +11,35 @@ class SpriteLoaderGrf : public SpriteLoader {
 public:
 	/**
 	 * Load a sprite from the disk and return a sprite struct which is the same for all loaders.
+	 * The sprite is decoded from the mapping of the file when there is one.
 	 */
 	bool LoadSprite(SpriteLoader::Sprite *sprite, uint8 file_slot, size_t file_pos, SpriteType sprite_type);
+
+	/**
+	 * Load a sprite by reading it byte by byte via the Fio functions, for
+	 * files that aren't mapped into memory. The result is the same as the
+	 * one of LoadSprite.
+	 * @param sprite the sprite to decode into
+	 * @param file_slot the file the sprite is in
+	 * @param file_pos the location of the sprite in the file
+	 * @param sprite_type the type of the sprite
+	 * @return true if the sprite is decoded
+	 */
+	static bool LoadSpriteFromFile(SpriteLoader::Sprite *sprite, uint8 file_slot, size_t file_pos, SpriteType sprite_type);
+
+	/**
+	 * Decode a sprite from a GRF that is in memory, e.g. from the mapping of
+	 * the file. Unlike LoadSprite this doesn't use the Fio functions nor the
+	 * data buffer shared by all sprites, so it can be called on any thread.
+	 * @param sprite the sprite to decode into
+	 * @param buffer the buffer to decode the pixels in
+	 * @param data the start of the sprite
+	 * @param size the number of bytes from the start of the sprite till the end of the memory
+	 * @param file_slot the file the sprite is in
+	 * @param sprite_type the type of the sprite
+	 * @return true if the sprite is decoded, false if it isn't a normal sprite or it is corrupted
+	 */
+	static bool DecodeSprite(SpriteLoader::Sprite *sprite, ReusableBuffer<SpriteLoader::CommonPixel> *buffer, const byte *data, size_t size, uint8 file_slot, SpriteType sprite_type);
 };
 
 #endif /* SPRITELOADER_GRF_HPP */
@@ -33,8 +33,9 @@ public:
 		/**
 		 * Allocate the sprite data of this sprite.
 		 * @param size the minimum size of the data field.
+		 * @param buffer the buffer to allocate it in; the default is shared by all sprites and thus only usable on the main thread.
 		 */
-		void AllocateData(size_t size) { this->data = Sprite::buffer.ZeroAllocate(size); }
+		void AllocateData(size_t size, ReusableBuffer<SpriteLoader::CommonPixel> *buffer = &Sprite::buffer) { this->data = buffer->ZeroAllocate(size); }
 	private:
 		/** Allocated memory to pass sprite data around */
 		static ReusableBuffer<SpriteLoader::CommonPixel> buffer;
@@ -0,0 +1,307 @@
+/* $Id$ */
+
+/** @file state_hash.cpp Hashing of the game state to find the origin of desyncs.
+ *
+ * With the desync debug level set to 1 or more the hash of the game state is
+ * written to the command log every day, with level 2 or more every tick. Only
+ * a slice of the map is hashed each time, so all of it is covered once every
+ * MAP_HASH_SLICES days; this keeps it cheap enough to leave it enabled.
+ *
+ * When a desync happened, the command log of the server and a savegame are
+ * enough to replay the game with ReplayCommandLog and find the first
+ * moment, and the part of the game state, where the replay diverges from
+ * the state hashes in the log.
+ */
+
+#include "stdafx.h"
+#include "openttd.h"
+#include "debug.h"
+#include "variables.h"
+#include "map_func.h"
+#include "vehicle_base.h"
+#include "station_base.h"
+#include "company_base.h"
+#include "company_func.h"
+#include "command_func.h"
+#include "console_func.h"
+#include "date_func.h"
+#include "fileio_func.h"
+#include "string_func.h"
+#include "core/random_func.hpp"
+#include "saveload/saveload.h"
+#include "state_hash.h"
+
+bool _replaying_commands; ///< Whether ReplayCommandLog is running the game; the AIs must not act then
+
+/** The number of slices the map is divided in for hashing. */
+static const uint MAP_HASH_SLICES = 64;
+
+/** Names of the parts of the state hash, for showing mismatches. */
+static const char * const _state_hash_part_names[SHP_END] = {
+	"map",
+	"vehicles",
+	"cargo",
+	"companies",
+	"random",
+};
+
+/**
+ * Add a value to a hash (FNV-1a on 32 bit words).
+ * @param hash the hash to add the value to
+ * @param value the value to add
+ */
+static inline void HashAdd(uint32 &hash, uint32 value)
+{
+	hash = (hash ^ value) * 16777619;
+}
+
+/**
+ * Calculate the hash of the game state as it is right now.
+ * @param hash the hash to fill
+ */
+void CalcStateHash(StateHash *hash)
+{
+	for (uint i = 0; i < SHP_END; i++) hash->part[i] = 2166136261U;
+
+	/* The slice only depends on the tick counter, so all clients hash the same tiles */
+	uint slice = (_tick_counter / DAY_TICKS) % MAP_HASH_SLICES;
+	uint slice_size = MapSize() / MAP_HASH_SLICES;
+	for (TileIndex t = slice * slice_size; t < (slice + 1) * slice_size; t++) {
+		const Tile *m = &_m[t];
+		HashAdd(hash->part[SHP_MAP], m->type_height | m->m1 << 8 | m->m2 << 16);
+		HashAdd(hash->part[SHP_MAP], m->m3 | m->m4 << 8 | m->m5 << 16 | m->m6 << 24);
+		HashAdd(hash->part[SHP_MAP], _me[t].m7);
+	}
+
+	const Vehicle *v;
+	FOR_ALL_VEHICLES(v) {
+		HashAdd(hash->part[SHP_VEHICLES], v->index | v->type << 16 | v->direction << 24);
+		HashAdd(hash->part[SHP_VEHICLES], v->x_pos);
+		HashAdd(hash->part[SHP_VEHICLES], v->y_pos);
+		HashAdd(hash->part[SHP_VEHICLES], v->z_pos | v->progress << 8 | v->vehstatus << 16);
+		HashAdd(hash->part[SHP_VEHICLES], v->tile);
+		HashAdd(hash->part[SHP_VEHICLES], v->cur_speed);
+
+		HashAdd(hash->part[SHP_CARGO], v->index | v->cargo_type << 16);
+		HashAdd(hash->part[SHP_CARGO], v->cargo.Count());
+	}
+
+	const Station *st;
+	FOR_ALL_STATIONS(st) {
+		for (CargoID c = 0; c < NUM_CARGO; c++) {
+			const GoodsEntry *ge = &st->goods[c];
+			if (ge->cargo.Empty()) continue;
+			HashAdd(hash->part[SHP_CARGO], st->index | c << 16);
+			HashAdd(hash->part[SHP_CARGO], ge->cargo.Count());
+		}
+	}
+
+	const Company *c;
+	FOR_ALL_COMPANIES(c) {
+		HashAdd(hash->part[SHP_COMPANIES], c->index);
+		int64 money = c->money;
+		HashAdd(hash->part[SHP_COMPANIES], GB(money, 0, 32));
+		HashAdd(hash->part[SHP_COMPANIES], GB(money, 32, 32));
+		HashAdd(hash->part[SHP_COMPANIES], (uint32)(int64)c->current_loan);
+	}
+
+	HashAdd(hash->part[SHP_RANDOM], _random.state[0]);
+	HashAdd(hash->part[SHP_RANDOM], _random.state[1]);
+}
+
+/**
+ * Write the state hash to the command log when it is due. Called at the
+ * end of every tick of the game state.
+ */
+void StateHashLoop()
+{
+	if (_debug_desync_level < 1) return;
+	if (_debug_desync_level < 2 && _date_fract != 0) return;
+
+	StateHash hash;
+	CalcStateHash(&hash);
+
+	DEBUG(desync, 1, "state: %08x; %08x; %08x; %08x; %08x; %08x; %08x\n", _date, _date_fract,
+			hash.part[SHP_MAP], hash.part[SHP_VEHICLES], hash.part[SHP_CARGO], hash.part[SHP_COMPANIES], hash.part[SHP_RANDOM]);
+}
+
+/** An entry of the command log that is relevant for replaying. */
+struct ReplayEntry {
+	Date date;           ///< The date the entry was logged at
+	DateFract date_fract; ///< The date fraction the entry was logged at
+	bool is_command;     ///< Whether this is a command or a state hash
+	CompanyID company;   ///< The company that executed the command
+	TileIndex tile;      ///< The tile of the command
+	uint32 p1;           ///< The first parameter of the command
+	uint32 p2;           ///< The second parameter of the command
+	uint32 cmd;          ///< The command
+	char text[256];      ///< The text of the command, empty for none
+	StateHash hash;      ///< The logged state hash
+};
+
+/**
+ * Split a log line into its fields.
+ * @param line the line, will be modified
+ * @param fields the array to put the fields in
+ * @param count the number of fields to split off; the last field is the remainder of the line
+ * @return true when all fields were found
+ */
+static bool SplitLogLine(char *line, char **fields, uint count)
+{
+	for (uint i = 0; i < count; i++) {
+		fields[i] = line;
+		if (i == count - 1) break;
+
+		line = strstr(line, "; ");
+		if (line == NULL) return false;
+		*line = '\0';
+		line += 2;
+	}
+	return true;
+}
+
+/**
+ * Parse a line of the command log.
+ * @param line the line, will be modified
+ * @param entry the entry to fill
+ * @return true when the line is a command or a state hash
+ */
+static bool ParseLogLine(char *line, ReplayEntry *entry)
+{
+	char *fields[8];
+
+	/* Strip the line ending */
+	for (char *p = line; *p != '\0'; p++) {
+		if (*p == '\r' || *p == '\n') {
+			*p = '\0';
+			break;
+		}
+	}
+
+	if (strncmp(line, "cmd: ", 5) == 0) {
+		if (!SplitLogLine(line + 5, fields, 8)) return false;
+
+		entry->is_command = true;
+		entry->company = (CompanyID)strtoul(fields[2], NULL, 16);
+		entry->tile    = strtoul(fields[3], NULL, 16);
+		entry->p1      = strtoul(fields[4], NULL, 16);
+		entry->p2      = strtoul(fields[5], NULL, 16);
+		entry->cmd     = strtoul(fields[6], NULL, 16);
+		if (strcmp(fields[7], "(null)") == 0) {
+			entry->text[0] = '\0';
+		} else {
+			strecpy(entry->text, fields[7], lastof(entry->text));
+		}
+	} else if (strncmp(line, "state: ", 7) == 0) {
+		if (!SplitLogLine(line + 7, fields, 2 + SHP_END)) return false;
+
+		entry->is_command = false;
+		for (uint i = 0; i < SHP_END; i++) entry->hash.part[i] = strtoul(fields[2 + i], NULL, 16);
+	} else {
+		return false;
+	}
+
+	entry->date       = strtoul(fields[0], NULL, 16);
+	entry->date_fract = strtoul(fields[1], NULL, 16);
+	return true;
+}
+
+/**
+ * Compare two moments in time.
+ * @return true when date/date_fract a lies before date/date_fract b
+ */
+static inline bool IsBefore(Date a, DateFract a_fract, Date b, DateFract b_fract)
+{
+	return a < b || (a == b && a_fract < b_fract);
+}
+
+/**
+ * Load a savegame and replay the commands of a command log on it, checking
+ * the state of the game against the state hashes in the log. The replay
+ * stops at the first state hash that does not match; the game diverged
+ * somewhere after the last matching state hash.
+ * @param savegame the savegame to start with
+ * @param logfile the command log (of the server) to replay
+ * @return true when the whole log was replayed without differences
+ */
+bool ReplayCommandLog(const char *savegame, const char *logfile)
+{
+	extern bool SafeSaveOrLoad(const char *filename, int mode, GameMode newgm, Subdirectory subdir);
+	extern void StateGameLoop();
+
+	FILE *f = FioFOpenFile(logfile, "rb", AUTOSAVE_DIR);
+	if (f == NULL) f = FioFOpenFile(logfile, "rb", BASE_DIR);
+	if (f == NULL) {
+		IConsolePrintF(CC_ERROR, "Cannot open command log '%s'.", logfile);
+		return false;
+	}
+
+	if (!SafeSaveOrLoad(savegame, SL_LOAD, GM_NORMAL, SAVE_DIR)) {
+		IConsolePrintF(CC_ERROR, "Cannot load savegame '%s'.", savegame);
+		fclose(f);
+		return false;
+	}
+	SetLocalCompany(COMPANY_SPECTATOR);
+
+	/* The commands of the AIs are in the log already; running the AIs would execute them twice */
+	_replaying_commands = true;
+
+	Date ok_date = _date;
+	DateFract ok_date_fract = _date_fract;
+	uint commands = 0;
+	uint checks = 0;
+	bool result = true;
+
+	char line[512];
+	ReplayEntry entry;
+	while (fgets(line, lengthof(line), f) != NULL) {
+		if (!ParseLogLine(line, &entry)) continue;
+
+		/* Everything before the savegame has already happened */
+		if (IsBefore(entry.date, entry.date_fract, _date, _date_fract)) continue;
+
+		/* Run the game till the moment the entry was logged */
+		while (IsBefore(_date, _date_fract, entry.date, entry.date_fract)) {
+			if (_pause_game) break;
+			StateGameLoop();
+		}
+		if (_date != entry.date || _date_fract != entry.date_fract) {
+			IConsolePrintF(CC_ERROR, "Cannot reach date %08x; %08x as the game is paused.", entry.date, entry.date_fract);
+			result = false;
+			break;
+		}
+
+		if (entry.is_command) {
+			CompanyID old_company = _current_company;
+			_current_company = entry.company;
+			DoCommandP(entry.tile, entry.p1, entry.p2, entry.cmd, NULL, StrEmpty(entry.text) ? NULL : entry.text, false);
+			_current_company = old_company;
+			commands++;
+			continue;
+		}
+
+		StateHash hash;
+		CalcStateHash(&hash);
+		checks++;
+
+		if (memcmp(&hash, &entry.hash, sizeof(hash)) == 0) {
+			ok_date = _date;
+			ok_date_fract = _date_fract;
+			continue;
+		}
+
+		IConsolePrintF(CC_ERROR, "State diverged after %08x; %08x and at or before %08x; %08x.", ok_date, ok_date_fract, _date, _date_fract);
+		for (uint i = 0; i < SHP_END; i++) {
+			if (hash.part[i] == entry.hash.part[i]) continue;
+			IConsolePrintF(CC_ERROR, "  %s: logged %08x, replayed %08x", _state_hash_part_names[i], entry.hash.part[i], hash.part[i]);
+		}
+		result = false;
+		break;
+	}
+
+	_replaying_commands = false;
+	fclose(f);
+
+	IConsolePrintF(CC_DEFAULT, "Replayed %d commands and checked %d state hashes.", commands, checks);
+	return result;
+}
@@ -0,0 +1,29 @@
+/* $Id$ */
+
+/** @file state_hash.h Hashing of the game state to find the origin of desyncs. */
+
+#ifndef STATE_HASH_H
+#define STATE_HASH_H
+
+/** The parts of the game state that are hashed separately. */
+enum StateHashPart {
+	SHP_MAP,       ///< A slice of the map array
+	SHP_VEHICLES,  ///< The positions and speeds of all vehicles
+	SHP_CARGO,     ///< The amount of cargo in vehicles and stations
+	SHP_COMPANIES, ///< The money of the companies
+	SHP_RANDOM,    ///< The state of the game's randomizer
+	SHP_END,       ///< So we know how many parts there are
+};
+
+/** The hashes of all parts of the game state at a single moment. */
+struct StateHash {
+	uint32 part[SHP_END]; ///< The hash of each StateHashPart
+};
+
+extern bool _replaying_commands;
+
+void CalcStateHash(StateHash *hash);
+void StateHashLoop();
+bool ReplayCommandLog(const char *savegame, const char *logfile);
+
+#endif /* STATE_HASH_H */
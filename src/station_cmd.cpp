@@ -1522,6 +1522,7 @@ CommandCost CmdBuildRoadStop(TileIndex tile, DoCommandFlag flags, uint32 p1, uin
 		} else {
 			MakeRoadStop(tile, st->owner, st->index, rs_type, rts, (DiagDirection)p1);
 		}
+		YapfNotifyRoadLayoutChange();
 
 		UpdateStationVirtCoordDirty(st);
 		UpdateStationAcceptance(st, false);
@@ -1606,6 +1607,7 @@ static CommandCost RemoveRoadStop(Station *st, DoCommandFlag flags, TileIndex ti
 
 		DoClearSquare(tile);
 		st->rect.AfterRemoveTile(st, tile);
+		YapfNotifyRoadLayoutChange();
 
 		UpdateStationVirtCoordDirty(st);
 		DeleteStationIfEmpty(st);
@@ -2092,6 +2094,7 @@ CommandCost CmdBuildBuoy(TileIndex tile, DoCommandFlag flags, uint32 p1, uint32
 		st->build_date = _date;
 
 		MakeBuoy(tile, st->index, GetWaterClass(tile));
+		YapfNotifyWaterLayoutChange(tile);
 
 		UpdateStationVirtCoordDirty(st);
 		UpdateStationAcceptance(st, false);
@@ -2261,6 +2264,8 @@ CommandCost CmdBuildDock(TileIndex tile, DoCommandFlag flags, uint32 p1, uint32
 				_dock_w_chk[direction], _dock_h_chk[direction], StationRect::ADD_TRY);
 
 		MakeDock(tile, st->owner, st->index, direction, wc);
+		YapfNotifyWaterLayoutChange(tile);
+		YapfNotifyWaterLayoutChange(tile + TileOffsByDiagDir(direction));
 
 		UpdateStationVirtCoordDirty(st);
 		UpdateStationAcceptance(st, false);
@@ -3084,6 +3089,7 @@ void BuildOilRig(TileIndex tile)
 
 	assert(IsTileType(tile, MP_INDUSTRY));
 	MakeOilrig(tile, st->index, GetWaterClass(tile));
+	YapfNotifyWaterLayoutChange(tile);
 
 	st->owner = OWNER_NONE;
 	st->airport_flags = 0;
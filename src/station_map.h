@@ -235,6 +235,7 @@ static inline void SetRailwayStationReservation(TileIndex t, bool b)
 {
 	assert(IsRailwayStationTile(t));
 	SB(_m[t].m6, 2, 1, b ? 1 : 0);
+	InvalidateFollowedReservations(t);
 }
 
 /**
@@ -915,6 +915,9 @@ enum Sprites {
 	SPR_VEH_BUS_SW_VIEW   = 3097,
 	SPR_VEH_BUS_SIDE_VIEW = 3098,
 
+	/* First sprite of the original vehicles; they end with the rotor sprites */
+	SPR_ORIGINAL_VEHICLES_BASE = 2733,
+
 	/* Rotor sprite numbers */
 	SPR_ROTOR_STOPPED   = 3901,
 	SPR_ROTOR_MOVING_1  = 3902,
@@ -12,6 +12,7 @@
 #include "engine_base.h"
 #include "company_func.h"
 #include "depot_base.h"
+#include "depot_func.h"
 #include "vehicle_gui.h"
 #include "train.h"
 #include "newgrf_engine.h"
@@ -43,6 +44,7 @@ static void TrainController(Vehicle *v, Vehicle *nomove);
 static TileIndex TrainApproachingCrossingTile(const Vehicle *v);
 static void CheckIfTrainNeedsService(Vehicle *v);
 static void CheckNextTrainTile(Vehicle *v);
+static inline bool CheckCompatibleRail(const Vehicle *v, TileIndex tile);
 
 static const byte _vehicle_initial_x_fract[4] = {10, 8, 4,  8};
 static const byte _vehicle_initial_y_fract[4] = { 8, 4, 8, 10};
@@ -227,6 +229,9 @@ void TrainConsistChanged(Vehicle *v, bool same_length)
 
 	bool train_can_tilt = true;
 
+	/* The properties of the vehicles might be different in the new consist */
+	InvalidateVehicleCallbackCache();
+
 	for (Vehicle *u = v; u != NULL; u = u->Next()) {
 		const RailVehicleInfo *rvi_u = RailVehInfo(u->engine_type);
 
@@ -2125,6 +2130,9 @@ static TrainFindDepotData FindClosestTrainDepot(Vehicle *v, int max_distance)
 
 	tfdd.best_length = UINT_MAX;
 
+	/* No need to search when the train is not connected to any depot. */
+	if (GetRailDepotDistance(v->tile) == UINT_MAX) return tfdd;
+
 	uint8 pathfinder = _settings_game.pf.pathfinder_for_trains;
 	if ((_settings_game.pf.reserve_paths || HasReservedTracks(v->tile, v->u.rail.track)) && pathfinder == VPF_NTP) pathfinder = VPF_NPF;
 
@@ -2856,6 +2864,241 @@ public:
 	}
 };
 
+/** Number of threads computing the track choices of the trains at the start of a tick. */
+static const uint TRAIN_PATHFINDER_THREADS = 4;
+/** Minimum number of track choices to start the threads for; fewer are computed right away. */
+static const uint TRAIN_PATHFINDER_MIN_THREADED = 8;
+
+/**
+ * A track choice a train is expected to make during the current tick,
+ * computed before the trains move. It is only used when the train
+ * makes the choice with exactly the same input.
+ */
+struct TrainPathRequest {
+	VehicleID veh;          ///< The front engine of the train
+	TileIndex from_tile;    ///< Tile the train is on when making the choice
+	TileIndex tile;         ///< Tile the train is about to enter
+	DiagDirection enterdir; ///< Direction the train enters the tile in
+	TrackBits tracks;       ///< Tracks to choose from
+	uint32 order;           ///< Packed current order of the train
+	TileIndex dest_tile;    ///< Destination tile of the train
+	Track best_track;       ///< The chosen track
+	bool path_not_found;    ///< The chosen track is only a guess
+	bool used;              ///< Whether the train made the choice
+};
+
+/** The track choices of the current tick, sorted by vehicle index. */
+static SmallVector<TrainPathRequest, 64> _train_path_requests;
+
+/**
+ * Predict the track choice the train will make during this tick, if any.
+ * @param v the front engine of the train
+ * @param req [out] the choice to compute
+ * @return true if the train is expected to choose a track without reserving it
+ */
+static bool PredictTrainPathRequest(const Vehicle *v, TrainPathRequest *req)
+{
+	if (v->vehstatus & VS_CRASHED) return false;
+	if (v->vehstatus & VS_STOPPED && v->cur_speed == 0) return false;
+	if (v->breakdown_ctr != 0 || HasBit(v->u.rail.flags, VRF_REVERSING) || HasBit(v->u.rail.flags, VRF_TRAIN_STUCK)) return false;
+	if (v->u.rail.track == TRACK_BIT_WORMHOLE || v->u.rail.track == TRACK_BIT_DEPOT) return false;
+	if (IsTileType(v->tile, MP_TUNNELBRIDGE)) return false;
+
+	/* ChooseTrainTrack looks at the next order in these cases. */
+	if (v->current_order.IsType(OT_LEAVESTATION) || v->current_order.IsType(OT_LOADING)) return false;
+	if (!v->current_order.IsType(OT_GOTO_DEPOT) && (v->current_order.IsType(OT_GOTO_STATION) ?
+			IsRailwayStationTile(v->tile) && v->current_order.GetDestination() == GetStationIndex(v->tile) :
+			v->tile == v->dest_tile)) {
+		return false;
+	}
+
+	/* Only trains that reach the next tile this tick need to choose; one step
+	 * is at least 192 units of speed and the speed can't grow much in a tick. */
+	DiagDirection exitdir = TrackdirToExitdir(GetVehicleTrackdir(v));
+	uint steps = ((v->cur_speed + 16) * 3 / 4 + v->progress) / 192 + 1;
+	uint distance;
+	switch (exitdir) {
+		default: NOT_REACHED();
+		case DIAGDIR_NE: distance = (v->x_pos & (TILE_SIZE - 1)) + 1; break;
+		case DIAGDIR_SE: distance = TILE_SIZE - (v->y_pos & (TILE_SIZE - 1)); break;
+		case DIAGDIR_SW: distance = TILE_SIZE - (v->x_pos & (TILE_SIZE - 1)); break;
+		case DIAGDIR_NW: distance = (v->y_pos & (TILE_SIZE - 1)) + 1; break;
+	}
+	if (distance > steps) return false;
+
+	/* The same tracks as TrainController offers ChooseTrainTrack. */
+	TileIndex tile = v->tile + TileOffsByDiagDir(exitdir);
+	if (!IsValidTile(tile)) return false;
+	TrackStatus ts = GetTileTrackStatus(tile, TRANSPORT_RAIL, 0, ReverseDiagDir(exitdir));
+	TrackBits tracks = TrackdirBitsToTrackBits(TrackStatusToTrackdirBits(ts) & DiagdirReachesTrackdirs(exitdir));
+	if (_settings_game.pf.forbid_90_deg) tracks &= ~TrackCrossesTracks(FindFirstTrack(v->u.rail.track));
+
+	/* Nothing to choose, or ChooseTrainTrack follows a reservation or reserves itself. */
+	if (KillFirstBit(tracks) == TRACK_BIT_NONE) return false;
+	if ((GetReservedTrackbits(tile) & DiagdirReachesTracks(exitdir)) != TRACK_BIT_NONE) return false;
+	if (!CheckCompatibleRail(v, tile)) return false;
+
+	req->veh = v->index;
+	req->from_tile = v->tile;
+	req->tile = tile;
+	req->enterdir = exitdir;
+	req->tracks = tracks;
+	req->order = v->current_order.Pack();
+	req->dest_tile = v->dest_tile;
+	req->used = false;
+	return true;
+}
+
+/** Compute every step-th track choice of the tick, starting with the given one. */
+static void ComputeTrainPathRequests(uint first, uint step)
+{
+	for (uint i = first; i < _train_path_requests.Length(); i += step) {
+		TrainPathRequest *req = _train_path_requests.Get(i);
+		Trackdir trackdir = YapfChooseRailTrackConcurrent(GetVehicle(req->veh), req->tile, req->enterdir, req->tracks, &req->path_not_found);
+		req->best_track = (trackdir != INVALID_TRACKDIR) ? TrackdirToTrack(trackdir) : FindFirstTrack(req->tracks);
+	}
+}
+
+/** Thread computing its share of the track choices of the tick. */
+static void TrainPathfinderThread(void *data)
+{
+	ComputeTrainPathRequests((uint)(size_t)data, TRAIN_PATHFINDER_THREADS);
+}
+
+/** Compare the track choices computed by the threads with choices computed one after the other. */
+static void CheckTrainPathRequests()
+{
+	for (uint i = 0; i < _train_path_requests.Length(); i++) {
+		const TrainPathRequest *req = _train_path_requests.Get(i);
+		bool path_not_found;
+		Trackdir trackdir = YapfChooseRailTrackConcurrent(GetVehicle(req->veh), req->tile, req->enterdir, req->tracks, &path_not_found);
+		Track best_track = (trackdir != INVALID_TRACKDIR) ? TrackdirToTrack(trackdir) : FindFirstTrack(req->tracks);
+		if (best_track != req->best_track || path_not_found != req->path_not_found) {
+			DEBUG(desync, 0, "train %d at tile 0x%X: batched track choice %d/%d differs from serial %d/%d",
+				req->veh, req->tile, req->best_track, req->path_not_found, best_track, path_not_found);
+		}
+	}
+}
+
+/**
+ * Compute the track choices the trains without path reservation are about
+ * to make during this tick, before any of them moves. The map doesn't change
+ * while they are computed, so the choices only depend on the game state and
+ * not on the number of threads used. The results are only used by trains
+ * that make the choice with the same input later on in the tick; any other
+ * choice is made by the pathfinder as usual.
+ */
+void StartTrainPathfindingBatch()
+{
+	static ThreadMutex *mutex = NULL;
+	static uint computed = 0;
+	static uint used = 0;
+	static Date last_date = 0;
+
+	/* some statistics */
+	for (const TrainPathRequest *req = _train_path_requests.Begin(); req != _train_path_requests.End(); req++) {
+		if (req->used) used++;
+	}
+	if (last_date != _date) {
+		last_date = _date;
+		if (computed != 0) DEBUG(yapf, 2, "Train path batches today: %u choices computed, %u used", computed, used);
+		computed = 0;
+		used = 0;
+	}
+
+	_train_path_requests.Clear();
+
+	if (!_settings_game.pf.yapf.rail_parallel_pathfinding) return;
+	if (_settings_game.pf.pathfinder_for_trains != VPF_YAPF || _settings_game.pf.reserve_paths) return;
+
+	const Vehicle *v;
+	FOR_ALL_VEHICLES(v) {
+		if (v->type != VEH_TRAIN || !IsFrontEngine(v)) continue;
+
+		TrainPathRequest req;
+		if (PredictTrainPathRequest(v, &req)) *_train_path_requests.Append() = req;
+	}
+
+	uint num_requests = _train_path_requests.Length();
+	computed += num_requests;
+
+	/* The searches may not update the landmarks on their own threads. */
+	if (_settings_game.pf.yapf.rail_use_landmarks) YapfUpdateRailLandmarks();
+	if (num_requests < TRAIN_PATHFINDER_MIN_THREADED) {
+		ComputeTrainPathRequests(0, 1);
+		return;
+	}
+
+	if (mutex == NULL) mutex = ThreadMutex::New();
+	_yapf_node_list_mutex = mutex;
+
+	ThreadObject *threads[TRAIN_PATHFINDER_THREADS];
+	for (uint i = 1; i < TRAIN_PATHFINDER_THREADS; i++) {
+		if (!ThreadObject::New(&TrainPathfinderThread, (void *)(size_t)i, &threads[i])) threads[i] = NULL;
+	}
+	ComputeTrainPathRequests(0, TRAIN_PATHFINDER_THREADS);
+	for (uint i = 1; i < TRAIN_PATHFINDER_THREADS; i++) {
+		if (threads[i] == NULL) {
+			/* No thread could be started, so do its share here. */
+			ComputeTrainPathRequests(i, TRAIN_PATHFINDER_THREADS);
+			continue;
+		}
+		threads[i]->Join();
+		delete threads[i];
+	}
+
+	_yapf_node_list_mutex = NULL;
+
+	if (_debug_desync_level >= 2) CheckTrainPathRequests();
+}
+
+/** Forget the track choices of this tick, so nothing outside the vehicle ticks uses them. */
+void EndTrainPathfindingBatch()
+{
+	for (TrainPathRequest *req = _train_path_requests.Begin(); req != _train_path_requests.End(); req++) {
+		/* Keep the requests for the statistics, but don't let them match anymore. */
+		req->tile = INVALID_TILE;
+	}
+}
+
+/**
+ * Take the track choice computed at the start of the tick, if the train
+ * makes it with exactly the same input.
+ * @param v the train
+ * @param tile the tile the train is about to enter
+ * @param enterdir the direction the train enters the tile in
+ * @param tracks the tracks to choose from
+ * @param best_track [out] the chosen track
+ * @param path_not_found [out] whether the chosen track is only a guess
+ * @return true if the choice was computed before
+ */
+static bool TakeTrainPathRequest(const Vehicle *v, TileIndex tile, DiagDirection enterdir, TrackBits tracks, Track *best_track, bool *path_not_found)
+{
+	/* The requests are sorted by vehicle index. */
+	uint lo = 0;
+	uint hi = _train_path_requests.Length();
+	while (lo < hi) {
+		uint mid = (lo + hi) / 2;
+		if (_train_path_requests.Get(mid)->veh < v->index) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	if (lo == _train_path_requests.Length()) return false;
+
+	TrainPathRequest *req = _train_path_requests.Get(lo);
+	if (req->veh != v->index || req->used || req->tile != tile || req->enterdir != enterdir || req->tracks != tracks ||
+			req->from_tile != v->tile || req->order != v->current_order.Pack() || req->dest_tile != v->dest_tile) {
+		return false;
+	}
+
+	req->used = true;
+	*best_track = req->best_track;
+	*path_not_found = req->path_not_found;
+	return true;
+}
+
 /* choose a track */
 static Track ChooseTrainTrack(Vehicle *v, TileIndex tile, DiagDirection enterdir, TrackBits tracks, bool force_res, bool *got_reservation, bool mark_stuck)
 {
@@ -2927,7 +3170,10 @@ static Track ChooseTrainTrack(Vehicle *v, TileIndex tile, DiagDirection enterdir
 		bool      path_not_found = false;
 		TileIndex new_tile = res_dest.tile;
 
-		Track next_track = DoTrainPathfind(v, new_tile, dest_enterdir, tracks, &path_not_found, do_track_reservation, &res_dest);
+		Track next_track;
+		if (do_track_reservation || !TakeTrainPathRequest(v, new_tile, dest_enterdir, tracks, &next_track, &path_not_found)) {
+			next_track = DoTrainPathfind(v, new_tile, dest_enterdir, tracks, &path_not_found, do_track_reservation, &res_dest);
+		}
 		if (new_tile == tile) best_track = next_track;
 
 		/* handle "path not found" state */
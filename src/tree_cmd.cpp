@@ -21,6 +21,7 @@
 #include "water.h"
 #include "landscape_type.h"
 #include "company_base.h"
+#include "yapf/yapf.h"
 
 #include "table/strings.h"
 #include "table/sprites.h"
@@ -699,7 +700,7 @@ static void TileLoop_Trees(TileIndex tile)
 			} else {
 				/* just one tree, change type into MP_CLEAR */
 				switch (GetTreeGround(tile)) {
-					case TREE_GROUND_SHORE: MakeShore(tile); break;
+					case TREE_GROUND_SHORE: MakeShore(tile); YapfNotifyWaterLayoutChange(tile); break;
 					case TREE_GROUND_GRASS: MakeClear(tile, CLEAR_GRASS, GetTreeDensity(tile)); break;
 					case TREE_GROUND_ROUGH: MakeClear(tile, CLEAR_ROUGH, 3); break;
 					default: // snow or desert
@@ -364,11 +364,14 @@ CommandCost CmdBuildBridge(TileIndex end_tile, DoCommandFlag flags, uint32 p1, u
 			case TRANSPORT_ROAD:
 				MakeRoadBridgeRamp(tile_start, owner, bridge_type, dir,                 roadtypes);
 				MakeRoadBridgeRamp(tile_end,   owner, bridge_type, ReverseDiagDir(dir), roadtypes);
+				YapfNotifyRoadLayoutChange();
 				break;
 
 			case TRANSPORT_WATER:
 				MakeAqueductBridgeRamp(tile_start, owner, dir);
 				MakeAqueductBridgeRamp(tile_end,   owner, ReverseDiagDir(dir));
+				YapfNotifyWaterLayoutChange(tile_start);
+				YapfNotifyWaterLayoutChange(tile_end);
 				break;
 
 			default:
@@ -571,6 +574,7 @@ CommandCost CmdBuildTunnel(TileIndex start_tile, DoCommandFlag flags, uint32 p1,
 		} else {
 			MakeRoadTunnel(start_tile, _current_company, direction,                 (RoadTypes)GB(p1, 0, 2));
 			MakeRoadTunnel(end_tile,   _current_company, ReverseDiagDir(direction), (RoadTypes)GB(p1, 0, 2));
+			YapfNotifyRoadLayoutChange();
 		}
 	}
 
@@ -665,6 +669,7 @@ static CommandCost DoClearTunnel(TileIndex tile, DoCommandFlag flags)
 		} else {
 			DoClearSquare(tile);
 			DoClearSquare(endtile);
+			YapfNotifyRoadLayoutChange();
 		}
 	}
 	return CommandCost(EXPENSES_CONSTRUCTION, _price.clear_tunnel * (GetTunnelBridgeLength(tile, endtile) + 2));
@@ -738,6 +743,8 @@ static CommandCost DoClearBridge(TileIndex tile, DoCommandFlag flags)
 			YapfNotifyTrackLayoutChange(endtile, track);
 
 			if (v != NULL) TryPathReserve(v, true);
+		} else {
+			YapfNotifyRoadLayoutChange();
 		}
 	}
 
@@ -37,6 +37,8 @@
 #include "depot_func.h"
 #include "settings_type.h"
 #include "network/network.h"
+#include "pathfinder_stats.h"
+#include "pbs.h"
 
 #include "table/sprites.h"
 #include "table/strings.h"
@@ -195,6 +197,7 @@ Vehicle::Vehicle()
 	this->fill_percent_te_id = INVALID_TE_ID;
 	this->first              = this;
 	this->colourmap          = PAL_NONE;
+	memset(this->cb_cache, 0, sizeof(this->cb_cache));
 }
 
 /**
@@ -523,6 +526,9 @@ bool IsEngineCountable(const Vehicle *v)
 
 void Vehicle::PreDestructor()
 {
+	ForgetPathfinderStatsVehicle(this);
+	ForgetFollowedReservation(this);
+
 	if (CleaningPool()) return;
 
 	if (IsValidStationID(this->last_station_visited)) {
@@ -621,8 +627,14 @@ void CallVehicleTicks()
 	Station *st;
 	FOR_ALL_STATIONS(st) LoadUnloadStation(st);
 
+	/* Only memoise callbacks while ticking the vehicles; this happens
+	 * in exactly the same order on all clients. */
+	SetVehicleCallbackCacheActive(true);
+	StartTrainPathfindingBatch();
+
 	Vehicle *v;
 	FOR_ALL_VEHICLES(v) {
+		_pathfinder_stats_vehicle = v;
 		v->Tick();
 
 		switch (v->type) {
@@ -645,6 +657,10 @@ void CallVehicleTicks()
 		}
 	}
 
+	_pathfinder_stats_vehicle = NULL;
+	EndTrainPathfindingBatch();
+	SetVehicleCallbackCacheActive(false);
+
 	for (AutoreplaceMap::iterator it = _vehicles_to_autoreplace.Begin(); it != _vehicles_to_autoreplace.End(); it++) {
 		v = it->first;
 		/* Autoreplace needs the current company set as the vehicle owner */
@@ -158,6 +158,9 @@ struct VehicleAir {
 	byte state;
 };
 
+/** Number of junctions of the path of a road vehicle that are remembered, @see VehicleRoad::path_tile */
+static const uint RV_PATH_CACHE_LENGTH = 8;
+
 struct VehicleRoad {
 	byte state;             ///< @see RoadVehicleStates
 	byte frame;
@@ -173,6 +176,14 @@ struct VehicleRoad {
 
 	RoadType roadtype;
 	RoadTypes compatible_roadtypes;
+
+	/* The junctions of the last path found by YAPF, and the trackdir to take on each of them.
+	 * They are saved, so clients that join a game follow the same paths as the server. */
+	TileIndex path_dest;                             ///< Destination of the cached path
+	TileIndex path_tile[RV_PATH_CACHE_LENGTH];       ///< Junction tiles of the cached path, in the order they are passed
+	TrackdirByte path_trackdir[RV_PATH_CACHE_LENGTH]; ///< Trackdir to take on each of the junction tiles
+	byte path_length;                                ///< Number of junctions in the cached path; 0 when there is none
+	byte path_pos;                                   ///< Index of the next junction of the cached path
 };
 
 struct VehicleEffect {
@@ -189,6 +200,14 @@ struct VehicleShip {
 	TrackBitsByte state;
 };
 
+/** A result of a vehicle callback that is memoised for the rest of the tick. */
+struct VehicleCallbackCacheEntry {
+	uint32 generation; ///< The generation of the callback cache the result belongs to
+	uint16 callback;   ///< The callback that was evaluated
+	uint16 param;      ///< The first parameter of the callback
+	uint16 result;     ///< The value the callback returned
+};
+
 DECLARE_OLD_POOL(Vehicle, Vehicle, 9, 125)
 
 /* Some declarations of functions, so we can make them friendly */
@@ -283,6 +302,7 @@ public:
 	 * of corresponding spritegroups get matched */
 	byte random_bits;
 	byte waiting_triggers;   ///< triggers to be yet matched
+	mutable VehicleCallbackCacheEntry cb_cache[4]; ///< NOSAVE: callback results of the current tick, @see GetVehicleCallback
 
 	StationID last_station_visited;
 
@@ -33,6 +33,7 @@
 #include "effectvehicle_func.h"
 #include "tunnelbridge_map.h"
 #include "ai/ai.hpp"
+#include "yapf/yapf.h"
 
 #include "table/sprites.h"
 #include "table/strings.h"
@@ -137,6 +138,8 @@ CommandCost CmdBuildShipDepot(TileIndex tile, DoCommandFlag flags, uint32 p1, ui
 		MakeShipDepot(tile2, _current_company, DEPOT_SOUTH, axis, wc2);
 		MarkTileDirtyByTile(tile);
 		MarkTileDirtyByTile(tile2);
+		YapfNotifyWaterLayoutChange(tile);
+		YapfNotifyWaterLayoutChange(tile2);
 	}
 
 	return CommandCost(EXPENSES_CONSTRUCTION, _price.build_ship_depot);
@@ -160,6 +163,7 @@ void MakeWaterKeepingClass(TileIndex tile, Owner o)
 		case WATER_CLASS_RIVER: MakeRiver(tile, Random());    break;
 		default:                DoClearSquare(tile);          break;
 	}
+	YapfNotifyWaterLayoutChange(tile);
 }
 
 static CommandCost RemoveShipDepot(TileIndex tile, DoCommandFlag flags)
@@ -227,6 +231,9 @@ static CommandCost DoBuildShiplift(TileIndex tile, DiagDirection dir, DoCommandF
 		MarkTileDirtyByTile(tile);
 		MarkTileDirtyByTile(tile - delta);
 		MarkTileDirtyByTile(tile + delta);
+		YapfNotifyWaterLayoutChange(tile);
+		YapfNotifyWaterLayoutChange(tile - delta);
+		YapfNotifyWaterLayoutChange(tile + delta);
 		MarkCanalsAndRiversAroundDirty(tile - delta);
 		MarkCanalsAndRiversAroundDirty(tile + delta);
 	}
@@ -330,6 +337,7 @@ CommandCost CmdBuildCanal(TileIndex tile, DoCommandFlag flags, uint32 p1, uint32
 				MakeCanal(tile, _current_company, Random());
 			}
 			MarkTileDirtyByTile(tile);
+			YapfNotifyWaterLayoutChange(tile);
 			MarkCanalsAndRiversAroundDirty(tile);
 		}
 
@@ -950,6 +958,7 @@ void DoFloodTile(TileIndex target)
 	if (flooded) {
 		/* Mark surrounding canal tiles dirty too to avoid glitches */
 		MarkCanalsAndRiversAroundDirty(target);
+		YapfNotifyWaterLayoutChange(target);
 
 		/* update signals if needed */
 		UpdateSignalsInBuffer();
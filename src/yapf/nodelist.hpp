@@ -5,10 +5,103 @@
 #ifndef  NODELIST_HPP
 #define  NODELIST_HPP
 
-#include "../misc/array.hpp"
+#include "../core/alloc_func.hpp"
+#include "../thread.h"
 #include "../misc/hashtable.hpp"
 #include "../misc/binaryheap.hpp"
 
+/** Mutex guarding the free node list arenas while pathfinders run on several threads, NULL otherwise. */
+extern ThreadMutex *_yapf_node_list_mutex;
+
+/** Number of nodes a free node list arena keeps the memory for. */
+static const int YAPF_ARENA_KEEP_NODES = 4096;
+/** Node list arenas whose hash tables have more slots than this are freed after their search. */
+static const int YAPF_ARENA_KEEP_SLOTS = 1 << 17;
+
+/** Function freeing all free arenas of a node list type. */
+typedef void YapfFreeArenasProc();
+void YapfRegisterNodeListArenas(YapfFreeArenasProc *proc);
+
+/** Array of nodes whose memory blocks are kept when it is cleared,
+ *  so the following searches don't have to allocate them again. */
+template <class Titem_, int Tblock_size_, int Tnum_blocks_>
+class CNodeArrayT {
+public:
+	typedef Titem_ Titem;
+	static const int Tblock_size = Tblock_size_; ///< number of items in one block
+	static const int Tnum_blocks = Tnum_blocks_; ///< maximum number of blocks
+	static const int Tcapacity   = Tblock_size * Tnum_blocks; ///< total max number of items
+
+protected:
+	Titem_ *m_blocks[Tnum_blocks_]; ///< allocated blocks of (not constructed) items
+	int     m_num_blocks;           ///< number of allocated blocks
+	int     m_num_items;            ///< number of constructed items
+
+public:
+	CNodeArrayT() : m_num_blocks(0), m_num_items(0) {}
+
+	~CNodeArrayT()
+	{
+		Clear();
+		for (int i = 0; i < m_num_blocks; i++) free(m_blocks[i]);
+	}
+
+	/** destroy all items, but keep the blocks for reuse */
+	FORCEINLINE void Clear()
+	{
+		for (int i = m_num_items - 1; i >= 0; i--) (*this)[i].~Titem_();
+		m_num_items = 0;
+	}
+
+	/** free the blocks beyond the given number of blocks; the array must be empty */
+	void Compact(int max_blocks)
+	{
+		assert(m_num_items == 0);
+		while (m_num_blocks > max_blocks) free(m_blocks[--m_num_blocks]);
+	}
+
+	/** return actual number of items */
+	FORCEINLINE int Size() const { return m_num_items; }
+
+	/** allocate and construct new item */
+	FORCEINLINE Titem_& Add()
+	{
+		int block = m_num_items / Tblock_size;
+		if (block == m_num_blocks) {
+			assert(m_num_blocks < Tnum_blocks);
+			m_blocks[m_num_blocks++] = MallocT<Titem_>(Tblock_size);
+		}
+		Titem_& item = m_blocks[block][m_num_items++ % Tblock_size];
+		new (&item) Titem_;
+		return item;
+	}
+
+	/** indexed access (non-const) */
+	FORCEINLINE Titem_& operator [] (int idx)
+	{
+		assert(idx >= 0 && idx < m_num_items);
+		return m_blocks[idx / Tblock_size][idx % Tblock_size];
+	}
+
+	/** indexed access (const) */
+	FORCEINLINE const Titem_& operator [] (int idx) const
+	{
+		assert(idx >= 0 && idx < m_num_items);
+		return m_blocks[idx / Tblock_size][idx % Tblock_size];
+	}
+
+	template <typename D> void Dump(D &dmp) const
+	{
+		dmp.WriteLine("capacity = %d", Tcapacity);
+		dmp.WriteLine("num_items = %d", m_num_items);
+		CStrA name;
+		for (int i = 0; i < m_num_items; i++) {
+			name.Format("item[%d]", i);
+			dmp.WriteStructT(name.Data(), &(*this)[i]);
+		}
+	}
+};
+
 /** Hash table based node list multi-container class.
  *  Implements open list, closed list and priority queue for A-star
  *  path finder. */
@@ -20,7 +113,7 @@ public:
 	/** make Titem_::Key a property of HashTable */
 	typedef typename Titem_::Key Key;
 	/** type that we will use as item container */
-	typedef CArrayT<Titem_, 65536, 256> CItemArray;
+	typedef CNodeArrayT<Titem_, 4096, 4096> CItemArray;
 	/** how pointers to open nodes will be stored */
 	typedef CHashTableT<Titem_, Thash_bits_open_  > COpenList;
 	/** how pointers to closed nodes will be stored */
@@ -28,28 +121,109 @@ public:
 	/** how the priority queue will be managed */
 	typedef CBinaryHeapT<Titem_> CPriorityQueue;
 
+	/** All containers of one node list. They are kept between the searches,
+	 *  so a new search neither allocates nor clears them; the hash tables
+	 *  forget their items by starting a new generation of their slots.
+	 *  The free arenas are shared by all threads through a list guarded by
+	 *  _yapf_node_list_mutex instead of being thread-local, as not every
+	 *  compiler this is built with supports thread-local storage. */
+	struct CArena {
+		CItemArray     m_arr;
+		COpenList      m_open;
+		CClosedList    m_closed;
+		CPriorityQueue m_open_queue;
+		CArena        *m_next_free; ///< next arena waiting for a search
+
+		CArena() : m_open_queue(204800) {}
+
+		/** forget all nodes of the finished search */
+		void Clear()
+		{
+			m_open_queue.Clear();
+			m_open.Clear();
+			m_closed.Clear();
+			m_arr.Clear();
+		}
+
+		/** free the memory of the nodes beyond what the next searches usually need */
+		void Compact()
+		{
+			m_open_queue.Compact(YAPF_ARENA_KEEP_NODES);
+			m_arr.Compact((YAPF_ARENA_KEEP_NODES + CItemArray::Tblock_size - 1) / CItemArray::Tblock_size);
+		}
+	};
+
 protected:
+	/** arenas of the finished searches of this node list type, waiting for the next searches */
+	static CArena        *s_free_arenas;
+	/** whether FreeArenas has been registered, so the free arenas are freed with the game */
+	static bool           s_registered;
+	/** arena with the containers used by this node list */
+	CArena               *m_arena;
 	/** here we store full item data (Titem_) */
-	CItemArray            m_arr;
+	CItemArray           &m_arr;
 	/** hash table of pointers to open item data */
-	COpenList             m_open;
+	COpenList            &m_open;
 	/** hash table of pointers to closed item data */
-	CClosedList           m_closed;
+	CClosedList          &m_closed;
 	/** priority queue of pointers to open item data */
-	CPriorityQueue        m_open_queue;
+	CPriorityQueue       &m_open_queue;
 	/** new open node under construction */
 	Titem                *m_new_node;
+
+	/** take a free arena, or make a new one when all arenas of this type are in use */
+	static CArena *AcquireArena()
+	{
+		if (_yapf_node_list_mutex != NULL) _yapf_node_list_mutex->BeginCritical();
+		CArena *arena = s_free_arenas;
+		if (arena != NULL) s_free_arenas = arena->m_next_free;
+		if (_yapf_node_list_mutex != NULL) _yapf_node_list_mutex->EndCritical();
+
+		return (arena != NULL) ? arena : new CArena();
+	}
+
+	/** free all arenas of this node list type waiting for a search */
+	static void FreeArenas()
+	{
+		while (s_free_arenas != NULL) {
+			CArena *arena = s_free_arenas;
+			s_free_arenas = arena->m_next_free;
+			delete arena;
+		}
+	}
+
 public:
 	/** default constructor */
 	CNodeList_HashTableT()
-		: m_open_queue(204800)
+		: m_arena(AcquireArena())
+		, m_arr(m_arena->m_arr)
+		, m_open(m_arena->m_open)
+		, m_closed(m_arena->m_closed)
+		, m_open_queue(m_arena->m_open_queue)
 	{
 		m_new_node = NULL;
 	}
 
-	/** destructor */
+	/** destructor - hand the arena over to the next search */
 	~CNodeList_HashTableT()
 	{
+		/* Don't keep the hash tables of the huge node lists around */
+		if (COpenList::Tcapacity + CClosedList::Tcapacity > YAPF_ARENA_KEEP_SLOTS) {
+			delete m_arena;
+			return;
+		}
+
+		m_arena->Clear();
+		m_arena->Compact();
+
+		if (_yapf_node_list_mutex != NULL) _yapf_node_list_mutex->BeginCritical();
+		m_arena->m_next_free = s_free_arenas;
+		s_free_arenas = m_arena;
+		if (!s_registered) {
+			YapfRegisterNodeListArenas(&FreeArenas);
+			s_registered = true;
+		}
+		if (_yapf_node_list_mutex != NULL) _yapf_node_list_mutex->EndCritical();
 	}
 
 	/** return number of open nodes */
@@ -154,4 +328,10 @@ public:
 	}
 };
 
+template <class Titem_, int Thash_bits_open_, int Thash_bits_closed_>
+typename CNodeList_HashTableT<Titem_, Thash_bits_open_, Thash_bits_closed_>::CArena *CNodeList_HashTableT<Titem_, Thash_bits_open_, Thash_bits_closed_>::s_free_arenas = NULL;
+
+template <class Titem_, int Thash_bits_open_, int Thash_bits_closed_>
+bool CNodeList_HashTableT<Titem_, Thash_bits_open_, Thash_bits_closed_>::s_registered = false;
+
 #endif /* NODELIST_HPP */
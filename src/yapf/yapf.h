@@ -20,12 +20,13 @@
 Trackdir YapfChooseShipTrack(const Vehicle *v, TileIndex tile, DiagDirection enterdir, TrackBits tracks);
 
 /** Finds the best path for given road vehicle.
+ * The junctions of the path are remembered in the RV, so the next junctions do not need a new search.
  * @param v        the RV that needs to find a path
  * @param tile     the tile to find the path from (should be next tile the RV is about to enter)
  * @param enterdir diagonal direction which the RV will enter this new tile from
  * @return         the best trackdir for next turn or INVALID_TRACKDIR if the path could not be found
  */
-Trackdir YapfChooseRoadTrack(const Vehicle *v, TileIndex tile, DiagDirection enterdir);
+Trackdir YapfChooseRoadTrack(Vehicle *v, TileIndex tile, DiagDirection enterdir);
 
 /** Finds the best path for given train.
  * @param v        the train that needs to find a path
@@ -39,6 +40,18 @@ Trackdir YapfChooseRoadTrack(const Vehicle *v, TileIndex tile, DiagDirection ent
  */
 Trackdir YapfChooseRailTrack(const Vehicle *v, TileIndex tile, DiagDirection enterdir, TrackBits tracks, bool *path_not_found, bool reserve_track, PBSTileInfo *target);
 
+/** Finds the best path for given train like YapfChooseRailTrack without reserving it.
+ *  Pathfinders of this kind can run on several threads at once as long as the map
+ *  and the vehicles don't change meanwhile and _yapf_node_list_mutex is set.
+ * @param v        the train that needs to find a path
+ * @param tile     the tile to find the path from (should be next tile the train is about to enter)
+ * @param enterdir diagonal direction which the train will enter this new tile from
+ * @param tracks   available trackdirs on the new tile (to choose from)
+ * @param path_not_found [out] true is returned if no path can be found (returned Trackdir is only a 'guess')
+ * @return         the best trackdir for next turn or INVALID_TRACKDIR if the path could not be found
+ */
+Trackdir YapfChooseRailTrackConcurrent(const Vehicle *v, TileIndex tile, DiagDirection enterdir, TrackBits tracks, bool *path_not_found);
+
 /** Used by RV multistop feature to find the nearest road stop that has a free slot.
  * @param v      RV (its current tile will be the origin)
  * @param tile   destination tile
@@ -80,6 +93,18 @@ bool YapfRailFindNearestSafeTile(const Vehicle *v, TileIndex tile, Trackdir td,
 /** Use this function to notify YAPF that track layout (or signal configuration) has change */
 void YapfNotifyTrackLayoutChange(TileIndex tile, Track track);
 
+/** Use this function to free the memory YAPF keeps between the searches, when a game is started, loaded or left */
+void YapfFreeNodeListArenas();
+
+/** Use this function to make sure the landmarks of the rail network are up to date, before searching paths on several threads */
+void YapfUpdateRailLandmarks();
+
+/** Use this function to notify YAPF that the road layout has changed, so the cached paths of the road vehicles are forgotten */
+void YapfNotifyRoadLayoutChange();
+
+/** Use this function to notify YAPF that ships may be able to travel differently over the given tile, or over the whole map when it is INVALID_TILE */
+void YapfNotifyWaterLayoutChange(TileIndex tile);
+
 /** performance measurement helpers */
 void *NpfBeginInterval();
 int NpfEndInterval(void *perf);
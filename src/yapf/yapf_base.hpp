@@ -7,8 +7,10 @@
 
 #include "../debug.h"
 #include "../settings_type.h"
+#include "../pathfinder_stats.h"
 
 extern int _total_pf_time_us;
+extern uint64 ottd_microseconds();
 
 /** CYapfBaseT - A-star type path finder base class.
  *  Derive your own pathfinder from it. You must provide the following template argument:
@@ -115,6 +117,9 @@ public:
 		CPerformanceTimer perf;
 		perf.Start();
 #endif /* !NO_DEBUG_MESSAGES */
+		bool recording = IsRecordingPathfinderStats();
+		uint64 stats_start = recording ? ottd_microseconds() : 0;
+		bool limit_reached = false;
 
 		Yapf().PfSetStartupNodes();
 
@@ -136,15 +141,26 @@ public:
 				m_nodes.InsertClosedNode(*n);
 			} else {
 				m_pBestDestNode = m_pBestIntermediateNode;
+				limit_reached = true;
 				break;
 			}
 		}
 
 		bool bDestFound = (m_pBestDestNode != NULL) && (m_pBestDestNode != m_pBestIntermediateNode);
 
+		if (recording) {
+			uint64 us = ottd_microseconds() - stats_start;
+			/* Searches may run on several threads at once. */
+			if (_yapf_node_list_mutex != NULL) _yapf_node_list_mutex->BeginCritical();
+			RecordPathfinderSearch(VPF_YAPF, TrackFollower::TT(), m_veh, us, m_nodes.ClosedCount(), bDestFound, limit_reached);
+			if (_yapf_node_list_mutex != NULL) _yapf_node_list_mutex->EndCritical();
+		}
+
 #ifndef NO_DEBUG_MESSAGES
 		perf.Stop();
-		if (_debug_yapf_level >= 2) {
+		/* Searches of a batch run on several threads at once; neither the
+		 * total time nor the debug output can be shared by them safely. */
+		if (_debug_yapf_level >= 2 && _yapf_node_list_mutex == NULL) {
 			int t = perf.Get(1000000);
 			_total_pf_time_us += t;
 
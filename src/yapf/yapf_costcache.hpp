@@ -153,9 +153,9 @@ public:
 	typedef CSegmentCostCacheT<CachedData> Cache;
 
 protected:
-	Cache&      m_global_cache;
+	Cache      *m_global_cache; ///< the global cache, only looked up once it is used
 
-	FORCEINLINE CYapfSegmentCostCacheGlobalT() : m_global_cache(stGetGlobalCache()) {};
+	FORCEINLINE CYapfSegmentCostCacheGlobalT() : m_global_cache(NULL) {};
 
 	/** to access inherited path finder */
 	FORCEINLINE Tpf& Yapf()
@@ -192,9 +192,10 @@ public:
 		if (!Yapf().CanUseGlobalCache(n)) {
 			return Tlocal::PfNodeCacheFetch(n);
 		}
+		if (m_global_cache == NULL) m_global_cache = &stGetGlobalCache();
 		CacheKey key(n.GetKey());
 		bool found;
-		CachedData& item = m_global_cache.Get(key, &found);
+		CachedData& item = m_global_cache->Get(key, &found);
 		Yapf().ConnectNodeToCachedData(n, item);
 		return found;
 	}
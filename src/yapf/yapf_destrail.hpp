@@ -117,6 +117,8 @@ protected:
 	TileIndex    m_destTile;
 	TrackdirBits m_destTrackdirs;
 	StationID    m_dest_station_id;
+	bool         m_use_landmarks;   ///< whether to use the landmarks for the estimate
+	RailLandmarkTarget m_landmarks; ///< distances from the landmarks to the destination
 
 	/** to access inherited path finder */
 	Tpf& Yapf()
@@ -158,6 +160,27 @@ public:
 				break;
 		}
 		CYapfDestinationRailBase::SetDestination(v);
+
+		m_use_landmarks = Yapf().PfGetSettings().rail_use_landmarks;
+		if (m_use_landmarks) SetLandmarkTarget();
+	}
+
+	/** Collect the distances from the landmarks to all destination tiles. */
+	void SetLandmarkTarget()
+	{
+		m_landmarks.Clear();
+		if (m_dest_station_id == INVALID_STATION) {
+			m_landmarks.AddTile(m_destTile);
+			return;
+		}
+
+		if (!IsValidStationID(m_dest_station_id)) return;
+		const Station *st = GetStation(m_dest_station_id);
+		if (st->train_tile == INVALID_TILE) return;
+
+		BEGIN_TILE_LOOP(tile, st->trainst_w, st->trainst_h, st->train_tile)
+			if (IsRailwayStationTile(tile) && GetStationIndex(tile) == m_dest_station_id) m_landmarks.AddTile(tile);
+		END_TILE_LOOP(tile, st->trainst_w, st->trainst_h, st->train_tile)
 	}
 
 	/** Called by YAPF to detect if node ends in the desired destination */
@@ -203,6 +226,16 @@ public:
 		int dmin = min(dx, dy);
 		int dxy = abs(dx - dy);
 		int d = dmin * YAPF_TILE_CORNER_LENGTH + (dxy - 1) * (YAPF_TILE_LENGTH / 2);
+		if (m_use_landmarks) {
+			/* Every tile on the way costs at least YAPF_TILE_CORNER_LENGTH, so the
+			 * estimate stays admissible and a found path is still a cheapest one.
+			 * The chosen path can still differ: another one of several equally cheap
+			 * paths may be found first, the destination may be found within
+			 * max_search_nodes where it wasn't before and, when it isn't found,
+			 * the best intermediate node is the one with the lowest estimate of
+			 * the remaining cost, which is now a different one. */
+			d = max(d, (int)m_landmarks.GetDistance(tile) * YAPF_TILE_CORNER_LENGTH);
+		}
 		n.m_estimate = n.m_cost + d;
 		assert(n.m_estimate >= n.m_parent->m_estimate);
 		return true;
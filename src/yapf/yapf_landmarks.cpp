@@ -0,0 +1,317 @@
+/* $Id$ */
+
+/** @file yapf_landmarks.cpp Distances from landmarks on the rail network, for the estimate of the rail pathfinder.
+ *
+ * A few tiles at the far ends of the rail network are chosen as landmarks,
+ * and the number of tiles from every landmark to every rail tile is stored.
+ * For a tile n and a destination tile t the triangle inequality gives
+ * dist(n, t) >= |dist(L, t) - dist(L, n)| for every landmark L, which often
+ * is a lot closer to the real distance than the distance as the crow flies,
+ * e.g. when the track takes a long detour.
+ *
+ * The distances are counted over a graph of tiles, where two neighbouring
+ * tiles are connected when both have track at their common side, whatever
+ * the owner, railtype or the way the tracks join inside the tiles. A train
+ * can't go anywhere this graph doesn't, so the distances are never more
+ * than those of the paths of a train. Every tile a train enters costs at
+ * least YAPF_TILE_CORNER_LENGTH, so the estimate never exceeds the cost of
+ * the remaining path.
+ *
+ * The distances are calculated again the first time they are needed after
+ * any change to the rail layout. They are only a function of the rail
+ * layout, so every client uses the same estimate for every search.
+ */
+
+#include "../stdafx.h"
+#include "../core/alloc_func.hpp"
+#include "../core/smallvec_type.hpp"
+
+#include "yapf.hpp"
+#include "yapf_landmarks.hpp"
+
+#include <algorithm>
+
+/** Distance of the tiles that can't be reached from a landmark. */
+static const uint16 LANDMARK_UNREACHABLE = 0xFFFF;
+/** Index of a tile that has no rail, or of a missing neighbour. */
+static const uint32 LANDMARK_NO_TILE = 0xFFFFFFFF;
+
+static TileIndex *_landmark_tiles = NULL;    ///< All tiles with rail, in ascending order
+static uint32 *_landmark_row_start = NULL;   ///< Index in _landmark_tiles of the first tile of each row of the map, MapSizeY() + 1 entries
+static uint16 *_landmark_distances = NULL;   ///< Distance from each landmark to each tile of _landmark_tiles, RAIL_LANDMARK_COUNT per tile
+static uint _landmark_num_tiles = 0;         ///< Number of tiles in _landmark_tiles
+static uint _landmark_count = 0;             ///< Number of landmarks that have been chosen
+static bool _landmarks_valid = false;        ///< Whether the distances match the rail layout of the map
+
+/** Forget the landmark distances; called whenever the rail layout changes. */
+void InvalidateRailLandmarks()
+{
+	_landmarks_valid = false;
+}
+
+/**
+ * Get the index of a tile in _landmark_tiles.
+ * @param tile the tile
+ * @return the index, or LANDMARK_NO_TILE when the tile has no rail
+ */
+static uint32 GetLandmarkTileIndex(TileIndex tile)
+{
+	/* only search the tiles of the row of the tile */
+	uint y = TileY(tile);
+	const TileIndex *end = _landmark_tiles + _landmark_row_start[y + 1];
+	const TileIndex *it = std::lower_bound((const TileIndex *)_landmark_tiles + _landmark_row_start[y], end, tile);
+	return (it == end || *it != tile) ? LANDMARK_NO_TILE : (uint32)(it - _landmark_tiles);
+}
+
+/**
+ * Get the tracks of a tile the landmark graph is made of.
+ * @param tile the tile
+ * @return the tracks of the tile
+ */
+static FORCEINLINE TrackBits GetLandmarkTracks(TileIndex tile)
+{
+	switch (GetTileType(tile)) {
+		case MP_RAILWAY:
+		case MP_ROAD:
+		case MP_STATION:
+		case MP_TUNNELBRIDGE:
+			return TrackStatusToTrackBits(GetTileTrackStatus(tile, TRANSPORT_RAIL, 0));
+
+		default:
+			return TRACK_BIT_NONE;
+	}
+}
+
+/**
+ * Find the tiles a tile is connected to in the landmark graph.
+ * The connections are the same both ways, so the distances are too.
+ * @param tile the tile
+ * @param neighbours the indices in _landmark_tiles of the connected tiles, LANDMARK_NO_TILE for the missing ones
+ */
+static void GetLandmarkNeighbours(TileIndex tile, uint32 *neighbours)
+{
+	TrackBits tracks = GetLandmarkTracks(tile);
+
+	for (DiagDirection dir = DIAGDIR_BEGIN; dir < DIAGDIR_END; dir++) {
+		neighbours[dir] = LANDMARK_NO_TILE;
+
+		/* any track at the side of the tile we leave? */
+		if ((tracks & DiagdirReachesTracks(ReverseDiagDir(dir))) == TRACK_BIT_NONE) continue;
+
+		TileIndex next;
+		if (IsTileType(tile, MP_TUNNELBRIDGE) && GetTunnelBridgeDirection(tile) == dir) {
+			next = GetOtherTunnelBridgeEnd(tile);
+		} else {
+			next = tile + TileOffsByDiagDir(dir);
+			if (next >= MapSize()) continue;
+			/* tunnels and bridges can only be entered from their front */
+			if (IsTileType(next, MP_TUNNELBRIDGE) && GetTunnelBridgeDirection(next) == ReverseDiagDir(dir)) continue;
+		}
+
+		/* any track at the side of the tile we enter? */
+		if ((GetLandmarkTracks(next) & DiagdirReachesTracks(dir)) == TRACK_BIT_NONE) continue;
+
+		neighbours[dir] = GetLandmarkTileIndex(next);
+	}
+}
+
+/**
+ * Count the tiles from a tile to all other tiles of the landmark graph.
+ * @param neighbours the connected tiles of each tile, DIAGDIR_END per tile
+ * @param source the index of the tile to count from
+ * @param dist the distance to each tile; UINT_MAX for the tiles that can't be reached
+ * @param queue storage for the search
+ * @return the number of tiles that can be reached
+ */
+static uint SearchLandmarkDistances(const uint32 *neighbours, uint32 source, uint *dist, SmallVector<uint32, 256> &queue)
+{
+	for (uint i = 0; i < _landmark_num_tiles; i++) dist[i] = UINT_MAX;
+
+	queue.Clear();
+	*queue.Append() = source;
+	dist[source] = 0;
+
+	for (uint i = 0; i < queue.Length(); i++) {
+		uint32 cur = queue[i];
+		for (uint j = 0; j < DIAGDIR_END; j++) {
+			uint32 next = neighbours[cur * DIAGDIR_END + j];
+			if (next == LANDMARK_NO_TILE || dist[next] != UINT_MAX) continue;
+			dist[next] = dist[cur] + 1;
+			*queue.Append() = next;
+		}
+	}
+
+	return queue.Length();
+}
+
+/**
+ * Choose the landmarks and calculate the distances from them.
+ * The landmarks are spread over the largest connected part of the network:
+ * the first is the tile farthest from an arbitrary tile of that part, and
+ * every next one the tile farthest from all landmarks chosen so far.
+ */
+static void UpdateRailLandmarks()
+{
+	/* collect the tiles with rail */
+	SmallVector<TileIndex, 256> tiles;
+	for (TileIndex tile = 0; tile < MapSize(); tile++) {
+		if (GetLandmarkTracks(tile) != TRACK_BIT_NONE) *tiles.Append() = tile;
+	}
+
+	free(_landmark_tiles);
+	_landmark_num_tiles = tiles.Length();
+	_landmark_tiles = MallocT<TileIndex>(max(_landmark_num_tiles, 1U));
+	if (_landmark_num_tiles != 0) memcpy(_landmark_tiles, tiles.Begin(), _landmark_num_tiles * sizeof(TileIndex));
+	tiles.Reset();
+
+	_landmark_row_start = ReallocT(_landmark_row_start, MapSizeY() + 1);
+	uint32 index = 0;
+	for (uint y = 0; y <= MapSizeY(); y++) {
+		while (index < _landmark_num_tiles && TileY(_landmark_tiles[index]) < y) index++;
+		_landmark_row_start[y] = index;
+	}
+
+	_landmark_distances = ReallocT(_landmark_distances, max(_landmark_num_tiles, 1U) * RAIL_LANDMARK_COUNT);
+	_landmark_count = 0;
+	_landmarks_valid = true;
+
+	if (_landmark_num_tiles == 0) return;
+
+	uint32 *neighbours = MallocT<uint32>(_landmark_num_tiles * DIAGDIR_END);
+	for (uint i = 0; i < _landmark_num_tiles; i++) GetLandmarkNeighbours(_landmark_tiles[i], &neighbours[i * DIAGDIR_END]);
+
+	uint *dist = MallocT<uint>(_landmark_num_tiles);
+	uint *min_dist = MallocT<uint>(_landmark_num_tiles);
+	SmallVector<uint32, 256> queue;
+
+	/* find the largest connected part; min_dist marks the tiles already counted */
+	for (uint i = 0; i < _landmark_num_tiles; i++) min_dist[i] = UINT_MAX;
+	uint32 start = 0;
+	uint start_size = 0;
+	for (uint32 i = 0; i < _landmark_num_tiles; i++) {
+		if (min_dist[i] != UINT_MAX) continue;
+
+		queue.Clear();
+		*queue.Append() = i;
+		min_dist[i] = 0;
+		for (uint j = 0; j < queue.Length(); j++) {
+			uint32 cur = queue[j];
+			for (uint k = 0; k < DIAGDIR_END; k++) {
+				uint32 next = neighbours[cur * DIAGDIR_END + k];
+				if (next == LANDMARK_NO_TILE || min_dist[next] != UINT_MAX) continue;
+				min_dist[next] = 0;
+				*queue.Append() = next;
+			}
+		}
+
+		if (queue.Length() > start_size) {
+			start = i;
+			start_size = queue.Length();
+		}
+	}
+
+	/* the first landmark is the tile farthest from the start */
+	SearchLandmarkDistances(neighbours, start, dist, queue);
+	uint32 landmark = start;
+	for (uint i = 0; i < _landmark_num_tiles; i++) {
+		if (dist[i] != UINT_MAX && dist[i] > dist[landmark]) landmark = i;
+	}
+
+	for (uint i = 0; i < _landmark_num_tiles; i++) min_dist[i] = UINT_MAX;
+
+	while (_landmark_count < RAIL_LANDMARK_COUNT) {
+		SearchLandmarkDistances(neighbours, landmark, dist, queue);
+
+		uint l = _landmark_count++;
+		for (uint i = 0; i < _landmark_num_tiles; i++) {
+			/* distances that don't fit are as good as unknown */
+			_landmark_distances[i * RAIL_LANDMARK_COUNT + l] = dist[i] < LANDMARK_UNREACHABLE ? dist[i] : LANDMARK_UNREACHABLE;
+			if (dist[i] < min_dist[i]) min_dist[i] = dist[i];
+		}
+
+		/* the next landmark is the tile farthest from all landmarks so far */
+		uint32 next = landmark;
+		for (uint i = 0; i < _landmark_num_tiles; i++) {
+			if (min_dist[i] != UINT_MAX && min_dist[i] > min_dist[next]) next = i;
+		}
+		if (min_dist[next] == 0) break;
+		landmark = next;
+	}
+
+	for (uint i = 0; i < _landmark_num_tiles; i++) {
+		for (uint l = _landmark_count; l < RAIL_LANDMARK_COUNT; l++) _landmark_distances[i * RAIL_LANDMARK_COUNT + l] = LANDMARK_UNREACHABLE;
+	}
+
+	DEBUG(yapf, 2, "Rail landmarks: %u landmarks over %u of %u rail tiles", _landmark_count, start_size, _landmark_num_tiles);
+
+	free(neighbours);
+	free(dist);
+	free(min_dist);
+}
+
+void YapfUpdateRailLandmarks()
+{
+	if (!_landmarks_valid) UpdateRailLandmarks();
+}
+
+/**
+ * Get the distances from the landmarks to a tile.
+ * @param tile the tile
+ * @return RAIL_LANDMARK_COUNT distances, or NULL when the tile has no rail
+ */
+static const uint16 *GetLandmarkDistances(TileIndex tile)
+{
+	YapfUpdateRailLandmarks();
+
+	uint32 index = GetLandmarkTileIndex(tile);
+	return index == LANDMARK_NO_TILE ? NULL : &_landmark_distances[index * RAIL_LANDMARK_COUNT];
+}
+
+/** Start a destination without any tiles. */
+void RailLandmarkTarget::Clear()
+{
+	for (uint l = 0; l < RAIL_LANDMARK_COUNT; l++) {
+		this->min_dist[l] = LANDMARK_UNREACHABLE;
+		this->max_dist[l] = 0;
+	}
+}
+
+/**
+ * Add a tile to the destination.
+ * @param tile the tile
+ */
+void RailLandmarkTarget::AddTile(TileIndex tile)
+{
+	const uint16 *dist = GetLandmarkDistances(tile);
+	if (dist == NULL) return;
+
+	for (uint l = 0; l < _landmark_count; l++) {
+		if (dist[l] == LANDMARK_UNREACHABLE) continue;
+		this->min_dist[l] = min(this->min_dist[l], dist[l]);
+		this->max_dist[l] = max(this->max_dist[l], dist[l]);
+	}
+}
+
+/**
+ * Get the least number of tiles from a tile to any tile of the destination.
+ * @param tile the tile
+ * @return the lower bound of the distance, in tiles
+ */
+uint RailLandmarkTarget::GetDistance(TileIndex tile) const
+{
+	const uint16 *dist = GetLandmarkDistances(tile);
+	if (dist == NULL) return 0;
+
+	uint best = 0;
+	for (uint l = 0; l < _landmark_count; l++) {
+		/* the landmark doesn't tell anything about tiles it can't reach */
+		if (dist[l] == LANDMARK_UNREACHABLE || this->min_dist[l] == LANDMARK_UNREACHABLE) continue;
+
+		if (this->min_dist[l] > dist[l]) {
+			best = max<uint>(best, this->min_dist[l] - dist[l]);
+		} else if (dist[l] > this->max_dist[l]) {
+			best = max<uint>(best, dist[l] - this->max_dist[l]);
+		}
+	}
+	return best;
+}
@@ -0,0 +1,25 @@
+/* $Id$ */
+
+/** @file yapf_landmarks.hpp Distances from landmarks on the rail network, for the estimate of the rail pathfinder. */
+
+#ifndef  YAPF_LANDMARKS_HPP
+#define  YAPF_LANDMARKS_HPP
+
+#include "../tile_type.h"
+
+/** Maximum number of landmarks on the rail network. */
+static const uint RAIL_LANDMARK_COUNT = 8;
+
+/** The distances from the landmarks to the tiles of the destination of a search. */
+struct RailLandmarkTarget {
+	uint16 min_dist[RAIL_LANDMARK_COUNT]; ///< Distance from each landmark to the nearest tile of the destination
+	uint16 max_dist[RAIL_LANDMARK_COUNT]; ///< Distance from each landmark to the farthest tile of the destination
+
+	void Clear();
+	void AddTile(TileIndex tile);
+	uint GetDistance(TileIndex tile) const;
+};
+
+void InvalidateRailLandmarks();
+
+#endif /* YAPF_LANDMARKS_HPP */
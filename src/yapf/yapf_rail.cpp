@@ -7,13 +7,34 @@
 #include "yapf.hpp"
 #include "yapf_node_rail.hpp"
 #include "yapf_costrail.hpp"
+#include "yapf_landmarks.hpp"
 #include "yapf_destrail.hpp"
 #include "../vehicle_func.h"
 #include "../functions.h"
+#include "../depot_func.h"
+#include "../core/smallvec_type.hpp"
 
 #define DEBUG_YAPF_CACHE 0
 
 int _total_pf_time_us = 0;
+ThreadMutex *_yapf_node_list_mutex = NULL;
+
+/** The functions freeing the free arenas of the node list types that have been used. */
+static SmallVector<YapfFreeArenasProc *, 8> _yapf_node_list_arenas;
+
+/**
+ * Remember how to free the free arenas of a node list type.
+ * @param proc the function freeing them
+ */
+void YapfRegisterNodeListArenas(YapfFreeArenasProc *proc)
+{
+	*_yapf_node_list_arenas.Append() = proc;
+}
+
+void YapfFreeNodeListArenas()
+{
+	for (YapfFreeArenasProc **proc = _yapf_node_list_arenas.Begin(); proc != _yapf_node_list_arenas.End(); proc++) (*proc)();
+}
 
 template <class Types>
 class CYapfReserveTrack
@@ -155,7 +176,7 @@ public:
 		if (target != NULL) target->okay = true;
 
 		if (Yapf().CanUseGlobalCache(*m_res_node))
-			YapfNotifyTrackLayoutChange(INVALID_TILE, INVALID_TRACK);
+			CSegmentCostCacheBase::NotifyTrackLayoutChange(INVALID_TILE, INVALID_TRACK);
 
 		return true;
 	}
@@ -523,6 +544,23 @@ Trackdir YapfChooseRailTrack(const Vehicle *v, TileIndex tile, DiagDirection ent
 	return td_ret;
 }
 
+/** Choose the rail track without touching the global segment cost cache, which is shared by all pathfinders. */
+template <class Tpf>
+static Trackdir ChooseRailTrackConcurrent(const Vehicle *v, TileIndex tile, DiagDirection enterdir, TrackBits tracks, bool *path_not_found)
+{
+	Tpf pf;
+	pf.DisableCache(true);
+	return pf.ChooseRailTrack(v, tile, enterdir, tracks, path_not_found, false, NULL);
+}
+
+Trackdir YapfChooseRailTrackConcurrent(const Vehicle *v, TileIndex tile, DiagDirection enterdir, TrackBits tracks, bool *path_not_found)
+{
+	if (_settings_game.pf.forbid_90_deg) {
+		return ChooseRailTrackConcurrent<CYapfRail2>(v, tile, enterdir, tracks, path_not_found);
+	}
+	return ChooseRailTrackConcurrent<CYapfRail1>(v, tile, enterdir, tracks, path_not_found);
+}
+
 bool YapfCheckReverseTrain(const Vehicle *v)
 {
 	/* last wagon */
@@ -594,6 +632,12 @@ bool YapfFindNearestRailDepotTwoWay(const Vehicle *v, int max_distance, int reve
 	TileIndex last_tile = last_veh->tile;
 	Trackdir td_rev = ReverseTrackdir(GetVehicleTrackdir(last_veh));
 
+	/* Each tile costs at least YAPF_TILE_CORNER_LENGTH, so skip the search
+	 * when the nearest depot is out of reach for sure. */
+	uint dist = min(GetRailDepotDistance(origin.tile), GetRailDepotDistance(last_tile));
+	if (dist == UINT_MAX) return false;
+	if (max_distance > 0 && (int)(dist - 1) * YAPF_TILE_CORNER_LENGTH > YAPF_TILE_LENGTH * max_distance) return false;
+
 	typedef bool (*PfnFindNearestDepotTwoWay)(const Vehicle*, TileIndex, Trackdir, TileIndex, Trackdir, int, int, TileIndex*, bool*);
 	PfnFindNearestDepotTwoWay pfnFindNearestDepotTwoWay = &CYapfAnyDepotRail1::stFindNearestDepotTwoWay;
 
@@ -625,4 +669,7 @@ int CSegmentCostCacheBase::s_rail_change_counter = 0;
 void YapfNotifyTrackLayoutChange(TileIndex tile, Track track)
 {
 	CSegmentCostCacheBase::NotifyTrackLayoutChange(tile, track);
+	InvalidateRailDepotDistances();
+	InvalidateRailLandmarks();
+	InvalidateFollowedReservations(INVALID_TILE);
 }
@@ -282,13 +282,13 @@ public:
 		return 'r';
 	}
 
-	static Trackdir stChooseRoadTrack(const Vehicle *v, TileIndex tile, DiagDirection enterdir)
+	static Trackdir stChooseRoadTrack(Vehicle *v, TileIndex tile, DiagDirection enterdir)
 	{
 		Tpf pf;
 		return pf.ChooseRoadTrack(v, tile, enterdir);
 	}
 
-	FORCEINLINE Trackdir ChooseRoadTrack(const Vehicle *v, TileIndex tile, DiagDirection enterdir)
+	FORCEINLINE Trackdir ChooseRoadTrack(Vehicle *v, TileIndex tile, DiagDirection enterdir)
 	{
 		/* handle special case - when next tile is destination tile */
 		if (tile == v->dest_tile) {
@@ -311,15 +311,29 @@ public:
 		Yapf().SetDestination(dest_tile, dest_trackdirs);
 
 		/* find the best path */
-		Yapf().FindPath(v);
+		bool path_found = Yapf().FindPath(v);
 
 		/* if path not found - return INVALID_TRACKDIR */
 		Trackdir next_trackdir = INVALID_TRACKDIR;
 		Node *pNode = Yapf().GetBestNode();
 		if (pNode != NULL) {
+			/* remember the junctions right after the origin, when the path
+			 * leads to the destination and not just close to it */
+			uint length = 0;
+			for (Node *n = pNode; n->m_parent != NULL; n = n->m_parent) length++;
+			VehicleRoad *road = &v->u.road;
+			road->path_length = path_found ? min<uint>(length, RV_PATH_CACHE_LENGTH) : 0;
+			road->path_pos = 0;
+			road->path_dest = dest_tile;
+
 			/* path was found or at least suggested
 			 * walk through the path back to its origin */
 			while (pNode->m_parent != NULL) {
+				length--;
+				if (length < road->path_length) {
+					road->path_tile[length] = pNode->GetTile();
+					road->path_trackdir[length] = pNode->GetTrackdir();
+				}
 				pNode = pNode->m_parent;
 			}
 			/* return trackdir from the best origin node (one of start nodes) */
@@ -430,10 +444,58 @@ struct CYapfRoadAnyDepot1 : CYapfT<CYapfRoad_TypesT<CYapfRoadAnyDepot1, CRoadNod
 struct CYapfRoadAnyDepot2 : CYapfT<CYapfRoad_TypesT<CYapfRoadAnyDepot2, CRoadNodeListExitDir , CYapfDestinationAnyDepotRoadT> > {};
 
 
-Trackdir YapfChooseRoadTrack(const Vehicle *v, TileIndex tile, DiagDirection enterdir)
+/**
+ * Take the trackdir for a tile from the path a road vehicle found before.
+ * @param v        the road vehicle
+ * @param tile     the tile the road vehicle is about to enter
+ * @param enterdir the direction it enters the tile from
+ * @return the trackdir of the cached path, or INVALID_TRACKDIR when the path does not pass the tile or can not be followed any more
+ */
+static Trackdir GetCachedRoadTrack(Vehicle *v, TileIndex tile, DiagDirection enterdir)
 {
+	VehicleRoad *road = &v->u.road;
+	if (road->path_dest != v->dest_tile) return INVALID_TRACKDIR;
+
+	/* Junctions that are passed without asking for a path are skipped */
+	for (uint i = road->path_pos; i < road->path_length; i++) {
+		if (road->path_tile[i] != tile) continue;
+
+		Trackdir td = road->path_trackdir[i];
+		TrackdirBits trackdirs = TrackStatusToTrackdirBits(GetTileTrackStatus(tile, TRANSPORT_ROAD, road->compatible_roadtypes)) & DiagdirReachesTrackdirs(enterdir);
+		if ((trackdirs & TrackdirToTrackdirBits(td)) == TRACKDIR_BIT_NONE) return INVALID_TRACKDIR;
+
+		road->path_pos = i + 1;
+		return td;
+	}
+	return INVALID_TRACKDIR;
+}
+
+Trackdir YapfChooseRoadTrack(Vehicle *v, TileIndex tile, DiagDirection enterdir)
+{
+	static uint hits = 0;
+	static uint misses = 0;
+	static Date last_date = 0;
+
+	/* some statistics */
+	if (last_date != _date) {
+		last_date = _date;
+		if (hits + misses != 0) DEBUG(yapf, 2, "Road path cache today: %u hits, %u misses (%u%% hit rate)", hits, misses, hits * 100 / (hits + misses));
+		hits = 0;
+		misses = 0;
+	}
+
+	if (tile != v->dest_tile) {
+		Trackdir td = GetCachedRoadTrack(v, tile, enterdir);
+		if (td != INVALID_TRACKDIR) {
+			hits++;
+			return td;
+		}
+		misses++;
+	}
+	v->u.road.path_length = 0;
+
 	/* default is YAPF type 2 */
-	typedef Trackdir (*PfnChooseRoadTrack)(const Vehicle*, TileIndex, DiagDirection);
+	typedef Trackdir (*PfnChooseRoadTrack)(Vehicle*, TileIndex, DiagDirection);
 	PfnChooseRoadTrack pfnChooseRoadTrack = &CYapfRoad2::stChooseRoadTrack; // default: ExitDir, allow 90-deg
 
 	/* check if non-default YAPF type should be used */
@@ -492,3 +554,11 @@ Depot *YapfFindNearestRoadDepot(const Vehicle *v)
 	Depot *ret = pfnFindNearestDepot(v, tile, trackdir);
 	return ret;
 }
+
+void YapfNotifyRoadLayoutChange()
+{
+	Vehicle *v;
+	FOR_ALL_VEHICLES(v) {
+		if (v->type == VEH_ROAD) v->u.road.path_length = 0;
+	}
+}
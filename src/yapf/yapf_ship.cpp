@@ -5,6 +5,7 @@
 #include "../stdafx.h"
 
 #include "yapf.hpp"
+#include "yapf_ship_regions.hpp"
 
 /** Node Follower module of YAPF for ships */
 template <class Types>
@@ -17,6 +18,10 @@ public:
 	typedef typename Node::Key Key;                      ///< key to hash tables
 
 protected:
+	const ShipRegionCorridor *m_corridor; ///< the water regions the path has to stay in, or NULL to search the whole map
+
+	CYapfFollowShipT() : m_corridor(NULL) {}
+
 	/** to access inherited path finder */
 	FORCEINLINE Tpf& Yapf()
 	{
@@ -31,10 +36,17 @@ public:
 	{
 		TrackFollower F(Yapf().GetVehicle());
 		if (F.Follow(old_node.m_key.m_tile, old_node.m_key.m_td)) {
+			if (m_corridor != NULL && !m_corridor->Contains(F.m_new_tile)) return;
 			Yapf().AddMultipleNodes(&old_node, F);
 		}
 	}
 
+	/** Restrict the search to the regions of a corridor */
+	FORCEINLINE void SetCorridor(const ShipRegionCorridor *corridor)
+	{
+		m_corridor = corridor;
+	}
+
 	/** return debug report character to identify the transportation type */
 	FORCEINLINE char TransportTypeChar() const
 	{
@@ -57,18 +69,32 @@ public:
 		Trackdir trackdir = GetVehicleTrackdir(v);
 		assert(IsValidTrackdir(trackdir));
 
+		/* when the destination is far away, only search through the first
+		 * water regions on the way to it; the search over the whole map is
+		 * the fall back when there is no path within them */
+		ShipRegionCorridor corridor;
+		if (FindShipRegionCorridor(tile, v->dest_tile, &corridor)) {
+			Trackdir next_trackdir = FindShipTrack(v, src_tile, trackdir, tile, corridor.target_tile, &corridor);
+			if (next_trackdir != INVALID_TRACKDIR) return next_trackdir;
+		}
+		return FindShipTrack(v, src_tile, trackdir, tile, v->dest_tile, NULL);
+	}
+
+	static Trackdir FindShipTrack(const Vehicle *v, TileIndex src_tile, Trackdir trackdir, TileIndex tile, TileIndex dest_tile, const ShipRegionCorridor *corridor)
+	{
 		/* convert origin trackdir to TrackdirBits */
 		TrackdirBits trackdirs = TrackdirToTrackdirBits(trackdir);
 		/* get available trackdirs on the destination tile */
-		TrackdirBits dest_trackdirs = TrackStatusToTrackdirBits(GetTileTrackStatus(v->dest_tile, TRANSPORT_WATER, 0));
+		TrackdirBits dest_trackdirs = TrackStatusToTrackdirBits(GetTileTrackStatus(dest_tile, TRANSPORT_WATER, 0));
 
 		/* create pathfinder instance */
 		Tpf pf;
 		/* set origin and destination nodes */
 		pf.SetOrigin(src_tile, trackdirs);
-		pf.SetDestination(v->dest_tile, dest_trackdirs);
-		/* find best path */
-		pf.FindPath(v);
+		pf.SetDestination(dest_tile, dest_trackdirs);
+		pf.SetCorridor(corridor);
+		/* find best path; within a corridor only a path that gets there counts */
+		if (!pf.FindPath(v) && corridor != NULL) return INVALID_TRACKDIR;
 
 		Trackdir next_trackdir = INVALID_TRACKDIR; // this would mean "path not found"
 
@@ -0,0 +1,466 @@
+/* $Id$ */
+
+/** @file yapf_ship_regions.cpp Water regions, the coarse graph long ship paths are routed over.
+ *
+ * The map is divided into square water regions. The water tiles of a region
+ * that ships can travel between without leaving the region form a patch of
+ * the region; the patches are connected to the patches of other regions by
+ * links. A search over these patches finds the regions a ship has to pass to
+ * reach its destination, and the tile level search of the ship then only
+ * needs to look at the first few of them.
+ *
+ * The regions are (re)calculated when they are needed; the commands that
+ * change water tiles only mark the region of the tile as out of date.
+ */
+
+#include "../stdafx.h"
+#include "../core/alloc_func.hpp"
+#include "../core/smallvec_type.hpp"
+
+#include "yapf.hpp"
+#include "yapf_ship_regions.hpp"
+
+/** Patch of the tiles ships can not travel over. */
+static const byte WATER_PATCH_NONE = 0xFF;
+/** Number of tiles in a water region. */
+static const uint WATER_REGION_NUM_TILES = WATER_REGION_EDGE_LENGTH * WATER_REGION_EDGE_LENGTH;
+/** Maximum number of patches the search for a corridor visits before giving up. */
+static const uint MAX_REGION_SEARCH_NODES = 16384;
+
+/** A connection from a patch of a water region to a patch of another one. */
+struct WaterRegionLink {
+	uint32 other_region;  ///< Index of the region the link leads to
+	uint32 other_version; ///< Version of the patches of that region the link was made with
+	byte patch;           ///< Patch of this region the link starts in
+	byte other_patch;     ///< Patch of the other region the link leads to
+};
+
+/** State of a patch in the search for a corridor. */
+struct WaterPatchVisit {
+	uint32 generation; ///< Search that visited the patch last
+};
+
+/** A square part of the map with the connectivity of its water tiles. */
+struct WaterRegion {
+	byte *patches;                           ///< Patch of each tile of the region; NULL when no tile can be travelled over
+	byte num_patches;                        ///< Number of patches in the region
+	bool patches_valid;                      ///< Whether the patches match the tiles of the map
+	bool links_valid;                        ///< Whether the links match the tiles of the map
+	uint32 version;                          ///< Incremented every time the patches are recalculated
+	SmallVector<WaterRegionLink, 4> links;   ///< Links to the patches of other regions, ordered by patch
+	SmallVector<WaterPatchVisit, 1> visits;  ///< Search state of each patch
+
+	WaterRegion() : patches(NULL), num_patches(0), patches_valid(false), links_valid(false), version(0) {}
+	~WaterRegion() { free(this->patches); }
+};
+
+static WaterRegion *_water_regions = NULL; ///< All water regions of the map, row by row
+static uint _water_regions_x;              ///< Number of water regions along the x axis of the map
+static uint _water_regions_y;              ///< Number of water regions along the y axis of the map
+static uint32 _water_region_search;        ///< Generation of the last search for a corridor
+
+/** Make sure there are water regions for the current map. */
+static void AllocateWaterRegions()
+{
+	uint size_x = MapSizeX() / WATER_REGION_EDGE_LENGTH;
+	uint size_y = MapSizeY() / WATER_REGION_EDGE_LENGTH;
+	if (_water_regions != NULL && size_x == _water_regions_x && size_y == _water_regions_y) return;
+
+	delete[] _water_regions;
+	_water_regions = new WaterRegion[size_x * size_y];
+	_water_regions_x = size_x;
+	_water_regions_y = size_y;
+}
+
+/**
+ * Get the index of the water region a tile is in.
+ * @param tile the tile
+ * @return the index of its region
+ */
+static FORCEINLINE uint GetWaterRegionIndex(TileIndex tile)
+{
+	return (TileY(tile) / WATER_REGION_EDGE_LENGTH) * _water_regions_x + TileX(tile) / WATER_REGION_EDGE_LENGTH;
+}
+
+/**
+ * Get the index of a tile within its water region.
+ * @param tile the tile
+ * @return the index of the tile in WaterRegion::patches
+ */
+static FORCEINLINE uint GetWaterRegionTileIndex(TileIndex tile)
+{
+	return (TileY(tile) % WATER_REGION_EDGE_LENGTH) * WATER_REGION_EDGE_LENGTH + TileX(tile) % WATER_REGION_EDGE_LENGTH;
+}
+
+/**
+ * Get the north tile of a water region.
+ * @param index the index of the region
+ * @return the tile with the lowest coordinates of the region
+ */
+static FORCEINLINE TileIndex GetWaterRegionTile(uint index)
+{
+	return TileXY((index % _water_regions_x) * WATER_REGION_EDGE_LENGTH, (index / _water_regions_x) * WATER_REGION_EDGE_LENGTH);
+}
+
+/**
+ * Get the distance between two water regions, in regions.
+ * @param a the index of one region
+ * @param b the index of the other region
+ * @return the Manhattan distance between them
+ */
+static FORCEINLINE uint GetWaterRegionDistance(uint a, uint b)
+{
+	return Delta(a % _water_regions_x, b % _water_regions_x) + Delta(a / _water_regions_x, b / _water_regions_x);
+}
+
+/**
+ * Get the trackdirs ships can travel over on a tile.
+ * @param tile the tile
+ * @return the trackdirs
+ */
+static FORCEINLINE TrackdirBits GetWaterTrackdirs(TileIndex tile)
+{
+	return TrackStatusToTrackdirBits(GetTileTrackStatus(tile, TRANSPORT_WATER, 0));
+}
+
+/**
+ * Recalculate the patches of a water region.
+ * @param index the index of the region
+ */
+static void UpdateWaterRegionPatches(uint index)
+{
+	static SmallVector<TileIndex, 64> stack;
+
+	WaterRegion &r = _water_regions[index];
+	if (r.patches == NULL) r.patches = MallocT<byte>(WATER_REGION_NUM_TILES);
+	memset(r.patches, WATER_PATCH_NONE, WATER_REGION_NUM_TILES);
+	r.num_patches = 0;
+
+	TileIndex north = GetWaterRegionTile(index);
+	for (uint y = 0; y < WATER_REGION_EDGE_LENGTH; y++) {
+		for (uint x = 0; x < WATER_REGION_EDGE_LENGTH; x++) {
+			TileIndex start = north + TileDiffXY(x, y);
+			if (r.patches[GetWaterRegionTileIndex(start)] != WATER_PATCH_NONE || GetWaterTrackdirs(start) == TRACKDIR_BIT_NONE) continue;
+
+			/* Flood the new patch over the tiles that can be reached from this one within the region */
+			byte patch = r.num_patches++;
+			r.patches[GetWaterRegionTileIndex(start)] = patch;
+			*stack.Append() = start;
+			while (stack.Length() != 0) {
+				TileIndex tile = stack[stack.Length() - 1];
+				stack.Erase(stack.End() - 1);
+
+				for (TrackdirBits tdb = GetWaterTrackdirs(tile); tdb != TRACKDIR_BIT_NONE; tdb = KillFirstBit(tdb)) {
+					CFollowTrackWater F;
+					if (!F.Follow(tile, (Trackdir)FindFirstBit2x64(tdb))) continue;
+					if (GetWaterRegionIndex(F.m_new_tile) != index) continue;
+
+					byte *p = &r.patches[GetWaterRegionTileIndex(F.m_new_tile)];
+					if (*p != WATER_PATCH_NONE) continue;
+					*p = patch;
+					*stack.Append() = F.m_new_tile;
+				}
+			}
+		}
+	}
+
+	if (r.num_patches == 0) {
+		free(r.patches);
+		r.patches = NULL;
+	}
+
+	r.patches_valid = true;
+	r.links_valid = false;
+	r.version++;
+	r.visits.Clear();
+	for (uint i = 0; i < r.num_patches; i++) r.visits.Append()->generation = 0;
+}
+
+/**
+ * Get the patch of a tile.
+ * @param tile the tile
+ * @return the patch of the tile in its region, or WATER_PATCH_NONE when ships can not travel over it
+ */
+static byte GetWaterPatch(TileIndex tile)
+{
+	uint index = GetWaterRegionIndex(tile);
+	WaterRegion &r = _water_regions[index];
+	if (!r.patches_valid) UpdateWaterRegionPatches(index);
+	return r.patches == NULL ? WATER_PATCH_NONE : r.patches[GetWaterRegionTileIndex(tile)];
+}
+
+/**
+ * Recalculate the links of a water region to the patches of the other regions.
+ * @param index the index of the region
+ */
+static void UpdateWaterRegionLinks(uint index)
+{
+	WaterRegion &r = _water_regions[index];
+	r.links.Clear();
+
+	for (uint patch = 0; patch < r.num_patches; patch++) {
+		uint first = r.links.Length();
+		TileIndex north = GetWaterRegionTile(index);
+		for (uint i = 0; i < WATER_REGION_NUM_TILES; i++) {
+			if (r.patches[i] != patch) continue;
+
+			TileIndex tile = north + TileDiffXY(i % WATER_REGION_EDGE_LENGTH, i / WATER_REGION_EDGE_LENGTH);
+			for (TrackdirBits tdb = GetWaterTrackdirs(tile); tdb != TRACKDIR_BIT_NONE; tdb = KillFirstBit(tdb)) {
+				CFollowTrackWater F;
+				if (!F.Follow(tile, (Trackdir)FindFirstBit2x64(tdb))) continue;
+
+				uint other = GetWaterRegionIndex(F.m_new_tile);
+				if (other == index) continue;
+				byte other_patch = GetWaterPatch(F.m_new_tile);
+				if (other_patch == WATER_PATCH_NONE) continue;
+
+				bool known = false;
+				for (const WaterRegionLink *l = r.links.Get(first); l != r.links.End(); l++) {
+					if (l->other_region == other && l->other_patch == other_patch) {
+						known = true;
+						break;
+					}
+				}
+				if (known) continue;
+
+				WaterRegionLink *l = r.links.Append();
+				l->other_region = other;
+				l->other_version = _water_regions[other].version;
+				l->patch = patch;
+				l->other_patch = other_patch;
+			}
+		}
+	}
+
+	r.links_valid = true;
+}
+
+/**
+ * Make sure the patches and links of a water region match the map.
+ * @param index the index of the region
+ */
+static void UpdateWaterRegion(uint index)
+{
+	WaterRegion &r = _water_regions[index];
+	if (!r.patches_valid) UpdateWaterRegionPatches(index);
+
+	/* The links are out of date too when the patches of a region they lead to have changed */
+	bool valid = r.links_valid;
+	for (const WaterRegionLink *l = r.links.Begin(); valid && l != r.links.End(); l++) {
+		WaterRegion &other = _water_regions[l->other_region];
+		if (!other.patches_valid) UpdateWaterRegionPatches(l->other_region);
+		if (other.version != l->other_version) valid = false;
+	}
+	if (!valid) UpdateWaterRegionLinks(index);
+}
+
+/** A patch in the search for a corridor. */
+struct WaterRegionSearchNode {
+	uint32 region; ///< Index of the region of the patch
+	uint32 parent; ///< Index of the node the patch was reached from, or UINT32_MAX for the origin
+	uint cost;     ///< Number of regions passed from the origin
+	uint estimate; ///< Cost plus the distance to the region of the destination
+	byte patch;    ///< The patch in the region
+};
+
+/** Nodes of the search for a corridor, and the indices of the open ones as binary heap. */
+static SmallVector<WaterRegionSearchNode, 256> _region_search_nodes;
+static SmallVector<uint32, 256> _region_search_open;
+
+/**
+ * Whether a node in the search for a corridor has to be expanded before another one.
+ * Between equally good nodes the one furthest from the origin is taken.
+ */
+static FORCEINLINE bool IsBetterWaterRegionNode(uint32 a, uint32 b)
+{
+	const WaterRegionSearchNode &na = _region_search_nodes[a];
+	const WaterRegionSearchNode &nb = _region_search_nodes[b];
+	if (na.estimate != nb.estimate) return na.estimate < nb.estimate;
+	if (na.cost != nb.cost) return na.cost > nb.cost;
+	return a < b;
+}
+
+/** Add a node to the open nodes of the search for a corridor. */
+static void PushWaterRegionNode(uint32 region, byte patch, uint32 parent, uint cost, uint dest_region)
+{
+	uint32 node = _region_search_nodes.Length();
+	WaterRegionSearchNode *n = _region_search_nodes.Append();
+	n->region = region;
+	n->patch = patch;
+	n->parent = parent;
+	n->cost = cost;
+	n->estimate = cost + GetWaterRegionDistance(region, dest_region);
+
+	uint i = _region_search_open.Length();
+	*_region_search_open.Append() = node;
+	while (i > 0 && IsBetterWaterRegionNode(node, _region_search_open[(i - 1) / 2])) {
+		_region_search_open[i] = _region_search_open[(i - 1) / 2];
+		i = (i - 1) / 2;
+	}
+	_region_search_open[i] = node;
+}
+
+/** Take the best node from the open nodes of the search for a corridor. */
+static uint32 PopWaterRegionNode()
+{
+	uint32 best = _region_search_open[0];
+	uint32 last = _region_search_open[_region_search_open.Length() - 1];
+	_region_search_open.Erase(_region_search_open.End() - 1);
+
+	uint length = _region_search_open.Length();
+	if (length == 0) return best;
+
+	uint i = 0;
+	for (;;) {
+		uint child = 2 * i + 1;
+		if (child >= length) break;
+		if (child + 1 < length && IsBetterWaterRegionNode(_region_search_open[child + 1], _region_search_open[child])) child++;
+		if (!IsBetterWaterRegionNode(_region_search_open[child], last)) break;
+		_region_search_open[i] = _region_search_open[child];
+		i = child;
+	}
+	_region_search_open[i] = last;
+	return best;
+}
+
+/**
+ * Choose the tile a ship heads for at the end of a corridor: the tile of
+ * the patch it reaches there that is closest to the region after it.
+ * @param index the index of the last region of the corridor
+ * @param patch the patch of that region
+ * @param next the index of the region after it
+ * @return the tile
+ */
+static TileIndex GetWaterRegionTargetTile(uint index, byte patch, uint next)
+{
+	const WaterRegion &r = _water_regions[index];
+	TileIndex north = GetWaterRegionTile(index);
+	TileIndex centre = GetWaterRegionTile(next) + TileDiffXY(WATER_REGION_EDGE_LENGTH / 2, WATER_REGION_EDGE_LENGTH / 2);
+
+	TileIndex best = INVALID_TILE;
+	uint best_dist = UINT_MAX;
+	for (uint i = 0; i < WATER_REGION_NUM_TILES; i++) {
+		if (r.patches[i] != patch) continue;
+
+		TileIndex tile = north + TileDiffXY(i % WATER_REGION_EDGE_LENGTH, i / WATER_REGION_EDGE_LENGTH);
+		uint dist = DistanceManhattan(tile, centre);
+		if (dist < best_dist) {
+			best = tile;
+			best_dist = dist;
+		}
+	}
+	return best;
+}
+
+/**
+ * Whether a tile is in one of the regions of the corridor.
+ * @param tile the tile
+ * @return true when the tile search may pass it
+ */
+bool ShipRegionCorridor::Contains(TileIndex tile) const
+{
+	uint index = GetWaterRegionIndex(tile);
+	for (uint i = 0; i < this->num_regions; i++) {
+		if (this->regions[i] == index) return true;
+	}
+	return false;
+}
+
+/**
+ * Find the water regions a ship has to pass first to get to its destination.
+ * @param tile the tile the ship is about to enter
+ * @param dest_tile the destination of the ship
+ * @param corridor receives the regions and the tile to search the path to
+ * @return false when the destination can not be reached over the regions, so the tile search should look at the whole map
+ */
+bool FindShipRegionCorridor(TileIndex tile, TileIndex dest_tile, ShipRegionCorridor *corridor)
+{
+	AllocateWaterRegions();
+
+	uint origin = GetWaterRegionIndex(tile);
+	uint dest = GetWaterRegionIndex(dest_tile);
+
+	byte origin_patch = GetWaterPatch(tile);
+	if (origin_patch == WATER_PATCH_NONE) return false;
+	/* When ships can not travel over the destination itself any patch of its region will do */
+	byte dest_patch = GetWaterPatch(dest_tile);
+
+	_water_region_search++;
+	_region_search_nodes.Clear();
+	_region_search_open.Clear();
+	PushWaterRegionNode(origin, origin_patch, UINT32_MAX, 0, dest);
+
+	uint32 found = UINT32_MAX;
+	while (_region_search_open.Length() != 0 && _region_search_nodes.Length() < MAX_REGION_SEARCH_NODES) {
+		uint32 node = PopWaterRegionNode();
+		uint region = _region_search_nodes[node].region;
+		byte patch = _region_search_nodes[node].patch;
+
+		UpdateWaterRegion(region);
+		WaterPatchVisit *visit = _water_regions[region].visits.Get(patch);
+		if (visit->generation == _water_region_search) continue;
+		visit->generation = _water_region_search;
+
+		if (region == dest && (dest_patch == WATER_PATCH_NONE || patch == dest_patch)) {
+			found = node;
+			break;
+		}
+
+		uint cost = _region_search_nodes[node].cost + 1;
+		const WaterRegion &r = _water_regions[region];
+		for (const WaterRegionLink *l = r.links.Begin(); l != r.links.End(); l++) {
+			if (l->patch != patch) continue;
+			if (_water_regions[l->other_region].visits[l->other_patch].generation == _water_region_search) continue;
+			PushWaterRegionNode(l->other_region, l->other_patch, node, cost, dest);
+		}
+	}
+
+	if (found == UINT32_MAX) {
+		DEBUG(yapf, 4, "[YAPFw] no water region path from 0x%X to 0x%X after %u patches", tile, dest_tile, _region_search_nodes.Length());
+		return false;
+	}
+
+	/* Walk back to the origin to get the regions in the order they are passed */
+	uint length = _region_search_nodes[found].cost + 1;
+	uint32 last = found;
+	uint32 next = UINT32_MAX;
+	for (uint32 n = found; n != UINT32_MAX; n = _region_search_nodes[n].parent) {
+		uint i = _region_search_nodes[n].cost;
+		if (i < SHIP_CORRIDOR_MAX_REGIONS) {
+			corridor->regions[i] = _region_search_nodes[n].region;
+			if (i == SHIP_CORRIDOR_MAX_REGIONS - 1) last = n;
+		} else if (i == SHIP_CORRIDOR_MAX_REGIONS) {
+			next = n;
+		}
+	}
+
+	if (length <= SHIP_CORRIDOR_MAX_REGIONS) {
+		corridor->num_regions = length;
+		corridor->target_tile = dest_tile;
+	} else {
+		corridor->num_regions = SHIP_CORRIDOR_MAX_REGIONS;
+		corridor->target_tile = GetWaterRegionTargetTile(_region_search_nodes[last].region, _region_search_nodes[last].patch, _region_search_nodes[next].region);
+	}
+	return true;
+}
+
+void YapfNotifyWaterLayoutChange(TileIndex tile)
+{
+	if (tile == INVALID_TILE) {
+		delete[] _water_regions;
+		_water_regions = NULL;
+		return;
+	}
+	if (_water_regions == NULL) return;
+
+	/* Links of the regions around the tile can lead into or out of it */
+	uint x = TileX(tile) / WATER_REGION_EDGE_LENGTH;
+	uint y = TileY(tile) / WATER_REGION_EDGE_LENGTH;
+	uint index = GetWaterRegionIndex(tile);
+	_water_regions[index].patches_valid = false;
+	_water_regions[index].links_valid = false;
+	if (x > 0) _water_regions[index - 1].links_valid = false;
+	if (x < _water_regions_x - 1) _water_regions[index + 1].links_valid = false;
+	if (y > 0) _water_regions[index - _water_regions_x].links_valid = false;
+	if (y < _water_regions_y - 1) _water_regions[index + _water_regions_x].links_valid = false;
+}
@@ -0,0 +1,29 @@
+/* $Id$ */
+
+/** @file yapf_ship_regions.hpp Water regions, the coarse graph long ship paths are routed over. */
+
+#ifndef  YAPF_SHIP_REGIONS_HPP
+#define  YAPF_SHIP_REGIONS_HPP
+
+#include "../tile_type.h"
+
+/** Width and height of a water region, in tiles. */
+static const uint WATER_REGION_EDGE_LENGTH = 16;
+/** Maximum number of water regions a ship searches its path through at once. */
+static const uint SHIP_CORRIDOR_MAX_REGIONS = 6;
+
+/**
+ * The first water regions of the path of a ship to its destination.
+ * The tile level search of the ship stays within these regions.
+ */
+struct ShipRegionCorridor {
+	uint regions[SHIP_CORRIDOR_MAX_REGIONS]; ///< Indices of the regions, starting with the region of the ship
+	uint num_regions;                        ///< Number of regions in the corridor
+	TileIndex target_tile;                   ///< Tile to search the path to; the destination if it is in the corridor
+
+	bool Contains(TileIndex tile) const;
+};
+
+bool FindShipRegionCorridor(TileIndex tile, TileIndex dest_tile, ShipRegionCorridor *corridor);
+
+#endif /* YAPF_SHIP_REGIONS_HPP */